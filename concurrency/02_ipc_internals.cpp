@@ -58,12 +58,19 @@
 #include <chrono>
 #include <atomic>
 #include <cstring>
+#include <condition_variable>
+#include <queue>
+#include <string>
+#include <new>
 
 // POSIX IPC headers (for inter-process communication)
 #include <unistd.h>
 #include <sys/wait.h>
 #include <sys/mman.h>   // for shared memory
 #include <fcntl.h>
+#include <sched.h>      // for sched_yield()
+
+#include "../synchronization/hdr_histogram.h"
 
 using namespace std;
 
@@ -242,6 +249,171 @@ void demonstrate_shared_memory_ipc() {
 // ==================================================================
 // PART 3: PERFORMANCE COMPARISON
 // ==================================================================
+// An average hides the tail: one 5 ms scheduler hiccup in 10000 messages
+// barely moves the mean but is exactly what a caller notices. Each path
+// below records every single message into an HDR histogram
+// (../synchronization/hdr_histogram.h) and reports percentiles.
+
+const int IPC_MESSAGES = 20000;
+
+// A child process records into its own Histogram (it has its own copy of
+// memory), then ships it back to the parent in serialized form
+void send_histogram(int fd, const hdr::Histogram& h) {
+    string bytes = h.serialize();
+    uint64_t len = bytes.size();
+    write(fd, &len, sizeof(len));
+    write(fd, bytes.data(), bytes.size());
+}
+
+hdr::Histogram receive_histogram(int fd) {
+    uint64_t len = 0;
+    if(read(fd, &len, sizeof(len)) != sizeof(len)) {
+        return hdr::Histogram();
+    }
+    string bytes(len, '\0');
+    size_t got = 0;
+    while(got < len) {
+        ssize_t n = read(fd, &bytes[got], len - got);
+        if(n <= 0) break;
+        got += n;
+    }
+    return hdr::Histogram::deserialize(bytes);
+}
+
+// Thread -> thread: the producer_consumer handoff (mutex + condition
+// variable + queue). Latency = push until a consumer has popped it.
+void measure_thread_handoff() {
+    const int PRODUCERS = 2, CONSUMERS = 2;
+    mutex mtx;
+    condition_variable cv;
+    queue<uint64_t> data_queue;   // each item is its enqueue timestamp
+    bool finished_producing = false;
+    hdr::ConcurrentHistogram latency;
+
+    auto producer = [&]() {
+        for(int i = 0; i < IPC_MESSAGES / PRODUCERS; i++) {
+            {
+                lock_guard<mutex> lock(mtx);
+                data_queue.push(hdr::nowNs());
+            }
+            cv.notify_one();
+            // Give consumers a chance so we measure handoff, not backlog
+            this_thread::yield();
+        }
+    };
+    auto consumer = [&]() {
+        hdr::Recorder& mine = latency.recorder();   // per thread: no shared counter
+        while(true) {
+            unique_lock<mutex> lock(mtx);
+            cv.wait(lock, [&] { return !data_queue.empty() || finished_producing; });
+            if(data_queue.empty()) break;
+            uint64_t enqueued = data_queue.front();
+            data_queue.pop();
+            lock.unlock();
+            mine.record(hdr::nowNs() - enqueued);
+        }
+    };
+
+    vector<thread> producers, consumers;
+    for(int i = 0; i < CONSUMERS; i++) consumers.emplace_back(consumer);
+    for(int i = 0; i < PRODUCERS; i++) producers.emplace_back(producer);
+    for(auto& t : producers) t.join();
+    {
+        lock_guard<mutex> lock(mtx);
+        finished_producing = true;
+    }
+    cv.notify_all();
+    for(auto& t : consumers) t.join();
+
+    latency.snapshot().print(cout, "thread handoff (mutex+cv)");
+}
+
+// Process -> process over a pipe: parent writes a timestamp, child reads
+// it (one-way latency) and answers with one byte (round trip)
+void measure_pipe_latency() {
+    int to_child[2], to_parent[2], results[2];
+    if(pipe(to_child) == -1 || pipe(to_parent) == -1 || pipe(results) == -1) {
+        cerr << "Pipe creation failed!" << endl;
+        return;
+    }
+
+    pid_t pid = fork();
+    if(pid == 0) {
+        close(to_child[1]); close(to_parent[0]); close(results[0]);
+        hdr::Histogram one_way;
+        uint64_t sent;
+        char ack = 'k';
+        while(read(to_child[0], &sent, sizeof(sent)) == sizeof(sent)) {
+            one_way.record(hdr::nowNs() - sent);
+            write(to_parent[1], &ack, 1);
+        }
+        send_histogram(results[1], one_way);
+        exit(0);
+    }
+
+    close(to_child[0]); close(to_parent[1]); close(results[1]);
+    hdr::Histogram round_trip;
+    char ack;
+    for(int i = 0; i < IPC_MESSAGES; i++) {
+        uint64_t sent = hdr::nowNs();
+        write(to_child[1], &sent, sizeof(sent));
+        read(to_parent[0], &ack, 1);
+        round_trip.record(hdr::nowNs() - sent);
+    }
+    close(to_child[1]);   // child's read() returns 0: done
+    receive_histogram(results[0]).print(cout, "pipe one-way");
+    round_trip.print(cout, "pipe round trip");
+    close(to_parent[0]); close(results[0]);
+    wait(NULL);
+}
+
+// Process -> process over MAP_SHARED memory: no syscall per message, the
+// child polls a sequence number (yielding, so it also works on one CPU)
+struct ShmChannel {
+    atomic<uint64_t> seq;
+    atomic<uint64_t> sent_ns;
+    atomic<uint64_t> acked;
+};
+
+void measure_shared_memory_latency() {
+    ShmChannel* ch = (ShmChannel*)mmap(NULL, sizeof(ShmChannel),
+                                       PROT_READ | PROT_WRITE,
+                                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    int results[2];
+    if(ch == MAP_FAILED || pipe(results) == -1) {
+        cerr << "mmap/pipe failed!" << endl;
+        return;
+    }
+    new (ch) ShmChannel{{0}, {0}, {0}};
+
+    pid_t pid = fork();
+    if(pid == 0) {
+        close(results[0]);
+        hdr::Histogram one_way;
+        for(uint64_t expect = 1; expect <= (uint64_t)IPC_MESSAGES; expect++) {
+            while(ch->seq.load(memory_order_acquire) < expect) sched_yield();
+            one_way.record(hdr::nowNs() - ch->sent_ns.load(memory_order_relaxed));
+            ch->acked.store(expect, memory_order_release);
+        }
+        send_histogram(results[1], one_way);
+        exit(0);
+    }
+
+    close(results[1]);
+    hdr::Histogram round_trip;
+    for(uint64_t i = 1; i <= (uint64_t)IPC_MESSAGES; i++) {
+        uint64_t sent = hdr::nowNs();
+        ch->sent_ns.store(sent, memory_order_relaxed);
+        ch->seq.store(i, memory_order_release);
+        while(ch->acked.load(memory_order_acquire) < i) sched_yield();
+        round_trip.record(hdr::nowNs() - sent);
+    }
+    receive_histogram(results[0]).print(cout, "shared memory one-way");
+    round_trip.print(cout, "shared memory round trip");
+    close(results[0]);
+    wait(NULL);
+    munmap(ch, sizeof(ShmChannel));
+}
 
 void performance_comparison() {
     cout << "\n=== PERFORMANCE COMPARISON ===" << endl;
@@ -267,10 +439,15 @@ void performance_comparison() {
     cout << "1000 thread communications (atomic inc): " 
          << thread_time.count() << " μs" << endl;
     cout << "Average: " << thread_time.count() / 1000.0 << " μs per operation" << endl;
-    
-    // Pipe communication is much slower (~1000x)
-    cout << "\nPipe/Socket IPC: ~1-10 μs per message (system call overhead)" << endl;
-    cout << "Shared memory IPC: ~0.01-0.1 μs (after setup)" << endl;
+    cout << "(mostly thread creation - the handoff itself is measured below)" << endl;
+    
+    // Per-message latency distributions, all in μs
+    cout << "\nPer-message latency, " << IPC_MESSAGES << " messages each:" << endl;
+    measure_thread_handoff();
+    measure_pipe_latency();
+    measure_shared_memory_latency();
+    cout << "Pipe pays a syscall + copy + wakeup per message; shared memory pays" << endl;
+    cout << "none, but the reader must poll (or block on a futex) to notice." << endl;
 }
 
 int main() {
@@ -71,10 +71,14 @@
 #include <iostream>
 #include <thread>
 #include <vector>
+#include <atomic>
+#include <random>
 #include <pthread.h>
 #include <unistd.h>
 #include <sys/resource.h>
 
+#include "perf_counters.h"
+
 using namespace std;
 
 // Global variable - in DATA segment, SHARED by all threads
@@ -239,6 +243,83 @@ void show_actual_stack_usage() {
     cout << "Each recursion used ~100 bytes (local variables + return address)" << endl;
 }
 
+// The claims above, counted (perf_counters.h). Without a PMU (VMs,
+// containers) the cache/TLB columns are missing; wall time and the
+// software counters (page faults, context switches) still tell the story.
+struct alignas(64) PaddedCounter {
+    atomic<long> value{0};
+};
+
+void measure_the_claims() {
+    cout << "\n=== MEASURING THE CLAIMS (hardware/software counters) ===" << endl;
+    perfcount::Counters counters;
+
+    // "Each thread gets an 8MB stack": reserved, not allocated. Starting a
+    // thread faults in a handful of pages, not 2048. All alive at once, so
+    // glibc can't hand a joined thread's stack to the next one
+    const int THREADS = 100;
+    {
+        perfcount::Region r(counters, "100 live threads", THREADS);
+        vector<thread> live;
+        for(int i = 0; i < THREADS; i++) live.emplace_back([]() { volatile int x = 0; x++; });
+        for(auto& t : live) t.join();
+    }
+    // Stack pages are allocated when first touched: ~1 fault per 4KB used
+    {
+        const int KB = 1024;
+        perfcount::Region r(counters, "thread using 1MB stack", 1);
+        thread t([]() {
+            char frame[KB * 1024];
+            volatile char* touch = frame;
+            for(int off = 0; off < KB * 1024; off += 4096) touch[off] = 1;
+        });
+        t.join();
+    }
+
+    // "Heap is SHARED": two threads writing neighbouring counters share a
+    // cache line, which bounces between their cores (cache-misses);
+    // padding each counter to its own line removes that
+    const long INCREMENTS = 20000000;
+    auto hammer = [&](atomic<long>& a, atomic<long>& b, const string& name) {
+        perfcount::Region r(counters, name, 2 * INCREMENTS);
+        thread t1([&]() { for(long i = 0; i < INCREMENTS; i++) a.fetch_add(1, memory_order_relaxed); });
+        thread t2([&]() { for(long i = 0; i < INCREMENTS; i++) b.fetch_add(1, memory_order_relaxed); });
+        t1.join();
+        t2.join();
+    };
+    atomic<long> adjacent[2] = {{0}, {0}};
+    PaddedCounter padded[2];
+    hammer(adjacent[0], adjacent[1], "2 threads, 1 cache line");
+    hammer(padded[0].value, padded[1].value, "2 threads, padded");
+
+    // Shared heap, one address space: the TLB caches translations for a
+    // few MB only. Same number of random reads, small vs big buffer
+    const size_t SMALL = 1 << 20, BIG = 256 << 20, READS = 4000000;
+    vector<char> small(SMALL), big;
+    {
+        perfcount::Region r(counters, "first touch of 256MB", BIG / 4096);
+        big.resize(BIG);   // zero-filled: every page faults in once
+    }
+    auto random_reads = [&](const vector<char>& buf, const string& name) {
+        mt19937_64 rng(1);
+        long sum = 0;
+        perfcount::Region r(counters, name, READS);
+        for(size_t i = 0; i < READS; i++) sum += buf[rng() % buf.size()];
+        volatile long sink = sum;
+        (void)sink;
+    };
+    random_reads(small, "random reads, 1MB");
+    random_reads(big, "random reads, 256MB");
+
+    cout << "Per op (thread, 4KB page, increment or read):" << endl;
+    counters.report(cout, true);
+    cout << "Read it as: thread stacks cost a few faults each, not 8MB; a page is" << endl;
+    cout << "allocated on first touch (1 fault per 4KB); reads spread over 256MB" << endl;
+    cout << "miss the caches and the TLB (slower per read, dTLB-misses with a PMU)." << endl;
+    cout << "On one CPU the two counter threads never run at once, so false" << endl;
+    cout << "sharing only shows on a multi-core machine." << endl;
+}
+
 int main() {
     cout << "THREAD MEMORY LAYOUT - DEEP DIVE" << endl;
     cout << "===================================" << endl;
@@ -264,6 +345,9 @@ int main() {
     
     // Show actual stack usage
     show_actual_stack_usage();
+
+    // Count what the layout costs
+    measure_the_claims();
     
     cout << "\n=== SUMMARY: THREAD MEMORY MODEL ===" << endl;
     cout << "┌─────────────────────────────────────────────┐" << endl;
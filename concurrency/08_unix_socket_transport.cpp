@@ -0,0 +1,396 @@
+/**
+ * Part 2.2: Unix-Domain Socket Transport (SOCK_SEQPACKET + fd passing)
+ *
+ * 02_ipc_internals.cpp measures pipes and anonymous shared memory - both
+ * only reach a process that inherited them across fork(). Here the child
+ * does NOT use anything it inherited: it connect()s to a socket PATH, exactly
+ * what an independently started worker would do (see unix_transport.h).
+ *
+ * Build: make FILE=08_unix_socket_transport.cpp run
+ * Args:  ./program [small_messages] [big_messages]   (defaults: 200000, 20)
+ *
+ * Three comparisons against the pipe path of 02_ipc_internals.cpp:
+ *   1. Small (64 B) messages, one way, as fast as possible:
+ *        pipe write()/read() per message  vs  seqpacket sendmsg() per
+ *        message  vs  sendmmsg()/recvmmsg() in batches of 32
+ *      -> batching divides the SYSCALLS by 32, but every datagram is still
+ *         its own socket buffer (skb) allocated, queued and freed in the
+ *         kernel, so per-message cost drops far less than 32x. A pipe is a
+ *         plain byte ring: for tiny messages it stays cheaper per message;
+ *         what the socket buys is boundaries, a name, and fd passing.
+ *   2. Small message round trip (ping-pong), HDR percentiles:
+ *        pipe vs seqpacket - both one syscall each way; the socket does
+ *        a little more work per message (skb allocation)
+ *   3. 16MB messages, producer fills -> consumer checksums -> ack:
+ *        pipe: fill a buffer, write() it through the 64KB pipe, read()
+ *              it into another buffer: 2 copies, ~500 syscalls
+ *        memfd: fill the shared pages IN PLACE, pass the fd (SCM_RIGHTS),
+ *               consumer mmap()s the same pages: 0 copies, 2 syscalls
+ *        memfd (recycled): same, but the producer reuses one memfd instead
+ *               of allocating fresh (zeroed) pages for every message
+ *      -> a fresh 16MB memfd is 4096 page allocations + zeroing + faults on
+ *         both sides, which can cost MORE than the pipe's two copies;
+ *         recycled, only the consumer's mapping faults remain
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "unix_transport.h"
+#include "../synchronization/hdr_histogram.h"
+
+using namespace std;
+
+const size_t SMALL = 64;
+const size_t BIG = 16 * 1024 * 1024;
+const size_t BATCH = 32;
+
+double seconds_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Read exactly n bytes from a pipe (a byte stream: reads may come back short)
+bool read_full(int fd, void* buf, size_t n) {
+    char* p = (char*)buf;
+    while(n > 0) {
+        ssize_t got = read(fd, p, n);
+        if(got <= 0) return false;
+        p += got;
+        n -= got;
+    }
+    return true;
+}
+
+bool write_full(int fd, const void* buf, size_t n) {
+    const char* p = (const char*)buf;
+    while(n > 0) {
+        ssize_t put = write(fd, p, n);
+        if(put <= 0) return false;
+        p += put;
+        n -= put;
+    }
+    return true;
+}
+
+// Producer writes word i = seed + i; consumer sums; both sides agree on the
+// expected sum without sharing anything
+void fill_payload(char* data, size_t bytes, uint64_t seed) {
+    uint64_t* w = (uint64_t*)data;
+    for(size_t i = 0; i < bytes / 8; i++) w[i] = seed + i;
+}
+
+uint64_t checksum(const char* data, size_t bytes) {
+    const uint64_t* w = (const uint64_t*)data;
+    uint64_t sum = 0;
+    for(size_t i = 0; i < bytes / 8; i++) sum += w[i];
+    return sum;
+}
+
+uint64_t expected_checksum(size_t bytes, uint64_t seed) {
+    uint64_t n = bytes / 8;
+    return seed * n + n * (n - 1) / 2;
+}
+
+// The child connects by name - no inherited descriptors involved. Retries
+// briefly in case it runs before the parent reaches accept() (the listener
+// is bound before fork, so connect() would already queue; this is only for
+// a server started independently).
+ipc::Channel connect_retry(const string& path) {
+    for(int i = 0; i < 100; i++) {
+        ipc::Channel c = ipc::connectTo(path);
+        if(c.valid()) return c;
+        usleep(10000);
+    }
+    return ipc::Channel();
+}
+
+// Fork a child that runs body(channel) on a connection it made itself;
+// returns the parent's accepted end
+template <typename Body>
+ipc::Channel spawn_socket_child(ipc::Listener& listener, const string& path, Body body) {
+    pid_t pid = fork();
+    if(pid == 0) {
+        ipc::Channel ch = connect_retry(path);
+        if(!ch.valid()) {
+            perror("connect");
+            exit(1);
+        }
+        body(ch);
+        exit(0);
+    }
+    return listener.accept();
+}
+
+// ==================================================================
+// 1. SMALL MESSAGES, ONE WAY
+// ==================================================================
+
+void report_throughput(const string& name, size_t messages, double secs, double syscalls) {
+    cout << "  " << left << setw(34) << name << right << fixed << setprecision(0)
+         << setw(10) << messages / secs << " msg/s" << setprecision(1)
+         << setw(8) << secs * 1e9 / messages << " ns/msg" << setprecision(2)
+         << setw(8) << syscalls / messages << " syscalls/msg" << endl;
+}
+
+void small_pipe(size_t messages) {
+    int data[2], ack[2];
+    if(pipe(data) == -1 || pipe(ack) == -1) {
+        cerr << "Pipe creation failed!" << endl;
+        return;
+    }
+    pid_t pid = fork();
+    if(pid == 0) {
+        close(data[1]); close(ack[0]);
+        char msg[SMALL];
+        uint64_t got = 0;
+        while(read_full(data[0], msg, SMALL)) got++;
+        write(ack[1], &got, sizeof(got));
+        exit(0);
+    }
+    close(data[0]); close(ack[1]);
+    char msg[SMALL] = {};
+    auto start = chrono::steady_clock::now();
+    for(size_t i = 0; i < messages; i++) {
+        memcpy(msg, &i, sizeof(i));
+        write(data[1], msg, SMALL);
+    }
+    close(data[1]);
+    uint64_t got = 0;
+    read_full(ack[0], &got, sizeof(got));
+    double secs = seconds_since(start);
+    close(ack[0]);
+    wait(NULL);
+    // Lower bound: the reader may need more than one read() per message
+    report_throughput("pipe write/read", got, secs, 2.0 * got);
+}
+
+void small_socket(const string& path, size_t messages, size_t batch) {
+    ipc::Listener listener(path);
+    if(!listener.valid()) {
+        perror("listen");
+        return;
+    }
+    ipc::Channel ch = spawn_socket_child(listener, path, [&](ipc::Channel& c) {
+        ipc::RecvBatch in(batch, SMALL);
+        uint64_t got = 0, calls = 0;
+        int n;
+        while((n = c.recvBatch(in)) > 0) {
+            got += n;
+            calls++;
+        }
+        uint64_t result[2] = {got, calls};
+        c.send(result, sizeof(result));
+    });
+
+    vector<char> payload(batch * SMALL, 0);
+    vector<pair<const void*, size_t>> out(batch);
+    uint64_t sendCalls = 0;
+    auto start = chrono::steady_clock::now();
+    for(size_t i = 0; i < messages; i += batch) {
+        size_t n = min(batch, messages - i);
+        for(size_t k = 0; k < n; k++) {
+            uint64_t seq = i + k;
+            memcpy(&payload[k * SMALL], &seq, sizeof(seq));
+            out[k] = {&payload[k * SMALL], SMALL};
+        }
+        if(batch == 1) {
+            ch.send(out[0].first, SMALL);
+        } else {
+            out.resize(n);
+            ch.sendBatch(out);
+            out.resize(batch);
+        }
+        sendCalls++;   // sendmmsg may loop internally on a full buffer
+    }
+    shutdown(ch.fd(), SHUT_WR);   // child's recvBatch() returns 0
+    ipc::RecvBatch in(1);
+    uint64_t got = 0, recvCalls = 0;
+    if(ch.recvBatch(in) == 1 && in.length(0) == 2 * sizeof(uint64_t)) {
+        memcpy(&got, in.payload(0), sizeof(got));
+        memcpy(&recvCalls, in.payload(0) + sizeof(got), sizeof(recvCalls));
+    }
+    double secs = seconds_since(start);
+    wait(NULL);
+    string name = batch == 1 ? "seqpacket sendmsg/recvmsg"
+                             : "seqpacket sendmmsg/recvmmsg x" + to_string(batch);
+    report_throughput(name, got, secs, double(sendCalls + recvCalls));
+}
+
+// ==================================================================
+// 2. SMALL MESSAGE ROUND TRIP
+// ==================================================================
+
+const int PING_PONGS = 20000;
+
+void round_trip_pipe() {
+    int to_child[2], to_parent[2];
+    if(pipe(to_child) == -1 || pipe(to_parent) == -1) {
+        cerr << "Pipe creation failed!" << endl;
+        return;
+    }
+    pid_t pid = fork();
+    if(pid == 0) {
+        close(to_child[1]); close(to_parent[0]);
+        char msg[SMALL];
+        while(read_full(to_child[0], msg, SMALL)) write(to_parent[1], msg, SMALL);
+        exit(0);
+    }
+    close(to_child[0]); close(to_parent[1]);
+    hdr::Histogram rtt;
+    char msg[SMALL] = {};
+    for(int i = 0; i < PING_PONGS; i++) {
+        uint64_t sent = hdr::nowNs();
+        write(to_child[1], msg, SMALL);
+        read_full(to_parent[0], msg, SMALL);
+        rtt.record(hdr::nowNs() - sent);
+    }
+    close(to_child[1]);
+    close(to_parent[0]);
+    wait(NULL);
+    rtt.print(cout, "pipe round trip (64 B)");
+}
+
+void round_trip_socket(const string& path) {
+    ipc::Listener listener(path);
+    ipc::Channel ch = spawn_socket_child(listener, path, [](ipc::Channel& c) {
+        ipc::RecvBatch in(1, SMALL);
+        while(c.recvBatch(in) == 1) c.send(in.payload(0), in.length(0));
+    });
+    hdr::Histogram rtt;
+    ipc::RecvBatch in(1, SMALL);
+    char msg[SMALL] = {};
+    for(int i = 0; i < PING_PONGS; i++) {
+        uint64_t sent = hdr::nowNs();
+        ch.send(msg, SMALL);
+        ch.recvBatch(in);
+        rtt.record(hdr::nowNs() - sent);
+    }
+    ch.close();
+    wait(NULL);
+    rtt.print(cout, "seqpacket round trip (64 B)");
+}
+
+// ==================================================================
+// 3. 16MB MESSAGES
+// ==================================================================
+
+void report_big(const string& name, int messages, double secs, bool ok) {
+    cout << "  " << left << setw(34) << name << right << fixed << setprecision(2)
+         << setw(8) << secs * 1e3 / messages << " ms/msg" << setprecision(2)
+         << setw(8) << (double)BIG * messages / secs / 1e9 << " GB/s"
+         << (ok ? "   checksums ok" : "   CHECKSUM MISMATCH") << endl;
+}
+
+void big_pipe(int messages) {
+    int data[2], ack[2];
+    if(pipe(data) == -1 || pipe(ack) == -1) {
+        cerr << "Pipe creation failed!" << endl;
+        return;
+    }
+    pid_t pid = fork();
+    if(pid == 0) {
+        close(data[1]); close(ack[0]);
+        vector<char> buf(BIG);
+        while(read_full(data[0], buf.data(), BIG)) {
+            uint64_t sum = checksum(buf.data(), BIG);
+            write(ack[1], &sum, sizeof(sum));
+        }
+        exit(0);
+    }
+    close(data[0]); close(ack[1]);
+    vector<char> buf(BIG);
+    bool ok = true;
+    auto start = chrono::steady_clock::now();
+    for(int i = 0; i < messages; i++) {
+        fill_payload(buf.data(), BIG, i);
+        write_full(data[1], buf.data(), BIG);
+        uint64_t sum = 0;
+        read_full(ack[0], &sum, sizeof(sum));
+        ok &= sum == expected_checksum(BIG, i);
+    }
+    double secs = seconds_since(start);
+    close(data[1]); close(ack[0]);
+    wait(NULL);
+    report_big("pipe (copy in, copy out)", messages, secs, ok);
+}
+
+void big_memfd(const string& path, int messages, bool recycle) {
+    ipc::Listener listener(path);
+    ipc::Channel ch = spawn_socket_child(listener, path, [](ipc::Channel& c) {
+        ipc::RecvBatch in(1, sizeof(uint64_t));
+        while(c.recvBatch(in) == 1) {
+            ipc::SharedBlob blob = in.takeBlob(0);
+            uint64_t sum = blob.valid() ? checksum(blob.data(), blob.size()) : 0;
+            c.send(&sum, sizeof(sum));
+        }   // blob unmapped + fd closed here
+    });
+
+    ipc::RecvBatch in(1, sizeof(uint64_t));
+    ipc::SharedBlob reused;
+    bool ok = true;
+    auto start = chrono::steady_clock::now();
+    for(int i = 0; i < messages; i++) {
+        ipc::SharedBlob fresh;
+        if(!recycle || !reused.valid()) {
+            fresh = ipc::SharedBlob::create(BIG, "bench-payload");
+            if(!fresh.valid()) {
+                perror("memfd_create");
+                ok = false;
+                break;
+            }
+        }
+        ipc::SharedBlob& blob = recycle ? (reused.valid() ? reused : (reused = move(fresh))) : fresh;
+        fill_payload(blob.data(), BIG, i);   // written in place: no staging buffer
+        ch.sendBlob(blob);
+        // Wait for the ack before refilling: the consumer reads these pages
+        uint64_t sum = 0;
+        if(ch.recvBatch(in) == 1) memcpy(&sum, in.payload(0), sizeof(sum));
+        ok &= sum == expected_checksum(BIG, i);
+    }
+    double secs = seconds_since(start);
+    ch.close();
+    wait(NULL);
+    report_big(recycle ? "memfd + SCM_RIGHTS, recycled" : "memfd + SCM_RIGHTS, fresh each",
+               messages, secs, ok);
+}
+
+int main(int argc, char** argv) {
+    size_t small_messages = argc > 1 ? strtoull(argv[1], nullptr, 10) : 200000;
+    int big_messages = argc > 2 ? atoi(argv[2]) : 20;
+    string path = "/tmp/unix_transport_" + to_string(getpid()) + ".sock";
+
+    cout << "UNIX-DOMAIN SOCKET TRANSPORT vs PIPE" << endl;
+    cout << "====================================" << endl;
+    cout << "socket path: " << path << " (child connects by name)" << endl;
+
+    cout << "\n1. " << small_messages << " x " << SMALL << " B messages, one way:" << endl;
+    small_pipe(small_messages);
+    small_socket(path, small_messages, 1);
+    small_socket(path, small_messages, BATCH);
+
+    cout << "\n2. Round trip, " << PING_PONGS << " x " << SMALL << " B (μs):" << endl;
+    round_trip_pipe();
+    round_trip_socket(path);
+
+    cout << "\n3. " << big_messages << " x " << BIG / (1024 * 1024)
+         << " MB messages (producer fill + consumer checksum + ack):" << endl;
+    big_pipe(big_messages);
+    big_memfd(path, big_messages, false);
+    big_memfd(path, big_messages, true);
+
+    cout << "\n=== KEY TAKEAWAYS ===" << endl;
+    cout << "1. A socket path reaches any process; a pipe only reaches fork relatives." << endl;
+    cout << "2. SOCK_SEQPACKET keeps message boundaries: no framing reassembly." << endl;
+    cout << "3. sendmmsg/recvmmsg amortize syscalls; each datagram still costs an skb." << endl;
+    cout << "4. Big payloads: pass the fd (SCM_RIGHTS), not the bytes - no copies." << endl;
+    cout << "5. Fresh memfd pages must be allocated and zeroed; recycle buffers." << endl;
+    return 0;
+}
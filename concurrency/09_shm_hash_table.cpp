@@ -0,0 +1,262 @@
+/**
+ * Part 2.3: Cross-Process Shared-Memory Hash Table
+ *
+ * Several processes share one session table (shm_hash_table.h): each
+ * process attaches BY NAME (shm_open), readers never lock, writers lock a
+ * stripe with a robust mutex, and a writer killed mid-update is repaired by
+ * whoever touches its stripe next.
+ *
+ * Build: make FILE=09_shm_hash_table.cpp CXXFLAGS="-std=c++17 -O2 -Wall -Wextra -pthread" run
+ * Args:  ./program [processes] [seconds] [capacity] [huge_pages 0|1]
+ *        (defaults: 4, 1, 1048576, 0)
+ *
+ * Phases:
+ *   1. populate: the parent inserts capacity/2 sessions (upserts/s)
+ *   2. lookups: N reader processes, 90% hits, for `seconds`:
+ *        seqlock find()   vs   findLocked() (same probe under the stripe mutex)
+ *      then the same with one writer process updating sessions meanwhile
+ *      Every value carries a self-check (flags == ~tokens, userId == key):
+ *      "torn" counts reads that saw half an update - must be 0.
+ *   3. crash recovery: a writer process is SIGKILLed at a random moment,
+ *      20 times. Lock-free readers sweep all keys (a reader that finds a
+ *      bucket stuck mid-write repairs the stripe), then verify() checks
+ *      every stripe. "repairs" = times a lock's owner was found dead.
+ *
+ * Expected:
+ *   - read-only: seqlock and mutex lookups are both fast when uncontended
+ *     on one CPU, but the mutex version writes the lock's cache line on
+ *     every lookup: with readers on several cores that line ping-pongs,
+ *     while seqlock readers only read
+ *   - with a writer: mutex readers queue behind it; seqlock readers retry
+ *     only the one bucket being written
+ *   - crash: no process hangs, verify() passes, torn reads stay 0
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <csignal>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "shm_hash_table.h"
+
+using namespace std;
+
+struct Session {
+    uint64_t userId;
+    uint64_t expiresNs;
+    uint32_t tokens;
+    uint32_t flags;   // always ~tokens: lets readers detect a torn copy
+};
+
+using Table = shm::SharedHashTable<Session>;
+
+struct Stats {
+    uint64_t ops = 0, hits = 0, torn = 0;
+};
+
+string table_name;
+size_t table_capacity;
+Table::Options table_options;
+
+uint64_t key_of(uint64_t i) { return i * 0x9E3779B97F4A7C15ull + 1; }
+
+Session make_session(uint64_t key, uint32_t tokens) {
+    return Session{key, 0, tokens, ~tokens};
+}
+
+double now_seconds() {
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Every worker attaches by name itself - it could just as well be a
+// separately started program
+unique_ptr<Table> attach_or_die() {
+    string why;
+    auto t = Table::open(table_name, table_capacity, table_options, &why);
+    if(!t) {
+        cerr << "attach failed: " << why << endl;
+        _exit(1);
+    }
+    return t;
+}
+
+Stats reader(size_t keys, double seconds, bool locked, unsigned seed) {
+    auto t = attach_or_die();
+    mt19937_64 rng(seed);
+    Stats st;
+    Session s;
+    double end = now_seconds() + seconds;
+    while(true) {
+        for(int i = 0; i < 1024; i++) {
+            // 90% of lookups for keys that exist
+            uint64_t k = rng() % 10 == 0 ? key_of(keys + rng() % keys) : key_of(rng() % keys);
+            bool hit = locked ? t->findLocked(k, s) : t->find(k, s);
+            if(hit) {
+                st.hits++;
+                st.torn += s.userId != k || s.flags != ~s.tokens;
+            }
+        }
+        st.ops += 1024;
+        if(now_seconds() >= end) break;
+    }
+    return st;
+}
+
+Stats writer(size_t keys, double seconds, unsigned seed) {
+    auto t = attach_or_die();
+    mt19937_64 rng(seed);
+    Stats st;
+    double end = now_seconds() + seconds;
+    while(true) {
+        for(int i = 0; i < 256; i++) {
+            uint64_t k = key_of(rng() % keys);
+            t->upsert(k, make_session(k, (uint32_t)rng()));
+        }
+        st.ops += 256;
+        if(now_seconds() >= end) break;
+    }
+    return st;
+}
+
+// Fork a worker; its Stats come back over a pipe
+template <typename Body>
+pair<pid_t, int> spawn(Body body) {
+    int fds[2];
+    if(pipe(fds) == -1) {
+        perror("pipe");
+        exit(1);
+    }
+    pid_t pid = fork();
+    if(pid == 0) {
+        close(fds[0]);
+        Stats st = body();
+        write(fds[1], &st, sizeof(st));
+        _exit(0);
+    }
+    close(fds[1]);
+    return {pid, fds[0]};
+}
+
+Stats collect(pair<pid_t, int> worker) {
+    Stats st;
+    read(worker.second, &st, sizeof(st));
+    close(worker.second);
+    waitpid(worker.first, nullptr, 0);
+    return st;
+}
+
+void lookup_phase(const string& label, int processes, size_t keys, double seconds, bool locked, bool withWriter) {
+    vector<pair<pid_t, int>> readers;
+    for(int p = 0; p < processes; p++)
+        readers.push_back(spawn([=]() { return reader(keys, seconds, locked, 100 + p); }));
+    pair<pid_t, int> w{-1, -1};
+    if(withWriter) w = spawn([=]() { return writer(keys, seconds, 7); });
+
+    Stats total;
+    for(auto& r : readers) {
+        Stats st = collect(r);
+        total.ops += st.ops;
+        total.hits += st.hits;
+        total.torn += st.torn;
+    }
+    cout << "  " << left << setw(34) << label << right << fixed << setprecision(1)
+         << setw(8) << total.ops / seconds / 1e6 << " M lookups/s" << setprecision(0)
+         << setw(5) << 100.0 * total.hits / max<uint64_t>(1, total.ops) << "% hits"
+         << "  torn " << total.torn;
+    if(withWriter) {
+        Stats ws = collect(w);
+        cout << setprecision(2) << "  | writer " << ws.ops / seconds / 1e6 << " M updates/s";
+    }
+    cout << endl;
+}
+
+void crash_phase(Table& t, size_t keys, int rounds) {
+    uint64_t before = t.recoveries();
+    mt19937 rng(42);
+    int failures = 0;
+    uint64_t torn = 0, missing = 0;
+    double worstSweep = 0;
+    for(int r = 0; r < rounds; r++) {
+        pid_t pid = fork();
+        if(pid == 0) {
+            auto mine = attach_or_die();
+            mt19937_64 wr(r);
+            while(true) {   // churn: insert, update, erase extra keys
+                uint64_t k = key_of(keys + wr() % keys);
+                if(wr() & 1) mine->upsert(k, make_session(k, (uint32_t)wr()));
+                else mine->erase(k);
+                uint64_t e = key_of(wr() % keys);
+                mine->upsert(e, make_session(e, (uint32_t)wr()));
+            }
+        }
+        usleep(2000 + rng() % 8000);
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+
+        // Readers first: none may hang on a bucket the dead writer left odd
+        double start = now_seconds();
+        Session s;
+        for(size_t i = 0; i < keys; i++) {
+            uint64_t k = key_of(i);
+            if(!t.find(k, s)) missing++;
+            else torn += s.userId != k || s.flags != ~s.tokens;
+        }
+        worstSweep = max(worstSweep, now_seconds() - start);
+        string why;
+        if(!t.verify(&why)) {
+            failures++;
+            cout << "  round " << r << ": " << why << endl;
+        }
+    }
+    cout << "  " << rounds << " writers killed mid-run: " << t.recoveries() - before
+         << " repairs of a dead owner's stripe, verify failures " << failures
+         << ", missing keys " << missing << ", torn " << torn << endl;
+    cout << "  slowest full read sweep after a kill: " << fixed << setprecision(1)
+         << worstSweep * 1e3 << " ms (no hang)" << endl;
+}
+
+int main(int argc, char** argv) {
+    int processes = argc > 1 ? atoi(argv[1]) : 4;
+    double seconds = argc > 2 ? atof(argv[2]) : 1.0;
+    table_capacity = argc > 3 ? strtoull(argv[3], nullptr, 10) : (1 << 20);
+    table_options.hugePages = argc > 4 && atoi(argv[4]) != 0;
+    table_name = "/shm_hash_table_" + to_string(getpid());
+
+    cout << "CROSS-PROCESS SHARED-MEMORY HASH TABLE" << endl;
+    cout << "======================================" << endl;
+
+    string why;
+    auto table = Table::open(table_name, table_capacity, table_options, &why);
+    if(!table) {
+        cerr << "open failed: " << why << endl;
+        return 1;
+    }
+    size_t keys = table->capacity() / 2;
+    cout << "segment " << table_name << ": " << table->capacity() << " buckets, "
+         << table->pageMode() << ", " << processes << " reader processes" << endl;
+
+    cout << "\n1. Populate" << endl;
+    double start = now_seconds();
+    for(size_t i = 0; i < keys; i++) table->upsert(key_of(i), make_session(key_of(i), (uint32_t)i));
+    double secs = now_seconds() - start;
+    cout << "  " << keys << " sessions in " << fixed << setprecision(0) << secs * 1e3 << " ms ("
+         << setprecision(1) << keys / secs / 1e6 << " M upserts/s), size() = " << table->size() << endl;
+
+    cout << "\n2. Lookups, " << processes << " processes x " << seconds << " s" << endl;
+    lookup_phase("seqlock find()", processes, keys, seconds, false, false);
+    lookup_phase("mutex findLocked()", processes, keys, seconds, true, false);
+    lookup_phase("seqlock find() + 1 writer", processes, keys, seconds, false, true);
+    lookup_phase("mutex findLocked() + 1 writer", processes, keys, seconds, true, true);
+
+    cout << "\n3. Crash recovery" << endl;
+    crash_phase(*table, keys, 20);
+
+    Table::unlink(table_name);
+    return 0;
+}
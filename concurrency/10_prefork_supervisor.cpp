@@ -0,0 +1,184 @@
+/**
+ * Part 2.4: Prefork Worker Supervisor
+ *
+ * A supervisor process keeps N workers alive (prefork_supervisor.h), hands
+ * them jobs through a shared-memory queue, and replaces crashed workers.
+ * Every worker needs a "model" that is expensive to build (init_mb of
+ * tables, like a config/ML model/template cache a real server loads).
+ * Some jobs crash the worker that runs them (a real SIGSEGV); the job is
+ * re-queued and succeeds on its retry.
+ *
+ * Build: make FILE=10_prefork_supervisor.cpp CXXFLAGS="-std=c++17 -O2 -Wall -Wextra -pthread" run
+ * Args:  ./program [workers] [seconds] [crash_every] [init_mb] [huge_pages 0|1]
+ *        (defaults: 4, 1, 2000, 64, 1) - crash_every N: 1 job in N segfaults
+ *
+ * Runs:
+ *   1. zygote + pidfd, no crashes                -> baseline jobs/s
+ *   2. zygote + pidfd, with crashes               -> recovery time, jobs/s
+ *   3. zygote + SIGCHLD, with crashes             -> other detection path
+ *   4. zygote + crash handler notice + pidfd      -> detect before teardown
+ *   5. cold fork + crash handler notice + pidfd   -> every replacement re-runs init
+ *
+ * Recovery is measured from the crash (the worker stamps the shared clock
+ * just before faulting) to "detected" (supervisor reaped it) and to
+ * "serving" (the replacement's first instruction in its job loop).
+ *
+ * Expected (1 CPU, 4 workers, 64MB model):
+ *   - pidfd and SIGCHLD detect at the same moment: when the kernel has
+ *     finished tearing the dead process down. With the model on 4KB pages
+ *     that alone is ~10ms here (16k page table entries to walk while 3
+ *     other workers compete for the CPU); on huge pages ~0.3ms
+ *   - the crash handler notice detects in ~0.1ms regardless
+ *   - zygote: crash -> serving p50 under 1ms on huge pages (one fork of an
+ *     already-initialized process); cold fork: the full init, ~0.6s
+ *   - jobs/s with crashes close to the baseline for the zygote, a fraction
+ *     of it for cold fork; lost jobs = 0 everywhere
+ *   - p99 is scheduling noise on a single CPU: the supervisor, the zygote
+ *     and the replacement all queue behind the busy workers
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <sys/resource.h>
+#include <sys/mman.h>
+
+#include "prefork_supervisor.h"
+
+using namespace std;
+
+enum JobKind : uint32_t { WORK = 0, POISON = 1 };
+
+size_t model_mb = 64;
+bool use_huge_pages = true;
+uint32_t* model;           // built by init() in whichever process serves
+size_t model_size;
+volatile uint64_t sink;
+
+// The expensive startup: a few passes of dependent math over init_mb.
+// Backed by transparent huge pages where the kernel allows it: forking a
+// process (zygote -> worker) copies its page tables, and tearing a dead
+// one down walks them - 2MB pages make both 512x smaller.
+void build_model() {
+    size_t bytes = model_mb * 1024 * 1024;
+    void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(mem == MAP_FAILED) {
+        perror("mmap");
+        _exit(1);
+    }
+    if(use_huge_pages) madvise(mem, bytes, MADV_HUGEPAGE);
+    model = (uint32_t*)mem;
+    model_size = bytes / sizeof(uint32_t);
+    uint32_t x = 2463534242u;
+    for(size_t i = 0; i < model_size; i++) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        model[i] = x;
+    }
+    for(int pass = 0; pass < 3; pass++)
+        for(size_t i = 1; i < model_size; i++) model[i] ^= model[i - 1] * 2654435761u;
+}
+
+void handle(const prefork::Job& job) {
+    if(job.kind == POISON && job.attempts == 0) {
+        prefork::markCrashing();
+        *(volatile int*)nullptr = 1;   // a real crash: SIGSEGV
+    }
+    // ~a few microseconds of lookups into the model
+    uint64_t h = job.arg;
+    for(int i = 0; i < 64; i++) h = h * 31 + model[(h ^ i) % model_size];
+    sink = h;
+}
+
+double percentile(vector<double> v, double p) {
+    if(v.empty()) return 0;
+    sort(v.begin(), v.end());
+    return v[min(v.size() - 1, (size_t)(p * v.size()))];
+}
+
+void run(const string& label, prefork::Supervisor::Options opt, double seconds, uint64_t crash_every) {
+    prefork::Supervisor sup(opt, build_model, handle);
+    string why;
+    uint64_t t0 = prefork::nowNs();
+    if(!sup.start(&why)) {
+        cerr << "start failed: " << why << endl;
+        exit(1);
+    }
+
+    uint64_t submitted = 0, poisoned = 0;
+    uint64_t start = prefork::nowNs();
+    uint64_t end = start + (uint64_t)(seconds * 1e9);
+    while(prefork::nowNs() < end) {
+        while(true) {
+            prefork::Job job{submitted, WORK, 0, submitted * 0x9E3779B97F4A7C15ull};
+            if(crash_every && submitted % crash_every == crash_every - 1) job.kind = POISON;
+            if(!sup.submit(job)) break;
+            poisoned += job.kind == POISON;
+            submitted++;
+        }
+        sup.poll(1);
+    }
+    sup.drain();
+    double elapsed = (prefork::nowNs() - start) / 1e9;
+    uint64_t done = sup.completed();
+    sup.stop();
+
+    vector<double> detect, respawn, ready;
+    int never = 0;
+    for(auto& r : sup.recoveries()) {
+        detect.push_back((r.detectNs - r.crashNs) / 1e3);
+        if(r.readyNs) {
+            respawn.push_back((r.readyNs - r.detectNs) / 1e3);
+            ready.push_back((r.readyNs - r.crashNs) / 1e3);
+        } else {
+            never++;
+        }
+    }
+
+    cout << "\n" << label << "  (" << sup.spawnName() << ", " << sup.detectName() << ")" << endl;
+    cout << fixed << setprecision(0);
+    cout << "  startup (init + " << opt.workers << " workers):  " << (start - t0) / 1e6 << " ms" << endl;
+    cout << "  jobs: " << submitted << " submitted, " << done << " completed, "
+         << sup.requeued() << " re-queued after a crash, lost " << (long long)(submitted - done) << endl;
+    cout << "  throughput: " << setprecision(0) << done / elapsed << " jobs/s" << endl;
+    if(!detect.empty()) {
+        cout << "  crashes: " << detect.size() << " (" << poisoned << " poison jobs)" << endl;
+        cout << setprecision(1);
+        cout << "  crash -> detected:   p50 " << setw(8) << percentile(detect, 0.5) << " us   p99 "
+             << setw(8) << percentile(detect, 0.99) << " us" << endl;
+        cout << "  detected -> serving: p50 " << setw(8) << percentile(respawn, 0.5) << " us   p99 "
+             << setw(8) << percentile(respawn, 0.99) << " us" << endl;
+        cout << "  crash -> serving:    p50 " << setw(8) << percentile(ready, 0.5) << " us   p99 "
+             << setw(8) << percentile(ready, 0.99) << " us   max " << percentile(ready, 1.0) << " us";
+        if(never) cout << "   (" << never << " replacements crashed before serving)";
+        cout << endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    int workers = argc > 1 ? atoi(argv[1]) : 4;
+    double seconds = argc > 2 ? atof(argv[2]) : 1.0;
+    uint64_t crash_every = argc > 3 ? strtoull(argv[3], nullptr, 10) : 2000;
+    model_mb = argc > 4 ? strtoull(argv[4], nullptr, 10) : 64;
+    use_huge_pages = argc > 5 ? atoi(argv[5]) != 0 : true;
+
+    // Crashes are expected: don't spend time writing core dumps
+    rlimit nocore{0, 0};
+    setrlimit(RLIMIT_CORE, &nocore);
+
+    cout << "PREFORK WORKER SUPERVISOR" << endl;
+    cout << "=========================" << endl;
+    cout << workers << " workers, " << seconds << " s per run, 1 job in " << crash_every
+         << " segfaults its worker, " << model_mb << " MB model per worker on "
+         << (use_huge_pages ? "huge" : "4KB") << " pages" << endl;
+
+    using S = prefork::Supervisor;
+    run("1. baseline, no crashes", {workers, S::Spawn::ZYGOTE, S::Detect::PIDFD}, seconds, 0);
+    run("2. crashes, zygote respawn", {workers, S::Spawn::ZYGOTE, S::Detect::PIDFD}, seconds, crash_every);
+    run("3. crashes, zygote respawn", {workers, S::Spawn::ZYGOTE, S::Detect::SIGNALFD}, seconds, crash_every);
+    run("4. crashes, zygote respawn", {workers, S::Spawn::ZYGOTE, S::Detect::PIDFD, true}, seconds, crash_every);
+    run("5. crashes, cold respawn", {workers, S::Spawn::COLD, S::Detect::PIDFD, true}, seconds, crash_every);
+    return 0;
+}
@@ -0,0 +1,266 @@
+/**
+ * fork_cost.h
+ * Measure what fork() really costs a process with a big heap.
+ *
+ * 01_process_vs_thread.cpp times fork() of a tiny process. Snapshotting
+ * (Redis BGSAVE, fork-and-dump checkpoints) forks a process with GBs of
+ * heap and keeps the child alive while the parent goes on writing. That
+ * costs in three places:
+ *
+ *   1. fork() itself: the parent is stopped while the kernel copies the
+ *      page tables (8 bytes per 4KB page: 2MB per GB of heap; with huge
+ *      pages 8 bytes per 2MB) and write-protects every private page
+ *   2. copy-on-write: every page the parent writes while the child lives
+ *      takes a minor fault and a page copy (memory use grows by the copies)
+ *   3. teardown: the child's exit walks and frees its page tables again
+ *
+ * Region is an anonymous mapping with a chosen backing and fork advice:
+ *   Pages::SMALL  4KB pages
+ *   Pages::HUGE   MADV_HUGEPAGE (transparent huge pages, if enabled)
+ *   Advice::DONTFORK    MADV_DONTFORK: the child doesn't get the mapping at all
+ *   Advice::WIPEONFORK  MADV_WIPEONFORK: the child gets zero-filled memory
+ *                       (no page tables copied, no COW)
+ * Region::usage() reads the mapping's line in /proc/self/smaps: Shared vs
+ * Private shows how much is still shared with a child, AnonHugePages how
+ * much is really on huge pages.
+ *
+ * Usage:
+ *   forkcost::Region heap(8ull << 30, forkcost::Pages::HUGE);
+ *   heap.populate();
+ *   auto f = forkcost::measureFork(9);             // fork(), child exit, reap
+ *   auto c = forkcost::measureCow(heap, 0.1, true); // 10% random page writes during a snapshot
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+namespace forkcost {
+
+enum class Pages { SMALL, HUGE };
+enum class Advice { NONE, DONTFORK, WIPEONFORK };
+
+const size_t SMALL_PAGE = 4096;
+const size_t HUGE_PAGE = 2 << 20;
+
+inline double nowUs() {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Minor/major faults of this process so far (same counters as fields 10/12
+// of /proc/self/stat)
+struct Faults {
+    long minor;
+    long major;
+};
+
+inline Faults faults() {
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return Faults{ru.ru_minflt, ru.ru_majflt};
+}
+
+// Size of this process's page tables (VmPTE in /proc/self/status)
+inline long pageTablesKb() {
+    std::ifstream in("/proc/self/status");
+    std::string line;
+    while(std::getline(in, line))
+        if(line.compare(0, 6, "VmPTE:") == 0) return std::stol(line.substr(6));
+    return -1;
+}
+
+// One mapping's counters from /proc/self/smaps, in KB
+struct Usage {
+    long rss = 0;
+    long shared = 0;      // Shared_Clean + Shared_Dirty: still shared with a fork child
+    long privateKb = 0;   // Private_Clean + Private_Dirty: this process's own copies
+    long anonHuge = 0;    // AnonHugePages
+};
+
+class Region {
+public:
+    Region(size_t bytes, Pages pages = Pages::SMALL, Advice advice = Advice::NONE)
+        : bytes(bytes), pages(pages), advice(advice) {
+        // Reserve PROT_NONE around the region: it is 2MB aligned for huge
+        // pages, and it cannot merge with a neighbouring mapping, so its
+        // smaps entry counts only this region
+        reserved = bytes + 2 * HUGE_PAGE;
+        void* r = mmap(nullptr, reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(r == MAP_FAILED) {
+            error = std::string("mmap: ") + strerror(errno);
+            return;
+        }
+        reserve = (char*)r;
+        uintptr_t start = ((uintptr_t)reserve + HUGE_PAGE) & ~(uintptr_t)(HUGE_PAGE - 1);
+        void* m = mmap((void*)start, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+        if(m == MAP_FAILED) {
+            error = std::string("mmap: ") + strerror(errno);
+            return;
+        }
+        base = (char*)m;
+        if(pages == Pages::HUGE && madvise(base, bytes, MADV_HUGEPAGE) == -1)
+            error = std::string("MADV_HUGEPAGE: ") + strerror(errno);
+        int adv = advice == Advice::DONTFORK ? MADV_DONTFORK : advice == Advice::WIPEONFORK ? MADV_WIPEONFORK : 0;
+        if(adv && madvise(base, bytes, adv) == -1)
+            error = std::string(advice == Advice::DONTFORK ? "MADV_DONTFORK: " : "MADV_WIPEONFORK: ") + strerror(errno);
+    }
+
+    ~Region() {
+        if(reserve) munmap(reserve, reserved);
+    }
+
+    Region(const Region&) = delete;
+    Region& operator=(const Region&) = delete;
+
+    bool ok() const { return error.empty(); }
+    const std::string& why() const { return error; }
+    char* data() { return base; }
+    size_t size() const { return bytes; }
+    Pages backing() const { return pages; }
+    Advice forkAdvice() const { return advice; }
+
+    // Fault every page in (a heap that is actually in use)
+    void populate() {
+        for(size_t off = 0; off < bytes; off += SMALL_PAGE) base[off] = (char)off;
+    }
+
+    Usage usage() const {
+        Usage u;
+        std::ifstream in("/proc/self/smaps");
+        std::string line;
+        bool mine = false;
+        while(std::getline(in, line)) {
+            // Mapping header: "start-end perms offset dev inode [path]"
+            size_t dash = line.find('-');
+            if(dash != std::string::npos && dash < 17 && line.find(' ') > dash &&
+               isxdigit((unsigned char)line[0])) {
+                mine = std::stoull(line.substr(0, dash), nullptr, 16) == (uintptr_t)base;
+                continue;
+            }
+            if(!mine) continue;
+            std::istringstream fields(line);
+            std::string key;
+            long kb = 0;
+            fields >> key >> kb;
+            if(key == "Rss:") u.rss = kb;
+            else if(key == "Shared_Clean:" || key == "Shared_Dirty:") u.shared += kb;
+            else if(key == "Private_Clean:" || key == "Private_Dirty:") u.privateKb += kb;
+            else if(key == "AnonHugePages:") u.anonHuge = kb;
+        }
+        return u;
+    }
+
+private:
+    size_t bytes;
+    Pages pages;
+    Advice advice;
+    char* reserve = nullptr;
+    size_t reserved = 0;
+    char* base = nullptr;
+    std::string error;
+};
+
+struct ForkStats {
+    double forkUs;      // parent blocked in fork(): page table copy + write-protect
+    double childUs;     // fork() call -> child running
+    double reapUs;      // child _exit() -> waitpid() returns: its teardown
+};
+
+inline double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    return v.empty() ? 0 : v[v.size() / 2];
+}
+
+// Median over `reps` forks of this process as it is right now
+inline ForkStats measureFork(int reps) {
+    std::vector<double> forkUs, childUs, reapUs;
+    double* stamps = (double*)mmap(nullptr, SMALL_PAGE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    for(int i = 0; i < reps; i++) {
+        double t0 = nowUs();
+        pid_t pid = fork();
+        if(pid == 0) {
+            stamps[0] = nowUs();
+            stamps[1] = nowUs();   // last thing before exit
+            _exit(0);
+        }
+        double t1 = nowUs();
+        waitpid(pid, nullptr, 0);
+        double t2 = nowUs();
+        forkUs.push_back(t1 - t0);
+        childUs.push_back(stamps[0] - t0);
+        reapUs.push_back(t2 - stamps[1]);
+    }
+    munmap(stamps, SMALL_PAGE);
+    return ForkStats{median(forkUs), median(childUs), median(reapUs)};
+}
+
+struct CowStats {
+    size_t pagesWritten;
+    long faults;             // minor faults in the parent while a child was alive
+    double writeMs;          // the same writes...
+    long baselineFaults;     // ...with no child
+    double baselineMs;
+    Usage during;            // region counters while the child was still alive
+};
+
+// Fork a "snapshot" child that just holds the memory, then write one byte
+// into `fraction` of the region's 4KB pages (random order or from the
+// start), then repeat the writes with no child as the baseline
+inline CowStats measureCow(Region& region, double fraction, bool random) {
+    size_t total = region.size() / SMALL_PAGE;
+    std::vector<size_t> order(total);
+    for(size_t i = 0; i < total; i++) order[i] = i;
+    if(random) std::shuffle(order.begin(), order.end(), std::mt19937_64(42));
+    order.resize((size_t)(total * fraction));
+
+    auto writeAll = [&](char value) {
+        char* base = region.data();
+        Faults f0 = faults();
+        double t0 = nowUs();
+        for(size_t p : order) base[p * SMALL_PAGE + 64] = value;
+        double ms = (nowUs() - t0) / 1000;
+        return std::make_pair(faults().minor - f0.minor, ms);
+    };
+
+    int hold[2];
+    if(pipe(hold) == -1) return CowStats{};
+    pid_t pid = fork();
+    if(pid == 0) {
+        close(hold[1]);
+        char c;
+        ssize_t ignored = read(hold[0], &c, 1);   // "snapshot in progress" until the parent closes
+        (void)ignored;
+        _exit(0);
+    }
+    close(hold[0]);
+
+    CowStats st{};
+    st.pagesWritten = order.size();
+    auto withChild = writeAll(1);
+    st.faults = withChild.first;
+    st.writeMs = withChild.second;
+    st.during = region.usage();
+    close(hold[1]);
+    waitpid(pid, nullptr, 0);
+
+    auto alone = writeAll(2);
+    st.baselineFaults = alone.first;
+    st.baselineMs = alone.second;
+    return st;
+}
+
+}  // namespace forkcost
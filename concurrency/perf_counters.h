@@ -0,0 +1,351 @@
+/**
+ * perf_counters.h
+ * Hardware and software event counts for benchmark regions.
+ *
+ * The benchmarks here time with a clock, which says how long something
+ * took but not why. The reasons claimed in the README (cache lines bouncing
+ * between cores, TLB reach, page faults on first touch, context switches)
+ * are all counted by the kernel's perf events. Counters opens them once with
+ * perf_event_open(); a Region reads them on entry and exit and adds the
+ * difference to a per-name row; report() prints the rows.
+ *
+ *   Event              perf event                      fallback
+ *   CYCLES             HW_CPU_CYCLES                   -
+ *   INSTRUCTIONS       HW_INSTRUCTIONS                 -
+ *   CACHE_MISSES       HW_CACHE_MISSES (LLC)           -
+ *   DTLB_MISSES        HW_CACHE dTLB read misses       -
+ *   CONTEXT_SWITCHES   SW_CONTEXT_SWITCHES             getrusage nvcsw + nivcsw
+ *   PAGE_FAULTS        SW_PAGE_FAULTS                  getrusage minflt + majflt
+ *   CPU_CLOCK          SW_TASK_CLOCK                   CLOCK_*_CPUTIME_ID
+ *
+ * Degrading: VMs and containers often have no PMU (hardware events fail with
+ * ENOENT) or forbid perf_event_open altogether (seccomp, perf_event_paranoid
+ * 3). Each event falls back on its own: hardware events are left out of the
+ * report with the reason, software events come from getrusage/clock_gettime
+ * instead. When only user-space counting is allowed (paranoid 2, not root)
+ * hardware events count user space only; context switches then come from
+ * getrusage, since the user-only perf count of them is always 0.
+ * PERF_COUNTERS=off in the environment forces the fallback everywhere.
+ *
+ * Scope::PROCESS (default) counts the calling thread and every thread or
+ * child it creates afterwards (perf inherit; getrusage SELF + CHILDREN), so
+ * a region around "start N threads, join them" counts their work. A child's
+ * counts are added when it exits (fallback: when it is reaped): end the
+ * region after the join/waitpid.
+ * Scope::THREAD counts the calling thread only.
+ *
+ * Hardware counters are few; with more events than counters the kernel
+ * multiplexes them and each region's delta is scaled by its own time
+ * enabled / time running (estimates, flagged with '~' in the report).
+ *
+ * Usage:
+ *   perfcount::Counters counters;
+ *   {
+ *       perfcount::Region r(counters, "padded counters", iterations);
+ *       run();
+ *   }
+ *   counters.report(std::cout, true);   // true: per op (iterations)
+ */
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string>
+#include <ostream>
+#include <iomanip>
+#include <sstream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <linux/perf_event.h>
+
+namespace perfcount {
+
+enum class Event { CYCLES, INSTRUCTIONS, CACHE_MISSES, DTLB_MISSES, CONTEXT_SWITCHES, PAGE_FAULTS, CPU_CLOCK };
+const size_t EVENTS = 7;
+
+// The first four need a PMU
+inline bool isHardware(Event e) { return (size_t)e < 4; }
+
+enum class Source { HARDWARE, SOFTWARE, FALLBACK, NONE };
+enum class Scope { PROCESS, THREAD };
+
+inline const char* eventName(Event e) {
+    static const char* names[EVENTS] = {"cycles", "instructions", "cache-misses", "dTLB-misses",
+                                        "ctx-switches", "page-faults", "cpu-ms"};
+    return names[(size_t)e];
+}
+
+inline const char* sourceName(Source s) {
+    switch(s) {
+    case Source::HARDWARE: return "hardware";
+    case Source::SOFTWARE: return "perf software";
+    case Source::FALLBACK: return "getrusage/clock";
+    default:               return "unavailable";
+    }
+}
+
+inline uint64_t nowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// One reading of every event; CPU_CLOCK in ns
+struct Values {
+    std::array<double, EVENTS> v{};
+    std::array<double, EVENTS> enabled{}, running{};   // perf times, ns; 0 for fallbacks
+    bool scaled = false;          // some hardware value was multiplexed
+
+    double& operator[](Event e) { return v[(size_t)e]; }
+    double operator[](Event e) const { return v[(size_t)e]; }
+
+    // What happened between `start` and this reading. A multiplexed event is
+    // scaled by the share of THIS interval it was on a counter: scaling each
+    // reading by its lifetime ratio first would mix in the history before start
+    Values since(const Values& start) const {
+        Values delta;
+        for(size_t i = 0; i < EVENTS; i++) {
+            delta.v[i] = v[i] - start.v[i];
+            delta.enabled[i] = enabled[i] - start.enabled[i];
+            delta.running[i] = running[i] - start.running[i];
+            if(delta.running[i] > 0 && delta.running[i] < delta.enabled[i]) {
+                delta.v[i] = delta.v[i] * delta.enabled[i] / delta.running[i];
+                delta.scaled = true;
+            }
+        }
+        return delta;
+    }
+};
+
+class Counters {
+public:
+    explicit Counters(Scope scope = Scope::PROCESS) : scope(scope) {
+        fds.fill(-1);
+        sources.fill(Source::NONE);
+        const char* env = getenv("PERF_COUNTERS");
+        bool perf = !(env && std::string(env) == "off");
+        for(size_t i = 0; i < EVENTS; i++) {
+            Event e = (Event)i;
+            bool userOnly = false;
+            if(perf) fds[i] = open(e, userOnly);
+            if(fds[i] != -1 && e == Event::CONTEXT_SWITCHES && userOnly) {
+                ::close(fds[i]);   // switches happen in the kernel: user-only counts 0
+                fds[i] = -1;
+            }
+            if(fds[i] != -1) {
+                sources[i] = isHardware(e) ? Source::HARDWARE : Source::SOFTWARE;
+                if(userOnly) notes[i] = "user space only";
+            } else if(!isHardware(e)) {
+                sources[i] = Source::FALLBACK;
+            } else {
+                notes[i] = perf ? std::string("perf_event_open: ") + strerror(openErrno) : "PERF_COUNTERS=off";
+            }
+        }
+    }
+
+    ~Counters() {
+        for(int fd : fds) if(fd != -1) ::close(fd);
+    }
+
+    Counters(const Counters&) = delete;
+    Counters& operator=(const Counters&) = delete;
+
+    Source source(Event e) const { return sources[(size_t)e]; }
+    bool available(Event e) const { return sources[(size_t)e] != Source::NONE; }
+
+    // Raw totals since the counters were opened (fallbacks: since process
+    // start); multiplexed events are unscaled - take Values::since() of two
+    Values read() const {
+        Values out;
+        bool needRusage = false;
+        for(size_t i = 0; i < EVENTS; i++) needRusage |= sources[i] == Source::FALLBACK;
+        // PROCESS: this process's threads + its reaped children
+        rusage self{}, children{};
+        if(needRusage) {
+            getrusage(scope == Scope::PROCESS ? RUSAGE_SELF : RUSAGE_THREAD, &self);
+            if(scope == Scope::PROCESS) getrusage(RUSAGE_CHILDREN, &children);
+        }
+        for(size_t i = 0; i < EVENTS; i++) {
+            if(fds[i] != -1) {
+                uint64_t r[3] = {0, 0, 0};   // value, time enabled, time running
+                if(::read(fds[i], r, sizeof(r)) != sizeof(r)) continue;
+                out.v[i] = (double)r[0];
+                out.enabled[i] = (double)r[1];
+                out.running[i] = (double)r[2];
+            } else if(sources[i] == Source::FALLBACK) {
+                switch((Event)i) {
+                case Event::CONTEXT_SWITCHES:
+                    out.v[i] = (double)(self.ru_nvcsw + self.ru_nivcsw + children.ru_nvcsw + children.ru_nivcsw);
+                    break;
+                case Event::PAGE_FAULTS:
+                    out.v[i] = (double)(self.ru_minflt + self.ru_majflt + children.ru_minflt + children.ru_majflt);
+                    break;
+                case Event::CPU_CLOCK: {
+                    timespec ts;
+                    clock_gettime(scope == Scope::PROCESS ? CLOCK_PROCESS_CPUTIME_ID : CLOCK_THREAD_CPUTIME_ID, &ts);
+                    out.v[i] = ts.tv_sec * 1e9 + ts.tv_nsec + microseconds(children.ru_utime) * 1e3 +
+                               microseconds(children.ru_stime) * 1e3;
+                    break;
+                }
+                default: break;
+                }
+            }
+        }
+        return out;
+    }
+
+    // One row of the report: everything measured under one region name
+    struct Row {
+        std::string name;
+        size_t calls = 0;
+        double ops = 0;           // what the caller said a region did, summed
+        double wallNs = 0;
+        Values total;
+    };
+
+    void add(const std::string& name, double ops, double wallNs, const Values& delta) {
+        Row* row = nullptr;
+        for(auto& r : rows) if(r.name == name) row = &r;
+        if(!row) {
+            rows.push_back(Row());
+            row = &rows.back();
+            row->name = name;
+        }
+        row->calls++;
+        row->ops += ops;
+        row->wallNs += wallNs;
+        for(size_t i = 0; i < EVENTS; i++) row->total.v[i] += delta.v[i];
+        row->total.scaled |= delta.scaled;
+    }
+
+    const std::vector<Row>& regions() const { return rows; }
+    const Row* region(const std::string& name) const {
+        for(auto& r : rows) if(r.name == name) return &r;
+        return nullptr;
+    }
+    void clear() { rows.clear(); }
+
+    // Where each event comes from, one line
+    void describe(std::ostream& out) const {
+        out << "counters (" << (scope == Scope::PROCESS ? "process + children" : "this thread") << "):";
+        for(size_t i = 0; i < EVENTS; i++) {
+            out << " " << eventName((Event)i) << "=" << sourceName(sources[i]);
+            if(!notes[i].empty() && sources[i] != Source::NONE) out << " (" << notes[i] << ")";
+        }
+        out << std::endl;
+        std::string why;
+        for(size_t i = 0; i < EVENTS; i++)
+            if(sources[i] == Source::NONE && why.empty()) why = notes[i];
+        if(!why.empty()) out << "  hardware events unavailable: " << why << std::endl;
+    }
+
+    // A table of every region; perOp divides by the region's ops (or calls
+    // when it has none). Columns for unavailable events are left out.
+    void report(std::ostream& out, bool perOp = false) const {
+        describe(out);
+        bool ipc = available(Event::CYCLES) && available(Event::INSTRUCTIONS);
+        out << "  " << std::left << std::setw(26) << "region" << std::right << std::setw(7) << "calls"
+            << std::setw(12) << (perOp ? "wall us/op" : "wall ms");
+        for(size_t i = 0; i < EVENTS; i++) {
+            if(sources[i] == Source::NONE) continue;
+            std::string head = (Event)i == Event::CPU_CLOCK && perOp ? "cpu us" : eventName((Event)i);
+            out << std::setw(14) << head;
+        }
+        if(ipc) out << std::setw(7) << "IPC";
+        out << std::endl;
+        for(auto& r : rows) {
+            double div = perOp ? (r.ops > 0 ? r.ops : (double)r.calls) : 1;
+            out << "  " << std::left << std::setw(26) << r.name.substr(0, 25) << std::right << std::setw(7) << r.calls
+                << std::setw(12);
+            if(perOp) out << std::defaultfloat << std::setprecision(3) << r.wallNs / 1e3 / div;
+            else out << std::fixed << std::setprecision(2) << r.wallNs / 1e6;
+            for(size_t i = 0; i < EVENTS; i++) {
+                if(sources[i] == Source::NONE) continue;
+                double v = r.total.v[i] / div;
+                if((Event)i == Event::CPU_CLOCK) v /= perOp ? 1e3 : 1e6;
+                std::ostringstream cell;
+                cell << (r.total.scaled && isHardware((Event)i) ? "~" : "");
+                if(perOp) cell << std::defaultfloat << std::setprecision(3) << v;   // 0.000412 .. 255
+                else cell << std::fixed << std::setprecision((Event)i == Event::CPU_CLOCK ? 2 : 0) << v;
+                out << std::setw(14) << cell.str();
+            }
+            if(ipc) {
+                double cycles = r.total[Event::CYCLES];
+                out << std::setprecision(2) << std::setw(7) << (cycles > 0 ? r.total[Event::INSTRUCTIONS] / cycles : 0);
+            }
+            out << std::endl;
+        }
+    }
+
+private:
+    Scope scope;
+    std::array<int, EVENTS> fds;
+    std::array<Source, EVENTS> sources;
+    std::array<std::string, EVENTS> notes;
+    int openErrno = 0;
+    std::vector<Row> rows;
+
+    static double microseconds(const timeval& tv) { return tv.tv_sec * 1e6 + tv.tv_usec; }
+
+    int open(Event e, bool& userOnly) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.inherit = scope == Scope::PROCESS;
+        attr.exclude_hv = 1;
+        switch(e) {
+        case Event::CYCLES:           attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+        case Event::INSTRUCTIONS:     attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+        case Event::CACHE_MISSES:     attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+        case Event::DTLB_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case Event::CONTEXT_SWITCHES: attr.type = PERF_TYPE_SOFTWARE; attr.config = PERF_COUNT_SW_CONTEXT_SWITCHES; break;
+        case Event::PAGE_FAULTS:      attr.type = PERF_TYPE_SOFTWARE; attr.config = PERF_COUNT_SW_PAGE_FAULTS; break;
+        case Event::CPU_CLOCK:        attr.type = PERF_TYPE_SOFTWARE; attr.config = PERF_COUNT_SW_TASK_CLOCK; break;
+        }
+        // pid 0, any CPU: this task (and, with inherit, its later children)
+        int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        if(fd == -1 && (errno == EACCES || errno == EPERM)) {
+            attr.exclude_kernel = 1;
+            fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+            userOnly = fd != -1;
+        }
+        if(fd == -1 && isHardware(e) && openErrno == 0) openErrno = errno;
+        return fd;
+    }
+};
+
+// Counts between construction and destruction, added to `name`'s row
+class Region {
+public:
+    Region(Counters& counters, std::string name, double ops = 0)
+        : counters(counters), name(std::move(name)), ops(ops), start(counters.read()), startNs(nowNs()) {}
+
+    ~Region() {
+        uint64_t endNs = nowNs();
+        counters.add(name, ops, (double)(endNs - startNs), counters.read().since(start));
+    }
+
+    Region(const Region&) = delete;
+    Region& operator=(const Region&) = delete;
+
+private:
+    Counters& counters;
+    std::string name;
+    double ops;
+    Values start;
+    uint64_t startNs;
+};
+
+}  // namespace perfcount
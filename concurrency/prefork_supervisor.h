@@ -0,0 +1,651 @@
+/**
+ * prefork_supervisor.h
+ * A supervisor that keeps N worker PROCESSES alive and feeds them jobs.
+ *
+ * 01/07/process_exp fork a few children and wait() for them. A server
+ * worker fleet (nginx, gunicorn, php-fpm) needs more: jobs handed out
+ * through shared memory, a crash noticed immediately, the crashed worker's
+ * job not lost, and a replacement running before the queue backs up.
+ *
+ * JOB QUEUE (MAP_SHARED memory, inherited by every process):
+ *   a ring of slots, each with one atomic word = ticket | owner | state
+ *     EMPTY/READY --take: ONE CAS READY -> TAKEN(owner)--> TAKEN
+ *     TAKEN --finish--> DONE --supervisor recycles--> reused for ticket + N
+ *   The claim and the owner are written by the same CAS, so there is no
+ *   instant at which a worker holds a job nobody can attribute to it: when
+ *   worker w dies, every slot TAKEN by w is re-queued (Job::attempts + 1).
+ *   Only the supervisor pushes. Idle workers sleep on a futex in the
+ *   shared page (FUTEX_WAIT works across processes on MAP_SHARED memory).
+ *
+ * CRASH DETECTION (Options::detect):
+ *   PIDFD    - pidfd_open() per worker in one epoll set; readable on exit
+ *   SIGNALFD - signalfd for SIGCHLD in the same epoll, then waitpid(WNOHANG)
+ *   (PIDFD falls back to SIGNALFD on kernels without pidfd_open, < 5.3)
+ *   Both only fire once the kernel has torn the process down, and freeing
+ *   a big address space takes milliseconds. Options::crashNotice adds a
+ *   fatal-signal handler in each worker that bumps a shared eventfd and
+ *   lets the signal kill it: the supervisor re-queues the job and starts
+ *   the replacement WHILE the old process is still being torn down, and
+ *   reaps it later.
+ *
+ * RESPAWN (Options::spawn):
+ *   COLD   - fork() the supervisor; the child runs init() then serves
+ *   ZYGOTE - a "zygote" process runs init() ONCE at start and then only
+ *            forks: a replacement starts with the initialized state already
+ *            in memory (copy-on-write). Android starts apps this way.
+ *            The zygote forks with clone(CLONE_PARENT): the new worker is
+ *            the SUPERVISOR's child, so waitpid()/SIGCHLD work as with a
+ *            direct fork and no pid is ever reaped by someone else.
+ *
+ * Usage:
+ *   prefork::Supervisor sup(opt, [] { load_model(); }, [](const prefork::Job& j) { serve(j); });
+ *   sup.start(&why);
+ *   while(running) { while(sup.submit(next_job())) {} sup.poll(1); }
+ *   sup.drain();  sup.stop();
+ *   for(auto& r : sup.recoveries()) ...   // crash -> detected -> ready
+ */
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <string>
+#include <functional>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <csignal>
+#include <ctime>
+#include <climits>
+#include <unistd.h>
+#include <sched.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+namespace prefork {
+
+inline uint64_t nowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);   // one clock for all processes
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+struct Job {
+    uint64_t id;
+    uint32_t kind;
+    uint32_t attempts;   // 0 on first delivery, +1 each time a worker died holding it
+    uint64_t arg;
+};
+
+class JobQueue {
+public:
+    static constexpr uint64_t CAPACITY = 4096;
+    static constexpr uint64_t MAX_OWNER = (1 << 14) - 1;
+
+    // Supervisor only. False when every slot is still in use.
+    bool push(const Job& job) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if(t - recycled == CAPACITY) return false;
+        Slot& s = slots[t % CAPACITY];
+        s.job = job;
+        s.word.store(pack(t, 0, READY), std::memory_order_release);
+        tail.store(t + 1, std::memory_order_seq_cst);
+        published.fetch_add(1, std::memory_order_seq_cst);
+        if(sleepers.load(std::memory_order_seq_cst) > 0)
+            syscall(SYS_futex, &published, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+        return true;
+    }
+
+    // Worker: claim the oldest READY job. False if there is none.
+    bool take(uint64_t owner, Job& out, uint64_t& ticket) {
+        while(true) {
+            uint64_t h = head.load(std::memory_order_acquire);
+            if(h == tail.load(std::memory_order_acquire)) return false;
+            Slot& s = slots[h % CAPACITY];
+            uint64_t w = s.word.load(std::memory_order_acquire);
+            if(ticketOf(w) != h) continue;                // head moved under us
+            if(stateOf(w) != READY) {                     // someone took it: help advance
+                head.compare_exchange_weak(h, h + 1, std::memory_order_acq_rel);
+                continue;
+            }
+            if(s.word.compare_exchange_strong(w, pack(h, owner, TAKEN), std::memory_order_acq_rel)) {
+                out = s.job;   // the supervisor leaves a TAKEN slot alone
+                ticket = h;
+                head.compare_exchange_strong(h, h + 1, std::memory_order_acq_rel);
+                return true;
+            }
+        }
+    }
+
+    void finish(uint64_t owner, uint64_t ticket) {
+        slots[ticket % CAPACITY].word.store(pack(ticket, owner, DONE), std::memory_order_release);
+    }
+
+    // Worker: sleep until something is pushed (or timeoutMs passes)
+    void waitForWork(int timeoutMs) {
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        uint32_t seen = published.load(std::memory_order_seq_cst);
+        if(head.load(std::memory_order_seq_cst) == tail.load(std::memory_order_seq_cst)) {
+            timespec ts{timeoutMs / 1000, (long)(timeoutMs % 1000) * 1000000};
+            syscall(SYS_futex, &published, FUTEX_WAIT, seen, &ts, nullptr, 0);
+        }
+        sleepers.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    void wakeAll() {
+        published.fetch_add(1, std::memory_order_seq_cst);
+        syscall(SYS_futex, &published, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+    // Supervisor: free the DONE slots at the front of the ring, in order
+    void recycle() {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        while(recycled < t && stateOf(slots[recycled % CAPACITY].word.load(std::memory_order_acquire)) == DONE)
+            recycled++;
+    }
+
+    // Supervisor: owner is dead; hand each job it held to requeue()
+    template <typename F>
+    void reclaim(uint64_t owner, F requeue) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        for(uint64_t i = recycled; i < t; i++) {
+            Slot& s = slots[i % CAPACITY];
+            uint64_t w = s.word.load(std::memory_order_acquire);
+            if(stateOf(w) == TAKEN && ownerOf(w) == owner) {
+                Job job = s.job;
+                s.word.store(pack(i, owner, DONE), std::memory_order_release);
+                job.attempts++;
+                requeue(job);
+            }
+        }
+    }
+
+    // Supervisor: every pushed job finished (or re-queued)
+    bool idle() {
+        recycle();
+        return recycled == tail.load(std::memory_order_relaxed);
+    }
+
+private:
+    enum : uint64_t { READY = 1, TAKEN = 2, DONE = 3 };
+    // [ticket: 48][owner: 14][state: 2]
+    static uint64_t pack(uint64_t ticket, uint64_t owner, uint64_t state) { return ticket << 16 | owner << 2 | state; }
+    static uint64_t ticketOf(uint64_t w) { return w >> 16; }
+    static uint64_t ownerOf(uint64_t w) { return (w >> 2) & MAX_OWNER; }
+    static uint64_t stateOf(uint64_t w) { return w & 3; }
+
+    struct Slot {
+        std::atomic<uint64_t> word;
+        Job job;
+    };
+
+    alignas(64) std::atomic<uint64_t> head{0};        // next ticket to take (workers)
+    alignas(64) std::atomic<uint64_t> tail{0};        // next ticket to push (supervisor)
+    uint64_t recycled = 0;                            // supervisor only
+    alignas(64) std::atomic<uint32_t> published{0};   // futex word
+    std::atomic<uint32_t> sleepers{0};
+    alignas(64) Slot slots[CAPACITY];
+};
+
+struct alignas(64) WorkerSlot {
+    std::atomic<int> pid{0};
+    std::atomic<uint64_t> readyNs{0};   // stamped by the worker when it starts serving
+    std::atomic<uint64_t> crashNs{0};   // stamped by markCrashing() or the crash handler
+    std::atomic<uint32_t> dying{0};     // crash handler ran, process is on its way out
+    std::atomic<uint64_t> jobs{0};
+};
+
+const int MAX_WORKERS = 64;
+
+// Everything the processes share: one anonymous MAP_SHARED mapping
+struct Shared {
+    JobQueue queue;
+    WorkerSlot workers[MAX_WORKERS];
+    std::atomic<uint64_t> completed{0};
+    std::atomic<bool> stopping{false};
+    int noticeFd = -1;                  // eventfd, bumped by the crash handler
+};
+
+// Set in each worker process
+inline Shared* currentShared = nullptr;
+inline int currentWorker = -1;
+
+// Call from a job handler right before it is about to fail hard, so the
+// supervisor can measure crash -> replacement. Harmless anywhere else.
+inline void markCrashing() {
+    if(currentShared && currentWorker >= 0) currentShared->workers[currentWorker].crashNs.store(nowNs());
+}
+
+// Fatal-signal handler (Options::crashNotice). Only async-signal-safe
+// calls. SA_RESETHAND has restored the default action, so re-raising the
+// signal kills the process as it would have died anyway - also when the
+// signal came from kill()/raise() and there is no fault to re-execute.
+// The supervisor just hears about it first.
+inline void crashNoticeHandler(int sig) {
+    WorkerSlot& me = currentShared->workers[currentWorker];
+    uint64_t none = 0;
+    me.crashNs.compare_exchange_strong(none, nowNs());
+    me.dying.store(1);
+    uint64_t one = 1;
+    ssize_t ignored = write(currentShared->noticeFd, &one, sizeof(one));
+    (void)ignored;
+    raise(sig);
+}
+
+struct Recovery {
+    int worker;
+    int signal;          // what killed it (0: exited)
+    uint64_t crashNs;    // markCrashing() time, or detectNs if it wasn't called
+    uint64_t detectNs;   // supervisor reaped it
+    uint64_t readyNs;    // replacement started serving
+};
+
+class Supervisor {
+public:
+    enum class Spawn { COLD, ZYGOTE };
+    enum class Detect { PIDFD, SIGNALFD };
+
+    struct Options {
+        int workers = 4;
+        Spawn spawn = Spawn::ZYGOTE;
+        Detect detect = Detect::PIDFD;
+        bool crashNotice = false;   // hear about SIGSEGV/SIGBUS/... before the exit
+    };
+
+    using Init = std::function<void()>;
+    using Handler = std::function<void(const Job&)>;
+
+    Supervisor(Options opt, Init init, Handler handler)
+        : opt(opt), init(std::move(init)), handler(std::move(handler)) {}
+
+    ~Supervisor() { stop(); }
+
+    bool start(std::string* error) {
+        // Undo whatever was set up so far: stop() copes with a partial start
+        auto fail = [&](const char* what) {
+            if(error) *error = std::string(what) + ": " + strerror(errno);
+            stop();
+            return false;
+        };
+        if(opt.workers < 1 || opt.workers > MAX_WORKERS) {
+            errno = EINVAL;
+            return fail("workers");
+        }
+        void* mem = mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if(mem == MAP_FAILED) return fail("mmap");
+        shared = new(mem) Shared();
+
+        if((epfd = epoll_create1(EPOLL_CLOEXEC)) == -1) return fail("epoll_create1");
+        if(opt.detect == Detect::PIDFD) {
+            int probe = (int)syscall(SYS_pidfd_open, getpid(), 0);
+            if(probe == -1) opt.detect = Detect::SIGNALFD;   // pre-5.3 kernel
+            else close(probe);
+        }
+        if(opt.detect == Detect::SIGNALFD) {
+            sigset_t set;
+            sigemptyset(&set);
+            sigaddset(&set, SIGCHLD);
+            sigprocmask(SIG_BLOCK, &set, &savedMask);
+            maskBlocked = true;
+            if((sigfd = signalfd(-1, &set, SFD_CLOEXEC | SFD_NONBLOCK)) == -1) return fail("signalfd");
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.u64 = SIGNAL_TAG;
+            epoll_ctl(epfd, EPOLL_CTL_ADD, sigfd, &ev);
+        }
+        if(opt.crashNotice) {
+            if((shared->noticeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) == -1) return fail("eventfd");
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.u64 = NOTICE_TAG;
+            epoll_ctl(epfd, EPOLL_CTL_ADD, shared->noticeFd, &ev);
+        }
+        if(opt.spawn == Spawn::ZYGOTE && !startZygote()) return fail("zygote");
+
+        workers.assign(opt.workers, Worker());
+        for(int w = 0; w < opt.workers; w++)
+            if(!spawn(w)) return fail("spawn");
+        // Return once the whole fleet is serving (a cold worker runs init first)
+        for(int w = 0; w < opt.workers; w++)
+            while(shared->workers[w].readyNs.load() == 0) poll(1);
+        return true;
+    }
+
+    // False when the queue is full (call poll() and retry)
+    bool submit(const Job& job) {
+        while(!retry.empty()) {
+            if(!shared->queue.push(retry.front())) return false;
+            retry.pop_front();
+        }
+        return shared->queue.push(job);
+    }
+
+    // Reap and replace dead workers, free finished slots. Blocks up to
+    // timeoutMs if nothing happens.
+    void poll(int timeoutMs) {
+        epoll_event events[16];
+        int n = epoll_wait(epfd, events, 16, timeoutMs);
+        for(int i = 0; i < n; i++) {
+            uint64_t tag = events[i].data.u64;
+            if(tag == SIGNAL_TAG) {
+                signalfd_siginfo si;
+                while(read(sigfd, &si, sizeof(si)) == sizeof(si)) {}
+                int status;
+                pid_t pid;
+                while((pid = waitpid(-1, &status, WNOHANG)) > 0) onExit(pid, status);
+            } else if(tag == NOTICE_TAG) {
+                uint64_t count;
+                while(read(shared->noticeFd, &count, sizeof(count)) == sizeof(count)) {}
+                for(int w = 0; w < (int)workers.size(); w++)
+                    if(workers[w].pid > 0 && shared->workers[w].dying.load()) onNotice(w);
+            } else {
+                int status = 0;
+                pid_t pid = (pid_t)tag;
+                if(waitpid(pid, &status, 0) == pid) onExit(pid, status);
+            }
+        }
+        respawnUnstaffed();
+        shared->queue.recycle();
+        while(!retry.empty() && shared->queue.push(retry.front())) retry.pop_front();
+    }
+
+    // Wait until every submitted job has been handled
+    void drain() {
+        while(!retry.empty() || !shared->queue.idle()) poll(1);
+    }
+
+    void stop() {
+        if(!shared) return;
+        shared->stopping.store(true);
+        shared->queue.wakeAll();
+        for(auto& w : workers) {
+            if(w.pid <= 0) continue;
+            unwatch(w.pidfd);
+            waitpid(w.pid, nullptr, 0);
+            w.pid = 0;
+        }
+        for(auto& d : dying) {
+            unwatch(d.pidfd);
+            waitpid(d.pid, nullptr, 0);
+        }
+        dying.clear();
+        unstaffed.clear();
+        stopZygote();
+        if(sigfd != -1) {
+            close(sigfd);
+            sigfd = -1;
+        }
+        if(maskBlocked) {
+            sigprocmask(SIG_SETMASK, &savedMask, nullptr);
+            maskBlocked = false;
+        }
+        if(shared->noticeFd != -1) close(shared->noticeFd);
+        if(epfd != -1) {
+            close(epfd);
+            epfd = -1;
+        }
+        finalizeRecoveries();
+        completedJobs = shared->completed.load();
+        shared->~Shared();
+        munmap(shared, sizeof(Shared));
+        shared = nullptr;
+    }
+
+    const std::vector<Recovery>& recoveries() {
+        finalizeRecoveries();
+        return history;
+    }
+
+    uint64_t completed() const { return shared ? shared->completed.load() : completedJobs; }
+    uint64_t requeued() const { return requeuedJobs; }
+    const char* spawnName() const { return opt.spawn == Spawn::ZYGOTE ? "zygote" : "cold fork"; }
+    const char* detectName() const {
+        if(opt.crashNotice) return opt.detect == Detect::PIDFD ? "crash handler + pidfd" : "crash handler + SIGCHLD";
+        return opt.detect == Detect::PIDFD ? "pidfd" : "SIGCHLD";
+    }
+
+private:
+    static constexpr uint64_t SIGNAL_TAG = ~0ull;
+    static constexpr uint64_t NOTICE_TAG = ~1ull;
+    // pidfds are tagged with their pid
+
+    struct Worker {
+        pid_t pid = 0;
+        int pidfd = -1;
+        long pending = -1;   // history[] entry waiting for this worker's readyNs
+    };
+
+    // Replaced already (crash notice), not reaped yet
+    struct Dying {
+        pid_t pid;
+        int pidfd;
+        size_t entry;        // history[] entry to complete with the signal
+    };
+
+    Options opt;
+    Init init;
+    Handler handler;
+    Shared* shared = nullptr;
+    std::vector<Worker> workers;
+    std::vector<Dying> dying;
+    std::vector<Recovery> history;
+    std::deque<Job> retry;   // re-queued jobs that didn't fit yet
+    std::vector<int> unstaffed;   // dead workers not replaced yet
+    uint64_t requeuedJobs = 0, completedJobs = 0;
+    int epfd = -1, sigfd = -1;
+    sigset_t savedMask;
+    bool maskBlocked = false;
+    pid_t zygotePid = 0;
+    int zygoteSock = -1, zygotePidfd = -1;
+
+    [[noreturn]] void serve(int w) {
+        currentShared = shared;
+        currentWorker = w;
+        WorkerSlot& me = shared->workers[w];
+        if(shared->noticeFd != -1) {
+            struct sigaction sa{};
+            sa.sa_handler = crashNoticeHandler;
+            sa.sa_flags = SA_RESETHAND;
+            for(int sig : {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT}) sigaction(sig, &sa, nullptr);
+        }
+        me.readyNs.store(nowNs());
+        Job job;
+        uint64_t ticket;
+        while(true) {
+            if(shared->queue.take(w, job, ticket)) {
+                handler(job);
+                shared->queue.finish(w, ticket);
+                me.jobs.fetch_add(1, std::memory_order_relaxed);
+                shared->completed.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if(shared->stopping.load()) _exit(0);
+            shared->queue.waitForWork(100);
+        }
+    }
+
+    // Raw clone(CLONE_PARENT): fork() semantics, but the child's parent is
+    // OUR parent (the supervisor)
+    static pid_t forkSibling() {
+        return (pid_t)syscall(SYS_clone, CLONE_PARENT | SIGCHLD, nullptr, nullptr, nullptr, 0);
+    }
+
+    bool startZygote() {
+        int sv[2];
+        if(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == -1) return false;
+        pid_t pid = fork();
+        if(pid == -1) {
+            close(sv[0]);
+            close(sv[1]);
+            return false;
+        }
+        if(pid == 0) {
+            close(sv[0]);
+            init();   // the expensive part, paid once
+            int w;
+            while(recv(sv[1], &w, sizeof(w), 0) == sizeof(w)) {
+                pid_t child = forkSibling();
+                if(child == 0) {
+                    close(sv[1]);
+                    serve(w);
+                }
+                send(sv[1], &child, sizeof(child), MSG_NOSIGNAL);
+            }
+            _exit(0);
+        }
+        close(sv[1]);
+        zygotePid = pid;
+        zygoteSock = sv[0];
+        zygotePidfd = watch(pid);
+        return true;
+    }
+
+    void stopZygote() {
+        if(zygotePid <= 0) return;
+        unwatch(zygotePidfd);
+        close(zygoteSock);   // zygote's recv() returns 0 -> it exits
+        zygoteSock = -1;
+        waitpid(zygotePid, nullptr, 0);
+        zygotePid = 0;
+    }
+
+    // The zygote stopped answering (it died, and poll() has not reaped it
+    // yet, or a previous restart failed): reap it here, start a fresh one
+    bool restartZygote() {
+        if(zygotePid > 0) {
+            unwatch(zygotePidfd);
+            close(zygoteSock);
+            kill(zygotePid, SIGKILL);   // one that cannot talk is replaced either way
+            waitpid(zygotePid, nullptr, 0);
+        }
+        zygotePid = 0;
+        zygoteSock = -1;
+        return startZygote();
+    }
+
+    bool askZygote(int w, pid_t& pid) {
+        return send(zygoteSock, &w, sizeof(w), MSG_NOSIGNAL) == sizeof(w) &&
+               recv(zygoteSock, &pid, sizeof(pid), 0) == sizeof(pid);
+    }
+
+    bool spawn(int w) {
+        WorkerSlot& slot = shared->workers[w];
+        slot.readyNs.store(0);
+        slot.crashNs.store(0);
+        slot.dying.store(0);
+        pid_t pid;
+        if(opt.spawn == Spawn::ZYGOTE) {
+            if(!askZygote(w, pid) && !(restartZygote() && askZygote(w, pid))) return false;
+        } else {
+            pid = fork();
+            if(pid == 0) {
+                init();
+                serve(w);
+            }
+        }
+        if(pid <= 0) return false;
+        slot.pid.store(pid);
+        workers[w].pid = pid;
+        workers[w].pidfd = watch(pid);
+        return true;
+    }
+
+    int watch(pid_t pid) {
+        if(opt.detect != Detect::PIDFD) return -1;
+        int fd = (int)syscall(SYS_pidfd_open, pid, 0);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = (uint64_t)pid;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+        return fd;
+    }
+
+    // Explicit DEL: a forked child may hold a copy of the pidfd, which
+    // would keep a merely close()d fd registered
+    void unwatch(int& fd) {
+        if(fd == -1) return;
+        epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        fd = -1;
+    }
+
+    void onExit(pid_t pid, int status) {
+        if(pid == zygotePid) {   // lost the zygote: start a fresh one
+            unwatch(zygotePidfd);
+            close(zygoteSock);
+            zygoteSock = -1;
+            zygotePid = 0;
+            if(!shared->stopping.load()) startZygote();   // if this fails, the next spawn() retries
+            return;
+        }
+        int signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+        for(size_t i = 0; i < dying.size(); i++) {
+            if(dying[i].pid != pid) continue;
+            unwatch(dying[i].pidfd);
+            history[dying[i].entry].signal = signal;
+            dying.erase(dying.begin() + i);
+            return;
+        }
+        for(int w = 0; w < (int)workers.size(); w++) {
+            if(workers[w].pid != pid) continue;
+            unwatch(workers[w].pidfd);
+            workers[w].pid = 0;
+            replace(w, signal);
+            return;
+        }
+    }
+
+    // The crash handler ran: the worker will not touch the queue again, so
+    // replace it now and reap it when it is gone
+    void onNotice(int w) {
+        dying.push_back(Dying{workers[w].pid, workers[w].pidfd, history.size()});
+        workers[w].pid = 0;
+        workers[w].pidfd = -1;
+        replace(w, 0);
+    }
+
+    void replace(int w, int signal) {
+        uint64_t detected = nowNs();
+        finalize(w);
+        uint64_t crashed = shared->workers[w].crashNs.load();
+        history.push_back(Recovery{w, signal, crashed ? crashed : detected, detected, 0});
+        shared->queue.reclaim(w, [&](const Job& job) {
+            retry.push_back(job);
+            requeuedJobs++;
+        });
+        workers[w].pending = (long)history.size() - 1;
+        if(!shared->stopping.load() && !spawn(w)) unstaffed.push_back(w);
+    }
+
+    // Slots whose replacement could not be started: retried on every poll()
+    void respawnUnstaffed() {
+        std::vector<int> failed;
+        for(int w : unstaffed)
+            if(!shared->stopping.load() && !spawn(w)) failed.push_back(w);
+        unstaffed.swap(failed);
+    }
+
+    // The replacement stamps readyNs itself, some time after spawn()
+    void finalize(int w) {
+        long& p = workers[w].pending;
+        if(p < 0) return;
+        uint64_t ready = shared->workers[w].readyNs.load();
+        if(ready == 0) return;
+        history[p].readyNs = ready;
+        p = -1;
+    }
+
+    void finalizeRecoveries() {
+        if(!shared) return;
+        for(int w = 0; w < (int)workers.size(); w++) finalize(w);
+    }
+};
+
+}  // namespace prefork
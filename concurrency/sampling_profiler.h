@@ -0,0 +1,639 @@
+/**
+ * sampling_profiler.h
+ * In-process CPU sampling profiler: SIGPROF per thread, folded stacks out.
+ *
+ * perf_counters.h counts events for a region you choose. A profiler answers
+ * the other question - where does the CPU time go, without knowing in
+ * advance - and this one does it from inside the process, with no perf or
+ * gdb on the box:
+ *
+ *   1. Each registered thread gets its own POSIX timer on its own CPU-time
+ *      clock (timer_create(CLOCK_THREAD_CPUTIME_ID) + SIGEV_THREAD_ID), so
+ *      at `hz` every thread is sampled in proportion to the CPU it burns,
+ *      and the signal lands on that thread. (setitimer(ITIMER_PROF) is one
+ *      timer per process, delivered to whichever thread the kernel picks.)
+ *   2. The SIGPROF handler does only async-signal-safe work: it takes the
+ *      interrupted PC and frame pointer from the ucontext and walks the
+ *      frame-pointer chain, every step bounds-checked against the thread's
+ *      stack, into a slot of that thread's ring. No malloc, no locks, no
+ *      libc unwinder (backtrace() may allocate and take loader locks).
+ *      When the PC is inside a library (no frame pointers there), it first
+ *      scans a bounded window of the stack for a return address into the
+ *      executable's text that follows a call instruction, and resumes the
+ *      walk from there.
+ *      CPU-time timers only expire on the scheduler tick (~250 Hz), so
+ *      above that rate one signal stands for 1 + si_overrun periods and the
+ *      sample is weighted accordingly.
+ *   3. Each ring is single-producer (the handler, on its thread) /
+ *      single-consumer (the collector): two atomic indices, no CAS. A full
+ *      ring drops the sample and counts it. A thread's state (ring
+ *      included, ~266KB) is freed by the first drain after it unregisters;
+ *      its counters live on in the totals.
+ *   4. A background collector drains the rings every few ms, aggregates
+ *      identical stacks, and symbolizes each distinct PC once: the
+ *      executable's own ELF .symtab (static functions included, no
+ *      -rdynamic needed), dladdr() for shared libraries, demangled.
+ *   5. writeFolded() prints "root;caller;callee count" lines - the input
+ *      format of flamegraph.pl and speedscope.
+ *   6. stats() reports the profiler's own cost as it was measured: time in
+ *      the handler, collector CPU time, and the sampled threads' CPU time
+ *      to divide them by. (An A/B throughput run is far noisier than that
+ *      cost.) The kernel's signal delivery is not in the handler time.
+ *
+ * Build the profiled code with -fno-omit-frame-pointer (-O2 drops frame
+ * pointers). Frames without one (libc, libstdc++) end the walk or are
+ * skipped: their callees still show, attributed to the nearest framed
+ * caller. x86-64 and aarch64.
+ *
+ * Usage:
+ *   sampler::Profiler profiler(1000);           // Hz per thread
+ *   profiler.start();                            // also registers this thread
+ *   std::thread t([&] { sampler::ThreadScope s(profiler); work(); });
+ *   ...
+ *   profiler.stop();
+ *   profiler.writeFolded("out.folded");
+ *   profiler.printTop(std::cout, 15);
+ */
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <fstream>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
+#include <ctime>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <elf.h>
+#include <link.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+namespace sampler {
+
+const int MAX_DEPTH = 64;
+const size_t RING_SLOTS = 512;        // per thread: ~0.5 s of samples at 1 kHz
+
+struct Sample {
+    uint32_t depth;
+    uint32_t weight;                  // timer periods it stands for (1 + overruns)
+    uintptr_t pcs[MAX_DEPTH];         // [0] = interrupted PC, then return addresses
+};
+
+// The executable's code, set by Profiler::start() before any signal: the
+// only code known to keep frame pointers
+struct TextRange {
+    uintptr_t lo = 0, hi = 0;
+    bool contains(uintptr_t pc) const { return pc >= lo && pc < hi; }
+};
+inline TextRange& executableText() {
+    static TextRange range;
+    return range;
+}
+
+// Written only by the SIGPROF handler on its own thread, read only by the
+// collector
+struct ThreadState {
+    pid_t tid = 0;
+    uintptr_t stackLo = 0, stackHi = 0;
+    timer_t timer{};
+    bool timerArmed = false;
+    std::atomic<uint64_t> head{0};    // next slot the handler writes
+    std::atomic<uint64_t> tail{0};    // next slot the collector reads
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> taken{0};     // samples, weighted
+    std::atomic<uint64_t> signals{0};
+    std::atomic<uint64_t> handlerNs{0}; // time spent in onSigprof
+    // Collector side, under Profiler::lock
+    clockid_t cpuClock{};               // this thread's CPU-time clock
+    uint64_t cpuStartNs = 0, cpuNs = 0; // CPU time while registered (cpuNs once retired)
+    bool retired = false;               // unregistered: free once the ring is drained
+    Sample ring[RING_SLOTS];
+};
+
+inline uint64_t clockNs(clockid_t clock) {
+    timespec ts;
+    if(clock_gettime(clock, &ts) == -1) return 0;
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// ============================================================================
+// SIGNAL SIDE: async-signal-safe only
+// ============================================================================
+
+#if defined(__x86_64__)
+// Is `ret` right after a call instruction in the executable? (call rel32,
+// or call through a register / memory operand: FF /2)
+inline bool afterCall(uintptr_t ret) {
+    const TextRange& text = executableText();
+    if(!text.contains(ret) || ret < text.lo + 7) return false;
+    const uint8_t* p = (const uint8_t*)ret;
+    if(p[-5] == 0xE8) return true;
+    for(int len : {2, 3, 6, 7})
+        if(p[-len] == 0xFF && (p[-len + 1] & 0x38) == 0x10) return true;
+    return false;
+}
+#endif
+
+// Reads raw stack words (other frames' locals, redzones included), which
+// is exactly what AddressSanitizer would report
+__attribute__((no_sanitize_address))
+inline void captureSample(ThreadState* st, siginfo_t* info, void* context) {
+    uint64_t head = st->head.load(std::memory_order_relaxed);
+    if(head - st->tail.load(std::memory_order_acquire) >= RING_SLOTS) {
+        st->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Sample& s = st->ring[head % RING_SLOTS];
+    ucontext_t* uc = (ucontext_t*)context;
+    const TextRange& text = executableText();
+    auto inStack = [st](uintptr_t a) {
+        return a >= st->stackLo && a + 2 * sizeof(uintptr_t) <= st->stackHi && (a & (sizeof(uintptr_t) - 1)) == 0;
+    };
+    uint32_t depth = 0;
+#if defined(__x86_64__)
+    uintptr_t pc = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+    uintptr_t fp = (uintptr_t)uc->uc_mcontext.gregs[REG_RBP];
+    uintptr_t sp = (uintptr_t)uc->uc_mcontext.gregs[REG_RSP];
+    s.pcs[depth++] = pc;
+    // Interrupted in a library without frame pointers: rbp may be anything.
+    // Find the return address into our own code on the stack (bounded scan,
+    // call-preceded only), then the first frame record above it
+    if(!text.contains(pc) && inStack(sp)) {
+        uintptr_t slot = sp, limit = std::min(st->stackHi - 2 * sizeof(uintptr_t), sp + 512 * sizeof(uintptr_t));
+        while(slot < limit && !afterCall(*(uintptr_t*)slot)) slot += sizeof(uintptr_t);
+        if(slot < limit) {
+            s.pcs[depth++] = *(uintptr_t*)slot;
+            if(!(inStack(fp) && fp > slot)) {
+                fp = 0;
+                for(uintptr_t f = slot + sizeof(uintptr_t); f < limit; f += sizeof(uintptr_t)) {
+                    uintptr_t next = ((uintptr_t*)f)[0];
+                    if(next > f && inStack(next) && afterCall(((uintptr_t*)f)[1])) {
+                        fp = f;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+#elif defined(__aarch64__)
+    uintptr_t pc = (uintptr_t)uc->uc_mcontext.pc;
+    uintptr_t fp = (uintptr_t)uc->uc_mcontext.regs[29];
+    s.pcs[depth++] = pc;
+    uintptr_t lr = (uintptr_t)uc->uc_mcontext.regs[30];   // a leaf's caller
+    if(!text.contains(pc) && text.contains(lr)) s.pcs[depth++] = lr;
+#else
+    uintptr_t fp = 0;
+    s.pcs[depth++] = 0;
+#endif
+    // Frame record: [fp] = caller's fp, [fp + 8] = return address. Stop at
+    // anything outside the stack, misaligned, or not moving up the stack
+    while(depth < MAX_DEPTH && inStack(fp)) {
+        uintptr_t next = ((uintptr_t*)fp)[0];
+        uintptr_t ret = ((uintptr_t*)fp)[1];
+        if(ret == 0) break;
+        if(ret != s.pcs[depth - 1]) s.pcs[depth++] = ret;
+        if(next <= fp) break;
+        fp = next;
+    }
+    s.depth = depth;
+    // CPU-time timers fire on the scheduler tick: above HZ, one signal
+    // arrives per tick and si_overrun counts the periods it stands for
+    s.weight = 1 + (uint32_t)std::max(0, info->si_overrun);
+    st->head.store(head + 1, std::memory_order_release);
+    st->taken.fetch_add(s.weight, std::memory_order_relaxed);
+}
+
+// The handler times itself (CLOCK_MONOTONIC is vDSO and async-signal-safe):
+// the profiler's direct cost, without an A/B run's noise
+inline void onSigprof(int, siginfo_t* info, void* context) {
+    ThreadState* st = (ThreadState*)info->si_value.sival_ptr;
+    if(info->si_code != SI_TIMER || !st) return;
+    uint64_t begin = clockNs(CLOCK_MONOTONIC);
+    captureSample(st, info, context);
+    st->signals.fetch_add(1, std::memory_order_relaxed);
+    st->handlerNs.fetch_add(clockNs(CLOCK_MONOTONIC) - begin, std::memory_order_relaxed);
+}
+
+// ============================================================================
+// SYMBOLIZATION (collector thread only)
+// ============================================================================
+
+class Symbolizer {
+public:
+    Symbolizer() { loadExecutable(); }
+
+    // Function name for a code address; cached
+    const std::string& name(uintptr_t pc) {
+        auto it = cache.find(pc);
+        if(it != cache.end()) return it->second;
+        return cache.emplace(pc, resolve(pc)).first->second;
+    }
+
+private:
+    struct Symbol {
+        uintptr_t start, size;
+        std::string name;
+    };
+    std::vector<Symbol> symbols;      // executable's functions, by runtime address
+    std::unordered_map<uintptr_t, std::string> cache;
+
+    static std::string demangle(const char* raw) {
+        int status = 0;
+        char* out = abi::__cxa_demangle(raw, nullptr, nullptr, &status);
+        std::string name = status == 0 && out ? out : raw;
+        free(out);
+        // Drop clone suffixes, qualifiers and the parameter list:
+        // "f(int, std::string const&) const [clone .cold]" -> "f"
+        size_t clone = name.find(" [clone ");
+        if(clone != std::string::npos) name.resize(clone);
+        for(const char* q : {" const", " volatile", " &&", " &"}) {
+            size_t len = strlen(q);
+            if(name.size() > len && name.compare(name.size() - len, len, q) == 0) name.resize(name.size() - len);
+        }
+        if(name.empty() || name.back() != ')') return clean(name);
+        int depth = 0;
+        for(size_t i = name.size(); i-- > 0;) {
+            if(name[i] == ')') depth++;
+            else if(name[i] == '(' && --depth == 0) {
+                if(i > 0) name.resize(i);
+                break;
+            }
+        }
+        return clean(name);
+    }
+
+    // ';' separates frames in the folded format
+    static std::string clean(std::string s) {
+        std::replace(s.begin(), s.end(), ';', ':');
+        return s;
+    }
+
+    std::string resolve(uintptr_t pc) {
+        auto it = std::upper_bound(symbols.begin(), symbols.end(), pc,
+                                   [](uintptr_t a, const Symbol& s) { return a < s.start; });
+        if(it != symbols.begin()) {
+            --it;
+            if(pc < it->start + std::max<uintptr_t>(it->size, 1)) return it->name;
+        }
+        Dl_info info;
+        if(dladdr((void*)pc, &info) && info.dli_sname) return demangle(info.dli_sname);
+        if(dladdr((void*)pc, &info) && info.dli_fname) {
+            const char* base = strrchr(info.dli_fname, '/');
+            return std::string("[") + (base ? base + 1 : info.dli_fname) + "]";
+        }
+        return "[unknown]";
+    }
+
+    // The main executable's load address (0 unless PIE)
+    static uintptr_t executableBase() {
+        uintptr_t base = 0;
+        dl_iterate_phdr([](dl_phdr_info* info, size_t, void* out) {
+            *(uintptr_t*)out = info->dlpi_addr;   // first entry is the executable
+            return 1;
+        }, &base);
+        return base;
+    }
+
+    // STT_FUNC entries of .symtab (falls back to .dynsym if stripped)
+    void loadExecutable() {
+        int fd = open("/proc/self/exe", O_RDONLY | O_CLOEXEC);
+        if(fd == -1) return;
+        struct stat sb;
+        if(fstat(fd, &sb) == -1 || (size_t)sb.st_size < sizeof(Elf64_Ehdr)) {
+            close(fd);
+            return;
+        }
+        void* map = mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(map == MAP_FAILED) return;
+        const char* file = (const char*)map;
+        const Elf64_Ehdr* eh = (const Elf64_Ehdr*)file;
+        if(memcmp(eh->e_ident, ELFMAG, SELFMAG) == 0 && eh->e_ident[EI_CLASS] == ELFCLASS64 &&
+           eh->e_shoff + (size_t)eh->e_shnum * sizeof(Elf64_Shdr) <= (size_t)sb.st_size) {
+            const Elf64_Shdr* sh = (const Elf64_Shdr*)(file + eh->e_shoff);
+            uintptr_t base = executableBase();
+            for(uint32_t want : {(uint32_t)SHT_SYMTAB, (uint32_t)SHT_DYNSYM}) {
+                for(int i = 0; i < eh->e_shnum && symbols.empty(); i++) {
+                    if(sh[i].sh_type != want || sh[i].sh_link >= eh->e_shnum) continue;
+                    const Elf64_Sym* syms = (const Elf64_Sym*)(file + sh[i].sh_offset);
+                    const char* strs = file + sh[sh[i].sh_link].sh_offset;
+                    size_t n = sh[i].sh_size / sizeof(Elf64_Sym);
+                    for(size_t k = 0; k < n; k++) {
+                        if(ELF64_ST_TYPE(syms[k].st_info) != STT_FUNC || syms[k].st_value == 0) continue;
+                        symbols.push_back(Symbol{base + syms[k].st_value, syms[k].st_size,
+                                                 demangle(strs + syms[k].st_name)});
+                    }
+                }
+            }
+        }
+        munmap(map, sb.st_size);
+        std::sort(symbols.begin(), symbols.end(), [](const Symbol& a, const Symbol& b) { return a.start < b.start; });
+    }
+};
+
+// ============================================================================
+// PROFILER
+// ============================================================================
+
+class Profiler {
+public:
+    explicit Profiler(int hz = 1000) : hz(hz) {}
+
+    ~Profiler() { stop(); }
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Install the handler, start the collector, register the calling thread
+    bool start() {
+        if(running) return true;
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = onSigprof;
+        sa.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        if(sigaction(SIGPROF, &sa, &previous) == -1) return false;
+        findExecutableText();
+        running = true;
+        startNs = nowNs();
+        collector = std::thread([this] { collect(); });
+        registerThread();
+        return true;
+    }
+
+    // Give the calling thread its own CPU-time timer; false if it failed
+    bool registerThread() {
+        if(!running) return false;
+        auto st = std::make_unique<ThreadState>();
+        st->tid = (pid_t)syscall(SYS_gettid);
+        st->cpuClock = CLOCK_THREAD_CPUTIME_ID;
+        pthread_getcpuclockid(pthread_self(), &st->cpuClock);   // readable from other threads
+        st->cpuStartNs = clockNs(st->cpuClock);
+        pthread_attr_t attr;
+        if(pthread_getattr_np(pthread_self(), &attr) == 0) {
+            void* addr = nullptr;
+            size_t size = 0;
+            pthread_attr_getstack(&attr, &addr, &size);
+            pthread_attr_destroy(&attr);
+            st->stackLo = (uintptr_t)addr;
+            st->stackHi = (uintptr_t)addr + size;
+        }
+        sigevent sev;
+        memset(&sev, 0, sizeof(sev));
+        sev.sigev_notify = SIGEV_THREAD_ID;
+        sev.sigev_signo = SIGPROF;
+        sev.sigev_value.sival_ptr = st.get();
+        sev._sigev_un._tid = st->tid;
+        if(timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, &st->timer) == -1) return false;
+        st->timerArmed = true;
+        long periodNs = 1000000000L / hz;
+        itimerspec its;
+        its.it_interval.tv_sec = periodNs / 1000000000L;
+        its.it_interval.tv_nsec = periodNs % 1000000000L;
+        its.it_value = its.it_interval;
+        timer_settime(st->timer, 0, &its, nullptr);
+        std::lock_guard<std::mutex> g(lock);
+        mine() = st.get();
+        threads.push_back(std::move(st));
+        registered++;
+        return true;
+    }
+
+    // Stop sampling the calling thread (before it exits). Its state is freed
+    // by the next drain: a signal the timer already queued for this thread
+    // is delivered on the way out of timer_delete(), on this thread, so
+    // none can arrive later
+    void unregisterThread() {
+        std::lock_guard<std::mutex> g(lock);
+        ThreadState* st = mine();
+        if(!st) return;
+        if(st->timerArmed) {
+            timer_delete(st->timer);
+            st->timerArmed = false;
+        }
+        st->cpuNs = clockNs(st->cpuClock) - st->cpuStartNs;
+        st->retired = true;
+        mine() = nullptr;
+    }
+
+    // Stop every timer, drain what is left, restore the old handler
+    void stop() {
+        if(!running) return;
+        {
+            std::lock_guard<std::mutex> g(lock);
+            for(auto& st : threads) {
+                if(st->timerArmed) timer_delete(st->timer);
+                st->timerArmed = false;
+                if(!st->retired)   // still registered: stop its CPU-time count here
+                    if(uint64_t now = clockNs(st->cpuClock)) st->cpuNs = now - st->cpuStartNs;
+            }
+        }
+        running = false;
+        collector.join();
+        drain();
+        // A SIGPROF already queued by a deleted timer may still arrive, and
+        // the default action kills the process: ignore rather than restore it
+        if(previous.sa_handler == SIG_DFL && !(previous.sa_flags & SA_SIGINFO)) signal(SIGPROF, SIG_IGN);
+        else sigaction(SIGPROF, &previous, nullptr);
+        elapsedNs = nowNs() - startNs;
+    }
+
+    struct Stats {
+        uint64_t samples = 0, signals = 0, dropped = 0, distinctStacks = 0;
+        uint64_t handlerNs = 0;     // inside onSigprof (not the kernel's delivery)
+        uint64_t sampledCpuNs = 0;  // CPU time of sampled threads while registered
+        uint64_t collectorCpuNs = 0;
+        size_t threads = 0;         // registered now
+        size_t registered = 0;      // ever
+        double seconds = 0;
+    };
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> g(lock);
+        Stats s = retiredTotals;
+        for(auto& st : threads) {
+            s.samples += st->taken.load();
+            s.signals += st->signals.load();
+            s.dropped += st->dropped.load();
+            s.handlerNs += st->handlerNs.load();
+            uint64_t now = st->retired || !running ? 0 : clockNs(st->cpuClock);
+            s.sampledCpuNs += now ? now - st->cpuStartNs : st->cpuNs;
+            s.threads += !st->retired;
+        }
+        s.collectorCpuNs = collectorCpuNs.load();
+        s.distinctStacks = stacks.size();
+        s.registered = registered;
+        s.seconds = elapsedNs / 1e9;
+        return s;
+    }
+
+    // "root;...;leaf count", one line per distinct symbolized stack
+    bool writeFolded(const std::string& path) {
+        std::ofstream out(path);
+        if(!out) return false;
+        for(auto& f : folded()) out << f.first << " " << f.second << "\n";
+        return (bool)out;
+    }
+
+    // Functions by self samples (leaf) and total samples (anywhere on the stack)
+    void printTop(std::ostream& out, size_t n) {
+        std::map<std::string, uint64_t> self, total;
+        uint64_t all = 0;
+        for(auto& f : folded()) {
+            all += f.second;
+            size_t from = 0;
+            std::vector<std::string> seen;
+            while(true) {
+                size_t to = f.first.find(';', from);
+                std::string frame = f.first.substr(from, to == std::string::npos ? std::string::npos : to - from);
+                if(std::find(seen.begin(), seen.end(), frame) == seen.end()) {
+                    total[frame] += f.second;   // recursion counts once
+                    seen.push_back(frame);
+                }
+                if(to == std::string::npos) {
+                    self[frame] += f.second;
+                    break;
+                }
+                from = to + 1;
+            }
+        }
+        std::vector<std::pair<uint64_t, std::string>> rows;
+        for(auto& t : total) rows.push_back({t.second, t.first});
+        std::sort(rows.rbegin(), rows.rend());
+        out << "  " << std::setw(8) << "total%" << std::setw(8) << "self%" << "  function" << std::endl;
+        for(size_t i = 0; i < rows.size() && i < n; i++) {
+            double pct = all ? 100.0 * rows[i].first / all : 0;
+            double selfPct = all ? 100.0 * self[rows[i].second] / all : 0;
+            out << "  " << std::fixed << std::setprecision(1) << std::setw(7) << pct << "%" << std::setw(7)
+                << selfPct << "%  " << rows[i].second.substr(0, 90) << std::endl;
+        }
+    }
+
+private:
+    int hz;
+    std::atomic<bool> running{false};
+    struct sigaction previous;
+    std::thread collector;
+    mutable std::mutex lock;                           // threads (registration) and stacks
+    std::deque<std::unique_ptr<ThreadState>> threads;  // registered, or retired but not drained yet
+    Stats retiredTotals;                               // counters of freed states
+    size_t registered = 0;
+    std::atomic<uint64_t> collectorCpuNs{0};
+    std::map<std::vector<uintptr_t>, uint64_t> stacks; // raw PCs, leaf first -> samples
+    Symbolizer symbolizer;
+    uint64_t startNs = 0, elapsedNs = 0;
+
+    static uint64_t nowNs() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+    }
+
+    static void findExecutableText() {
+        dl_iterate_phdr([](dl_phdr_info* info, size_t, void*) {
+            for(int i = 0; i < info->dlpi_phnum; i++) {
+                const ElfW(Phdr)& ph = info->dlpi_phdr[i];
+                if(ph.p_type != PT_LOAD || !(ph.p_flags & PF_X)) continue;
+                executableText().lo = info->dlpi_addr + ph.p_vaddr;
+                executableText().hi = info->dlpi_addr + ph.p_vaddr + ph.p_memsz;
+            }
+            return 1;   // first entry is the executable
+        }, nullptr);
+    }
+
+    static ThreadState*& mine() {
+        static thread_local ThreadState* st = nullptr;
+        return st;
+    }
+
+    void collect() {
+        // Not a sampled thread: the collector's own cost shows as overhead,
+        // not in the profile
+        while(running) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            drain();
+            collectorCpuNs.store(clockNs(CLOCK_THREAD_CPUTIME_ID));
+        }
+    }
+
+    void drain() {
+        std::lock_guard<std::mutex> g(lock);
+        for(auto it = threads.begin(); it != threads.end();) {
+            ThreadState* st = it->get();
+            uint64_t tail = st->tail.load(std::memory_order_relaxed);
+            uint64_t head = st->head.load(std::memory_order_acquire);
+            for(; tail != head; tail++) {
+                const Sample& s = st->ring[tail % RING_SLOTS];
+                stacks[std::vector<uintptr_t>(s.pcs, s.pcs + s.depth)] += s.weight;
+            }
+            st->tail.store(tail, std::memory_order_release);
+            if(!st->retired) {
+                ++it;
+                continue;
+            }
+            // Unregistered: no handler can touch it any more
+            retiredTotals.samples += st->taken.load();
+            retiredTotals.signals += st->signals.load();
+            retiredTotals.dropped += st->dropped.load();
+            retiredTotals.handlerNs += st->handlerNs.load();
+            retiredTotals.sampledCpuNs += st->cpuNs;
+            it = threads.erase(it);
+        }
+    }
+
+    // Symbolize and merge: different PCs in the same functions fold together
+    std::map<std::string, uint64_t> folded() {
+        std::map<std::vector<uintptr_t>, uint64_t> snapshot;
+        {
+            std::lock_guard<std::mutex> g(lock);
+            snapshot = stacks;
+        }
+        std::map<std::string, uint64_t> out;
+        for(auto& s : snapshot) {
+            std::string line;
+            for(size_t i = s.first.size(); i-- > 0;) {
+                // Return addresses point after the call: look up the call itself
+                uintptr_t pc = i == 0 ? s.first[i] : s.first[i] - 1;
+                if(!line.empty()) line += ';';
+                line += symbolizer.name(pc);
+            }
+            out[line] += s.second;
+        }
+        return out;
+    }
+};
+
+// Registers the current thread for its lifetime
+class ThreadScope {
+public:
+    explicit ThreadScope(Profiler& p) : profiler(p) { profiler.registerThread(); }
+    ~ThreadScope() { profiler.unregisterThread(); }
+
+    ThreadScope(const ThreadScope&) = delete;
+    ThreadScope& operator=(const ThreadScope&) = delete;
+
+private:
+    Profiler& profiler;
+};
+
+}  // namespace sampler
@@ -0,0 +1,520 @@
+/**
+ * shm_hash_table.h
+ * A fixed-capacity hash table that several PROCESSES share by name.
+ *
+ * 02_ipc_internals.cpp shares one int through MAP_ANONYMOUS memory - only
+ * visible to fork children, and unsynchronized. A session or rate-limit
+ * table needs: a name any process can attach to, lock-free readers, writers
+ * that exclude each other, and no process able to wedge the others by
+ * dying at the wrong moment.
+ *
+ * LAYOUT (one shm_open() segment, mmap'd MAP_SHARED by every process):
+ *   [Header][Shard 0 .. S-1][Bucket 0 .. capacity-1]
+ *   - the buckets are split into S shards (stripes); a key's hash picks
+ *     its shard and its home bucket inside it; linear probing wraps within
+ *     the shard, so a key only ever touches its own shard's buckets
+ *   - erase leaves a tombstone (keys never move -> readers never miss one)
+ *
+ * READERS: per-bucket seqlock, no lock, no write to shared memory
+ *   read seq (odd = being written: retry) -> copy key/value -> re-read seq;
+ *   changed -> retry. Fields are std::atomic words read relaxed, so a torn
+ *   copy is thrown away rather than being undefined behaviour.
+ *
+ * WRITERS: one PTHREAD_MUTEX_ROBUST | PTHREAD_PROCESS_SHARED mutex per shard
+ *   Before touching a bucket the writer records it in the shard's journal
+ *   (index + old contents), then seq -> odd, write, seq -> even, journal
+ *   cleared. If the process dies holding the lock, the next locker gets
+ *   EOWNERDEAD and rolls the journaled bucket back (seq odd) or keeps it
+ *   (seq even: the write had finished), recounts the shard, and calls
+ *   pthread_mutex_consistent(). A READER stuck on an odd seq also tries the
+ *   lock, so a crash is repaired even if no writer comes along.
+ *
+ * HUGE PAGES (Options::hugePages): 40MB of buckets is 10k 4KB pages of TLB
+ *   misses on random lookups. Tries a file on hugetlbfs (/dev/hugepages,
+ *   needs reserved pages: vm.nr_hugepages), else shm_open + MADV_HUGEPAGE
+ *   (transparent huge pages for shmem, if shmem_enabled allows it), else
+ *   plain 4KB pages. pageMode() says which one you got. Every process must
+ *   pass the same options to find the same segment.
+ *
+ * Usage:
+ *   auto t = shm::SharedHashTable<Session>::open("/sessions", 1 << 20);
+ *   t->upsert(userId, session);   t->find(userId, out);   t->erase(userId);
+ *   shm::SharedHashTable<Session>::unlink("/sessions");   // when done
+ *
+ * Value must be trivially copyable; it is stored as 8-byte words.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <type_traits>
+#include <thread>
+#include <chrono>
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace shm {
+
+const uint64_t MAGIC = 0x53484d4854424c31ull;   // "SHMHTBL1"
+
+template <typename Value>
+class SharedHashTable {
+    static_assert(std::is_trivially_copyable<Value>::value, "Value is copied as raw words");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "atomics must work across processes");
+
+    static constexpr size_t WORDS = (sizeof(Value) + 7) / 8;
+    enum : uint32_t { EMPTY = 0, FULL = 1, TOMBSTONE = 2 };
+    enum : uint32_t { UNINIT = 0, READY = 2 };
+
+    struct Bucket {
+        std::atomic<uint32_t> seq;      // odd while being written
+        std::atomic<uint32_t> state;
+        std::atomic<uint64_t> key;
+        std::atomic<uint64_t> words[WORDS];
+    };
+
+    struct alignas(64) Shard {
+        pthread_mutex_t lock;
+        uint64_t count;                 // FULL buckets; under lock
+        // Undo journal for the one bucket being written (under lock)
+        std::atomic<uint32_t> journalValid;
+        uint32_t journalBucket;
+        uint32_t oldState;
+        uint64_t oldKey;
+        uint64_t oldWords[WORDS];
+    };
+
+    struct alignas(64) Header {
+        uint64_t magic;
+        uint64_t valueSize;
+        uint64_t capacity;              // buckets, power of two
+        uint64_t shards;                // power of two
+        uint64_t totalBytes;
+        std::atomic<uint32_t> state;
+        std::atomic<uint64_t> recoveries;
+    };
+
+public:
+    struct Options {
+        bool hugePages = false;
+        uint32_t shards = 256;
+    };
+
+    enum Result { INSERTED, UPDATED, FULL_SHARD, LOCK_FAILED };
+
+    // Create the segment, or attach to it if another process already did.
+    // capacity = total buckets (rounded up to a power of two); keep the
+    // load factor under ~0.7. Returns nullptr with *error set on failure.
+    static std::unique_ptr<SharedHashTable> open(const std::string& name, size_t capacity,
+                                                 Options opt = Options(), std::string* error = nullptr) {
+        std::unique_ptr<SharedHashTable> t(new SharedHashTable());
+        std::string why;
+        if(!t->attach(name, capacity, opt, why)) {
+            if(error) *error = why;
+            return nullptr;
+        }
+        return t;
+    }
+
+    // Remove the name; attached processes keep their mapping until they unmap
+    static void unlink(const std::string& name) {
+        shm_unlink(name.c_str());
+        ::unlink(hugetlbfsPath(name).c_str());
+    }
+
+    ~SharedHashTable() {
+        if(base != MAP_FAILED) munmap(base, mappedBytes);
+    }
+
+    // Lock-free lookup. False if absent.
+    bool find(uint64_t key, Value& out) {
+        uint64_t h = mix(key);
+        size_t s = shardOf(h);
+        size_t mask = shardCapacity - 1;
+        for(size_t probe = 0, i = h & mask; probe < shardCapacity; probe++, i = (i + 1) & mask) {
+            Bucket& b = bucket(s, i);
+            uint32_t state;
+            uint64_t k, words[WORDS];
+            stableRead(s, b, state, k, words);
+            if(state == EMPTY) return false;
+            if(state == FULL && k == key) {
+                memcpy(&out, words, sizeof(Value));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Same lookup under the shard mutex (what you'd write without seqlocks)
+    bool findLocked(uint64_t key, Value& out) {
+        uint64_t h = mix(key);
+        size_t s = shardOf(h);
+        if(!lockShard(s)) return false;
+        bool found = false;
+        size_t mask = shardCapacity - 1;
+        for(size_t probe = 0, i = h & mask; probe < shardCapacity; probe++, i = (i + 1) & mask) {
+            Bucket& b = bucket(s, i);
+            uint32_t state = b.state.load(std::memory_order_relaxed);
+            if(state == EMPTY) break;
+            if(state == FULL && b.key.load(std::memory_order_relaxed) == key) {
+                uint64_t words[WORDS];
+                for(size_t w = 0; w < WORDS; w++) words[w] = b.words[w].load(std::memory_order_relaxed);
+                memcpy(&out, words, sizeof(Value));
+                found = true;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&shards[s].lock);
+        return found;
+    }
+
+    Result upsert(uint64_t key, const Value& value) {
+        uint64_t words[WORDS] = {};
+        memcpy(words, &value, sizeof(Value));
+        uint64_t h = mix(key);
+        size_t s = shardOf(h);
+        if(!lockShard(s)) return LOCK_FAILED;
+        Shard& sh = shards[s];
+        size_t mask = shardCapacity - 1;
+        long reuse = -1;   // first tombstone on the path
+        Result result = FULL_SHARD;
+        for(size_t probe = 0, i = h & mask; probe < shardCapacity; probe++, i = (i + 1) & mask) {
+            Bucket& b = bucket(s, i);
+            uint32_t state = b.state.load(std::memory_order_relaxed);
+            if(state == FULL && b.key.load(std::memory_order_relaxed) == key) {
+                write(sh, i, b, FULL, key, words);
+                result = UPDATED;
+                break;
+            }
+            if(state == TOMBSTONE && reuse < 0) reuse = (long)i;
+            if(state == EMPTY) {
+                size_t at = reuse >= 0 ? (size_t)reuse : i;
+                write(sh, at, bucket(s, at), FULL, key, words);
+                sh.count++;
+                result = INSERTED;
+                break;
+            }
+        }
+        if(result == FULL_SHARD && reuse >= 0) {   // no EMPTY left, but a tombstone
+            write(sh, reuse, bucket(s, reuse), FULL, key, words);
+            sh.count++;
+            result = INSERTED;
+        }
+        pthread_mutex_unlock(&sh.lock);
+        return result;
+    }
+
+    bool erase(uint64_t key) {
+        uint64_t h = mix(key);
+        size_t s = shardOf(h);
+        if(!lockShard(s)) return false;
+        Shard& sh = shards[s];
+        bool erased = false;
+        size_t mask = shardCapacity - 1;
+        for(size_t probe = 0, i = h & mask; probe < shardCapacity; probe++, i = (i + 1) & mask) {
+            Bucket& b = bucket(s, i);
+            uint32_t state = b.state.load(std::memory_order_relaxed);
+            if(state == EMPTY) break;
+            if(state == FULL && b.key.load(std::memory_order_relaxed) == key) {
+                uint64_t zero[WORDS] = {};
+                write(sh, i, b, TOMBSTONE, key, zero);
+                sh.count--;
+                erased = true;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&sh.lock);
+        return erased;
+    }
+
+    // Approximate while writers run (shard counts are read without locks)
+    size_t size() const {
+        size_t n = 0;
+        for(size_t s = 0; s < header->shards; s++)
+            n += __atomic_load_n(&shards[s].count, __ATOMIC_RELAXED);
+        return n;
+    }
+
+    size_t capacity() const { return header->capacity; }
+    uint64_t recoveries() const { return header->recoveries.load(); }
+    const std::string& pageMode() const { return mode; }
+
+    // Takes every shard lock (recovering dead owners), then checks that no
+    // bucket is mid-write and the counts match. For tests and after crashes.
+    bool verify(std::string* why = nullptr) {
+        for(size_t s = 0; s < header->shards; s++) {
+            if(!lockShard(s)) {
+                if(why) *why = "shard " + std::to_string(s) + " not recoverable";
+                return false;
+            }
+            uint64_t full = 0;
+            bool ok = !shards[s].journalValid.load();
+            for(size_t i = 0; i < shardCapacity; i++) {
+                Bucket& b = bucket(s, i);
+                ok &= (b.seq.load() & 1) == 0;
+                full += b.state.load() == FULL;
+            }
+            ok &= full == shards[s].count;
+            pthread_mutex_unlock(&shards[s].lock);
+            if(!ok) {
+                if(why) *why = "shard " + std::to_string(s) + " inconsistent";
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    void* base = MAP_FAILED;
+    size_t mappedBytes = 0;
+    Header* header = nullptr;
+    Shard* shards = nullptr;
+    Bucket* buckets = nullptr;
+    size_t shardCapacity = 0;
+    unsigned shardShift = 0;
+    std::string mode;
+
+    SharedHashTable() = default;
+
+    static std::string hugetlbfsPath(const std::string& name) {
+        return "/dev/hugepages" + (name[0] == '/' ? name : "/" + name);
+    }
+
+    // The bracketed choice in .../shmem_enabled; "never"/"deny" = 4KB pages anyway
+    static std::string shmemThpSetting() {
+        char buf[256] = {};
+        int fd = ::open("/sys/kernel/mm/transparent_hugepage/shmem_enabled", O_RDONLY | O_CLOEXEC);
+        if(fd < 0) return "unknown";
+        ssize_t n = read(fd, buf, sizeof(buf) - 1);
+        close(fd);
+        std::string all(buf, n > 0 ? n : 0);
+        size_t from = all.find('['), to = all.find(']');
+        return from != std::string::npos && to > from ? all.substr(from + 1, to - from - 1) : "unknown";
+    }
+
+    static uint64_t mix(uint64_t x) {   // splitmix64 finalizer
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    // High bits pick the shard, low bits the home bucket: independent
+    size_t shardOf(uint64_t h) const { return shardShift == 64 ? 0 : h >> shardShift; }
+
+    Bucket& bucket(size_t shard, size_t i) { return buckets[shard * shardCapacity + i]; }
+
+    static size_t layoutBytes(size_t capacity, size_t shardCount) {
+        return sizeof(Header) + shardCount * sizeof(Shard) + capacity * sizeof(Bucket);
+    }
+
+    void stableRead(size_t shard, Bucket& b, uint32_t& state, uint64_t& key, uint64_t* words) {
+        for(unsigned spins = 0;; spins++) {
+            uint32_t s1 = b.seq.load(std::memory_order_acquire);
+            if((s1 & 1) == 0) {
+                state = b.state.load(std::memory_order_relaxed);
+                key = b.key.load(std::memory_order_relaxed);
+                for(size_t w = 0; w < WORDS; w++) words[w] = b.words[w].load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if(b.seq.load(std::memory_order_relaxed) == s1) return;
+            }
+            if(spins >= 64) {
+                // Writer preempted (let it run) or dead (repair it ourselves)
+                repairIfOwnerDead(shard);
+                sched_yield();
+            }
+        }
+    }
+
+    void repairIfOwnerDead(size_t s) {
+        int r = pthread_mutex_trylock(&shards[s].lock);
+        if(r == EOWNERDEAD) {
+            recover(s);
+            r = 0;
+        }
+        if(r == 0) pthread_mutex_unlock(&shards[s].lock);
+    }
+
+    bool lockShard(size_t s) {
+        int r = pthread_mutex_lock(&shards[s].lock);
+        if(r == EOWNERDEAD) {
+            recover(s);
+            return true;
+        }
+        return r == 0;   // ENOTRECOVERABLE: someone unlocked without repairing
+    }
+
+    // Caller holds the lock of a shard whose previous owner died
+    void recover(size_t s) {
+        Shard& sh = shards[s];
+        if(sh.journalValid.load(std::memory_order_acquire)) {
+            Bucket& b = bucket(s, sh.journalBucket);
+            uint32_t q = b.seq.load(std::memory_order_relaxed);
+            if(q & 1) {   // died mid-write: roll back
+                b.state.store(sh.oldState, std::memory_order_relaxed);
+                b.key.store(sh.oldKey, std::memory_order_relaxed);
+                for(size_t w = 0; w < WORDS; w++) b.words[w].store(sh.oldWords[w], std::memory_order_relaxed);
+                b.seq.store(q + 1, std::memory_order_release);
+            }
+            sh.journalValid.store(0, std::memory_order_release);
+        }
+        uint64_t full = 0;   // the count update may or may not have happened
+        for(size_t i = 0; i < shardCapacity; i++) full += bucket(s, i).state.load() == FULL;
+        sh.count = full;
+        header->recoveries.fetch_add(1);
+        pthread_mutex_consistent(&sh.lock);
+    }
+
+    void write(Shard& sh, size_t index, Bucket& b, uint32_t state, uint64_t key, const uint64_t* words) {
+        sh.journalBucket = (uint32_t)index;
+        sh.oldState = b.state.load(std::memory_order_relaxed);
+        sh.oldKey = b.key.load(std::memory_order_relaxed);
+        for(size_t w = 0; w < WORDS; w++) sh.oldWords[w] = b.words[w].load(std::memory_order_relaxed);
+        sh.journalValid.store(1, std::memory_order_release);
+
+        uint32_t q = b.seq.load(std::memory_order_relaxed);
+        b.seq.store(q + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        b.state.store(state, std::memory_order_relaxed);
+        b.key.store(key, std::memory_order_relaxed);
+        for(size_t w = 0; w < WORDS; w++) b.words[w].store(words[w], std::memory_order_relaxed);
+        b.seq.store(q + 2, std::memory_order_release);
+
+        sh.journalValid.store(0, std::memory_order_release);
+    }
+
+    // Open (O_EXCL first: exactly one process initializes) and map
+    bool attach(const std::string& name, size_t wantCapacity, const Options& opt, std::string& why,
+                bool tryHugetlbfs = true) {
+        if(name.empty() || name[0] != '/' || name.find('/', 1) != std::string::npos) {
+            why = "name must look like \"/table\"";
+            return false;
+        }
+        size_t cap = 1;
+        while(cap < wantCapacity) cap <<= 1;
+        size_t shardCount = 1;
+        while(shardCount < opt.shards && shardCount < cap) shardCount <<= 1;
+        size_t bytes = layoutBytes(cap, shardCount);
+
+        int fd = -1;
+        bool creator = false;
+        const size_t HUGE_PAGE = 2 * 1024 * 1024;
+        if(opt.hugePages && tryHugetlbfs) {
+            std::string path = hugetlbfsPath(name);
+            fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+            creator = fd >= 0;
+            if(fd < 0 && errno == EEXIST) fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+            if(fd >= 0) {
+                bytes = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+                mode = "hugetlbfs 2MB pages";
+                // No reserved huge pages -> ftruncate/mmap fails: fall back
+                if(creator && ftruncate(fd, bytes) != 0) {
+                    close(fd);
+                    ::unlink(path.c_str());
+                    fd = -1;
+                    creator = false;
+                }
+            }
+        }
+        if(fd < 0) {
+            fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+            creator = fd >= 0;
+            if(fd < 0 && errno == EEXIST) fd = shm_open(name.c_str(), O_RDWR, 0600);
+            if(fd < 0) {
+                why = std::string("shm_open: ") + strerror(errno);
+                return false;
+            }
+            mode = "4KB pages";
+            if(creator && ftruncate(fd, bytes) != 0) {
+                why = std::string("ftruncate: ") + strerror(errno);
+                close(fd);
+                shm_unlink(name.c_str());
+                return false;
+            }
+        }
+
+        if(!creator) {
+            // The creator may not have sized it yet
+            struct stat st;
+            for(int i = 0; i < 2000 && fstat(fd, &st) == 0 && st.st_size == 0; i++)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+                why = "segment exists but was never sized";
+                close(fd);
+                return false;
+            }
+            bytes = st.st_size;
+        }
+
+        base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);   // the mapping keeps the segment alive
+        if(base == MAP_FAILED) {
+            if(creator && mode[0] == 'h') {   // hugetlbfs without reserved pages
+                ::unlink(hugetlbfsPath(name).c_str());
+                return attach(name, wantCapacity, opt, why, false);
+            }
+            why = std::string("mmap: ") + strerror(errno);
+            if(creator) unlink(name);
+            return false;
+        }
+        mappedBytes = bytes;
+        if(opt.hugePages && mode == "4KB pages" && madvise(base, bytes, MADV_HUGEPAGE) == 0)
+            mode = "shmem + MADV_HUGEPAGE (shmem_enabled: " + shmemThpSetting() + ")";
+
+        header = (Header*)base;
+        if(creator) {
+            initialize(cap, shardCount, bytes);
+        } else {
+            for(int i = 0; i < 2000 && header->state.load(std::memory_order_acquire) != READY; i++)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if(header->state.load(std::memory_order_acquire) != READY || header->magic != MAGIC ||
+               header->valueSize != sizeof(Value)) {
+                why = "segment exists but is not a table of this Value type (or its creator died)";
+                return false;
+            }
+            cap = header->capacity;
+            shardCount = header->shards;
+        }
+        shards = (Shard*)((char*)base + sizeof(Header));
+        buckets = (Bucket*)((char*)shards + shardCount * sizeof(Shard));
+        shardCapacity = cap / shardCount;
+        unsigned bits = 0;
+        while((size_t(1) << bits) < shardCount) bits++;
+        shardShift = 64 - bits;
+        return true;
+    }
+
+    void initialize(size_t cap, size_t shardCount, size_t bytes) {
+        // ftruncate'd memory is already zero: EMPTY buckets, seq 0
+        header->magic = MAGIC;
+        header->valueSize = sizeof(Value);
+        header->capacity = cap;
+        header->shards = shardCount;
+        header->totalBytes = bytes;
+        header->recoveries.store(0);
+        Shard* sh = (Shard*)((char*)base + sizeof(Header));
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        for(size_t s = 0; s < shardCount; s++) {
+            pthread_mutex_init(&sh[s].lock, &attr);
+            sh[s].count = 0;
+            sh[s].journalValid.store(0);
+        }
+        pthread_mutexattr_destroy(&attr);
+        header->state.store(READY, std::memory_order_release);
+    }
+};
+
+}  // namespace shm
@@ -0,0 +1,448 @@
+/**
+ * unix_transport.h
+ * Local IPC between processes that are NOT fork relatives.
+ *
+ * A pipe or a MAP_SHARED|MAP_ANONYMOUS region only reaches a child that
+ * inherited the fd/mapping at fork(). A Unix-domain socket has a NAME: any
+ * process that knows the path can connect() - workers started by systemd, a
+ * shell, another supervisor...
+ *
+ * WHY SOCK_SEQPACKET (not SOCK_STREAM):
+ *   - connection-oriented like a stream (accept, EOF when the peer dies)
+ *   - but every send() is ONE message and every recv() returns exactly one:
+ *     no length-prefix reassembly, no partial reads
+ *   - so a whole batch of messages can go out in ONE sendmmsg() syscall and
+ *     come in with ONE recvmmsg()
+ *
+ * LARGE PAYLOADS: pass the memory, not the bytes
+ *   A 16MB message through a pipe or socket is copied twice (user -> kernel ->
+ *   user) in 64KB pieces. Instead:
+ *     sender:   memfd_create() + ftruncate + mmap, write the payload in place
+ *     transfer: the fd goes over the socket as SCM_RIGHTS ancillary data -
+ *               the kernel installs a new fd for the same file in the receiver
+ *     receiver: mmap() it and read the very same pages
+ *   Nothing is copied; the cost is page-table setup on both sides.
+ *   The sender seals the memfd's size (F_SEAL_SHRINK | F_SEAL_GROW) so the
+ *   receiver can't be SIGBUS'd by it being truncated under its mapping.
+ *
+ * FRAMING: every message starts with a FrameHeader {kind, length}.
+ *   INLINE - the payload follows the header in the same datagram
+ *   MEMFD  - no payload; one fd rides along, `length` bytes of it are valid
+ *
+ * API:
+ *   ipc::Listener l("/tmp/x.sock");     ipc::Channel c = ipc::connectTo("/tmp/x.sock");
+ *   ipc::Channel s = l.accept();        c.send(ptr, n);  c.sendBatch(msgs);
+ *   ipc::RecvBatch b(32);               c.sendBlob(blob);
+ *   s.recvBatch(b); b.payload(i) / b.takeBlob(i)
+ *   Paths starting with '@' are Linux abstract-namespace names (no file).
+ *
+ * Errors: -1 / false with errno set, like the syscalls underneath.
+ */
+
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace ipc {
+
+struct FrameHeader {
+    uint32_t kind;
+    uint32_t reserved;
+    uint64_t length;
+};
+
+enum : uint32_t { INLINE = 1, MEMFD = 2 };
+
+// Bigger inline messages would run into the socket buffer limit
+// (net.core.wmem_default, ~208KB); send those as a SharedBlob
+const size_t MAX_INLINE = 64 * 1024;
+
+// ==================================================================
+// SharedBlob: memfd + its mapping (move-only)
+// ==================================================================
+class SharedBlob {
+    int fd_ = -1;
+    char* data_ = nullptr;
+    size_t size_ = 0;
+
+public:
+    SharedBlob() = default;
+    SharedBlob(const SharedBlob&) = delete;
+    SharedBlob& operator=(const SharedBlob&) = delete;
+    SharedBlob(SharedBlob&& o) noexcept { *this = std::move(o); }
+    SharedBlob& operator=(SharedBlob&& o) noexcept {
+        if(this != &o) {
+            reset();
+            std::swap(fd_, o.fd_);
+            std::swap(data_, o.data_);
+            std::swap(size_, o.size_);
+        }
+        return *this;
+    }
+    ~SharedBlob() { reset(); }
+
+    // Writable blob of `size` bytes, size sealed; invalid (!valid()) on error
+    static SharedBlob create(size_t size, const char* name = "ipc-blob") {
+        SharedBlob b;
+        int fd = memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if(fd < 0) return b;
+        if(ftruncate(fd, size) != 0 ||
+           fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+            close(fd);
+            return b;
+        }
+        b.fd_ = fd;
+        b.size_ = size;
+        if(!b.map(PROT_READ | PROT_WRITE)) b.reset();
+        return b;
+    }
+
+    // Read-only view of a received fd; takes ownership of `fd`. Refuses a
+    // file shorter than `length` or one whose size isn't sealed.
+    static SharedBlob adopt(int fd, size_t length) {
+        SharedBlob b;
+        b.fd_ = fd;
+        struct stat st;
+        int seals = fcntl(fd, F_GET_SEALS);
+        if(fstat(fd, &st) != 0 || (size_t)st.st_size < length || seals < 0 ||
+           (seals & (F_SEAL_SHRINK)) == 0) {
+            errno = EBADMSG;
+            b.reset();
+            return b;
+        }
+        b.size_ = length;
+        if(!b.map(PROT_READ)) b.reset();
+        return b;
+    }
+
+    bool valid() const { return fd_ >= 0; }
+    int fd() const { return fd_; }
+    char* data() { return data_; }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    void reset() {
+        if(data_ && size_) munmap(data_, size_);
+        if(fd_ >= 0) close(fd_);
+        fd_ = -1;
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+private:
+    bool map(int prot) {
+        if(size_ == 0) return true;
+        void* p = mmap(nullptr, size_, prot, MAP_SHARED, fd_, 0);
+        if(p == MAP_FAILED) return false;
+        data_ = (char*)p;
+        return true;
+    }
+};
+
+// ==================================================================
+// RecvBatch: preallocated slots for one recvmmsg() call
+// ==================================================================
+class RecvBatch {
+    struct Slot {
+        std::vector<char> buf;   // header + inline payload
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        iovec iov;
+        int fd = -1;             // SCM_RIGHTS fd not yet taken
+    };
+    std::vector<Slot> slots;
+    std::vector<mmsghdr> hdrs;
+    size_t count = 0;
+
+    friend class Channel;
+
+public:
+    explicit RecvBatch(size_t capacity, size_t maxInline = MAX_INLINE)
+        : slots(capacity), hdrs(capacity) {
+        for(auto& s : slots) s.buf.resize(sizeof(FrameHeader) + maxInline);
+    }
+    RecvBatch(const RecvBatch&) = delete;
+    RecvBatch& operator=(const RecvBatch&) = delete;
+    ~RecvBatch() { clear(); }
+
+    size_t size() const { return count; }
+    size_t capacity() const { return slots.size(); }
+
+    const FrameHeader& header(size_t i) const {
+        return *reinterpret_cast<const FrameHeader*>(slots[i].buf.data());
+    }
+    const char* payload(size_t i) const { return slots[i].buf.data() + sizeof(FrameHeader); }
+    size_t length(size_t i) const { return header(i).length; }
+
+    // MEMFD frame -> mapped blob (the slot's fd is consumed)
+    SharedBlob takeBlob(size_t i) {
+        int fd = slots[i].fd;
+        slots[i].fd = -1;
+        if(fd < 0 || header(i).kind != MEMFD) {
+            if(fd >= 0) close(fd);
+            errno = EBADMSG;
+            return SharedBlob();
+        }
+        return SharedBlob::adopt(fd, header(i).length);
+    }
+
+    // Drop the previous batch; closes any fds nobody took
+    void clear() {
+        for(size_t i = 0; i < count; i++) {
+            if(slots[i].fd >= 0) close(slots[i].fd);
+            slots[i].fd = -1;
+        }
+        count = 0;
+    }
+};
+
+// ==================================================================
+// Channel: one connected SOCK_SEQPACKET endpoint
+// ==================================================================
+class Channel {
+    int fd_ = -1;
+
+public:
+    Channel() = default;
+    explicit Channel(int fd) : fd_(fd) {}
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+    Channel(Channel&& o) noexcept : fd_(o.fd_) { o.fd_ = -1; }
+    Channel& operator=(Channel&& o) noexcept {
+        if(this != &o) {
+            close();
+            fd_ = o.fd_;
+            o.fd_ = -1;
+        }
+        return *this;
+    }
+    ~Channel() { close(); }
+
+    bool valid() const { return fd_ >= 0; }
+    int fd() const { return fd_; }
+    void close() {
+        if(fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+    // Connected pair without a name (for a forked child, like pipe())
+    static std::pair<Channel, Channel> pair() {
+        int sv[2];
+        if(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) != 0)
+            return {Channel(), Channel()};
+        return {Channel(sv[0]), Channel(sv[1])};
+    }
+
+    // One INLINE message; header and payload are gathered by the kernel
+    // (iovec), not copied together first
+    bool send(const void* data, size_t len) {
+        if(len > MAX_INLINE) {
+            errno = EMSGSIZE;
+            return false;
+        }
+        FrameHeader h{INLINE, 0, len};
+        iovec iov[2] = {{&h, sizeof(h)}, {const_cast<void*>(data), len}};
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = len ? 2 : 1;
+        return sendAll(msg, sizeof(h) + len);
+    }
+
+    // Many INLINE messages in as few sendmmsg() calls as the socket buffer
+    // allows; returns how many were sent (all of them unless an error)
+    size_t sendBatch(const std::vector<std::pair<const void*, size_t>>& msgs) {
+        std::vector<FrameHeader> heads(msgs.size());
+        std::vector<iovec> iovs(msgs.size() * 2);
+        std::vector<mmsghdr> hdrs(msgs.size());
+        for(size_t i = 0; i < msgs.size(); i++) {
+            if(msgs[i].second > MAX_INLINE) {
+                errno = EMSGSIZE;
+                return 0;
+            }
+            heads[i] = FrameHeader{INLINE, 0, msgs[i].second};
+            iovs[2 * i] = {&heads[i], sizeof(FrameHeader)};
+            iovs[2 * i + 1] = {const_cast<void*>(msgs[i].first), msgs[i].second};
+            hdrs[i] = mmsghdr{};
+            hdrs[i].msg_hdr.msg_iov = &iovs[2 * i];
+            hdrs[i].msg_hdr.msg_iovlen = 2;
+        }
+        size_t sent = 0;
+        while(sent < msgs.size()) {
+            int n = sendmmsg(fd_, &hdrs[sent], msgs.size() - sent, MSG_NOSIGNAL);
+            if(n < 0) {
+                if(errno == EINTR) continue;
+                break;
+            }
+            sent += n;
+        }
+        return sent;
+    }
+
+    // Hand over a blob: the receiver gets its own fd for the same memory.
+    // The sender may keep (or drop) its SharedBlob; both views stay valid.
+    bool sendBlob(const SharedBlob& blob) {
+        FrameHeader h{MEMFD, 0, blob.size()};
+        iovec iov = {&h, sizeof(h)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsghdr* c = CMSG_FIRSTHDR(&msg);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type = SCM_RIGHTS;
+        c->cmsg_len = CMSG_LEN(sizeof(int));
+        int fd = blob.fd();
+        memcpy(CMSG_DATA(c), &fd, sizeof(int));
+        return sendAll(msg, sizeof(h));
+    }
+
+    // Blocks until at least one message is available, then takes up to
+    // batch.capacity() that are already queued (one recvmmsg). Returns the
+    // number received; 0 = peer closed; -1 = error (EBADMSG: a message
+    // was truncated or malformed)
+    int recvBatch(RecvBatch& batch) {
+        batch.clear();
+        size_t cap = batch.slots.size();
+        for(size_t i = 0; i < cap; i++) {
+            RecvBatch::Slot& s = batch.slots[i];
+            s.iov = {s.buf.data(), s.buf.size()};
+            mmsghdr& m = batch.hdrs[i];
+            m = mmsghdr{};
+            m.msg_hdr.msg_iov = &s.iov;
+            m.msg_hdr.msg_iovlen = 1;
+            m.msg_hdr.msg_control = s.control;
+            m.msg_hdr.msg_controllen = sizeof(s.control);
+        }
+        int n;
+        do {
+            // MSG_WAITFORONE: block for the first, then take what's queued
+            n = recvmmsg(fd_, batch.hdrs.data(), cap, MSG_WAITFORONE | MSG_CMSG_CLOEXEC, nullptr);
+        } while(n < 0 && errno == EINTR);
+        if(n <= 0) return n;
+
+        // A closed peer shows up as zero-length datagrams (every real frame
+        // has a header): stop the batch there
+        int end = 0;
+        while(end < n && batch.hdrs[end].msg_len > 0) end++;
+        n = end;
+
+        batch.count = n;
+        bool bad = false;
+        for(int i = 0; i < n; i++) {
+            msghdr& m = batch.hdrs[i].msg_hdr;
+            for(cmsghdr* c = CMSG_FIRSTHDR(&m); c; c = CMSG_NXTHDR(&m, c)) {
+                if(c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+                size_t fds = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                for(size_t k = 0; k < fds; k++) {
+                    int fd;
+                    memcpy(&fd, CMSG_DATA(c) + k * sizeof(int), sizeof(int));
+                    if(batch.slots[i].fd < 0) batch.slots[i].fd = fd;
+                    else ::close(fd);   // one fd per frame; never leak extras
+                }
+            }
+            size_t got = batch.hdrs[i].msg_len;
+            const FrameHeader& h = batch.header(i);
+            if((m.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) || got < sizeof(FrameHeader) ||
+               (h.kind == INLINE && got != sizeof(FrameHeader) + h.length) ||
+               (h.kind == MEMFD && batch.slots[i].fd < 0) ||
+               (h.kind != INLINE && h.kind != MEMFD))
+                bad = true;
+        }
+        if(bad) {
+            batch.clear();
+            errno = EBADMSG;
+            return -1;
+        }
+        return n;
+    }
+
+private:
+    bool sendAll(msghdr& msg, size_t expect) {
+        ssize_t n;
+        do {
+            n = sendmsg(fd_, &msg, MSG_NOSIGNAL);
+        } while(n < 0 && errno == EINTR);
+        return n == (ssize_t)expect;   // SEQPACKET: all or nothing
+    }
+};
+
+// ==================================================================
+// Naming: listen / connect by path
+// ==================================================================
+inline bool makeAddress(const std::string& path, sockaddr_un& addr, socklen_t& len) {
+    addr = sockaddr_un{};
+    addr.sun_family = AF_UNIX;
+    if(path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    memcpy(addr.sun_path, path.data(), path.size());
+    if(path[0] == '@') addr.sun_path[0] = '\0';   // abstract namespace
+    len = offsetof(sockaddr_un, sun_path) + path.size() + (path[0] == '@' ? 0 : 1);
+    return true;
+}
+
+class Listener {
+    int fd_ = -1;
+    std::string path_;
+
+public:
+    explicit Listener(const std::string& path, int backlog = 64) : path_(path) {
+        sockaddr_un addr;
+        socklen_t len;
+        if(!makeAddress(path, addr, len)) return;
+        if(path[0] != '@') unlink(path.c_str());   // stale socket from a dead server
+        fd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if(fd_ < 0) return;
+        if(bind(fd_, (sockaddr*)&addr, len) != 0 || listen(fd_, backlog) != 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+    Listener(const Listener&) = delete;
+    Listener& operator=(const Listener&) = delete;
+    ~Listener() {
+        if(fd_ >= 0) {
+            ::close(fd_);
+            if(path_[0] != '@') unlink(path_.c_str());
+        }
+    }
+
+    bool valid() const { return fd_ >= 0; }
+
+    Channel accept() {
+        int c;
+        do {
+            c = ::accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        } while(c < 0 && errno == EINTR);
+        return Channel(c);
+    }
+};
+
+inline Channel connectTo(const std::string& path) {
+    sockaddr_un addr;
+    socklen_t len;
+    if(!makeAddress(path, addr, len)) return Channel();
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if(fd < 0) return Channel();
+    if(connect(fd, (sockaddr*)&addr, len) != 0) {
+        ::close(fd);
+        return Channel();
+    }
+    return Channel(fd);
+}
+
+}  // namespace ipc
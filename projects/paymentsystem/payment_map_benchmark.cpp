@@ -0,0 +1,212 @@
+// payment_map_benchmark.cpp
+// PaymentService's method table under concurrent load:
+// std::unordered_map + std::shared_mutex vs ConcurrentHashMap
+// (synchronization/concurrent_hash_map.h).
+//
+// Build: make FILE=payment_map_benchmark.cpp CXXFLAGS="-std=c++17 -O2 -Wall -Wextra -pthread" run
+// Args:  ./payment_map_benchmark [threads] [ms_per_run] [keys]   (defaults: 4, 300 ms, 100000)
+//
+// Workload: keys "user<N>:upi". A read looks a method up by string_view and
+// takes a reference to it (what makePayment() does). A write registers or
+// removes a method (half each, over twice the prefilled key range), so the
+// map keeps inserting, erasing and resizing while readers run.
+//
+// Note the baseline must build a std::string for every lookup: C++17
+// unordered_map has no heterogeneous find().
+
+#include "../../synchronization/concurrent_hash_map.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <shared_mutex>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+// Same interface as payment_system.cpp, without the console output
+class Pay
+{
+public:
+    virtual void doPayment() = 0;
+    virtual ~Pay() = default;
+};
+
+class UPI : public Pay
+{
+private:
+    string upiId;
+
+public:
+    UPI(string id) : upiId(move(id)) {}
+    void doPayment() override {}
+};
+
+// ============================================================================
+// BASELINE: unordered_map behind a reader-writer lock
+// ============================================================================
+
+class LockedPaymentTable
+{
+private:
+    unordered_map<string, shared_ptr<Pay>> paymethod;
+    mutable shared_mutex rw;
+
+public:
+    bool insert_or_assign(string_view name, shared_ptr<Pay> pm)
+    {
+        unique_lock<shared_mutex> lock(rw);
+        return paymethod.insert_or_assign(string(name), move(pm)).second;
+    }
+
+    bool erase(string_view name)
+    {
+        unique_lock<shared_mutex> lock(rw);
+        return paymethod.erase(string(name)) > 0;
+    }
+
+    bool find(string_view name, shared_ptr<Pay> &out) const
+    {
+        shared_lock<shared_mutex> lock(rw);
+        auto it = paymethod.find(string(name)); // allocates when the key exceeds SSO
+        if (it == paymethod.end())
+            return false;
+        out = it->second;
+        return true;
+    }
+
+    size_t size() const
+    {
+        shared_lock<shared_mutex> lock(rw);
+        return paymethod.size();
+    }
+
+    static const char *name() { return "unordered_map+shared_mutex"; }
+};
+
+class ConcurrentPaymentTable : public ConcurrentHashMap<shared_ptr<Pay>>
+{
+public:
+    static const char *name() { return "ConcurrentHashMap"; }
+};
+
+// ============================================================================
+// BENCHMARK
+// ============================================================================
+
+struct Result
+{
+    double mops;
+    long netInserts;
+    size_t finalSize;
+};
+
+template <typename Table>
+Result run(const vector<string> &keys, size_t prefill, int threads, int readPercent, chrono::milliseconds duration)
+{
+    Table table;
+    shared_ptr<Pay> method = make_shared<UPI>("bench@upi");
+    for (size_t i = 0; i < prefill; ++i)
+        table.insert_or_assign(keys[i], method);
+
+    atomic<bool> start{false}, stop{false};
+    atomic<long> ops{0}, net{0};
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&, t]()
+                             {
+            mt19937_64 rng(t * 7919 + 1);
+            long mine = 0, delta = 0;
+            shared_ptr<Pay> found;
+            while (!start.load(memory_order_acquire))
+                this_thread::yield();
+            while (!stop.load(memory_order_relaxed))
+            {
+                uint64_t r = rng();
+                string_view key = keys[r % keys.size()];
+                if (int((r >> 32) % 100) < readPercent)
+                    table.find(key, found);
+                else if ((r >> 40) & 1)
+                    delta += table.insert_or_assign(key, method) ? 1 : 0;
+                else
+                    delta -= table.erase(key) ? 1 : 0;
+                ++mine;
+            }
+            ops += mine;
+            net += delta; });
+    }
+
+    auto begin = chrono::steady_clock::now();
+    start.store(true, memory_order_release);
+    this_thread::sleep_for(duration);
+    stop = true;
+    for (auto &w : workers)
+        w.join();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    return {ops.load() / secs / 1e6, net.load(), table.size()};
+}
+
+int main(int argc, char **argv)
+{
+    int threads = argc > 1 ? atoi(argv[1]) : 4;
+    chrono::milliseconds duration(argc > 2 ? atoi(argv[2]) : 300);
+    size_t prefill = argc > 3 ? strtoull(argv[3], nullptr, 10) : 100000;
+    if (threads < 1 || prefill < 1)
+    {
+        cerr << "usage: " << argv[0] << " [threads >= 1] [ms_per_run] [keys >= 1]\n";
+        return 1;
+    }
+
+    // Long enough to defeat the small-string optimization, like real ids
+    vector<string> keys(prefill * 2);
+    for (size_t i = 0; i < keys.size(); ++i)
+        keys[i] = "user" + to_string(1000000 + i) + ":upi-primary";
+
+    cout << "--- PaymentService method table: " << threads << " threads, " << prefill
+         << " methods, " << duration.count() << " ms per run ---\n\n";
+
+    // Single-threaded sanity check, including a resize from the minimum size
+    {
+        ConcurrentHashMap<int> m;
+        int n = int(min<size_t>(keys.size(), 5000)); // keys.size() is even and >= 2
+        bool ok = true;
+        for (int i = 0; i < n; ++i)
+            ok &= m.insert_or_assign(keys[i], i);
+        for (int i = 0; i < n; i += 2)
+            ok &= m.erase(keys[i]);
+        for (int i = 0, v = 0; i < n; ++i)
+            ok &= m.find(keys[i], v) == (i % 2 == 1) && (i % 2 == 0 || v == i);
+        ok &= m.size() == size_t(n / 2) && !m.insert_or_assign(keys[1], 42);
+        cout << "Sequential check: " << (ok ? "ok" : "FAILED") << " (capacity grew to " << m.capacity() << ")\n\n";
+        if (!ok)
+            return 1;
+    }
+
+    cout << setw(8) << "read %" << setw(30) << "unordered_map+shared_mutex" << setw(20) << "ConcurrentHashMap"
+         << setw(10) << "ratio" << setw(12) << "size check" << endl;
+
+    bool allOk = true;
+    for (int readPct : {100, 95, 50})
+    {
+        Result base = run<LockedPaymentTable>(keys, prefill, threads, readPct, duration);
+        Result conc = run<ConcurrentPaymentTable>(keys, prefill, threads, readPct, duration);
+        // Every successful insert/erase is reflected in the final size
+        bool ok = size_t(long(prefill) + base.netInserts) == base.finalSize &&
+                  size_t(long(prefill) + conc.netInserts) == conc.finalSize;
+        allOk &= ok;
+        cout << setw(8) << readPct << fixed << setprecision(2) << setw(23) << base.mops << " Mops/s"
+             << setw(13) << conc.mops << " Mops/s" << setw(9) << conc.mops / base.mops << "x"
+             << setw(12) << (ok ? "ok" : "MISMATCH") << endl;
+    }
+    return allOk ? 0 : 1;
+}
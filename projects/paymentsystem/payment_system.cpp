@@ -1,8 +1,8 @@
 #include <iostream>
 #include <vector>
 #include <string>
-#include <unordered_map>
 #include <memory>
+#include "../../synchronization/concurrent_hash_map.h" // lock-free reads, safe to share across threads
 using namespace std;
 
 /*
@@ -161,28 +161,30 @@ public:
     }
 };
 // PaymentService: Manages multiple payment methods using smart pointers
+// Backed by ConcurrentHashMap: makePayment() may run on many threads while
+// addPayment() registers new methods, without a global lock.
 class PaymentService
 {
 private:
-    unordered_map<string, shared_ptr<Pay>> paymethod; // Store payment methods with RAII
+    ConcurrentHashMap<shared_ptr<Pay>> paymethod; // Store payment methods with RAII
 
 public:
     // Add a payment method to the service (using smart pointer for memory management)
     void addPayment(const string &paymentname, shared_ptr<Pay> pm)
     {
-        paymethod[paymentname] = pm; // Automatic memory management via shared_ptr
+        paymethod.insert_or_assign(paymentname, move(pm)); // Automatic memory management via shared_ptr
         cout << "Added payment method: " << paymentname << endl;
     }
 
     // Make payment using polymorphism (runtime dispatch to correct doPayment())
-    void makePayment(const string &name)
+    void makePayment(string_view name)
     {
-        if (paymethod.find(name) == paymethod.end())
+        shared_ptr<Pay> p; // our own reference: stays valid even if the method is replaced meanwhile
+        if (!paymethod.find(name, p))
         {
             cout << "Error: Payment method '" << name << "' not found!\n";
             return;
         }
-        shared_ptr<Pay> p = paymethod[name];
         p->doPayment(); // POLYMORPHISM: Calls correct derived class method at runtime
     }
 };
@@ -0,0 +1,172 @@
+/*
+ * PROBLEM: The Bidirectional Chat on an I/O Engine (io_uring / epoll)
+ *
+ * Same chat as 02_ipc_pipe_bidirectional.cpp - two pipes, parent sends,
+ * child answers "Child received: <msg>", "exit" quits - but the message
+ * loop goes through ../io_engine/io_engine.h instead of blocking
+ * read()/write():
+ *
+ *   02 (blocking), per message:         03 (engine), per message:
+ *     parent: write(), read()             parent: [write -> read] linked,
+ *     child:  read(),  write()                    ONE io_uring_enter()
+ *     = 4 syscalls                        child:  [reply write -> next read]
+ *                                                 linked, ONE io_uring_enter()
+ *                                         = 2 syscalls
+ *
+ * Linked ops (IOSQE_IO_LINK) keep the protocol order that 02 gets from
+ * blocking: the read of the reply is only started after the write went out
+ * in full. Without io_uring (old kernel, container seccomp) the engine falls
+ * back to epoll; run with IO_ENGINE=epoll to force it.
+ *
+ * Expected Output:
+ *   [Parent] Chat started on io_uring. Type 'exit' to quit.
+ *   [Parent] Enter message: hello
+ *   [Child] Received: hello
+ *   [Parent] Child replied: Child received: hello
+ *   [Parent] Enter message: exit
+ *   [Parent] Exiting... (1 messages, 1 syscalls)
+ *   [Child] Parent disconnected. Exiting... (1 messages, 2 syscalls)
+ * (the child's extra one is the very first read, before any reply)
+ *
+ * Non-interactive: printf 'hello\nworld\nexit\n' | ./program
+ * Numbers for many messages: ../io_engine/io_bench.cpp
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../io_engine/io_engine.h"
+using namespace std;
+
+int main()
+{
+    cout << "Hello understanding IPC on an I/O engine.." << endl; // flushed before fork
+
+    int pipe_p2c[2]; // Parent writes to [1], Child reads from [0]
+    int pipe_c2p[2]; // Child writes to [1], Parent reads from [0]
+    if (pipe(pipe_p2c) == -1 || pipe(pipe_c2p) == -1)
+    {
+        cout << "error creating pipes\n";
+        return 1;
+    }
+
+    pid_t anotherprocess = fork();
+    if (anotherprocess < 0)
+    {
+        cout << "another process creation failed\n";
+        return 1;
+    }
+
+    if (anotherprocess == 0)
+    {
+        close(pipe_p2c[1]);
+        close(pipe_c2p[0]);
+
+        // Each process builds its own engine AFTER fork: a ring is per process
+        auto engine = io::makeEngine(8);
+        vector<io::Completion> done;
+        char cbuff[1000];
+        string response;
+        size_t messages = 0, inFlight = 1;
+
+        cout << "[Child " << getpid() << "] Ready to receive messages...\n";
+        engine->prepRead(pipe_p2c[0], cbuff, sizeof(cbuff), 1);
+        while (true)
+        {
+            // One syscall: submit [reply write -> this read], wait for both
+            int n = 0;
+            done.clear();
+            engine->wait(done, inFlight);
+            for (auto &c : done)
+                if (c.userData == 1)
+                    n = c.res;
+
+            if (n <= 0 || strcmp(cbuff, "exit") == 0)
+            {
+                cout << "[Child] Parent disconnected. Exiting... (" << messages << " messages, "
+                     << engine->syscalls() << " syscalls)\n";
+                break;
+            }
+            cout << "[Child] Received: " << cbuff << endl;
+            ++messages;
+
+            // Queue the reply and, linked behind it, the read of the next
+            // message; both go out with the next wait()
+            response = "Child received: " + string(cbuff);
+            engine->prepWrite(pipe_c2p[1], response.c_str(), response.length() + 1, 2);
+            engine->linkLast();
+            engine->prepRead(pipe_p2c[0], cbuff, sizeof(cbuff), 1);
+            inFlight = 2;
+        }
+
+        engine->forget(pipe_p2c[0]);
+        engine->forget(pipe_c2p[1]);
+        close(pipe_p2c[0]);
+        close(pipe_c2p[1]);
+    }
+    else
+    {
+        close(pipe_p2c[0]);
+        close(pipe_c2p[1]);
+
+        auto engine = io::makeEngine(8);
+        // Both buffers live for the whole chat: register them once
+        static char sendBuf[1000], recvBuf[1000];
+        engine->registerBuffers({{sendBuf, sizeof(sendBuf)}, {recvBuf, sizeof(recvBuf)}});
+        vector<io::Completion> done;
+        size_t messages = 0;
+
+        cout << "[Parent " << getpid() << "] Chat started on " << engine->name() << ". Type 'exit' to quit.\n";
+
+        while (true)
+        {
+            cout << "[Parent] Enter message: ";
+            string pInput;
+            if (!getline(cin, pInput))
+                pInput = "exit"; // stdin closed
+            pInput = pInput.substr(0, sizeof(sendBuf) - 1);
+            memcpy(sendBuf, pInput.c_str(), pInput.length() + 1);
+            unsigned len = pInput.length() + 1;
+
+            done.clear();
+            if (pInput == "exit")
+            {
+                uint64_t calls = engine->syscalls();
+                engine->prepWriteFixed(pipe_p2c[1], 0, len, 1);
+                engine->wait(done, 1);
+                cout << "[Parent] Exiting... (" << messages << " messages, " << calls << " syscalls)\n";
+                break;
+            }
+
+            // Send, then (linked) read the reply: one submit-and-wait
+            engine->prepWriteFixed(pipe_p2c[1], 0, len, 1);
+            engine->linkLast();
+            engine->prepReadFixed(pipe_c2p[0], 1, sizeof(recvBuf), 2);
+            engine->wait(done, 2);
+            ++messages;
+
+            bool replied = false;
+            for (auto &c : done)
+                replied |= c.userData == 2 && c.res > 0;
+            if (!replied)
+            {
+                cout << "[Parent] Child is gone. Exiting...\n";
+                break;
+            }
+            cout << "[Parent] Child replied: " << recvBuf << endl
+                 << endl;
+        }
+
+        engine->forget(pipe_p2c[1]);
+        engine->forget(pipe_c2p[0]);
+        close(pipe_p2c[1]);
+        close(pipe_c2p[0]);
+
+        wait(nullptr);
+    }
+
+    return 0;
+}
@@ -37,71 +37,149 @@
  * - Process creation and replacement
  * - Inter-process communication via pipes
  * - Shell pipeline implementation internals
+ *
+ * Builtin Mode (./program --builtin ["ls [dir] | wc -l"]):
+ *   Counting a directory should not take two processes. With --builtin,
+ *   `ls` and `wc -l` run inside this process (csim_builtins.h), the way a
+ *   shell runs its builtins:
+ *   - `ls DIR | wc -l` as a whole: count getdents64() entries, no fork,
+ *     no exec, no pipe, no sorting, no text
+ *   - `wc -l FILE`: mmap + SIMD newline count
+ *   - `ls DIR`: getdents64 + sort, written in 1MB chunks
+ *   - a pipeline with other commands (`ls | grep x | wc -l`): one child per
+ *     stage as below; builtin stages skip the exec, the rest exec as usual
+ *   Without --builtin every stage is exec'd (the original lesson).
+ *
+ *   ./program                                  exec: ls | wc -l
+ *   ./program "ls /tmp | wc -l"                exec, any pipeline
+ *   ./program --builtin "ls /data | wc -l"     in-process count
+ *
+ * Benchmark vs the exec pipeline (1M entries, multi-GB file): csim_bench.cpp
  */
 
 #include <iostream>
 #include <vector>
 #include <string>
+#include <cstring>
 #include <unistd.h>
+#include <sys/wait.h>
+#include "csim_builtins.h"
 using namespace std;
 
-int main()
+// One child per stage; stage i reads from pipe i-1 and writes into pipe i.
+// With builtins on, a builtin stage runs its C++ code in the child instead
+// of exec'ing a binary.
+int runPipeline(const vector<builtin::Stage> &stages, bool builtins)
 {
-    cout << "Hello simulating shell command 'ls | wc -l'\n";
-    cout << "Main program PID: " << getpid() << endl;
-    int p1, p2;
-
-    // Create ONE pipe: ls → wc (you only need one pipe for unidirectional flow)
-    int pipefd[2];
+    size_t n = stages.size();
+    vector<int> fds; // pipe i = fds[2i] (read end), fds[2i+1] (write end)
 
-    if (pipe(pipefd) == -1)
+    // Create n-1 pipes: one between each pair of neighbours
+    for (size_t i = 0; i + 1 < n; i++)
     {
-        cout << "Pipe creation failed\n";
-        return 1;
+        int pipefd[2];
+        if (pipe(pipefd) == -1)
+        {
+            cout << "Pipe creation failed\n";
+            return 1;
+        }
+        fds.push_back(pipefd[0]);
+        fds.push_back(pipefd[1]);
     }
 
-    // Child 1: Execute 'ls' and send output to pipe
-    p1 = fork();
-    if (p1 == 0)
+    vector<pid_t> children;
+    for (size_t i = 0; i < n; i++)
     {
-        cout << "[Child 1 - ls] PID: " << getpid() << endl;
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            cout << "[Child " << i + 1 << " - " << stages[i][0] << "] PID: " << getpid() << endl;
 
-        // Redirect stdout to pipe write end
-        dup2(pipefd[1], STDOUT_FILENO); // ls output goes to pipe
+            // Redirect stdin from the previous pipe, stdout into the next one
+            if (i > 0)
+                dup2(fds[2 * (i - 1)], STDIN_FILENO);
+            if (i + 1 < n)
+                dup2(fds[2 * i + 1], STDOUT_FILENO);
 
-        // Close both pipe ends (dup2 already copied the fd)
-        close(pipefd[0]);
-        close(pipefd[1]);
+            // Close every pipe end (dup2 already copied the ones we use)
+            for (int fd : fds)
+                close(fd);
 
-        execlp("ls", "ls", nullptr);
-        exit(1); // Only if exec fails
-    }
+            if (builtins && builtin::isBuiltin(stages[i]))
+                _exit(builtin::runBuiltin(stages[i], STDIN_FILENO, STDOUT_FILENO));
 
-    // Child 2: Execute 'wc -l' and read input from pipe
-    p2 = fork();
-    if (p2 == 0)
-    { 
-        cout << "[Child 2 - wc] PID: " << getpid() << endl;
+            vector<char *> argv;
+            for (auto &word : stages[i])
+                argv.push_back(const_cast<char *>(word.c_str()));
+            argv.push_back(nullptr);
+            execvp(argv[0], argv.data());
+            perror(argv[0]);
+            _exit(127); // Only if exec fails
+        }
+        children.push_back(pid);
+    }
 
-        // Redirect stdin from pipe read end
-        dup2(pipefd[0], STDIN_FILENO); // wc reads from pipe
+    // Parent: Close pipe ends and wait for all children
+    for (int fd : fds)
+        close(fd);
 
-        // Close both pipe ends
-        close(pipefd[0]);
-        close(pipefd[1]);
+    cout << "[Parent] PID: " << getpid() << " - Waiting for children...\n";
+    int status = 0;
+    for (pid_t pid : children)
+        waitpid(pid, &status, 0); // exit status of the last stage is the pipeline's
+    cout << "[Parent] All " << n << " children completed!\n";
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
 
-        execlp("wc", "wc", "-l", nullptr);
-        exit(1); // Only if exec fails
+int main(int argc, char *argv[])
+{
+    bool builtins = false;
+    string line = "ls | wc -l";
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--builtin") == 0)
+            builtins = true;
+        else
+            line = argv[i];
     }
 
-    // Parent: Close pipe ends and wait for both children
-    close(pipefd[0]);
-    close(pipefd[1]);
+    cout << "Hello simulating shell command '" << line << "'" << (builtins ? " (builtin mode)" : "") << "\n";
+    cout << "Main program PID: " << getpid() << endl;
 
-    cout << "[Parent] PID: " << getpid() << " - Waiting for children...\n";
-    wait(NULL); // Wait for child 1
-    wait(NULL); // Wait for child 2
-    cout << "[Parent] Both children completed!\n";
+    vector<builtin::Stage> stages = builtin::parsePipeline(line);
+    for (auto &stage : stages)
+    {
+        if (stage.empty())
+        {
+            cout << "Empty command in pipeline\n";
+            return 1;
+        }
+    }
+
+    if (builtins)
+    {
+        builtin::Listing mode;
+        string dir;
+        if (builtin::isCountPipeline(stages, mode, dir))
+        {
+            // Nothing to list, only to count: no processes at all
+            builtin::DirStats stats;
+            if (!builtin::countEntries(dir.c_str(), mode, stats))
+            {
+                perror(dir.c_str());
+                return 2;
+            }
+            cout << stats.entries << endl;
+            cout << "[Builtin] " << stats.syscalls << " getdents64 calls, 0 processes\n";
+            return 0;
+        }
+        if (stages.size() == 1 && builtin::isBuiltin(stages[0]))
+        {
+            cout.flush();
+            return builtin::runBuiltin(stages[0], STDIN_FILENO, STDOUT_FILENO);
+        }
+    }
 
-    return 0;
-}
\ No newline at end of file
+    cout.flush(); // or the children inherit (and print) our buffered output
+    return runPipeline(stages, builtins);
+}
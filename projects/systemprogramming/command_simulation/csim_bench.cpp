@@ -0,0 +1,300 @@
+/*
+ * PROBLEM: What does `ls | wc -l` cost when the directory is huge?
+ *
+ * csim.cpp --builtin replaces the exec'd ls and wc with in-process code
+ * (csim_builtins.h). This benchmark builds a directory with N empty files
+ * and a multi-GB text file, then times every way of counting them:
+ *
+ *   Directory (N entries):
+ *     exec  ls | wc -l        fork+exec both, ls sorts N names, pipe
+ *     exec  ls -U | wc -l     same, unsorted (shows what the sort costs)
+ *     readdir() count         libc, 32KB getdents buffer
+ *     getdents64 32KB         builtin with readdir's buffer size
+ *     getdents64 1MB          builtin (csim --builtin "ls DIR | wc -l")
+ *   File (file_mb):
+ *     exec  wc -l FILE        coreutils wc
+ *     scalar memchr loop      over mmap
+ *     SSE2 / AVX2             over mmap (AVX2 only if the CPU has it)
+ *     AVX2 over read()        1MB chunks instead of mmap
+ *
+ * Each is run 3 times, best time kept; the file is in the page cache after
+ * the first pass (that's what a polling monitor sees). Every method must
+ * report the same count.
+ *
+ * Expected (1M entries, 2GB, one CPU here):
+ *   - directory: exec ls | wc -l ~2 s, of which ~1.4 s is ls sorting;
+ *     the builtin count ~0.33 s (~6x). A 1MB buffer needs 40 getdents64
+ *     calls instead of ~1200, but that barely shows: the time is the
+ *     file system producing 1M entries, not syscall entry
+ *   - file: scalar memchr pays a call per line (~60 bytes); AVX2 over
+ *     mmap ~6 GB/s, SSE2 ~4.6. coreutils 9.x wc -l is vectorized too, so
+ *     exec is on par with SSE2: the gain there is the fork/exec and
+ *     read() copies, ~25% per pass
+ *
+ * Build: make FILE=csim_bench.cpp CXXFLAGS="-std=c++17 -O2 -Wall -Wextra" run
+ * Args:  ./program [entries] [file_mb] [work_dir]
+ *        (defaults: 1000000, 2048, /tmp) - needs file_mb of disk + N inodes
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/wait.h>
+#include "csim_builtins.h"
+using namespace std;
+
+double nowSeconds()
+{
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Fork+exec every stage like csim.cpp does, return the last stage's stdout
+string execPipeline(const vector<builtin::Stage> &stages)
+{
+    int out[2];
+    if (pipe(out) == -1)
+        return "";
+    size_t n = stages.size();
+    int prevRead = -1;
+    vector<pid_t> children;
+    for (size_t i = 0; i < n; i++)
+    {
+        int link[2] = {-1, -1};
+        if (i + 1 < n && pipe(link) == -1)
+            return "";
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            if (prevRead != -1)
+                dup2(prevRead, STDIN_FILENO);
+            dup2(i + 1 < n ? link[1] : out[1], STDOUT_FILENO);
+            vector<char *> argv;
+            for (auto &word : stages[i])
+                argv.push_back(const_cast<char *>(word.c_str()));
+            argv.push_back(nullptr);
+            closefrom(3);
+            execvp(argv[0], argv.data());
+            _exit(127);
+        }
+        children.push_back(pid);
+        if (prevRead != -1)
+            close(prevRead);
+        if (i + 1 < n)
+        {
+            close(link[1]);
+            prevRead = link[0];
+        }
+    }
+    close(out[1]);
+    string result;
+    char buf[4096];
+    ssize_t r;
+    while ((r = read(out[0], buf, sizeof(buf))) > 0)
+        result.append(buf, r);
+    close(out[0]);
+    for (pid_t pid : children)
+        waitpid(pid, nullptr, 0);
+    return result;
+}
+
+struct Row
+{
+    string name;
+    double seconds;
+    uint64_t count;
+    string note;
+};
+
+// Best of 3
+Row measure(const string &name, function<uint64_t(string &)> run)
+{
+    Row row{name, 1e30, 0, ""};
+    for (int i = 0; i < 3; i++)
+    {
+        double start = nowSeconds();
+        row.count = run(row.note);
+        row.seconds = min(row.seconds, nowSeconds() - start);
+    }
+    return row;
+}
+
+void printRows(const vector<Row> &rows, double bytes)
+{
+    double slowest = 0;
+    for (auto &r : rows)
+        slowest = max(slowest, r.seconds);
+    for (auto &r : rows)
+    {
+        cout << "  " << left << setw(24) << r.name << right << fixed << setprecision(2) << setw(10)
+             << r.seconds * 1e3 << " ms" << setw(12) << r.count;
+        if (bytes > 0)
+            cout << setprecision(1) << setw(8) << bytes / r.seconds / 1e9 << " GB/s";
+        cout << setprecision(1) << setw(8) << slowest / r.seconds << "x";
+        if (!r.note.empty())
+            cout << "   " << r.note;
+        cout << "\n";
+    }
+}
+
+bool makeDirectory(const string &dir, size_t entries)
+{
+    if (mkdir(dir.c_str(), 0755) == -1 && errno != EEXIST)
+        return false;
+    int dfd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    char name[32];
+    for (size_t i = 0; i < entries; i++)
+    {
+        snprintf(name, sizeof(name), "ingest_%08zu.dat", i);
+        int fd = openat(dfd, name, O_CREAT | O_WRONLY | O_CLOEXEC, 0644);
+        if (fd == -1)
+            return false;
+        close(fd);
+    }
+    close(dfd);
+    return true;
+}
+
+void removeDirectory(const string &dir)
+{
+    int dfd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    vector<string> names;
+    builtin::forEachEntry(dir.c_str(), builtin::Listing::Almost, [&](const char *name, unsigned char) { names.emplace_back(name); });
+    for (auto &name : names)
+        unlinkat(dfd, name.c_str(), 0);
+    close(dfd);
+    rmdir(dir.c_str());
+}
+
+bool makeTextFile(const string &path, size_t mb)
+{
+    // Log-like lines of 10..110 bytes
+    mt19937 rng(7);
+    string block;
+    while (block.size() < (4 << 20))
+    {
+        size_t len = 10 + rng() % 100;
+        for (size_t i = 0; i < len; i++)
+            block += (char)('a' + rng() % 26);
+        block += '\n';
+    }
+    int fd = open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0644);
+    if (fd == -1)
+        return false;
+    size_t total = mb << 20;
+    for (size_t written = 0; written < total; written += block.size())
+        if (!builtin::writeAll(fd, block.data(), min(block.size(), total - written)))
+            return false;
+    close(fd);
+    return true;
+}
+
+uint64_t parseCount(const string &text)
+{
+    return strtoull(text.c_str(), nullptr, 10);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t entries = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t fileMb = argc > 2 ? strtoull(argv[2], nullptr, 10) : 2048;
+    string work = argc > 3 ? argv[3] : "/tmp";
+    string dir = work + "/csim_bench_dir_" + to_string(getpid());
+    string file = work + "/csim_bench_" + to_string(getpid()) + ".log";
+
+    cout << "CSIM BUILTINS vs EXEC PIPELINE\n";
+    cout << "==============================\n";
+    cout << "newline kernel on this CPU: " << builtin::kernelName(builtin::bestKernel()) << "\n";
+
+    double start = nowSeconds();
+    if (!makeDirectory(dir, entries))
+    {
+        perror("creating the directory");
+        removeDirectory(dir);
+        return 1;
+    }
+    cout << "\n1. Directory with " << entries << " entries (created in " << fixed << setprecision(1)
+         << nowSeconds() - start << " s)\n";
+
+    vector<Row> rows;
+    rows.push_back(measure("exec ls | wc -l", [&](string &) {
+        return parseCount(execPipeline({{"ls", dir}, {"wc", "-l"}}));
+    }));
+    rows.push_back(measure("exec ls -U | wc -l", [&](string &) {
+        return parseCount(execPipeline({{"ls", "-U", dir}, {"wc", "-l"}}));
+    }));
+    rows.push_back(measure("readdir() count", [&](string &) {
+        uint64_t n = 0;
+        DIR *d = opendir(dir.c_str());
+        while (dirent *e = readdir(d))
+            n += builtin::listed(e->d_name, builtin::Listing::Visible);
+        closedir(d);
+        return n;
+    }));
+    for (size_t buffer : {size_t(32 << 10), size_t(1 << 20)})
+    {
+        string name = string("getdents64 ") + (buffer == (1 << 20) ? "1MB" : "32KB");
+        rows.push_back(measure(name, [&, buffer](string &note) {
+            builtin::DirStats stats;
+            builtin::countEntries(dir.c_str(), builtin::Listing::Visible, stats, buffer);
+            note = to_string(stats.syscalls) + " syscalls";
+            return stats.entries;
+        }));
+    }
+    printRows(rows, 0);
+    removeDirectory(dir);
+    // Checked now: the directory rows are cleared before the file rows
+    bool agree = true;
+    for (auto &r : rows)
+        agree &= r.count == rows[0].count;
+
+    start = nowSeconds();
+    if (!makeTextFile(file, fileMb))
+    {
+        perror("creating the file");
+        unlink(file.c_str());
+        return 1;
+    }
+    cout << "\n2. " << fileMb << " MB text file (written in " << setprecision(1) << nowSeconds() - start << " s)\n";
+
+    rows.clear();
+    double bytes = (double)(fileMb << 20);
+    rows.push_back(measure("exec wc -l FILE", [&](string &) { return parseCount(execPipeline({{"wc", "-l", file}})); }));
+    vector<builtin::Kernel> kernels = {builtin::Kernel::Scalar};
+    if (builtin::bestKernel() != builtin::Kernel::Scalar)
+        kernels.push_back(builtin::Kernel::SSE2);
+    if (builtin::bestKernel() == builtin::Kernel::AVX2)
+        kernels.push_back(builtin::Kernel::AVX2);
+    for (auto k : kernels)
+    {
+        rows.push_back(measure(string(builtin::kernelName(k)) + " over mmap", [&, k](string &) {
+            int fd = open(file.c_str(), O_RDONLY);
+            uint64_t lines = 0;
+            builtin::countLines(fd, lines, k);
+            close(fd);
+            return lines;
+        }));
+    }
+    rows.push_back(measure(string(builtin::kernelName(kernels.back())) + " over read()", [&](string &) {
+        int fd = open(file.c_str(), O_RDONLY);
+        uint64_t lines = 0;
+        builtin::countLines(fd, lines, kernels.back(), true);
+        close(fd);
+        return lines;
+    }));
+    printRows(rows, bytes);
+    unlink(file.c_str());
+
+    for (auto &r : rows)
+        agree &= r.count == rows[0].count;
+    cout << "\ncounts agree: " << (agree ? "yes" : "NO") << "\n";
+    return agree ? 0 : 1;
+}
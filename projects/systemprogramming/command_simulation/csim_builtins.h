@@ -0,0 +1,389 @@
+/*
+ * csim_builtins.h
+ * In-process versions of `ls` and `wc -l` for csim.cpp's builtin mode.
+ *
+ * `ls | wc -l` the shell way = 2 fork()s, 2 execve()s (each maps a new
+ * binary and its libraries), ls sorting every name, every name copied
+ * through a pipe, and wc scanning the copy. To COUNT a directory none of
+ * that is needed:
+ *
+ *   countEntries(dir)   getdents64() straight into a 1MB buffer: one
+ *                       syscall returns tens of thousands of entries
+ *                       (readdir() refills a 32KB buffer, ~1000 entries).
+ *                       Nothing is sorted, copied or formatted.
+ *   countLines(fd)      regular file: mmap() it and count '\n' with a
+ *                       SIMD kernel (SSE2: 16 bytes per compare, AVX2: 32);
+ *                       pipes and terminals: read() 1MB chunks, same kernel.
+ *
+ * Counting kernel: compare a vector of bytes with '\n' (0xFF where equal),
+ * SUBTRACT that from per-byte counters (0xFF = -1, so each match adds 1),
+ * and fold the byte counters into 64-bit sums with psadbw every 255
+ * vectors, before a byte counter could overflow. No branch per byte, no
+ * popcount per vector. AVX2 is picked at run time (__builtin_cpu_supports)
+ * so the binary still runs on machines without it.
+ *
+ * The pipeline helpers decide what runs in-process: `ls` with -1/-a/-A and
+ * at most one directory, `wc -l` with at most one file. Anything else
+ * (other commands, other flags) is exec'd as before.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace builtin
+{
+    // ========================================================================
+    // DIRECTORIES: getdents64
+    // ========================================================================
+
+    // Layout the kernel fills in (not exported by glibc headers)
+    struct LinuxDirent64
+    {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+
+    struct DirStats
+    {
+        uint64_t entries = 0;  // what `ls` would print (see Listing)
+        uint64_t syscalls = 0; // getdents64 calls
+    };
+
+    enum class Listing
+    {
+        Visible, // ls:    skip names starting with '.'
+        Almost,  // ls -A: skip only "." and ".."
+        All      // ls -a
+    };
+
+    inline bool listed(const char *name, Listing mode)
+    {
+        if (name[0] != '.' || mode == Listing::All)
+            return true;
+        if (mode == Listing::Visible)
+            return false;
+        return !(name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+    }
+
+    // Calls f(name, d_type) for every entry `ls` would show, in directory
+    // order. bufferSize = bytes handed to each getdents64 call.
+    template <typename F>
+    bool forEachEntry(const char *path, Listing mode, F f, DirStats *stats = nullptr, size_t bufferSize = 1 << 20)
+    {
+        int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd == -1)
+            return false;
+        std::vector<char> buf(bufferSize);
+        while (true)
+        {
+            long n = syscall(SYS_getdents64, fd, buf.data(), buf.size());
+            if (stats)
+                stats->syscalls++;
+            if (n <= 0)
+            {
+                int err = errno;
+                close(fd);
+                errno = err;
+                return n == 0;
+            }
+            for (long off = 0; off < n;)
+            {
+                auto *d = reinterpret_cast<LinuxDirent64 *>(buf.data() + off);
+                if (listed(d->d_name, mode))
+                {
+                    if (stats)
+                        stats->entries++;
+                    f(d->d_name, d->d_type);
+                }
+                off += d->d_reclen;
+            }
+        }
+    }
+
+    inline bool countEntries(const char *path, Listing mode, DirStats &out, size_t bufferSize = 1 << 20)
+    {
+        out = DirStats();
+        return forEachEntry(path, mode, [](const char *, unsigned char) {}, &out, bufferSize);
+    }
+
+    // ========================================================================
+    // NEWLINE COUNTING
+    // ========================================================================
+
+    enum class Kernel
+    {
+        Scalar, // memchr() loop (what a simple wc does)
+        SSE2,
+        AVX2
+    };
+
+    inline const char *kernelName(Kernel k)
+    {
+        return k == Kernel::AVX2 ? "AVX2" : k == Kernel::SSE2 ? "SSE2" : "scalar";
+    }
+
+    inline uint64_t countScalar(const char *p, size_t n)
+    {
+        uint64_t lines = 0;
+        const char *end = p + n;
+        while ((p = static_cast<const char *>(memchr(p, '\n', end - p))) != nullptr)
+        {
+            ++lines;
+            ++p;
+        }
+        return lines;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    __attribute__((target("sse2"))) inline uint64_t countSSE2(const char *p, size_t n)
+    {
+        const __m128i nl = _mm_set1_epi8('\n');
+        const __m128i zero = _mm_setzero_si128();
+        __m128i total = zero;
+        size_t i = 0;
+        while (i + 16 <= n)
+        {
+            __m128i bytes = zero; // per-byte counters, at most 255 each
+            size_t blocks = std::min<size_t>((n - i) / 16, 255);
+            for (size_t b = 0; b < blocks; b++, i += 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+                bytes = _mm_sub_epi8(bytes, _mm_cmpeq_epi8(v, nl));
+            }
+            total = _mm_add_epi64(total, _mm_sad_epu8(bytes, zero));
+        }
+        uint64_t lanes[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), total);
+        return lanes[0] + lanes[1] + countScalar(p + i, n - i);
+    }
+
+    __attribute__((target("avx2"))) inline uint64_t countAVX2(const char *p, size_t n)
+    {
+        const __m256i nl = _mm256_set1_epi8('\n');
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i total = zero;
+        size_t i = 0;
+        while (i + 32 <= n)
+        {
+            __m256i bytes = zero;
+            size_t blocks = std::min<size_t>((n - i) / 32, 255);
+            for (size_t b = 0; b < blocks; b++, i += 32)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+                bytes = _mm256_sub_epi8(bytes, _mm256_cmpeq_epi8(v, nl));
+            }
+            total = _mm256_add_epi64(total, _mm256_sad_epu8(bytes, zero));
+        }
+        uint64_t lanes[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), total);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] + countSSE2(p + i, n - i);
+    }
+#endif
+
+    inline Kernel bestKernel()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        if (__builtin_cpu_supports("avx2"))
+            return Kernel::AVX2;
+        if (__builtin_cpu_supports("sse2"))
+            return Kernel::SSE2;
+#endif
+        return Kernel::Scalar;
+    }
+
+    inline uint64_t countNewlines(const char *p, size_t n, Kernel k)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        if (k == Kernel::AVX2)
+            return countAVX2(p, n);
+        if (k == Kernel::SSE2)
+            return countSSE2(p, n);
+#endif
+        return countScalar(p, n);
+    }
+
+    // Regular files are mapped; anything else (pipe, tty, socket) is read
+    // in 1MB chunks. forceRead skips the mapping (for comparison).
+    inline bool countLines(int fd, uint64_t &lines, Kernel k, bool forceRead = false)
+    {
+        lines = 0;
+        struct stat st;
+        if (!forceRead && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+        {
+            void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+            if (map != MAP_FAILED)
+            {
+                madvise(map, st.st_size, MADV_SEQUENTIAL);
+                lines = countNewlines(static_cast<const char *>(map), st.st_size, k);
+                munmap(map, st.st_size);
+                return true;
+            }
+        }
+        std::vector<char> buf(1 << 20);
+        while (true)
+        {
+            ssize_t n = read(fd, buf.data(), buf.size());
+            if (n == 0)
+                return true;
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            lines += countNewlines(buf.data(), n, k);
+        }
+    }
+
+    // ========================================================================
+    // PIPELINE
+    // ========================================================================
+
+    using Stage = std::vector<std::string>; // argv of one command
+
+    // "ls /data | wc -l" -> {{"ls", "/data"}, {"wc", "-l"}}. Whitespace
+    // separated words; no quoting (this is not a shell).
+    inline std::vector<Stage> parsePipeline(const std::string &line)
+    {
+        std::vector<Stage> stages(1);
+        std::istringstream in(line);
+        std::string word;
+        while (in >> word)
+        {
+            if (word == "|")
+                stages.emplace_back();
+            else
+                stages.back().push_back(word);
+        }
+        return stages;
+    }
+
+    // `ls [-1] [-a | -A] [dir]` -> mode + directory
+    inline bool parseLs(const Stage &s, Listing &mode, std::string &dir)
+    {
+        if (s.empty() || s[0] != "ls")
+            return false;
+        mode = Listing::Visible;
+        dir = ".";
+        int dirs = 0;
+        for (size_t i = 1; i < s.size(); i++)
+        {
+            if (s[i] == "-1")
+                continue;
+            else if (s[i] == "-a")
+                mode = Listing::All;
+            else if (s[i] == "-A")
+                mode = Listing::Almost;
+            else if (s[i][0] == '-')
+                return false; // -l, -R, ...: let the real ls do it
+            else
+            {
+                dir = s[i];
+                dirs++;
+            }
+        }
+        struct stat st;
+        return dirs <= 1 && stat(dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    }
+
+    // `wc -l [file]` -> file ("" = stdin)
+    inline bool parseWcLines(const Stage &s, std::string &file)
+    {
+        if (s.size() < 2 || s.size() > 3 || s[0] != "wc" || s[1] != "-l")
+            return false;
+        file = s.size() == 3 ? s[2] : "";
+        return true;
+    }
+
+    inline bool isBuiltin(const Stage &s)
+    {
+        Listing mode;
+        std::string path;
+        return parseLs(s, mode, path) || parseWcLines(s, path);
+    }
+
+    inline bool writeAll(int fd, const char *p, size_t n)
+    {
+        while (n > 0)
+        {
+            ssize_t w = write(fd, p, n);
+            if (w < 0 && errno == EINTR)
+                continue;
+            if (w <= 0)
+                return false;
+            p += w;
+            n -= w;
+        }
+        return true;
+    }
+
+    // Run one builtin stage reading `in`, writing `out`; returns an exit code
+    inline int runBuiltin(const Stage &s, int in, int out)
+    {
+        Listing mode;
+        std::string path;
+        if (parseLs(s, mode, path))
+        {
+            // ls prints sorted names; this is the C-locale (byte) order
+            std::vector<std::string> names;
+            if (!forEachEntry(path.c_str(), mode, [&](const char *name, unsigned char) { names.emplace_back(name); }))
+                return 2;
+            std::sort(names.begin(), names.end());
+            std::string text;
+            for (auto &name : names)
+            {
+                text += name;
+                text += '\n';
+                if (text.size() >= (1 << 20))
+                {
+                    if (!writeAll(out, text.data(), text.size()))
+                        return 2;
+                    text.clear();
+                }
+            }
+            return writeAll(out, text.data(), text.size()) ? 0 : 2;
+        }
+        if (parseWcLines(s, path))
+        {
+            int fd = path.empty() ? in : open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd == -1)
+                return 1;
+            uint64_t lines;
+            bool ok = countLines(fd, lines, bestKernel());
+            if (!path.empty())
+                close(fd);
+            if (!ok)
+                return 1;
+            std::string text = std::to_string(lines) + (path.empty() ? "" : " " + path) + "\n";
+            return writeAll(out, text.data(), text.size()) ? 0 : 1;
+        }
+        return 127;
+    }
+
+    // The whole pipeline is `ls [dir] | wc -l`: nothing needs to be listed,
+    // only counted
+    inline bool isCountPipeline(const std::vector<Stage> &stages, Listing &mode, std::string &dir)
+    {
+        std::string file;
+        return stages.size() == 2 && parseLs(stages[0], mode, dir) && parseWcLines(stages[1], file) && file.empty();
+    }
+}
@@ -0,0 +1,509 @@
+/*
+ * csim_executor.h
+ * Run many independent pipelines, at most P at a time (xargs -P style).
+ *
+ * csim.cpp starts one pipeline and blocks in wait(NULL) until it is done.
+ * With thousands of jobs and a cap of P running at once, blocking on one
+ * child is wrong: whichever job finishes first must free its slot, and its
+ * output must be drained while it runs (a pipe holds 64KB; a job writing
+ * more blocks until someone reads). So everything goes through ONE epoll
+ * set:
+ *
+ *   - each stage's pidfd (pidfd_open): readable when that process exits,
+ *     then waitid(P_PIDFD) reaps exactly it. No SIGCHLD handler, no
+ *     waitpid(-1) stealing children from other code. Kernels without
+ *     pidfd_open (< 5.3) fall back to signalfd(SIGCHLD) + waitpid(WNOHANG)
+ *     on the pids we started; so does a single stage whose pidfd_open
+ *     fails (e.g. EMFILE)
+ *   - each job's output pipe (non-blocking read end): drained as it fills
+ *
+ * A job is done when all its stages are reaped AND its output hit EOF;
+ * its slot is then refilled from the job list.
+ *
+ * Output is captured into POOLED 64KB chunks: a job appends to chunks taken
+ * from a free list and gives them back after the result callback, so
+ * memory is bounded by what the P running jobs hold at once, not by the
+ * output of every job that passed through.
+ *
+ * Stages are started with posix_spawnp() (vfork-style: no page table copy
+ * of this process per child). Every fd the executor owns is O_CLOEXEC;
+ * the spawned stage only keeps the two it got through dup2. The first
+ * stage reads /dev/null, as with xargs: a `cat` job must not sit on our
+ * terminal. Children get the signal mask from before SIGCHLD was blocked
+ * for the signalfd. With builtins
+ * on, `ls`/`wc -l` stages (csim_builtins.h) are fork()ed and run in C++.
+ *
+ * Usage:
+ *   executor::Executor ex({8, false});
+ *   ex.run(lines, [](const executor::Result &r) { ...r.pieces... });
+ *   ex.stats();
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <unistd.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include "csim_builtins.h"
+
+extern char **environ;
+
+namespace executor
+{
+    inline uint64_t nowNs()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+    }
+
+    // Fixed-size chunks handed out from a free list
+    class BufferPool
+    {
+    public:
+        static constexpr size_t CHUNK = 64 * 1024;
+
+        uint32_t acquire()
+        {
+            if (freeList.empty())
+            {
+                chunks.emplace_back(new char[CHUNK]);
+                freeList.push_back(chunks.size() - 1);
+            }
+            uint32_t c = freeList.back();
+            freeList.pop_back();
+            inUse++;
+            highWater = std::max(highWater, inUse);
+            return c;
+        }
+
+        void release(uint32_t c)
+        {
+            freeList.push_back(c);
+            inUse--;
+        }
+
+        char *data(uint32_t c) { return chunks[c].get(); }
+        size_t allocated() const { return chunks.size(); }
+        size_t peak() const { return highWater; }
+
+    private:
+        std::vector<std::unique_ptr<char[]>> chunks;
+        std::vector<uint32_t> freeList;
+        size_t inUse = 0, highWater = 0;
+    };
+
+    struct Result
+    {
+        size_t id;                                       // line number in the job list, from 0
+        const std::string *line;
+        int status;                                      // last stage: exit code, or 128 + signal
+        uint64_t startNs, endNs;                         // first stage spawned .. job done
+        size_t bytes;                                    // output captured
+        bool truncated;                                  // more than Options::outputLimit
+        std::vector<std::pair<const char *, size_t>> pieces; // the output; valid during the callback
+    };
+
+    struct Options
+    {
+        int parallel = 4;
+        bool builtins = false;
+        size_t outputLimit = 16 << 20; // per job; the rest is read and dropped
+    };
+
+    struct Stats
+    {
+        size_t jobs = 0, failed = 0;
+        uint64_t bytes = 0;
+        double seconds = 0;
+        size_t poolChunks = 0, poolPeak = 0;
+        const char *reaper = "";
+    };
+
+    class Executor
+    {
+    public:
+        using Callback = std::function<void(const Result &)>;
+
+        explicit Executor(Options opt) : opt(opt) {}
+
+        // Runs every line of `jobs` (one pipeline each) and calls done()
+        // as each finishes, in completion order. False if setup failed.
+        bool run(const std::vector<std::string> &jobs, Callback done)
+        {
+            epfd = epoll_create1(EPOLL_CLOEXEC);
+            if (epfd == -1)
+                return false;
+            statistics = Stats();
+            int probe = (int)syscall(SYS_pidfd_open, getpid(), 0);
+            usePidfd = probe != -1;
+            pollReap = false;
+            if (usePidfd)
+                close(probe);
+            else if (!startSignalfd())
+            {
+                close(epfd);
+                return false;
+            }
+            statistics.reaper = usePidfd ? "pidfd" : "signalfd(SIGCHLD)";
+            devNull = open("/dev/null", O_RDONLY | O_CLOEXEC); // -1: stage 0 inherits stdin
+
+            slots.assign(std::max(1, opt.parallel), Slot());
+            uint64_t begin = nowNs();
+            size_t next = 0, running = 0;
+
+            while (next < jobs.size() || running > 0)
+            {
+                // Fill every free slot; a job that could not start is finished here,
+                // since no fd of its would ever wake the loop
+                for (size_t s = 0; s < slots.size(); s++)
+                {
+                    while (!slots[s].active && next < jobs.size())
+                    {
+                        if (launch(s, next, jobs[next]))
+                            running++;
+                        else
+                            finish(s, done);
+                        next++;
+                    }
+                }
+                if (running == 0)
+                    continue;
+
+                epoll_event events[64];
+                int n = epoll_wait(epfd, events, 64, pollReap ? 1 : -1);
+                if (n < 0 && errno != EINTR)
+                    break;
+                if (pollReap)
+                    reapAny();
+                for (int i = 0; i < n; i++)
+                {
+                    uint64_t tag = events[i].data.u64;
+                    if (tag == SIGNAL_TAG)
+                        reapAny();
+                    else if ((tag >> 32) == OUTPUT)
+                        drain(tag & 0xffffffff);
+                    else
+                        reap(tag & 0xffffffff, (tag >> 32) - STAGE);
+                }
+                for (size_t s = 0; s < slots.size(); s++)
+                {
+                    if (slots[s].active && slots[s].alive == 0 && slots[s].outFd == -1)
+                    {
+                        finish(s, done);
+                        running--;
+                    }
+                }
+            }
+
+            statistics.seconds = (nowNs() - begin) / 1e9;
+            statistics.poolChunks = pool.allocated();
+            statistics.poolPeak = pool.peak();
+            stopSignalfd();
+            if (devNull != -1)
+                close(devNull);
+            devNull = -1;
+            close(epfd);
+            return true;
+        }
+
+        const Stats &stats() const { return statistics; }
+
+    private:
+        static constexpr uint64_t SIGNAL_TAG = ~0ull;
+        // tag = kind << 32 | slot; kind OUTPUT, or STAGE + stage index
+        static constexpr uint64_t OUTPUT = 1, STAGE = 2;
+
+        struct Slot
+        {
+            bool active = false;
+            size_t id = 0;
+            const std::string *line = nullptr;
+            std::vector<pid_t> pids;
+            std::vector<int> pidfds;
+            std::vector<int> statuses;
+            size_t alive = 0;
+            int outFd = -1;
+            std::vector<uint32_t> chunks;
+            size_t bytes = 0, dropped = 0;
+            uint64_t startNs = 0;
+        };
+
+        Options opt;
+        BufferPool pool;
+        std::vector<Slot> slots;
+        Stats statistics;
+        int epfd = -1, sigfd = -1, devNull = -1;
+        bool usePidfd = true;
+        bool pollReap = false; // neither a pidfd nor a signalfd: poll waitpid every 1 ms
+        sigset_t savedMask;
+
+        bool startSignalfd()
+        {
+            sigset_t set;
+            sigemptyset(&set);
+            sigaddset(&set, SIGCHLD);
+            sigprocmask(SIG_BLOCK, &set, &savedMask);
+            sigfd = signalfd(-1, &set, SFD_CLOEXEC | SFD_NONBLOCK);
+            if (sigfd == -1)
+            {
+                sigprocmask(SIG_SETMASK, &savedMask, nullptr);
+                return false;
+            }
+            add(sigfd, SIGNAL_TAG);
+            return true;
+        }
+
+        // A stage we could not get a pidfd for is reaped by pid instead
+        void watchWithoutPidfd()
+        {
+            if (sigfd != -1 || pollReap)
+                return;
+            if (startSignalfd())
+            {
+                statistics.reaper = "pidfd + signalfd(SIGCHLD)";
+                reapAny(); // a SIGCHLD that came before the block was discarded: look now
+            }
+            else
+            {
+                pollReap = true;
+                statistics.reaper = "pidfd + waitpid polling";
+            }
+        }
+
+        void stopSignalfd()
+        {
+            if (sigfd == -1)
+                return;
+            close(sigfd);
+            sigfd = -1;
+            sigprocmask(SIG_SETMASK, &savedMask, nullptr);
+        }
+
+        void add(int fd, uint64_t tag)
+        {
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.u64 = tag;
+            epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+        }
+
+        // Explicit DEL: close() alone leaves a pidfd in the set while other
+        // children are alive, and its stale event then names a reused slot
+        void remove(int fd)
+        {
+            epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+            close(fd);
+        }
+
+        // False: no output pipe, nothing was started and the job is over
+        bool launch(size_t s, size_t id, const std::string &line)
+        {
+            Slot &slot = slots[s];
+            slot.active = true;
+            slot.id = id;
+            slot.line = &line;
+            slot.bytes = slot.dropped = 0;
+            slot.startNs = nowNs();
+
+            std::vector<builtin::Stage> stages = builtin::parsePipeline(line);
+            size_t n = stages.size();
+            slot.pids.assign(n, -1);
+            slot.pidfds.assign(n, -1);
+            slot.statuses.assign(n, 127);
+            slot.alive = 0;
+
+            int out[2];
+            if (pipe2(out, O_CLOEXEC) == -1)
+            {
+                slot.outFd = -1;
+                return false;
+            }
+            // Only our end: a non-blocking stdout makes the stage's writes fail with EAGAIN
+            fcntl(out[0], F_SETFL, O_NONBLOCK);
+            int prevRead = -1;
+            for (size_t i = 0; i < n; i++)
+            {
+                int link[2] = {-1, -1};
+                if (i + 1 < n && pipe2(link, O_CLOEXEC) == -1)
+                    break;
+                int in = i == 0 ? devNull : prevRead, outFd = i + 1 < n ? link[1] : out[1];
+                pid_t pid = stages[i].empty() ? -1 : spawn(stages[i], in, outFd);
+                if (pid > 0)
+                {
+                    slot.pids[i] = pid;
+                    slot.alive++;
+                    if (usePidfd)
+                    {
+                        slot.pidfds[i] = (int)syscall(SYS_pidfd_open, pid, 0);
+                        if (slot.pidfds[i] != -1)
+                            add(slot.pidfds[i], (STAGE + i) << 32 | s);
+                        else
+                            watchWithoutPidfd();
+                    }
+                }
+                if (prevRead != -1)
+                    close(prevRead);
+                if (i + 1 < n)
+                {
+                    close(link[1]);
+                    prevRead = link[0];
+                }
+            }
+            if (prevRead != -1)
+                close(prevRead);
+            close(out[1]); // EOF once every writer (the last stage) is gone
+            slot.outFd = out[0];
+            add(slot.outFd, OUTPUT << 32 | s);
+            return true;
+        }
+
+        // stdin <- in (-1: inherit), stdout -> out
+        pid_t spawn(const builtin::Stage &stage, int in, int out)
+        {
+            if (opt.builtins && builtin::isBuiltin(stage))
+            {
+                pid_t pid = fork();
+                if (pid == 0)
+                {
+                    if (sigfd != -1)
+                        sigprocmask(SIG_SETMASK, &savedMask, nullptr);
+                    if (in != -1)
+                        dup2(in, STDIN_FILENO);
+                    dup2(out, STDOUT_FILENO);
+                    closefrom(3);
+                    _exit(builtin::runBuiltin(stage, STDIN_FILENO, STDOUT_FILENO));
+                }
+                return pid;
+            }
+            posix_spawn_file_actions_t actions;
+            posix_spawn_file_actions_init(&actions);
+            if (in != -1)
+                posix_spawn_file_actions_adddup2(&actions, in, STDIN_FILENO);
+            posix_spawn_file_actions_adddup2(&actions, out, STDOUT_FILENO);
+            std::vector<char *> argv;
+            for (auto &word : stage)
+                argv.push_back(const_cast<char *>(word.c_str()));
+            argv.push_back(nullptr);
+            // Unblock SIGCHLD again in the child when the signalfd holds it blocked
+            posix_spawnattr_t attr;
+            posix_spawnattr_init(&attr);
+            if (sigfd != -1)
+            {
+                posix_spawnattr_setsigmask(&attr, &savedMask);
+                posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+            }
+            pid_t pid = -1;
+            int err = posix_spawnp(&pid, argv[0], &actions, &attr, argv.data(), environ);
+            posix_spawnattr_destroy(&attr);
+            posix_spawn_file_actions_destroy(&actions);
+            return err == 0 ? pid : -1; // not found: the stage counts as exit 127
+        }
+
+        void drain(size_t s)
+        {
+            Slot &slot = slots[s];
+            while (slot.outFd != -1)
+            {
+                size_t used = slot.bytes % BufferPool::CHUNK;
+                bool room = slot.bytes < opt.outputLimit;
+                if (room && (slot.chunks.empty() || (used == 0 && slot.bytes > 0)))
+                {
+                    slot.chunks.push_back(pool.acquire());
+                    used = 0;
+                }
+                char scratch[4096];
+                char *dst = room ? pool.data(slot.chunks.back()) + used : scratch;
+                size_t len = room ? std::min(BufferPool::CHUNK - used, opt.outputLimit - slot.bytes) : sizeof(scratch);
+                ssize_t r = read(slot.outFd, dst, len);
+                if (r > 0)
+                {
+                    (room ? slot.bytes : slot.dropped) += r;
+                    continue;
+                }
+                if (r < 0 && errno == EINTR)
+                    continue;
+                if (r < 0 && errno == EAGAIN)
+                    return;
+                remove(slot.outFd); // EOF (or error)
+                slot.outFd = -1;
+            }
+        }
+
+        static int decode(int status)
+        {
+            return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        }
+
+        void reap(size_t s, size_t stage)
+        {
+            Slot &slot = slots[s];
+            siginfo_t info{};
+            // WNOHANG: a wrong wakeup must never block the whole loop
+            if (waitid((idtype_t)P_PIDFD, slot.pidfds[stage], &info, WEXITED | WNOHANG) == -1 || info.si_pid == 0)
+                return;
+            slot.statuses[stage] = info.si_code == CLD_EXITED ? info.si_status : 128 + info.si_status;
+            remove(slot.pidfds[stage]);
+            slot.pidfds[stage] = -1;
+            slot.pids[stage] = -1;
+            slot.alive--;
+        }
+
+        // Only the stages without a pidfd: waitpid(-1) would also take
+        // children whose pidfd is still waiting to be reaped through
+        void reapAny()
+        {
+            signalfd_siginfo si;
+            while (sigfd != -1 && read(sigfd, &si, sizeof(si)) == sizeof(si))
+            {
+            }
+            for (auto &slot : slots)
+            {
+                for (size_t i = 0; i < slot.pids.size(); i++)
+                {
+                    int status;
+                    if (slot.pids[i] == -1 || slot.pidfds[i] != -1 || waitpid(slot.pids[i], &status, WNOHANG) <= 0)
+                        continue;
+                    slot.statuses[i] = decode(status);
+                    slot.pids[i] = -1;
+                    slot.alive--;
+                }
+            }
+        }
+
+        void finish(size_t s, Callback &done)
+        {
+            Slot &slot = slots[s];
+            Result r{slot.id, slot.line, slot.statuses.back(), slot.startNs, nowNs(), slot.bytes, slot.dropped > 0, {}};
+            size_t left = slot.bytes;
+            for (uint32_t c : slot.chunks)
+            {
+                size_t len = std::min(left, BufferPool::CHUNK);
+                r.pieces.emplace_back(pool.data(c), len);
+                left -= len;
+            }
+            done(r);
+            for (uint32_t c : slot.chunks)
+                pool.release(c);
+            slot.chunks.clear();
+            slot.active = false;
+            statistics.jobs++;
+            statistics.failed += r.status != 0;
+            statistics.bytes += slot.bytes;
+        }
+    };
+}
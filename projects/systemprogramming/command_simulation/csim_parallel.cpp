@@ -0,0 +1,234 @@
+/*
+ * PROBLEM: Run a list of pipelines, at most P at a time, like xargs -P.
+ *
+ * csim.cpp runs one pipeline and blocks in wait(NULL). Here a job list
+ * (one pipeline per line, from a file or stdin) goes through
+ * csim_executor.h: up to P pipelines run at once, one epoll set reaps
+ * their processes through pidfds and drains their output pipes into pooled
+ * buffers, and each job's output is printed as a block when it finishes:
+ *
+ *   [job 3] exit 0, 12.41 ms, 6 bytes: seq 1 5000 | wc -l
+ *   5000
+ *
+ * followed by per-job latency percentiles and jobs/s.
+ *
+ * --bench N generates N mixed jobs (echo, seq | wc -l, sleep 0.01,
+ * ls | wc -l, a 1.2MB seq output) and compares a sequential run
+ * (fork+exec, read to EOF, wait - what csim.cpp does per line) with the
+ * executor at several P.
+ *
+ * Expected (one CPU here): sequential ~165-190 jobs/s; P=4 ~2x, P=16
+ * ~2.7x: the sleeps overlap and what is left is fork/exec CPU time. Past
+ * that, more P only stretches each job (p99 grows ~linearly with P) for no
+ * more jobs/s. The pool peaks at what the running jobs hold at once (~19
+ * chunks per 1.2MB seq), not at the total output.
+ *
+ * Build: make FILE=csim_parallel.cpp CXXFLAGS="-std=c++17 -O2 -Wall -Wextra" run
+ * Args:  ./program [-P n] [--builtin] [-q] [jobs_file]   (default P=4, stdin)
+ *        ./program --bench [jobs]                          (default 400)
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "csim_executor.h"
+using namespace std;
+
+struct Summary
+{
+    double seconds;
+    vector<double> latencyMs;
+    size_t failed;
+};
+
+double percentile(vector<double> v, double p)
+{
+    if (v.empty())
+        return 0;
+    sort(v.begin(), v.end());
+    return v[min(v.size() - 1, (size_t)(p * v.size()))];
+}
+
+void printSummary(const string &name, const Summary &s)
+{
+    size_t jobs = s.latencyMs.size();
+    cout << "  " << left << setw(16) << name << right << fixed << setprecision(0) << setw(10) << jobs / s.seconds
+         << setprecision(2) << setw(10) << percentile(s.latencyMs, 0.5) << setw(10) << percentile(s.latencyMs, 0.99)
+         << setw(10) << percentile(s.latencyMs, 1.0) << setw(8) << s.failed;
+}
+
+// One job the way csim.cpp runs it: fork+exec each stage, read the output
+// to EOF, then wait for every child
+int runBlocking(const string &line, size_t &bytes)
+{
+    vector<builtin::Stage> stages = builtin::parsePipeline(line);
+    int out[2];
+    if (stages.empty() || pipe2(out, O_CLOEXEC) == -1)
+        return 127;
+    size_t n = stages.size();
+    int prevRead = -1;
+    for (size_t i = 0; i < n; i++)
+    {
+        int link[2] = {-1, -1};
+        if (i + 1 < n && pipe2(link, O_CLOEXEC) == -1)
+            break;
+        if (fork() == 0)
+        {
+            if (prevRead != -1)
+                dup2(prevRead, STDIN_FILENO);
+            dup2(i + 1 < n ? link[1] : out[1], STDOUT_FILENO);
+            vector<char *> argv;
+            for (auto &word : stages[i])
+                argv.push_back(const_cast<char *>(word.c_str()));
+            argv.push_back(nullptr);
+            execvp(argv[0], argv.data());
+            _exit(127);
+        }
+        if (prevRead != -1)
+            close(prevRead);
+        if (i + 1 < n)
+        {
+            close(link[1]);
+            prevRead = link[0];
+        }
+    }
+    close(out[1]);
+    char buf[65536];
+    ssize_t r;
+    while ((r = read(out[0], buf, sizeof(buf))) > 0)
+        bytes += r;
+    close(out[0]);
+    int status = 0, last = 0;
+    for (size_t i = 0; i < n; i++)
+        if (wait(&status) > 0)
+            last = status; // wait(NULL) order: can't even tell which stage this was
+    return WIFEXITED(last) ? WEXITSTATUS(last) : 128 + WTERMSIG(last);
+}
+
+vector<string> benchJobs(size_t count)
+{
+    const char *mix[] = {
+        "echo hello",
+        "seq 1 5000 | wc -l",
+        "sleep 0.01",
+        "ls /usr/bin | wc -l",
+        "seq 1 200000",
+    };
+    vector<string> jobs;
+    for (size_t i = 0; i < count; i++)
+        jobs.push_back(mix[i % 5]);
+    return jobs;
+}
+
+int bench(size_t count)
+{
+    vector<string> jobs = benchJobs(count);
+    cout << "PARALLEL PIPELINE EXECUTOR\n";
+    cout << "==========================\n";
+    cout << count << " jobs: echo | seq 1 5000 | wc -l | sleep 0.01 | ls /usr/bin | wc -l | seq 1 200000 (1.2MB)\n\n";
+    cout << "  " << left << setw(16) << "run" << right << setw(10) << "jobs/s" << setw(10) << "p50 ms" << setw(10)
+         << "p99 ms" << setw(10) << "max ms" << setw(8) << "failed" << "   pool chunks (peak)\n";
+
+    Summary seq{0, {}, 0};
+    size_t seqBytes = 0;
+    uint64_t begin = executor::nowNs();
+    for (auto &line : jobs)
+    {
+        uint64_t t0 = executor::nowNs();
+        seq.failed += runBlocking(line, seqBytes) != 0;
+        seq.latencyMs.push_back((executor::nowNs() - t0) / 1e6);
+    }
+    seq.seconds = (executor::nowNs() - begin) / 1e9;
+    printSummary("sequential", seq);
+    cout << "\n";
+
+    bool agree = true;
+    const char *reaper = "";
+    for (int p : {1, 4, 16, 64})
+    {
+        executor::Executor ex({p, false});
+        Summary s{0, {}, 0};
+        ex.run(jobs, [&](const executor::Result &r) { s.latencyMs.push_back((r.endNs - r.startNs) / 1e6); });
+        s.seconds = ex.stats().seconds;
+        s.failed = ex.stats().failed;
+        agree &= ex.stats().bytes == seqBytes;
+        reaper = ex.stats().reaper;
+        printSummary("executor P=" + to_string(p), s);
+        cout << "   " << ex.stats().poolChunks << " x 64KB (" << ex.stats().poolPeak << ")\n";
+    }
+    cout << "\nreaper: " << reaper << ", output bytes agree with sequential: " << (agree ? "yes" : "NO") << "\n";
+    return agree ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    executor::Options opt;
+    bool quiet = false;
+    string path;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--bench")
+            return bench(i + 1 < argc ? strtoull(argv[i + 1], nullptr, 10) : 400);
+        if (arg == "-P" && i + 1 < argc)
+            opt.parallel = max(1, atoi(argv[++i]));
+        else if (arg == "--builtin")
+            opt.builtins = true;
+        else if (arg == "-q")
+            quiet = true;
+        else
+            path = arg;
+    }
+
+    vector<string> jobs;
+    ifstream file;
+    if (!path.empty())
+    {
+        file.open(path);
+        if (!file)
+        {
+            perror(path.c_str());
+            return 1;
+        }
+    }
+    istream &in = path.empty() ? cin : file;
+    string line;
+    while (getline(in, line))
+        if (line.find_first_not_of(" \t") != string::npos)
+            jobs.push_back(line);
+
+    vector<double> latencyMs;
+    executor::Executor ex(opt);
+    bool ok = ex.run(jobs, [&](const executor::Result &r) {
+        double ms = (r.endNs - r.startNs) / 1e6;
+        latencyMs.push_back(ms);
+        if (quiet)
+            return;
+        cout << "[job " << r.id << "] exit " << r.status << ", " << fixed << setprecision(2) << ms << " ms, "
+             << r.bytes << " bytes" << (r.truncated ? " (truncated)" : "") << ": " << *r.line << "\n";
+        for (auto &piece : r.pieces)
+            cout.write(piece.first, piece.second);
+        cout.flush();
+    });
+    if (!ok)
+    {
+        perror("executor");
+        return 1;
+    }
+
+    const executor::Stats &st = ex.stats();
+    cerr << "\n" << st.jobs << " jobs, P=" << opt.parallel << ", " << st.failed << " failed, " << fixed
+         << setprecision(2) << st.seconds << " s, " << setprecision(0) << st.jobs / max(st.seconds, 1e-9)
+         << " jobs/s\nlatency ms: p50 " << setprecision(2) << percentile(latencyMs, 0.5) << ", p90 "
+         << percentile(latencyMs, 0.9) << ", p99 " << percentile(latencyMs, 0.99) << ", max "
+         << percentile(latencyMs, 1.0) << "\noutput " << st.bytes << " bytes through " << st.poolChunks
+         << " pooled 64KB chunks (peak " << st.poolPeak << " in use), reaper " << st.reaper << "\n";
+    return st.failed ? 123 : 0; // xargs: 123 if any command failed
+}
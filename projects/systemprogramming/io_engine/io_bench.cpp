@@ -0,0 +1,411 @@
+/*
+ * PROBLEM: How many syscalls does one message really need?
+ *
+ * Every IPC example here does one blocking read()/write() per message. This
+ * benchmark runs the same workloads three ways and counts syscalls:
+ *   blocking   - plain read()/write()/pread()/pwrite(), one per operation
+ *   io_uring   - io_engine.h, ops queued in shared memory, one
+ *                io_uring_enter() submits a batch and waits for results
+ *   epoll      - io_engine.h's fallback backend, same code path
+ *
+ * Workloads:
+ *   1. Chat loop (02_ipc_pipe_bidirectional.cpp without the keyboard):
+ *      parent sends "message N", child answers "Child received: message N"
+ *      - engine parent: write LINKED to read of the reply -> 1 syscall
+ *      - engine child: reply write LINKED to the next read -> 1 syscall
+ *   2. Pipe streaming: 64-byte messages as fast as possible; the engine
+ *      queues 32 linked writes (links keep them in order) per submit.
+ *      The reader is the same blocking 64KB read() loop in all cases.
+ *   3. File: write a 64MB file in 4KB blocks, read it back, verify. Engine
+ *      keeps 32 ops in flight from 32 registered buffers (WRITE_FIXED /
+ *      READ_FIXED).
+ *
+ * Expected:
+ *   - syscalls/message: blocking 2 per side in the chat; io_uring 1; the
+ *     epoll fallback pays more (try, EAGAIN, epoll_wait, retry)
+ *   - streaming/file: io_uring ~1/32 syscall per op
+ *   - throughput: fewer syscalls is not automatically faster. A ping-pong is
+ *     bound by the wakeup of the other process, and an io_uring read that
+ *     has to wait is armed via poll first, which costs a bit more than
+ *     sleeping in read(). Buffered file writes that might block (block
+ *     allocation, inode lock) can be handed to io_uring's kernel worker
+ *     threads, which costs more than a plain pwrite(). Batches pay off
+ *     when syscall entry is the bottleneck (many fds, mitigations on,
+ *     more cores than this sandbox's one).
+ *
+ * Build: make FILE=io_bench.cpp CXXFLAGS="-std=c++17 -O2 -Wall -Wextra -pthread" run
+ * Args:  ./program [chat_messages] [stream_messages] [file_mb]
+ *        (defaults: 20000, 200000, 64)
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include "io_engine.h"
+using namespace std;
+
+const size_t MSG_BUF = 1000; // same buffer size as the chat
+const size_t STREAM_MSG = 64;
+const unsigned BATCH = 32;
+const size_t BLOCK = 4096;
+
+double secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void report(const string &name, size_t ops, double secs, double syscalls, const char *unit)
+{
+    cout << "  " << left << setw(12) << name << right << fixed << setprecision(0) << setw(12)
+         << ops / secs << " " << unit << "/s" << setprecision(2) << setw(10) << syscalls / ops
+         << " syscalls/" << unit << endl;
+}
+
+// Child -> parent: one number at the end of a run
+void sendCount(int fd, uint64_t value) { write(fd, &value, sizeof(value)); }
+
+uint64_t receiveCount(int fd)
+{
+    uint64_t value = 0;
+    read(fd, &value, sizeof(value));
+    return value;
+}
+
+// ============================================================================
+// 1. CHAT LOOP
+// ============================================================================
+
+void chatChildBlocking(int in, int out)
+{
+    uint64_t calls = 0;
+    char buf[MSG_BUF];
+    while (true)
+    {
+        ++calls;
+        if (read(in, buf, MSG_BUF) <= 0 || strcmp(buf, "exit") == 0)
+            break;
+        string response = "Child received: " + string(buf);
+        ++calls;
+        write(out, response.c_str(), response.length() + 1);
+    }
+    sendCount(out, calls);
+}
+
+void chatChildEngine(int in, int out, io::Backend backend)
+{
+    auto engine = io::makeEngine(8, backend);
+    char buf[MSG_BUF];
+    string response;
+    vector<io::Completion> done;
+    engine->prepRead(in, buf, MSG_BUF, 1);
+    size_t inFlight = 1;
+    while (true)
+    {
+        // Submits what was queued last round and waits for all of it: the
+        // reply's write finishes before the linked read even starts
+        int readRes = 0;
+        done.clear();
+        engine->wait(done, inFlight);
+        for (auto &c : done)
+            if (c.userData == 1)
+                readRes = c.res;
+        if (readRes <= 0 || strcmp(buf, "exit") == 0)
+            break;
+        response = "Child received: " + string(buf);
+        engine->prepWrite(out, response.c_str(), response.length() + 1, 2);
+        engine->linkLast(); // next read starts once the reply is out
+        engine->prepRead(in, buf, MSG_BUF, 1);
+        inFlight = 2;
+    }
+    uint64_t calls = engine->syscalls();
+    engine->forget(out);
+    sendCount(out, calls);
+}
+
+void chatParentBlocking(int out, int in, size_t messages, uint64_t &calls)
+{
+    char buf[MSG_BUF];
+    for (size_t i = 0; i < messages; ++i)
+    {
+        string msg = "message " + to_string(i);
+        write(out, msg.c_str(), msg.length() + 1);
+        read(in, buf, MSG_BUF);
+        calls += 2;
+    }
+}
+
+void chatParentEngine(int out, int in, size_t messages, io::Backend backend, uint64_t &calls)
+{
+    auto engine = io::makeEngine(8, backend);
+    static char sendBuf[MSG_BUF], recvBuf[MSG_BUF];
+    engine->registerBuffers({{sendBuf, MSG_BUF}, {recvBuf, MSG_BUF}});
+    vector<io::Completion> done;
+    for (size_t i = 0; i < messages; ++i)
+    {
+        int len = snprintf(sendBuf, MSG_BUF, "message %zu", i) + 1;
+        engine->prepWriteFixed(out, 0, len, 1);
+        engine->linkLast();
+        engine->prepReadFixed(in, 1, MSG_BUF, 2);
+        done.clear();
+        engine->wait(done, 2);
+    }
+    calls += engine->syscalls();
+    engine->forget(out);
+    engine->forget(in);
+}
+
+void chatRun(const string &name, size_t messages, bool useEngine, io::Backend backend)
+{
+    int p2c[2], c2p[2];
+    if (pipe(p2c) == -1 || pipe(c2p) == -1)
+    {
+        cout << "error creating pipes\n";
+        return;
+    }
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        close(p2c[1]);
+        close(c2p[0]);
+        if (useEngine)
+            chatChildEngine(p2c[0], c2p[1], backend);
+        else
+            chatChildBlocking(p2c[0], c2p[1]);
+        exit(0);
+    }
+    close(p2c[0]);
+    close(c2p[1]);
+
+    uint64_t calls = 0;
+    auto start = chrono::steady_clock::now();
+    if (useEngine)
+        chatParentEngine(p2c[1], c2p[0], messages, backend, calls);
+    else
+        chatParentBlocking(p2c[1], c2p[0], messages, calls);
+    double secs = secondsSince(start);
+
+    // "exit" + the child's count are outside the timed loop
+    write(p2c[1], "exit", 5);
+    uint64_t childCalls = receiveCount(c2p[0]);
+    close(p2c[1]);
+    close(c2p[0]);
+    wait(nullptr);
+    report(name, messages, secs, double(calls + childCalls), "msg");
+}
+
+// ============================================================================
+// 2. PIPE STREAMING
+// ============================================================================
+
+void streamRun(const string &name, size_t messages, bool useEngine, io::Backend backend)
+{
+    int data[2], ack[2];
+    if (pipe(data) == -1 || pipe(ack) == -1)
+    {
+        cout << "error creating pipes\n";
+        return;
+    }
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        close(data[1]);
+        close(ack[0]);
+        vector<char> buf(64 * 1024);
+        uint64_t bytes = 0;
+        ssize_t n;
+        while ((n = read(data[0], buf.data(), buf.size())) > 0)
+            bytes += n;
+        sendCount(ack[1], bytes);
+        exit(0);
+    }
+    close(data[0]);
+    close(ack[1]);
+
+    static char slots[BATCH][STREAM_MSG];
+    uint64_t calls = 0;
+    size_t failed = 0;
+    auto start = chrono::steady_clock::now();
+    if (!useEngine)
+    {
+        for (size_t i = 0; i < messages; ++i)
+        {
+            memcpy(slots[0], &i, sizeof(i));
+            write(data[1], slots[0], STREAM_MSG);
+            ++calls;
+        }
+    }
+    else
+    {
+        auto engine = io::makeEngine(BATCH * 2, backend);
+        vector<iovec> regs;
+        for (auto &slot : slots)
+            regs.push_back({slot, STREAM_MSG});
+        engine->registerBuffers(regs);
+        vector<io::Completion> done;
+        for (size_t i = 0; i < messages; i += BATCH)
+        {
+            unsigned n = (unsigned)min<size_t>(BATCH, messages - i);
+            for (unsigned k = 0; k < n; ++k)
+            {
+                size_t seq = i + k;
+                memcpy(slots[k], &seq, sizeof(seq));
+                engine->prepWriteFixed(data[1], k, STREAM_MSG, seq);
+                if (k + 1 < n)
+                    engine->linkLast(); // a pipe must see them in order
+            }
+            done.clear();
+            engine->wait(done, n); // slots are reused: wait for the batch
+            for (auto &c : done)
+                failed += c.res != (int)STREAM_MSG;
+        }
+        calls = engine->syscalls();
+        engine->forget(data[1]);
+    }
+    close(data[1]);
+    uint64_t bytes = receiveCount(ack[0]);
+    double secs = secondsSince(start);
+    close(ack[0]);
+    wait(nullptr);
+    report(name, messages, secs, double(calls), "msg");
+    if (bytes != messages * STREAM_MSG || failed)
+        cout << "    MISMATCH: reader got " << bytes << " bytes, " << failed << " failed writes" << endl;
+}
+
+// ============================================================================
+// 3. FILE
+// ============================================================================
+
+void fillBlock(char *block, size_t index)
+{
+    for (size_t w = 0; w < BLOCK / 8; ++w)
+        ((uint64_t *)block)[w] = index * 1000003 + w;
+}
+
+bool checkBlock(const char *block, size_t index)
+{
+    for (size_t w = 0; w < BLOCK / 8; ++w)
+        if (((const uint64_t *)block)[w] != index * 1000003 + w)
+            return false;
+    return true;
+}
+
+void fileRun(const string &name, const string &path, size_t blocks, bool useEngine, io::Backend backend)
+{
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        perror("open");
+        return;
+    }
+    static char slots[BATCH][BLOCK] __attribute__((aligned(4096)));
+    uint64_t calls = 0;
+    size_t bad = 0;
+
+    double writeSecs, readSecs;
+    if (!useEngine)
+    {
+        auto start = chrono::steady_clock::now();
+        for (size_t b = 0; b < blocks; ++b)
+        {
+            fillBlock(slots[0], b);
+            bad += pwrite(fd, slots[0], BLOCK, b * BLOCK) != (ssize_t)BLOCK;
+        }
+        writeSecs = secondsSince(start);
+        start = chrono::steady_clock::now();
+        for (size_t b = 0; b < blocks; ++b)
+            bad += pread(fd, slots[0], BLOCK, b * BLOCK) != (ssize_t)BLOCK || !checkBlock(slots[0], b);
+        readSecs = secondsSince(start);
+        calls = 2 * blocks;
+    }
+    else
+    {
+        auto engine = io::makeEngine(BATCH * 2, backend);
+        vector<iovec> regs;
+        for (auto &slot : slots)
+            regs.push_back({slot, BLOCK});
+        engine->registerBuffers(regs);
+        vector<io::Completion> done;
+
+        auto start = chrono::steady_clock::now();
+        for (size_t b = 0; b < blocks; b += BATCH)
+        {
+            unsigned n = (unsigned)min<size_t>(BATCH, blocks - b);
+            for (unsigned k = 0; k < n; ++k)
+            {
+                fillBlock(slots[k], b + k);
+                engine->prepWriteFixed(fd, k, BLOCK, b + k, (b + k) * BLOCK);
+            }
+            done.clear();
+            engine->wait(done, n);
+            for (auto &c : done)
+                bad += c.res != (int)BLOCK;
+        }
+        writeSecs = secondsSince(start);
+
+        start = chrono::steady_clock::now();
+        for (size_t b = 0; b < blocks; b += BATCH)
+        {
+            unsigned n = (unsigned)min<size_t>(BATCH, blocks - b);
+            for (unsigned k = 0; k < n; ++k)
+                engine->prepReadFixed(fd, k, BLOCK, k, (b + k) * BLOCK);
+            done.clear();
+            engine->wait(done, n);
+            for (auto &c : done)
+                bad += c.res != (int)BLOCK || !checkBlock(slots[c.userData], b + c.userData);
+        }
+        readSecs = secondsSince(start);
+        calls = engine->syscalls();
+        engine->forget(fd);
+    }
+    close(fd);
+    unlink(path.c_str());
+
+    double mb = double(blocks * BLOCK) / (1024 * 1024);
+    cout << "  " << left << setw(12) << name << right << fixed << setprecision(0) << setw(8)
+         << mb / writeSecs << " MB/s write" << setw(8) << mb / readSecs << " MB/s read" << setprecision(3)
+         << setw(8) << double(calls) / (2 * blocks) << " syscalls/block"
+         << (bad ? "   VERIFY FAILED" : "") << endl;
+}
+
+int main(int argc, char **argv)
+{
+    size_t chatMessages = argc > 1 ? strtoull(argv[1], nullptr, 10) : 20000;
+    size_t streamMessages = argc > 2 ? strtoull(argv[2], nullptr, 10) : 200000;
+    size_t fileMb = argc > 3 ? strtoull(argv[3], nullptr, 10) : 64;
+
+    bool haveUring = io::makeEngine(8, io::Backend::Uring) != nullptr;
+    cout << "io_uring: " << (haveUring ? "available" : "NOT available (only epoll fallback runs)") << endl;
+
+    struct Variant
+    {
+        string name;
+        bool engine;
+        io::Backend backend;
+    };
+    vector<Variant> variants = {{"blocking", false, io::Backend::Auto}};
+    if (haveUring)
+        variants.push_back({"io_uring", true, io::Backend::Uring});
+    variants.push_back({"epoll", true, io::Backend::Epoll});
+
+    cout << "\n1. Chat loop, " << chatMessages << " round trips (syscalls: both processes)" << endl;
+    for (auto &v : variants)
+        chatRun(v.name, chatMessages, v.engine, v.backend);
+
+    cout << "\n2. Pipe streaming, " << streamMessages << " x " << STREAM_MSG
+         << " B (syscalls: writer only)" << endl;
+    for (auto &v : variants)
+        streamRun(v.name, streamMessages, v.engine, v.backend);
+
+    cout << "\n3. File, " << fileMb << " MB in " << BLOCK << " B blocks, " << BATCH << " in flight" << endl;
+    string path = "io_bench_" + to_string(getpid()) + ".tmp";
+    for (auto &v : variants)
+        fileRun(v.name, path, fileMb * 1024 * 1024 / BLOCK, v.engine, v.backend);
+    return 0;
+}
@@ -0,0 +1,627 @@
+/*
+ * io_engine.h
+ * Queue I/O operations, submit many with ONE syscall, collect completions.
+ *
+ * Blocking code pays one read()/write() syscall per message (csim.cpp,
+ * 02_ipc_pipe_bidirectional.cpp, 02_ipc_pipe_basics.cpp). An Engine instead:
+ *
+ *   engine->prepWrite(fd, msg, len, 1);     // queued, nothing happens yet
+ *   engine->linkLast();                     // next op starts only if this one
+ *   engine->prepRead(fd2, buf, 1000, 2);    //   completes in full
+ *   engine->wait(done, 2);                  // submit both + wait: 1 syscall
+ *
+ * Backends:
+ *   io_uring (raw syscalls + <linux/io_uring.h>, no liburing):
+ *     submission queue (SQ) and completion queue (CQ) are rings shared with
+ *     the kernel via mmap. Queueing an op = writing a 64-byte SQE into
+ *     shared memory; io_uring_enter() hands over everything queued so far
+ *     and optionally waits for completions, in the same call.
+ *     - batched submission: N queued ops -> 1 io_uring_enter()
+ *     - registered buffers: IORING_REGISTER_BUFFERS pins the pages once;
+ *       READ_FIXED / WRITE_FIXED skip the per-op page lookup + pinning
+ *     - linked ops (IOSQE_IO_LINK): a chain runs in order; if one op fails
+ *       or is short, the rest complete with -ECANCELED
+ *   epoll (fallback when io_uring_setup fails: old kernel, seccomp'd
+ *   container, kernel.io_uring_disabled):
+ *     tries each op right away on a non-blocking fd; on EAGAIN it parks the
+ *     op until epoll reports the fd ready. Same API and semantics (order,
+ *     links, -ECANCELED, fixed buffers are plain buffers), more syscalls.
+ *     Regular files are never "not ready": their ops just run synchronously.
+ *
+ * makeEngine() picks io_uring and falls back to epoll; IO_ENGINE=epoll in
+ * the environment forces the fallback (for comparison).
+ *
+ * Results follow io_uring: res >= 0 is the byte count, res < 0 is -errno.
+ * Offsets: -1 = the fd's current position (pipes, sockets); >= 0 = pread /
+ * pwrite style.
+ *
+ * Caveats:
+ *   - the epoll backend sets O_NONBLOCK on the fds it is given; that flag
+ *     lives in the open file description, so it is shared with forked
+ *     copies of the fd that are still open
+ *   - call forget(fd) before closing an fd the engine has used (the epoll
+ *     backend keeps it registered)
+ *   - all members are for one thread
+ */
+
+#pragma once
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace io
+{
+    struct Completion
+    {
+        uint64_t userData;
+        int32_t res; // bytes, or -errno
+    };
+
+    enum class Backend
+    {
+        Auto,
+        Uring,
+        Epoll
+    };
+
+    class Engine
+    {
+    protected:
+        uint64_t syscallCount = 0;
+
+    public:
+        virtual ~Engine() = default;
+        virtual const char *name() const = 0;
+
+        // Pin buffers once; prepReadFixed/prepWriteFixed refer to them by index
+        virtual bool registerBuffers(const std::vector<iovec> &buffers) = 0;
+
+        virtual void prepRead(int fd, void *buf, unsigned len, uint64_t userData, int64_t offset = -1) = 0;
+        virtual void prepWrite(int fd, const void *buf, unsigned len, uint64_t userData, int64_t offset = -1) = 0;
+        virtual void prepReadFixed(int fd, unsigned bufIndex, unsigned len, uint64_t userData, int64_t offset = -1) = 0;
+        virtual void prepWriteFixed(int fd, unsigned bufIndex, unsigned len, uint64_t userData, int64_t offset = -1) = 0;
+
+        // The op prepared last must complete in full before the next one
+        // prepared starts; otherwise the next ones get -ECANCELED
+        virtual void linkLast() = 0;
+
+        // Hand queued ops to the kernel without waiting; returns how many
+        virtual int submit() = 0;
+
+        // Submit whatever is queued, block until at least minComplete ops
+        // have completed, append every available completion to `out`.
+        // Returns the number appended.
+        virtual size_t wait(std::vector<Completion> &out, size_t minComplete) = 0;
+
+        virtual void forget(int) {}
+
+        // Syscalls made by the engine itself (ring setup and buffer
+        // registration excluded; the epoll backend counts its fcntl/epoll_ctl)
+        uint64_t syscalls() const { return syscallCount; }
+    };
+
+    // ========================================================================
+    // IO_URING BACKEND
+    // ========================================================================
+
+    class UringEngine : public Engine
+    {
+    private:
+        int ringFd = -1;
+        io_uring_params params{};
+
+        void *sqRing = MAP_FAILED, *cqRing = MAP_FAILED;
+        size_t sqRingSize = 0, cqRingSize = 0;
+        io_uring_sqe *sqes = (io_uring_sqe *)MAP_FAILED;
+        size_t sqesSize = 0;
+
+        unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+        unsigned *cqHead, *cqTail, *cqMask;
+        io_uring_cqe *cqes;
+
+        unsigned localTail = 0; // SQEs written but not yet published
+        unsigned unsubmitted = 0;
+        io_uring_sqe *last = nullptr;
+
+        int enter(unsigned toSubmit, unsigned minComplete, unsigned flags)
+        {
+            int r;
+            do
+            {
+                ++syscallCount;
+                r = (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0);
+            } while (r < 0 && errno == EINTR);
+            return r;
+        }
+
+        void publish() { __atomic_store_n(sqTail, localTail, __ATOMIC_RELEASE); }
+
+        int flush()
+        {
+            publish();
+            if (unsubmitted == 0)
+                return 0;
+            int r = enter(unsubmitted, 0, 0);
+            if (r > 0)
+                unsubmitted -= r;
+            return r;
+        }
+
+        // Completions reaped while making room in a full SQ; wait() hands them out first
+        std::vector<Completion> early;
+
+        // nullptr if the SQ stays full because the ring refuses submissions
+        io_uring_sqe *nextSqe()
+        {
+            // SQ full: the kernel hasn't consumed earlier entries yet
+            while (localTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) == params.sq_entries)
+            {
+                if (flush() >= 0)
+                    continue;
+                if (errno != EBUSY && errno != EAGAIN)
+                    return nullptr;
+                // CQ backed up: drain it, or wait for an in-flight op to make room
+                if (reap(early) == 0 && enter(0, 1, IORING_ENTER_GETEVENTS) < 0)
+                    return nullptr;
+                reap(early);
+            }
+            unsigned index = localTail & *sqMask;
+            sqArray[index] = index;
+            ++localTail;
+            ++unsubmitted;
+            io_uring_sqe *sqe = &sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            last = sqe;
+            return sqe;
+        }
+
+        void prep(uint8_t opcode, int fd, const void *addr, unsigned len, uint64_t userData, int64_t offset,
+                  unsigned bufIndex = 0)
+        {
+            io_uring_sqe *sqe = nextSqe();
+            if (!sqe)
+            {
+                // Never write into an SQE the kernel still owns: fail the op instead
+                early.push_back({userData, -errno});
+                last = nullptr;
+                return;
+            }
+            sqe->opcode = opcode;
+            sqe->fd = fd;
+            sqe->addr = (uint64_t)(uintptr_t)addr;
+            sqe->len = len;
+            sqe->off = (uint64_t)offset; // -1 -> current position
+            sqe->user_data = userData;
+            sqe->buf_index = (uint16_t)bufIndex;
+        }
+
+        std::vector<iovec> fixed;
+
+        size_t reap(std::vector<Completion> &out)
+        {
+            unsigned head = *cqHead;
+            unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            size_t n = 0;
+            for (; head != tail; ++head, ++n)
+            {
+                const io_uring_cqe &cqe = cqes[head & *cqMask];
+                out.push_back({cqe.user_data, cqe.res});
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+            return n;
+        }
+
+    public:
+        // Check ok() before use: fails on kernels / sandboxes without io_uring
+        explicit UringEngine(unsigned entries)
+        {
+            ringFd = (int)syscall(__NR_io_uring_setup, entries, &params);
+            if (ringFd < 0)
+                return;
+
+            sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single = params.features & IORING_FEAT_SINGLE_MMAP; // both rings in one mapping
+            if (single)
+                sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+            sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                          IORING_OFF_SQ_RING);
+            if (sqRing == MAP_FAILED)
+            {
+                fail();
+                return;
+            }
+            cqRing = single ? sqRing
+                            : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                                   IORING_OFF_CQ_RING);
+            if (cqRing == MAP_FAILED)
+            {
+                fail();
+                return;
+            }
+            sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            sqes = (io_uring_sqe *)mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                        ringFd, IORING_OFF_SQES);
+            if (sqes == MAP_FAILED)
+            {
+                fail();
+                return;
+            }
+
+            char *sq = (char *)sqRing, *cq = (char *)cqRing;
+            sqHead = (unsigned *)(sq + params.sq_off.head);
+            sqTail = (unsigned *)(sq + params.sq_off.tail);
+            sqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+            sqArray = (unsigned *)(sq + params.sq_off.array);
+            cqHead = (unsigned *)(cq + params.cq_off.head);
+            cqTail = (unsigned *)(cq + params.cq_off.tail);
+            cqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+            cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+            localTail = *sqTail;
+        }
+
+        ~UringEngine() override { fail(); }
+
+        bool ok() const { return ringFd >= 0; }
+        const char *name() const override { return "io_uring"; }
+
+        bool registerBuffers(const std::vector<iovec> &buffers) override
+        {
+            fixed = buffers;
+            return syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, fixed.data(),
+                           (unsigned)fixed.size()) == 0;
+        }
+
+        void prepRead(int fd, void *buf, unsigned len, uint64_t userData, int64_t offset) override
+        {
+            prep(IORING_OP_READ, fd, buf, len, userData, offset);
+        }
+
+        void prepWrite(int fd, const void *buf, unsigned len, uint64_t userData, int64_t offset) override
+        {
+            prep(IORING_OP_WRITE, fd, buf, len, userData, offset);
+        }
+
+        void prepReadFixed(int fd, unsigned bufIndex, unsigned len, uint64_t userData, int64_t offset) override
+        {
+            prep(IORING_OP_READ_FIXED, fd, fixed[bufIndex].iov_base, len, userData, offset, bufIndex);
+        }
+
+        void prepWriteFixed(int fd, unsigned bufIndex, unsigned len, uint64_t userData, int64_t offset) override
+        {
+            prep(IORING_OP_WRITE_FIXED, fd, fixed[bufIndex].iov_base, len, userData, offset, bufIndex);
+        }
+
+        void linkLast() override
+        {
+            if (last)
+                last->flags |= IOSQE_IO_LINK;
+        }
+
+        int submit() override
+        {
+            last = nullptr;
+            return flush();
+        }
+
+        size_t wait(std::vector<Completion> &out, size_t minComplete) override
+        {
+            last = nullptr;
+            publish();
+            size_t got = early.size();
+            out.insert(out.end(), early.begin(), early.end());
+            early.clear();
+            got += reap(out);
+            while (got < minComplete || unsubmitted > 0)
+            {
+                unsigned need = got < minComplete ? unsigned(minComplete - got) : 0;
+                int r = enter(unsubmitted, need, need ? IORING_ENTER_GETEVENTS : 0);
+                if (r < 0 && errno != EBUSY && errno != EAGAIN)
+                    break; // EBUSY: CQ backed up - reaping below makes room
+                if (r > 0)
+                    unsubmitted -= r;
+                size_t more = reap(out);
+                got += more;
+                if (r <= 0 && more == 0 && got >= minComplete)
+                    break; // submission refused for now; completions are in
+            }
+            return got;
+        }
+
+    private:
+        void fail()
+        {
+            if (sqes != MAP_FAILED)
+                munmap(sqes, sqesSize);
+            if (cqRing != MAP_FAILED && cqRing != sqRing)
+                munmap(cqRing, cqRingSize);
+            if (sqRing != MAP_FAILED)
+                munmap(sqRing, sqRingSize);
+            sqes = (io_uring_sqe *)MAP_FAILED;
+            sqRing = cqRing = MAP_FAILED;
+            if (ringFd >= 0)
+                close(ringFd);
+            ringFd = -1;
+        }
+    };
+
+    // ========================================================================
+    // EPOLL FALLBACK
+    // ========================================================================
+
+    class EpollEngine : public Engine
+    {
+    private:
+        struct Op
+        {
+            bool isWrite;
+            int fd;
+            char *buf;
+            unsigned len;
+            uint64_t userData;
+            int64_t offset;
+            bool linkNext = false;
+            bool chained = false; // started by its predecessor, not by submit()
+            Op *next = nullptr;
+        };
+
+        struct Waiters
+        {
+            std::deque<Op *> readers, writers;
+        };
+
+        int epfd;
+        std::vector<iovec> fixed;
+        std::vector<Op *> queued;
+        std::vector<Op *> freeOps;
+        std::vector<std::unique_ptr<Op>> allOps;
+        std::unordered_map<int, Waiters> waiting;
+        std::unordered_set<int> known; // non-blocking + registered (edge-triggered)
+        std::vector<Completion> ready;
+        Op *last = nullptr;
+
+        Op *allocate()
+        {
+            if (freeOps.empty())
+            {
+                allOps.emplace_back(new Op());
+                return allOps.back().get();
+            }
+            Op *op = freeOps.back();
+            freeOps.pop_back();
+            return op;
+        }
+
+        void prep(bool isWrite, int fd, void *buf, unsigned len, uint64_t userData, int64_t offset)
+        {
+            Op *op = allocate();
+            *op = Op{isWrite, fd, (char *)buf, len, userData, offset};
+            if (last && last->linkNext)
+            {
+                last->next = op;
+                op->chained = true;
+            }
+            queued.push_back(op);
+            last = op;
+        }
+
+        // One non-blocking attempt; -EAGAIN means "not ready"
+        int attempt(Op *op)
+        {
+            ssize_t r;
+            ++syscallCount;
+            if (op->isWrite)
+                r = op->offset < 0 ? ::write(op->fd, op->buf, op->len) : pwrite(op->fd, op->buf, op->len, op->offset);
+            else
+                r = op->offset < 0 ? ::read(op->fd, op->buf, op->len) : pread(op->fd, op->buf, op->len, op->offset);
+            return r < 0 ? -errno : (int)r;
+        }
+
+        void prepareFd(int fd)
+        {
+            if (known.count(fd))
+                return;
+            known.insert(fd);
+            syscallCount += 2;
+            int flags = fcntl(fd, F_GETFL);
+            fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        }
+
+        bool watch(int fd)
+        {
+            // Registered once, edge-triggered: we always retry until EAGAIN,
+            // so an edge is never missed and no re-arming syscall is needed
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            ev.data.fd = fd;
+            ++syscallCount;
+            return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0 || errno == EEXIST;
+        }
+
+        void start(Op *op)
+        {
+            prepareFd(op->fd);
+            Waiters *w = nullptr;
+            auto it = waiting.find(op->fd);
+            if (it != waiting.end())
+                w = &it->second;
+            // Queue behind earlier ops on the same fd: keeps per-fd order
+            bool behind = w && !(op->isWrite ? w->writers : w->readers).empty();
+            int r = behind ? -EAGAIN : attempt(op);
+            if (r != -EAGAIN)
+                return finish(op, r);
+            if (!w)
+            {
+                if (!watch(op->fd))
+                    return finish(op, -errno);
+                w = &waiting[op->fd];
+            }
+            (op->isWrite ? w->writers : w->readers).push_back(op);
+        }
+
+        void finish(Op *op, int res)
+        {
+            ready.push_back({op->userData, res});
+            Op *next = op->next;
+            bool full = res == (int)op->len;
+            freeOps.push_back(op);
+            if (!next)
+                return;
+            if (full)
+                return start(next);
+            for (; next; next = next->next) // chain broken
+            {
+                ready.push_back({next->userData, -ECANCELED});
+                freeOps.push_back(next);
+            }
+        }
+
+        void retry(int fd, bool writers)
+        {
+            while (true)
+            {
+                auto it = waiting.find(fd); // finish() may touch the map
+                if (it == waiting.end())
+                    return;
+                std::deque<Op *> &q = writers ? it->second.writers : it->second.readers;
+                if (q.empty())
+                    return;
+                Op *op = q.front();
+                int r = attempt(op);
+                if (r == -EAGAIN)
+                    return;
+                q.pop_front();
+                finish(op, r);
+            }
+        }
+
+    public:
+        EpollEngine() { epfd = epoll_create1(EPOLL_CLOEXEC); }
+        ~EpollEngine() override { close(epfd); }
+
+        const char *name() const override { return "epoll"; }
+
+        bool registerBuffers(const std::vector<iovec> &buffers) override
+        {
+            fixed = buffers;
+            return true;
+        }
+
+        void prepRead(int fd, void *buf, unsigned len, uint64_t userData, int64_t offset) override
+        {
+            prep(false, fd, buf, len, userData, offset);
+        }
+
+        void prepWrite(int fd, const void *buf, unsigned len, uint64_t userData, int64_t offset) override
+        {
+            prep(true, fd, const_cast<void *>(buf), len, userData, offset);
+        }
+
+        void prepReadFixed(int fd, unsigned bufIndex, unsigned len, uint64_t userData, int64_t offset) override
+        {
+            prep(false, fd, fixed[bufIndex].iov_base, len, userData, offset);
+        }
+
+        void prepWriteFixed(int fd, unsigned bufIndex, unsigned len, uint64_t userData, int64_t offset) override
+        {
+            prep(true, fd, fixed[bufIndex].iov_base, len, userData, offset);
+        }
+
+        void linkLast() override
+        {
+            if (last)
+                last->linkNext = true;
+        }
+
+        int submit() override
+        {
+            int n = (int)queued.size();
+            std::vector<Op *> batch;
+            batch.swap(queued);
+            last = nullptr;
+            for (Op *op : batch)
+                if (!op->chained)
+                    start(op);
+            return n;
+        }
+
+        size_t wait(std::vector<Completion> &out, size_t minComplete) override
+        {
+            submit();
+            epoll_event events[64];
+            while (ready.size() < minComplete)
+            {
+                ++syscallCount;
+                int n = epoll_wait(epfd, events, 64, -1);
+                if (n < 0 && errno != EINTR)
+                    break;
+                for (int i = 0; i < n; ++i)
+                {
+                    // HUP/ERR: the retried op returns EOF / the error
+                    if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                        retry(events[i].data.fd, false);
+                    if (events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+                        retry(events[i].data.fd, true);
+                }
+            }
+            size_t n = ready.size();
+            out.insert(out.end(), ready.begin(), ready.end());
+            ready.clear();
+            return n;
+        }
+
+        void forget(int fd) override
+        {
+            if (!known.erase(fd))
+                return;
+            auto it = waiting.find(fd);
+            if (it != waiting.end())
+            {
+                for (Op *op : it->second.readers)
+                    freeOps.push_back(op);
+                for (Op *op : it->second.writers)
+                    freeOps.push_back(op);
+                waiting.erase(it);
+            }
+            ++syscallCount;
+            epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+        }
+    };
+
+    // io_uring if the kernel allows it, else epoll
+    inline std::unique_ptr<Engine> makeEngine(unsigned entries = 256, Backend which = Backend::Auto)
+    {
+        if (which == Backend::Auto)
+        {
+            const char *env = getenv("IO_ENGINE");
+            if (env && std::string(env) == "epoll")
+                which = Backend::Epoll;
+        }
+        if (which != Backend::Epoll)
+        {
+            std::unique_ptr<UringEngine> ring(new UringEngine(entries));
+            if (ring->ok())
+                return ring;
+            if (which == Backend::Uring)
+                return nullptr;
+        }
+        return std::unique_ptr<Engine>(new EpollEngine());
+    }
+}
@@ -14,6 +14,16 @@
 #include <stdexcept>
 #include <sstream>
 #include <iomanip>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <csignal>
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "../concurrency/sampling_profiler.h"
 
 using namespace std;
 
@@ -167,79 +177,109 @@ public:
 class CreditCardProcessor : public IPaymentProcessor
 {
 public:
+    explicit CreditCardProcessor(ostream &out = cout) : out(out) {}
+
     bool process(double amount, const string &paymentDetails) override
     {
-        cout << "Processing $" << fixed << setprecision(2) << amount
-             << " via Credit Card\n";
-        cout << "Card: " << paymentDetails << "\n";
+        out << "Processing $" << fixed << setprecision(2) << amount
+            << " via Credit Card\n";
+        out << "Card: " << paymentDetails << "\n";
         return true;
     }
 
     string getProcessorName() const override { return "Credit Card"; }
+
+private:
+    ostream &out;
 };
 
 class PayPalProcessor : public IPaymentProcessor
 {
 public:
+    explicit PayPalProcessor(ostream &out = cout) : out(out) {}
+
     bool process(double amount, const string &paymentDetails) override
     {
-        cout << "Processing $" << fixed << setprecision(2) << amount
-             << " via PayPal\n";
-        cout << "Account: " << paymentDetails << "\n";
+        out << "Processing $" << fixed << setprecision(2) << amount
+            << " via PayPal\n";
+        out << "Account: " << paymentDetails << "\n";
         return true;
     }
 
     string getProcessorName() const override { return "PayPal"; }
+
+private:
+    ostream &out;
 };
 
 class CryptoProcessor : public IPaymentProcessor
 {
 public:
+    explicit CryptoProcessor(ostream &out = cout) : out(out) {}
+
     bool process(double amount, const string &paymentDetails) override
     {
-        cout << "Processing $" << fixed << setprecision(2) << amount
-             << " via Cryptocurrency\n";
-        cout << "Wallet: " << paymentDetails << "\n";
+        out << "Processing $" << fixed << setprecision(2) << amount
+            << " via Cryptocurrency\n";
+        out << "Wallet: " << paymentDetails << "\n";
         return true;
     }
 
     string getProcessorName() const override { return "Cryptocurrency"; }
+
+private:
+    ostream &out;
 };
 
 // Notification Services (OCP - extensible)
 class EmailNotification : public INotificationService
 {
 public:
+    explicit EmailNotification(ostream &out = cout) : out(out) {}
+
     void send(const string &recipient, const string &message) override
     {
-        cout << "[EMAIL] To: " << recipient << "\n";
-        cout << "Message: " << message << "\n";
+        out << "[EMAIL] To: " << recipient << "\n";
+        out << "Message: " << message << "\n";
     }
+
+private:
+    ostream &out;
 };
 
 class SMSNotification : public INotificationService
 {
 public:
+    explicit SMSNotification(ostream &out = cout) : out(out) {}
+
     void send(const string &recipient, const string &message) override
     {
-        cout << "[SMS] To: " << recipient << "\n";
-        cout << "Message: " << message << "\n";
+        out << "[SMS] To: " << recipient << "\n";
+        out << "Message: " << message << "\n";
     }
+
+private:
+    ostream &out;
 };
 
 // Logger Implementation
 class ConsoleLogger : public ILogger
 {
 public:
+    explicit ConsoleLogger(ostream &out = cout) : out(out) {}
+
     void info(const string &message) override
     {
-        cout << "[INFO] " << message << "\n";
+        out << "[INFO] " << message << "\n";
     }
 
     void error(const string &message) override
     {
-        cout << "[ERROR] " << message << "\n";
+        out << "[ERROR] " << message << "\n";
     }
+
+private:
+    ostream &out;
 };
 
 // Discount Strategies (OCP - Strategy pattern)
@@ -631,12 +671,240 @@ public:
     }
 };
 
+// ============================================================================
+// PROFILE MODE: the same services under a synthetic load loop
+// ============================================================================
+
+// Swallows output: every service logs on every call
+class NullBuffer : public streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char *, streamsize n) override { return n; }
+};
+
+// One shop per thread (the services are not thread-safe), wired like the
+// demo below, cycling through its four scenarios until `stop`. Each shop
+// writes to its own stream: the processors set `fixed`/`setprecision` on
+// every order, and a shared cout would make that format state a data race.
+// The shop is rebuilt every 10000 orders so the order repository stays small
+long runShop(const atomic<bool> &stop)
+{
+    NullBuffer sink;
+    ostream out(&sink);
+    long orders = 0;
+    while (!stop.load(memory_order_relaxed))
+    {
+        ConsoleLogger logger(out);
+        InMemoryProductRepository productRepo;
+        InMemoryOrderRepository orderRepo;
+        productRepo.save(Product("P001", "Laptop", 999.99, 1000000000));
+        productRepo.save(Product("P002", "Mouse", 29.99, 1000000000));
+        productRepo.save(Product("P003", "Keyboard", 79.99, 1000000000));
+
+        InventoryService inventory(&productRepo, &logger);
+        NoDiscount noDiscount;
+        PercentageDiscount percentDiscount(20);
+        SeasonalDiscount seasonal(50, 100);
+        StandardShipping standardShip;
+        ExpressShipping expressShip;
+        FreeShipping freeShip;
+        PricingService pricing(&noDiscount, &standardShip, &logger);
+        CreditCardProcessor creditCard(out);
+        PayPalProcessor paypal(out);
+        CryptoProcessor crypto(out);
+        PaymentService payment(&creditCard, &logger);
+        NotificationManager notifications(&logger);
+        EmailNotification email(out);
+        SMSNotification sms(out);
+        notifications.addNotificationChannel(&email);
+        notifications.addNotificationChannel(&sms);
+        OrderService orderService(&productRepo, &orderRepo, &inventory, &pricing,
+                                  &payment, &notifications, &logger);
+
+        for (int i = 0; i < 10000 && !stop.load(memory_order_relaxed); i++, orders++)
+        {
+            string id = "ORD" + to_string(orders);
+            switch (orders % 4)
+            {
+            case 0:
+                pricing.setDiscountStrategy(&noDiscount);
+                pricing.setShippingCalculator(&standardShip);
+                payment.setProcessor(&creditCard);
+                orderService.placeOrder(id, "customer@example.com", {{"P001", 1}, {"P002", 2}},
+                                        "4111-1111-1111-1111", "123 Main St, City, State");
+                break;
+            case 1:
+                pricing.setDiscountStrategy(&percentDiscount);
+                orderService.placeOrder(id, "customer2@example.com", {{"P003", 1}},
+                                        "4111-1111-1111-1111", "456 Oak Ave, City, State");
+                break;
+            case 2:
+                pricing.setDiscountStrategy(&noDiscount);
+                pricing.setShippingCalculator(&expressShip);
+                payment.setProcessor(&paypal);
+                orderService.placeOrder(id, "customer3@example.com", {{"P001", 1}, {"P002", 1}, {"P003", 1}},
+                                        "paypal@example.com", "789 Pine Rd, City, State");
+                break;
+            default:
+                pricing.setDiscountStrategy(&seasonal);
+                pricing.setShippingCalculator(&freeShip);
+                payment.setProcessor(&crypto);
+                orderService.placeOrder(id, "customer4@example.com", {{"P001", 1}},
+                                        "0x1234567890abcdef", "321 Elm St, City, State");
+                break;
+            }
+        }
+    }
+    return orders;
+}
+
+struct LoadResult
+{
+    double ordersPerSec;
+    double cpuNsPerOrder; // process CPU time (all threads) per order
+};
+
+double processCpuNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// `threads` shops running for `seconds`, optionally every shop thread
+// sampled by `profiler`
+LoadResult loadRun(int threads, double seconds, sampler::Profiler *profiler)
+{
+    atomic<bool> stop{false};
+    atomic<long> orders{0};
+    vector<thread> shops;
+    auto start = chrono::steady_clock::now();
+    double cpuStart = processCpuNs();
+    for (int t = 0; t < threads; t++)
+    {
+        shops.emplace_back([&]() {
+            unique_ptr<sampler::ThreadScope> sampled;
+            if (profiler)
+                sampled = make_unique<sampler::ThreadScope>(*profiler);
+            orders += runShop(stop);
+        });
+    }
+    this_thread::sleep_for(chrono::duration<double>(seconds));
+    stop = true;
+    for (auto &t : shops)
+        t.join();
+    double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return {orders / wall, (processCpuNs() - cpuStart) / max(1L, orders.load())};
+}
+
+void emptyHandler(int) {}
+
+// Kernel cost of one signal to this thread and back (tgkill + an empty
+// handler + sigreturn). An upper bound for a timer signal, which needs no
+// syscall to be raised
+double signalDeliveryNs()
+{
+    struct sigaction sa, old;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = emptyHandler;
+    sigaction(SIGUSR2, &sa, &old);
+    pid_t pid = getpid(), tid = (pid_t)syscall(SYS_gettid);
+    const int N = 20000;
+    double best = 1e18;
+    for (int round = 0; round < 5; round++)
+    {
+        auto t0 = chrono::steady_clock::now();
+        for (int i = 0; i < N; i++)
+            syscall(SYS_tgkill, pid, tid, SIGUSR2);
+        best = min(best, chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / N);
+    }
+    sigaction(SIGUSR2, &old, nullptr);
+    return best;
+}
+
+double median(vector<double> v)
+{
+    sort(v.begin(), v.end());
+    size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+// ./program --profile [seconds] [hz] [threads] [out.folded]
+// Two measurements of the profiler's cost:
+// - direct: time in the handler + kernel signal delivery + collector CPU,
+//   per CPU-second of the sampled threads
+// - end to end: CPU time per order, unprofiled vs profiled runs
+//   alternating, as signed per-round deltas and their spread. On a busy or
+//   single-CPU box the spread is wider than the cost being measured
+// Then prints the top functions and writes the profiled runs' folded stacks
+int profileMode(int argc, char *argv[])
+{
+    double seconds = argc > 2 ? atof(argv[2]) : 2;
+    int hz = argc > 3 ? atoi(argv[3]) : 1000;
+    int threads = argc > 4 ? atoi(argv[4]) : 2;
+    string out = argc > 5 ? argv[5] : "ecommerce.folded";
+    const int ROUNDS = 5;
+
+    cout << "=== E-COMMERCE UNDER LOAD - SAMPLING PROFILE ===\n";
+    cout << threads << " shop threads, " << seconds << " s per run, " << ROUNDS
+         << " rounds, SIGPROF at " << hz << " Hz per thread\n\n";
+
+    double deliveryNs = signalDeliveryNs();
+    loadRun(threads, seconds, nullptr); // warm-up: page faults, allocator arenas, CPU frequency
+    sampler::Profiler profiler(hz);
+    profiler.start(); // the collector runs through the unprofiled runs too
+    vector<double> plainRate, profiledRate, deltas;
+    cout << setw(8) << "round" << setw(22) << "orders/s plain" << setw(16) << "profiled"
+         << setw(22) << "CPU ns/order plain" << setw(12) << "profiled" << setw(10) << "delta\n";
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        LoadResult plain = loadRun(threads, seconds, nullptr);
+        LoadResult profiled = loadRun(threads, seconds, &profiler);
+        double delta = 100 * (profiled.cpuNsPerOrder / plain.cpuNsPerOrder - 1);
+        plainRate.push_back(plain.ordersPerSec);
+        profiledRate.push_back(profiled.ordersPerSec);
+        deltas.push_back(delta);
+        cout << fixed << setprecision(0) << setw(8) << round + 1 << setw(22) << plain.ordersPerSec << setw(16)
+             << profiled.ordersPerSec << setw(22) << plain.cpuNsPerOrder << setw(12) << profiled.cpuNsPerOrder
+             << setprecision(2) << setw(9) << showpos << delta << noshowpos << "%\n";
+    }
+    profiler.stop();
+
+    sampler::Profiler::Stats st = profiler.stats();
+    double cpuSeconds = st.sampledCpuNs / 1e9;
+    double handlerNs = st.signals ? double(st.handlerNs) / st.signals : 0;
+    double direct = 100 * (st.handlerNs + st.signals * deliveryNs + st.collectorCpuNs) / max(1.0, double(st.sampledCpuNs));
+    auto spread = minmax_element(deltas.begin(), deltas.end());
+    cout << "\nend to end:  CPU/order delta median " << showpos << median(deltas) << "%, range " << *spread.first
+         << "% .. " << *spread.second << "%" << noshowpos << " (orders/s median " << setprecision(0)
+         << median(plainRate) << " plain, " << median(profiledRate) << " profiled)\n";
+    cout << setprecision(2) << "direct cost: " << st.signals / cpuSeconds << " signals per CPU-second x ("
+         << handlerNs / 1000 << " us handler + " << deliveryNs / 1000 << " us delivery) + collector "
+         << st.collectorCpuNs / 1e6 << " ms CPU = " << setprecision(3) << direct << "% of "
+         << setprecision(2) << cpuSeconds << " sampled CPU-seconds (target < 2%)\n";
+    cout << st.samples << " samples (" << st.signals << " signals: CPU timers fire on the scheduler tick, "
+         << "overruns weight them) from " << st.registered << " threads, " << st.dropped << " dropped, "
+         << st.distinctStacks << " distinct stacks\n\n";
+    profiler.printTop(cout, 20);
+    if (!profiler.writeFolded(out))
+    {
+        cerr << "cannot write " << out << "\n";
+        return 1;
+    }
+    cout << "\nfolded stacks: " << out << " (flamegraph.pl " << out << " > ecommerce.svg)\n";
+    return 0;
+}
+
 // ============================================================================
 // MAIN: Comprehensive Demo
 // ============================================================================
 
-int main()
+int main(int argc, char *argv[])
 {
+    if (argc > 1 && strcmp(argv[1], "--profile") == 0)
+        return profileMode(argc, argv);
+
     cout << "=== E-COMMERCE SYSTEM - ALL SOLID PRINCIPLES ===\n\n";
 
     // Setup infrastructure (DIP - inject dependencies)
@@ -0,0 +1,680 @@
+/**
+ * DISCOUNT RULE ENGINE - From Strategy Objects to a Compiled Decision Table
+ *
+ * Problem: 02_ocp_open_closed.cpp (PercentageDiscount, FixedAmountDiscount,
+ * BOGODiscount) and 06_real_world_ecommerce.cpp (SeasonalDiscount) model each
+ * promotion as ONE virtual object attached to ONE cart. That is great OCP
+ * teaching, but a promotions team runs thousands of rules at the same time:
+ * "10% off Electronics for VIPs", "BOGO on Books for members", "$50 off orders
+ * over $500 for everyone", ...
+ *
+ * Key Points:
+ * - Rules are DATA (a definition table), not classes. New promotions do not
+ *   require recompiling - the engine stays closed for modification.
+ * - Definitions are COMPILED once into a decision table indexed by
+ *   [product category][customer segment]. Wildcards are expanded at compile
+ *   time, so evaluation never scans rules that cannot apply.
+ * - Inside each cell, rules of the same kind collapse into a "staircase"
+ *   sorted by minimum quantity / threshold with a running best value, so a
+ *   lookup is a binary search: cost is O(lines * log(rules)), not O(lines * rules).
+ * - A cart is evaluated in ONE pass over its lines against one immutable
+ *   snapshot of the rule set.
+ * - Rule sets are hot-swapped atomically (shared_ptr publish); in-flight carts
+ *   finish on the old snapshot, which is freed when the last reader drops it.
+ *   std::atomic_load on a shared_ptr is NOT lock-free in libstdc++ (it locks
+ *   one of a small pool of mutexes around the refcount copy), so readers
+ *   take a snapshot once per batch, not once per cart line.
+ *
+ * Memory/cache notes:
+ * - The compiled table is a flat vector of POD structs (no vptr, no heap per
+ *   rule), so a cart evaluation touches a handful of cache lines.
+ * - The chained-strategy design calls a virtual function per rule per line:
+ *   an indirect branch + a likely cache miss on each strategy object.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <iomanip>
+#include <cstdint>
+#include <cmath>
+
+using namespace std;
+
+// ============================================================================
+// DOMAIN: categories, segments and carts
+// ============================================================================
+
+enum class Category : uint8_t
+{
+    ELECTRONICS,
+    BOOKS,
+    GROCERY,
+    APPAREL,
+    HOME,
+    TOYS,
+    COUNT
+};
+
+enum class Segment : uint8_t
+{
+    REGULAR,
+    MEMBER,
+    VIP,
+    EMPLOYEE,
+    COUNT
+};
+
+constexpr size_t NUM_CATEGORIES = static_cast<size_t>(Category::COUNT);
+constexpr size_t NUM_SEGMENTS = static_cast<size_t>(Segment::COUNT);
+
+struct CartLine
+{
+    Category category;
+    double unitPrice;
+    int quantity;
+};
+
+struct Cart
+{
+    Segment segment;
+    vector<CartLine> lines;
+
+    double subtotal() const
+    {
+        double total = 0.0;
+        for (const auto &line : lines)
+        {
+            total += line.unitPrice * line.quantity;
+        }
+        return total;
+    }
+};
+
+// ============================================================================
+// RULE DEFINITIONS (what the promotions team authors)
+// ============================================================================
+
+enum class RuleKind : uint8_t
+{
+    PERCENTAGE,     // pct off matching lines          (PercentageDiscount)
+    FIXED_PER_UNIT, // $ off each matching unit         (FixedAmountDiscount)
+    BOGO,           // every second matching unit free  (BOGODiscount)
+    CART_THRESHOLD  // $ off whole cart over threshold  (SeasonalDiscount)
+};
+
+struct RuleDefinition
+{
+    static constexpr int ANY = -1;
+
+    string id;
+    RuleKind kind;
+    int category; // Category index or ANY (ignored for CART_THRESHOLD)
+    int segment;  // Segment index or ANY
+    double value; // percentage, dollars per unit, or dollars off cart
+    int minQuantity;  // line rules: minimum quantity on the line
+    double threshold; // CART_THRESHOLD: minimum subtotal
+};
+
+// Savings for a single line - shared by both designs so results are comparable
+inline double lineSaving(RuleKind kind, double value, const CartLine &line)
+{
+    switch (kind)
+    {
+    case RuleKind::PERCENTAGE:
+        return line.unitPrice * line.quantity * (value / 100.0);
+    case RuleKind::FIXED_PER_UNIT:
+        return min(value, line.unitPrice) * line.quantity;
+    case RuleKind::BOGO:
+        return line.unitPrice * (line.quantity / 2);
+    default:
+        return 0.0;
+    }
+}
+
+// ============================================================================
+// BASELINE: one virtual strategy object per rule, chained
+// ============================================================================
+
+namespace chained_strategies
+{
+
+    // Same shape as IDiscountStrategy, widened to see the whole cart
+    class DiscountStrategy
+    {
+    public:
+        virtual ~DiscountStrategy() = default;
+        virtual double lineSaving(const Cart &cart, const CartLine &line) const = 0;
+        virtual double cartSaving(const Cart &cart, double subtotal) const = 0;
+    };
+
+    class LineRule : public DiscountStrategy
+    {
+    private:
+        RuleDefinition def;
+
+    public:
+        LineRule(const RuleDefinition &d) : def(d) {}
+
+        double lineSaving(const Cart &cart, const CartLine &line) const override
+        {
+            if (def.category != RuleDefinition::ANY &&
+                def.category != static_cast<int>(line.category))
+                return 0.0;
+            if (def.segment != RuleDefinition::ANY &&
+                def.segment != static_cast<int>(cart.segment))
+                return 0.0;
+            if (line.quantity < def.minQuantity)
+                return 0.0;
+            return ::lineSaving(def.kind, def.value, line);
+        }
+
+        double cartSaving(const Cart &, double) const override { return 0.0; }
+    };
+
+    class ThresholdRule : public DiscountStrategy
+    {
+    private:
+        RuleDefinition def;
+
+    public:
+        ThresholdRule(const RuleDefinition &d) : def(d) {}
+
+        double lineSaving(const Cart &, const CartLine &) const override { return 0.0; }
+
+        double cartSaving(const Cart &cart, double subtotal) const override
+        {
+            if (def.segment != RuleDefinition::ANY &&
+                def.segment != static_cast<int>(cart.segment))
+                return 0.0;
+            return subtotal >= def.threshold ? def.value : 0.0;
+        }
+    };
+
+    // Problem: every cart asks EVERY rule about EVERY line -> O(lines * rules)
+    // virtual calls, most of which return 0 because the rule does not apply.
+    class ChainedDiscountEngine
+    {
+    private:
+        vector<unique_ptr<DiscountStrategy>> strategies;
+
+    public:
+        explicit ChainedDiscountEngine(const vector<RuleDefinition> &defs)
+        {
+            for (const auto &def : defs)
+            {
+                if (def.kind == RuleKind::CART_THRESHOLD)
+                    strategies.push_back(make_unique<ThresholdRule>(def));
+                else
+                    strategies.push_back(make_unique<LineRule>(def));
+            }
+        }
+
+        // Best line rule per line, plus best cart-level rule (no stacking)
+        double price(const Cart &cart) const
+        {
+            double subtotal = 0.0;
+            double lineSavings = 0.0;
+            for (const auto &line : cart.lines)
+            {
+                subtotal += line.unitPrice * line.quantity;
+                double best = 0.0;
+                for (const auto &s : strategies)
+                    best = max(best, s->lineSaving(cart, line));
+                lineSavings += best;
+            }
+
+            double bestCart = 0.0;
+            for (const auto &s : strategies)
+                bestCart = max(bestCart, s->cartSaving(cart, subtotal));
+
+            return max(0.0, subtotal - lineSavings - bestCart);
+        }
+    };
+}
+
+// ============================================================================
+// COMPILED ENGINE: decision table + staircases + atomic hot swap
+// ============================================================================
+
+namespace compiled_engine
+{
+
+    // One step of a staircase: "from key onwards, the best value is best"
+    struct Step
+    {
+        double key;  // minQuantity (line rules) or threshold (cart rules)
+        double best; // running max of value over all rules with key <= this key
+    };
+
+    // Sorted by key; lookup = last step with key <= probe
+    class Staircase
+    {
+    private:
+        vector<Step> steps;
+
+    public:
+        void add(double key, double value) { steps.push_back({key, value}); }
+
+        void compile()
+        {
+            sort(steps.begin(), steps.end(),
+                 [](const Step &a, const Step &b)
+                 { return a.key < b.key; });
+
+            // Running max, then drop steps that do not improve on the previous one
+            vector<Step> compact;
+            double best = 0.0;
+            for (const auto &s : steps)
+            {
+                best = max(best, s.best);
+                if (!compact.empty() && compact.back().key == s.key)
+                    compact.back().best = best;
+                else if (compact.empty() || best > compact.back().best)
+                    compact.push_back({s.key, best});
+            }
+            steps.swap(compact);
+            steps.shrink_to_fit();
+        }
+
+        double lookup(double probe) const
+        {
+            auto it = upper_bound(steps.begin(), steps.end(), probe,
+                                  [](double p, const Step &s)
+                                  { return p < s.key; });
+            return it == steps.begin() ? 0.0 : prev(it)->best;
+        }
+
+        size_t size() const { return steps.size(); }
+    };
+
+    // Everything that can apply to one (category, segment) pair
+    struct Cell
+    {
+        Staircase percentage;   // key = minQuantity, value = pct
+        Staircase fixedPerUnit; // key = minQuantity, value = $ per unit
+        Staircase bogo;         // key = minQuantity, value = 1 if any rule
+    };
+
+    // Immutable once built; shared read-only by all pricing threads
+    class CompiledRuleSet
+    {
+    private:
+        array<Cell, NUM_CATEGORIES * NUM_SEGMENTS> table;
+        array<Staircase, NUM_SEGMENTS> cartRules; // key = threshold, value = $ off
+        size_t sourceRules = 0;
+        uint64_t version = 0;
+
+        static size_t index(size_t category, size_t segment)
+        {
+            return category * NUM_SEGMENTS + segment;
+        }
+
+        // Expands wildcards so evaluation never has to consider them
+        template <typename Fn>
+        static void forEachMatch(int category, int segment, Fn fn)
+        {
+            for (size_t c = 0; c < NUM_CATEGORIES; ++c)
+            {
+                if (category != RuleDefinition::ANY && category != static_cast<int>(c))
+                    continue;
+                for (size_t s = 0; s < NUM_SEGMENTS; ++s)
+                {
+                    if (segment != RuleDefinition::ANY && segment != static_cast<int>(s))
+                        continue;
+                    fn(c, s);
+                }
+            }
+        }
+
+    public:
+        static shared_ptr<const CompiledRuleSet> compile(const vector<RuleDefinition> &defs,
+                                                         uint64_t version)
+        {
+            auto set = make_shared<CompiledRuleSet>();
+            set->sourceRules = defs.size();
+            set->version = version;
+
+            for (const auto &def : defs)
+            {
+                if (def.kind == RuleKind::CART_THRESHOLD)
+                {
+                    for (size_t s = 0; s < NUM_SEGMENTS; ++s)
+                    {
+                        if (def.segment == RuleDefinition::ANY || def.segment == static_cast<int>(s))
+                            set->cartRules[s].add(def.threshold, def.value);
+                    }
+                    continue;
+                }
+
+                forEachMatch(def.category, def.segment, [&](size_t c, size_t s)
+                             {
+                    Cell &cell = set->table[index(c, s)];
+                    switch (def.kind)
+                    {
+                    case RuleKind::PERCENTAGE:
+                        cell.percentage.add(def.minQuantity, def.value);
+                        break;
+                    case RuleKind::FIXED_PER_UNIT:
+                        cell.fixedPerUnit.add(def.minQuantity, def.value);
+                        break;
+                    case RuleKind::BOGO:
+                        cell.bogo.add(def.minQuantity, 1.0);
+                        break;
+                    default:
+                        break;
+                    } });
+            }
+
+            for (auto &cell : set->table)
+            {
+                cell.percentage.compile();
+                cell.fixedPerUnit.compile();
+                cell.bogo.compile();
+            }
+            for (auto &stairs : set->cartRules)
+                stairs.compile();
+
+            return set;
+        }
+
+        // ONE pass over the cart: per line, three binary searches in one cell
+        double price(const Cart &cart) const
+        {
+            const size_t seg = static_cast<size_t>(cart.segment);
+            double subtotal = 0.0;
+            double lineSavings = 0.0;
+
+            for (const auto &line : cart.lines)
+            {
+                subtotal += line.unitPrice * line.quantity;
+
+                const Cell &cell = table[index(static_cast<size_t>(line.category), seg)];
+                double best = 0.0;
+
+                double pct = cell.percentage.lookup(line.quantity);
+                if (pct > 0.0)
+                    best = max(best, lineSaving(RuleKind::PERCENTAGE, pct, line));
+
+                double perUnit = cell.fixedPerUnit.lookup(line.quantity);
+                if (perUnit > 0.0)
+                    best = max(best, lineSaving(RuleKind::FIXED_PER_UNIT, perUnit, line));
+
+                if (cell.bogo.lookup(line.quantity) > 0.0)
+                    best = max(best, lineSaving(RuleKind::BOGO, 1.0, line));
+
+                lineSavings += best;
+            }
+
+            double bestCart = cartRules[seg].lookup(subtotal);
+            return max(0.0, subtotal - lineSavings - bestCart);
+        }
+
+        size_t ruleCount() const { return sourceRules; }
+        uint64_t getVersion() const { return version; }
+
+        size_t compiledSteps() const
+        {
+            size_t total = 0;
+            for (const auto &cell : table)
+                total += cell.percentage.size() + cell.fixedPerUnit.size() + cell.bogo.size();
+            for (const auto &stairs : cartRules)
+                total += stairs.size();
+            return total;
+        }
+    };
+
+    // Owns the "current" rule set. Readers grab a snapshot per cart (or per
+    // batch); the promotions service publishes a new set without making
+    // readers wait for a compile. The pointer swap itself is guarded by a
+    // mutex from a libstdc++ pool, held for a refcount copy, not a compile.
+    class DiscountRuleEngine
+    {
+    private:
+        shared_ptr<const CompiledRuleSet> current;
+        atomic<uint64_t> nextVersion{1};
+
+    public:
+        explicit DiscountRuleEngine(const vector<RuleDefinition> &defs)
+            : current(CompiledRuleSet::compile(defs, 0)) {}
+
+        // Compile OFF the hot path, then publish with one atomic pointer swap
+        void hotSwap(const vector<RuleDefinition> &defs)
+        {
+            auto next = CompiledRuleSet::compile(defs, nextVersion++);
+            atomic_store_explicit(&current, next, memory_order_release);
+        }
+
+        shared_ptr<const CompiledRuleSet> snapshot() const
+        {
+            return atomic_load_explicit(&current, memory_order_acquire);
+        }
+
+        double price(const Cart &cart) const
+        {
+            return snapshot()->price(cart);
+        }
+
+        // Batch pricing: one snapshot for the whole batch (consistent + cheaper)
+        void priceBatch(const vector<Cart> &carts, vector<double> &totals) const
+        {
+            auto rules = snapshot();
+            totals.resize(carts.size());
+            for (size_t i = 0; i < carts.size(); ++i)
+                totals[i] = rules->price(carts[i]);
+        }
+    };
+}
+
+// ============================================================================
+// WORKLOAD GENERATION
+// ============================================================================
+
+vector<RuleDefinition> generateRules(size_t count, uint32_t seed)
+{
+    mt19937 rng(seed);
+    uniform_int_distribution<int> kindDist(0, 9);
+    uniform_int_distribution<int> catDist(-1, static_cast<int>(NUM_CATEGORIES) - 1);
+    uniform_int_distribution<int> segDist(-1, static_cast<int>(NUM_SEGMENTS) - 1);
+    uniform_int_distribution<int> qtyDist(1, 6);
+
+    vector<RuleDefinition> rules;
+    rules.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        RuleDefinition def{"R" + to_string(i), RuleKind::PERCENTAGE,
+                           catDist(rng), segDist(rng), 0.0, qtyDist(rng), 0.0};
+        int k = kindDist(rng);
+        if (k < 5)
+        {
+            def.kind = RuleKind::PERCENTAGE;
+            def.value = 5 + (rng() % 30);
+        }
+        else if (k < 7)
+        {
+            def.kind = RuleKind::FIXED_PER_UNIT;
+            def.value = 1 + (rng() % 20);
+        }
+        else if (k < 8)
+        {
+            def.kind = RuleKind::BOGO;
+            def.minQuantity = 2 + (rng() % 3);
+        }
+        else
+        {
+            def.kind = RuleKind::CART_THRESHOLD;
+            def.threshold = 50 + (rng() % 20) * 50;
+            def.value = def.threshold * (0.05 + (rng() % 10) / 100.0);
+        }
+        rules.push_back(def);
+    }
+    return rules;
+}
+
+vector<Cart> generateCarts(size_t count, uint32_t seed)
+{
+    mt19937 rng(seed);
+    uniform_int_distribution<int> lineDist(1, 8);
+    uniform_int_distribution<int> catDist(0, static_cast<int>(NUM_CATEGORIES) - 1);
+    uniform_int_distribution<int> segDist(0, static_cast<int>(NUM_SEGMENTS) - 1);
+    uniform_real_distribution<double> priceDist(2.0, 400.0);
+    uniform_int_distribution<int> qtyDist(1, 6);
+
+    vector<Cart> carts(count);
+    for (auto &cart : carts)
+    {
+        cart.segment = static_cast<Segment>(segDist(rng));
+        int lines = lineDist(rng);
+        for (int i = 0; i < lines; ++i)
+        {
+            cart.lines.push_back({static_cast<Category>(catDist(rng)),
+                                  floor(priceDist(rng) * 100) / 100, qtyDist(rng)});
+        }
+    }
+    return carts;
+}
+
+// ============================================================================
+// BENCHMARK
+// ============================================================================
+
+template <typename Fn>
+double cartsPerSecond(const vector<Cart> &carts, size_t rounds, Fn priceFn, double &checksum)
+{
+    auto start = chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; ++r)
+        for (const auto &cart : carts)
+            checksum += priceFn(cart);
+    auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return (carts.size() * rounds) / elapsed;
+}
+
+void benchmark(size_t ruleCount)
+{
+    auto defs = generateRules(ruleCount, 42);
+    auto carts = generateCarts(2000, 7);
+
+    chained_strategies::ChainedDiscountEngine chained(defs);
+    compiled_engine::DiscountRuleEngine engine(defs);
+
+    // Verify both designs agree before timing them
+    size_t mismatches = 0;
+    for (const auto &cart : carts)
+    {
+        if (fabs(chained.price(cart) - engine.price(cart)) > 1e-6)
+            ++mismatches;
+    }
+
+    // Keep the chained run short when rules are many - it is O(lines * rules)
+    size_t chainedRounds = ruleCount > 1000 ? 1 : 50;
+    double sink = 0.0;
+    double chainedRate = cartsPerSecond(carts, chainedRounds,
+                                        [&](const Cart &c)
+                                        { return chained.price(c); }, sink);
+    double compiledRate = cartsPerSecond(carts, 200,
+                                         [&](const Cart &c)
+                                         { return engine.price(c); }, sink);
+
+    auto snap = engine.snapshot();
+    cout << setw(7) << ruleCount << " rules | compiled steps: " << setw(5) << snap->compiledSteps()
+         << " | chained: " << setw(12) << fixed << setprecision(0) << chainedRate << " carts/s"
+         << " | compiled: " << setw(12) << compiledRate << " carts/s"
+         << " | speedup: " << setprecision(1) << compiledRate / chainedRate << "x"
+         << " | mismatches: " << mismatches << "\n";
+    if (sink == 42.0)
+        cout << ""; // keep the optimizer honest
+}
+
+void benchmarkHotSwap()
+{
+    cout << "\n--- Hot swap under load ---\n";
+    auto small = generateRules(10, 1);
+    auto large = generateRules(10000, 2);
+    auto carts = generateCarts(2000, 3);
+
+    compiled_engine::DiscountRuleEngine engine(small);
+    atomic<bool> stop{false};
+    atomic<uint64_t> priced{0};
+
+    vector<thread> pricers;
+    for (int t = 0; t < 2; ++t)
+    {
+        pricers.emplace_back([&, t]()
+                             {
+            vector<double> totals;
+            while (!stop.load(memory_order_relaxed))
+            {
+                engine.priceBatch(carts, totals);
+                priced.fetch_add(carts.size(), memory_order_relaxed);
+            } });
+    }
+
+    int swaps = 0;
+    auto start = chrono::steady_clock::now();
+    while (chrono::steady_clock::now() - start < chrono::milliseconds(500))
+    {
+        engine.hotSwap(swaps % 2 ? small : large);
+        ++swaps;
+        this_thread::sleep_for(chrono::milliseconds(20));
+    }
+    stop = true;
+    for (auto &t : pricers)
+        t.join();
+
+    cout << "Rule set swaps: " << swaps
+         << " | carts priced meanwhile: " << priced.load()
+         << " | final version: " << engine.snapshot()->getVersion() << "\n";
+    cout << "Readers never waited on a compile: each batch kept its own snapshot alive.\n";
+}
+
+// ============================================================================
+// MAIN: Demonstration
+// ============================================================================
+
+int main()
+{
+    cout << "=== DISCOUNT RULE ENGINE ===\n\n";
+
+    // Demo: the four legacy strategies expressed as rule DATA
+    vector<RuleDefinition> defs = {
+        {"vip-electronics-20", RuleKind::PERCENTAGE, (int)Category::ELECTRONICS, (int)Segment::VIP, 20, 1, 0},
+        {"books-bogo", RuleKind::BOGO, (int)Category::BOOKS, RuleDefinition::ANY, 0, 2, 0},
+        {"grocery-2-off", RuleKind::FIXED_PER_UNIT, (int)Category::GROCERY, RuleDefinition::ANY, 2, 3, 0},
+        {"seasonal-50-over-100", RuleKind::CART_THRESHOLD, RuleDefinition::ANY, RuleDefinition::ANY, 50, 0, 100},
+    };
+
+    compiled_engine::DiscountRuleEngine engine(defs);
+    Cart cart{Segment::VIP,
+              {{Category::ELECTRONICS, 299.99, 1},
+               {Category::BOOKS, 15.00, 4},
+               {Category::GROCERY, 3.50, 5}}};
+
+    cout << fixed << setprecision(2);
+    cout << "VIP cart subtotal: $" << cart.subtotal() << "\n";
+    cout << "Total with rules:  $" << engine.price(cart) << "\n";
+
+    cart.segment = Segment::REGULAR;
+    cout << "Same cart, regular customer: $" << engine.price(cart) << "\n";
+
+    cout << "\n--- Benchmark: chained virtual strategies vs compiled table ---\n";
+    benchmark(10);
+    benchmark(10000);
+
+    benchmarkHotSwap();
+
+    cout << "\n=== KEY TAKEAWAYS ===\n";
+    cout << "1. Promotions are data; compile them once, evaluate many times\n";
+    cout << "2. Index by (category, segment) so irrelevant rules cost nothing\n";
+    cout << "3. Collapse same-kind rules into staircases: O(log rules) per line\n";
+    cout << "4. Publish immutable snapshots; readers only hold a lock for a pointer copy\n";
+    cout << "5. Still OCP: a new rule kind is a new Staircase, not a new if-ladder\n";
+
+    return 0;
+}
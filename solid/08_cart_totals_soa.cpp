@@ -0,0 +1,547 @@
+/**
+ * SHOPPING CART TOTALS - Incremental, Exact and Vectorized
+ *
+ * Problem: discount_system::ShoppingCart in 02_ocp_open_closed.cpp stores a
+ * vector<double>, re-sums it sequentially on EVERY calculateTotal() call and
+ * prints from inside the calculation. A cart service recalculates on every
+ * mutation (add, remove, change quantity), so that is O(items) work + I/O per
+ * click, and binary floating point slowly drifts (0.10 is not representable).
+ *
+ * Key Points:
+ * - FIXED-POINT money: prices are int64 cents. Sums are exact and associative,
+ *   which is what makes reordering them for SIMD legal.
+ * - INCREMENTAL totals: addItem/removeItem/setQuantity adjust a running total
+ *   in O(1). A full recompute is only needed for audits or after bulk loads.
+ * - STRUCTURE OF ARRAYS (SoA): sku, price, quantity and lineTotal live in
+ *   separate contiguous arrays. Summing lineTotal streams exactly one array
+ *   through the cache (8 values per 64-byte line) instead of dragging whole
+ *   item structs along (AoS).
+ * - SIMD recompute: SSE2 (baseline on x86-64) or AVX2 (-mavx2) adds 2/4
+ *   lanes of int64 per instruction; a portable 4-accumulator loop is the
+ *   fallback everywhere else.
+ * - BATCH API: thousands of carts in one CSR-style layout (offsets + one flat
+ *   lineTotal array) priced in a single sweep.
+ * - SRP fix: pricing returns numbers; printing is a separate receipt function.
+ *
+ * Accuracy comparison (double):
+ * - Naive summation error grows with the number of items (O(n * eps)).
+ * - Kahan summation carries the lost low-order bits in a compensation term.
+ * - Fixed-point cents has no rounding error at all (until 2^63 cents).
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <iomanip>
+#include <cstdint>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// ============================================================================
+// VIOLATION: the original cart (sums + prints on every call)
+// ============================================================================
+
+namespace bad_design
+{
+
+    class ShoppingCart
+    {
+    private:
+        vector<double> items;
+
+    public:
+        void addItem(double price) { items.push_back(price); }
+
+        void removeLast()
+        {
+            if (!items.empty())
+                items.pop_back();
+        }
+
+        // O(n) every time, float drift, and I/O mixed into the calculation
+        double calculateTotal(bool print = true) const
+        {
+            double subtotal = 0.0;
+            for (double price : items)
+            {
+                subtotal += price;
+            }
+            if (print)
+                cout << "Subtotal: $" << subtotal << "\n";
+            return subtotal;
+        }
+    };
+}
+
+// ============================================================================
+// SUMMATION KERNELS
+// ============================================================================
+
+namespace summation
+{
+
+    // Naive double sum - what the original cart does
+    double naiveSum(const double *values, size_t n)
+    {
+        double sum = 0.0;
+        for (size_t i = 0; i < n; ++i)
+            sum += values[i];
+        return sum;
+    }
+
+    // Kahan (compensated) sum - keeps the bits naive summation throws away.
+    // Note: must not be compiled with -ffast-math, which cancels the compensation.
+    double kahanSum(const double *values, size_t n)
+    {
+        double sum = 0.0;
+        double compensation = 0.0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            double y = values[i] - compensation;
+            double t = sum + y;
+            compensation = (t - sum) - y;
+            sum = t;
+        }
+        return sum;
+    }
+
+    // Exact int64 sum, vectorized. Integer addition is associative, so
+    // splitting into lanes gives bit-identical results to the scalar loop.
+    int64_t sumCents(const int64_t *values, size_t n)
+    {
+        size_t i = 0;
+        int64_t total = 0;
+
+#if defined(__AVX2__)
+        __m256i acc0 = _mm256_setzero_si256();
+        __m256i acc1 = _mm256_setzero_si256();
+        for (; i + 8 <= n; i += 8)
+        {
+            acc0 = _mm256_add_epi64(acc0, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i)));
+            acc1 = _mm256_add_epi64(acc1, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i + 4)));
+        }
+        alignas(32) int64_t lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), _mm256_add_epi64(acc0, acc1));
+        total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__SSE2__)
+        __m128i acc0 = _mm_setzero_si128();
+        __m128i acc1 = _mm_setzero_si128();
+        for (; i + 4 <= n; i += 4)
+        {
+            acc0 = _mm_add_epi64(acc0, _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i)));
+            acc1 = _mm_add_epi64(acc1, _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i + 2)));
+        }
+        alignas(16) int64_t lanes[2];
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanes), _mm_add_epi64(acc0, acc1));
+        total = lanes[0] + lanes[1];
+#else
+        // Portable: independent accumulators break the add dependency chain
+        int64_t a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            a0 += values[i];
+            a1 += values[i + 1];
+            a2 += values[i + 2];
+            a3 += values[i + 3];
+        }
+        total = a0 + a1 + a2 + a3;
+#endif
+        for (; i < n; ++i)
+            total += values[i];
+        return total;
+    }
+
+    const char *kernelName()
+    {
+#if defined(__AVX2__)
+        return "AVX2 (4 x int64 lanes)";
+#elif defined(__SSE2__)
+        return "SSE2 (2 x int64 lanes)";
+#else
+        return "portable 4-accumulator loop";
+#endif
+    }
+}
+
+// ============================================================================
+// CORRECT: SoA cart with fixed-point money and incremental totals
+// ============================================================================
+
+namespace good_design
+{
+
+    using Cents = int64_t;
+
+    inline Cents toCents(double dollars) { return llround(dollars * 100.0); }
+    inline double toDollars(Cents cents) { return cents / 100.0; }
+
+    // Discounts work in cents too - basis points keep percentages exact-ish
+    class DiscountStrategy
+    {
+    public:
+        virtual ~DiscountStrategy() = default;
+        virtual Cents apply(Cents subtotal) const = 0;
+        virtual string getDescription() const = 0;
+    };
+
+    class NoDiscount : public DiscountStrategy
+    {
+    public:
+        Cents apply(Cents subtotal) const override { return subtotal; }
+        string getDescription() const override { return "No discount"; }
+    };
+
+    class PercentageDiscount : public DiscountStrategy
+    {
+    private:
+        int64_t basisPoints; // 20% = 2000 bp
+
+    public:
+        PercentageDiscount(double pct) : basisPoints(llround(pct * 100)) {}
+
+        Cents apply(Cents subtotal) const override
+        {
+            // Round half up to the nearest cent
+            return subtotal - (subtotal * basisPoints + 5000) / 10000;
+        }
+
+        string getDescription() const override
+        {
+            return to_string(basisPoints / 100) + "% off";
+        }
+    };
+
+    // Invariant: runningTotal == sum(lineTotal) after every public call.
+    class ShoppingCart
+    {
+    private:
+        // Structure of Arrays: one array per field, index = line slot
+        vector<uint32_t> sku;
+        vector<Cents> unitPrice;
+        vector<int32_t> quantity;
+        vector<Cents> lineTotal;
+
+        // SKU -> slot, so mutations do not scan the sku column
+        unordered_map<uint32_t, size_t> slotOf;
+
+        Cents runningTotal = 0;
+        unique_ptr<DiscountStrategy> discount;
+
+        size_t findLine(uint32_t id) const
+        {
+            auto it = slotOf.find(id);
+            if (it == slotOf.end())
+                throw out_of_range("SKU not in cart: " + to_string(id));
+            return it->second;
+        }
+
+    public:
+        ShoppingCart() : discount(make_unique<NoDiscount>()) {}
+
+        void reserve(size_t lines)
+        {
+            sku.reserve(lines);
+            unitPrice.reserve(lines);
+            quantity.reserve(lines);
+            lineTotal.reserve(lines);
+            slotOf.reserve(lines);
+        }
+
+        // O(1) amortized: append one slot, adjust running total
+        void addItem(uint32_t id, Cents price, int32_t qty = 1)
+        {
+            if (slotOf.count(id))
+                throw invalid_argument("SKU already in cart: " + to_string(id));
+            Cents line = price * qty;
+            slotOf[id] = sku.size();
+            sku.push_back(id);
+            unitPrice.push_back(price);
+            quantity.push_back(qty);
+            lineTotal.push_back(line);
+            runningTotal += line;
+        }
+
+        // O(1) after lookup: swap-with-last keeps the arrays dense (order not preserved)
+        void removeItem(uint32_t id)
+        {
+            size_t i = findLine(id);
+            runningTotal -= lineTotal[i];
+            size_t last = sku.size() - 1;
+            slotOf[sku[last]] = i;
+            slotOf.erase(id);
+            sku[i] = sku[last];
+            unitPrice[i] = unitPrice[last];
+            quantity[i] = quantity[last];
+            lineTotal[i] = lineTotal[last];
+            sku.pop_back();
+            unitPrice.pop_back();
+            quantity.pop_back();
+            lineTotal.pop_back();
+        }
+
+        void setQuantity(uint32_t id, int32_t qty)
+        {
+            size_t i = findLine(id);
+            Cents line = unitPrice[i] * qty;
+            runningTotal += line - lineTotal[i];
+            quantity[i] = qty;
+            lineTotal[i] = line;
+        }
+
+        void setDiscountStrategy(unique_ptr<DiscountStrategy> strategy)
+        {
+            discount = move(strategy);
+        }
+
+        Cents subtotal() const { return runningTotal; }
+        Cents total() const { return discount->apply(runningTotal); }
+
+        // Full recompute over the lineTotal column only (audit / bulk load)
+        Cents recomputeSubtotal() const
+        {
+            return summation::sumCents(lineTotal.data(), lineTotal.size());
+        }
+
+        size_t lineCount() const { return sku.size(); }
+        const vector<Cents> &lineTotals() const { return lineTotal; }
+        const DiscountStrategy &getDiscount() const { return *discount; }
+    };
+
+    // Presentation is its own responsibility (SRP)
+    void printReceipt(const ShoppingCart &cart)
+    {
+        cout << fixed << setprecision(2);
+        cout << "Subtotal: $" << toDollars(cart.subtotal()) << "\n";
+        cout << "Discount: " << cart.getDiscount().getDescription() << "\n";
+        cout << "Total: $" << toDollars(cart.total()) << "\n";
+    }
+
+    // Thousands of carts in CSR layout: cart c owns lineTotals[offsets[c] .. offsets[c+1])
+    class CartBatch
+    {
+    private:
+        vector<size_t> offsets{0};
+        vector<Cents> lineTotals;
+        vector<int64_t> discountBasisPoints;
+
+    public:
+        void reserve(size_t carts, size_t lines)
+        {
+            offsets.reserve(carts + 1);
+            discountBasisPoints.reserve(carts);
+            lineTotals.reserve(lines);
+        }
+
+        void addCart(const vector<Cents> &lines, int64_t basisPoints)
+        {
+            lineTotals.insert(lineTotals.end(), lines.begin(), lines.end());
+            offsets.push_back(lineTotals.size());
+            discountBasisPoints.push_back(basisPoints);
+        }
+
+        size_t size() const { return discountBasisPoints.size(); }
+
+        // One sweep over contiguous memory; each segment uses the SIMD kernel
+        void priceAll(vector<Cents> &totals) const
+        {
+            totals.resize(size());
+            for (size_t c = 0; c < size(); ++c)
+            {
+                Cents sub = summation::sumCents(lineTotals.data() + offsets[c],
+                                                offsets[c + 1] - offsets[c]);
+                totals[c] = sub - (sub * discountBasisPoints[c] + 5000) / 10000;
+            }
+        }
+    };
+}
+
+// ============================================================================
+// BENCHMARKS
+// ============================================================================
+
+using Clock = chrono::steady_clock;
+
+double nsPer(Clock::time_point start, size_t ops)
+{
+    return chrono::duration<double, nano>(Clock::now() - start).count() / ops;
+}
+
+void accuracyDemo()
+{
+    cout << "\n--- Accuracy: 10,000,000 items at $0.10 ---\n";
+    const size_t n = 10000000;
+    vector<double> prices(n, 0.10);
+    vector<int64_t> cents(n, 10);
+
+    cout << fixed << setprecision(10);
+    cout << "Naive double: $" << summation::naiveSum(prices.data(), n) << "\n";
+    cout << "Kahan double: $" << summation::kahanSum(prices.data(), n) << "\n";
+    cout << "Fixed cents:  $" << good_design::toDollars(summation::sumCents(cents.data(), n))
+         << "  (exact: 1000000.00)\n";
+    cout << setprecision(2);
+}
+
+void mutationBenchmark()
+{
+    cout << "\n--- Per-mutation cost (cart with 200 lines, recalc after each mutation) ---\n";
+    const int lines = 200;
+    const int mutations = 200000;
+    mt19937 rng(1);
+
+    // Original: every mutation triggers an O(n) re-sum
+    bad_design::ShoppingCart oldCart;
+    for (int i = 0; i < lines; ++i)
+        oldCart.addItem(9.99 + i);
+    double sink = 0.0;
+    auto start = Clock::now();
+    for (int m = 0; m < mutations; ++m)
+    {
+        oldCart.removeLast();
+        oldCart.addItem(4.99 + (m & 7));
+        sink += oldCart.calculateTotal(false);
+    }
+    double oldNs = nsPer(start, mutations);
+
+    // New: running total, O(1) per mutation
+    good_design::ShoppingCart cart;
+    cart.reserve(lines);
+    for (int i = 0; i < lines; ++i)
+        cart.addItem(i, 999 + i * 100);
+    int64_t isink = 0;
+    start = Clock::now();
+    for (int m = 0; m < mutations; ++m)
+    {
+        uint32_t id = rng() % lines;
+        cart.setQuantity(id, 1 + (m & 3));
+        isink += cart.total();
+    }
+    double newNs = nsPer(start, mutations);
+
+    cout << "vector<double> re-sum:     " << setw(8) << oldNs << " ns/mutation\n";
+    cout << "SoA running total:         " << setw(8) << newNs << " ns/mutation\n";
+    cout << "Running total == recompute: "
+         << (cart.subtotal() == cart.recomputeSubtotal() ? "yes" : "NO") << "\n";
+    if (sink == 0.5 && isink == 5)
+        cout << "";
+}
+
+void recomputeBenchmark()
+{
+    cout << "\n--- Full recompute kernel: " << summation::kernelName() << " ---\n";
+    const size_t n = 1 << 20;
+    const int rounds = 50;
+    vector<double> prices(n);
+    vector<int64_t> cents(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        cents[i] = 100 + (i % 5000);
+        prices[i] = cents[i] / 100.0;
+    }
+
+    double dsink = 0.0;
+    int64_t isink = 0;
+
+    auto start = Clock::now();
+    for (int r = 0; r < rounds; ++r)
+        dsink += summation::naiveSum(prices.data(), n);
+    double naiveNs = nsPer(start, n * rounds);
+
+    start = Clock::now();
+    for (int r = 0; r < rounds; ++r)
+        dsink += summation::kahanSum(prices.data(), n);
+    double kahanNs = nsPer(start, n * rounds);
+
+    start = Clock::now();
+    for (int r = 0; r < rounds; ++r)
+        isink += summation::sumCents(cents.data(), n);
+    double simdNs = nsPer(start, n * rounds);
+
+    cout << setprecision(3);
+    cout << "naive double: " << naiveNs << " ns/item\n";
+    cout << "kahan double: " << kahanNs << " ns/item\n";
+    cout << "int64 SIMD:   " << simdNs << " ns/item\n";
+    cout << setprecision(2);
+    if (dsink == 0.5 && isink == 5)
+        cout << "";
+}
+
+void batchBenchmark()
+{
+    cout << "\n--- Batch pricing ---\n";
+    const size_t carts = 100000;
+    mt19937 rng(9);
+    uniform_int_distribution<int> lineDist(1, 40);
+    uniform_int_distribution<int> priceDist(99, 49999);
+
+    good_design::CartBatch batch;
+    batch.reserve(carts, carts * 20);
+    vector<good_design::Cents> lines;
+    for (size_t c = 0; c < carts; ++c)
+    {
+        lines.clear();
+        int n = lineDist(rng);
+        for (int i = 0; i < n; ++i)
+            lines.push_back(priceDist(rng) * (1 + rng() % 3));
+        batch.addCart(lines, (rng() % 4) * 500);
+    }
+
+    vector<good_design::Cents> totals;
+    const int rounds = 20;
+    auto start = Clock::now();
+    for (int r = 0; r < rounds; ++r)
+        batch.priceAll(totals);
+    double secs = chrono::duration<double>(Clock::now() - start).count();
+
+    cout << fixed << setprecision(0);
+    cout << "Priced " << carts << " carts x " << rounds << " rounds: "
+         << (carts * rounds) / secs << " carts/s\n";
+    cout << setprecision(2);
+}
+
+// ============================================================================
+// MAIN: Demonstration
+// ============================================================================
+
+int main()
+{
+    cout << "=== SHOPPING CART TOTALS: SoA + FIXED POINT + SIMD ===\n\n";
+
+    good_design::ShoppingCart cart;
+    cart.addItem(1, good_design::toCents(50.00));
+    cart.addItem(2, good_design::toCents(30.00));
+    cart.addItem(3, good_design::toCents(20.00));
+
+    cout << "With no discount:\n";
+    good_design::printReceipt(cart);
+
+    cout << "\nWith 20% discount, 2x item 2, item 3 removed:\n";
+    cart.setDiscountStrategy(make_unique<good_design::PercentageDiscount>(20));
+    cart.setQuantity(2, 2);
+    cart.removeItem(3);
+    good_design::printReceipt(cart);
+
+    accuracyDemo();
+    mutationBenchmark();
+    recomputeBenchmark();
+    batchBenchmark();
+
+    cout << "\n=== KEY TAKEAWAYS ===\n";
+    cout << "1. Money as integer cents: exact, and safe to reorder for SIMD\n";
+    cout << "2. Maintain totals incrementally; recompute only to audit\n";
+    cout << "3. SoA keeps the hot column contiguous and cache-friendly\n";
+    cout << "4. Batch many carts into one flat layout to amortize overhead\n";
+    cout << "5. Keep printing out of calculation functions (SRP)\n";
+
+    return 0;
+}
@@ -0,0 +1,624 @@
+/**
+ * RESILIENT NOTIFICATION BROADCAST
+ * Parallel fan-out + timer-wheel backoff + per-channel circuit breakers
+ *
+ * Problem: notification_system in 02_ocp_open_closed.cpp has two hot-path
+ * weaknesses that are invisible in a demo but painful in production:
+ *
+ * 1. NotificationManager::broadcast() calls channels one after another. If
+ *    SMS stalls for 2 seconds, Email/Push/Slack wait behind it:
+ *        broadcast latency = SUM of channel latencies.
+ * 2. RetryNotification::send() retries immediately in a tight loop. A channel
+ *    that is down gets hammered maxRetries times in microseconds (retry storm),
+ *    and a "fix" with sleep_for() would park one thread per pending retry.
+ *
+ * Design (still OCP: channels are untouched, new behavior is composition):
+ * - FAN-OUT: each channel send is a task on a small thread pool, so
+ *        broadcast latency = MAX of channel latencies.
+ * - BACKOFF: failed sends are re-armed on a hashed TIMING WHEEL with
+ *   exponential backoff + full jitter. One wheel thread serves every pending
+ *   retry; no thread sleeps on behalf of a single message.
+ * - CIRCUIT BREAKER per channel: after N consecutive failures (or slow calls)
+ *   the breaker OPENS and sends are skipped in nanoseconds. After a cooldown
+ *   one HALF-OPEN probe decides whether to close it again.
+ *
+ *   CLOSED --(N failures)--> OPEN --(cooldown)--> HALF_OPEN --(ok)--> CLOSED
+ *                              ^                      |
+ *                              +-------(fail)---------+
+ *
+ * Cost notes:
+ * - Breaker fast path is one atomic load - no lock on the hot path.
+ * - Trade-off: fan-out adds a thread handoff, so p50 of a healthy broadcast can
+ *   be slightly worse than the serial loop; the win is in the tail (p99/max).
+ * - Timer wheel insert is O(1): slot = (now + delay) % wheelSize.
+ * - Jitter spreads retries so a recovering channel is not hit by a thundering herd.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <queue>
+#include <future>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+#include <cstdlib>
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+// ============================================================================
+// CHANNEL ABSTRACTION (same contract as 02_ocp_open_closed.cpp)
+// ============================================================================
+
+class NotificationChannel
+{
+public:
+    virtual ~NotificationChannel() = default;
+    // Throws on delivery failure (as RetryNotification expects)
+    virtual void send(const string &recipient, const string &message) = 0;
+    virtual string getChannelName() const = 0;
+};
+
+// Local fake channel: fails or stalls a configurable fraction of the time
+class FakeChannel : public NotificationChannel
+{
+private:
+    string name;
+    double failRate;
+    double stallRate;
+    chrono::milliseconds stall;
+    atomic<uint64_t> delivered{0};
+
+    static double roll()
+    {
+        thread_local mt19937 rng(random_device{}());
+        return uniform_real_distribution<double>(0.0, 1.0)(rng);
+    }
+
+public:
+    FakeChannel(const string &n, double fail, double stallProb, chrono::milliseconds stallFor)
+        : name(n), failRate(fail), stallRate(stallProb), stall(stallFor) {}
+
+    void send(const string &, const string &) override
+    {
+        if (roll() < stallRate)
+            this_thread::sleep_for(stall); // a slow upstream, not our backoff
+        if (roll() < failRate)
+            throw runtime_error(name + " gateway error");
+        delivered.fetch_add(1, memory_order_relaxed);
+    }
+
+    string getChannelName() const override { return name; }
+    uint64_t deliveredCount() const { return delivered.load(); }
+};
+
+// ============================================================================
+// BASELINE: serial broadcast + tight-loop retry (original behavior)
+// ============================================================================
+
+namespace original
+{
+
+    class RetryNotification
+    {
+    private:
+        NotificationChannel *channel;
+        int maxRetries;
+
+    public:
+        RetryNotification(NotificationChannel *ch, int retries)
+            : channel(ch), maxRetries(retries) {}
+
+        bool send(const string &recipient, const string &message)
+        {
+            for (int i = 0; i < maxRetries; ++i)
+            {
+                try
+                {
+                    channel->send(recipient, message);
+                    return true;
+                }
+                catch (...)
+                {
+                    // Retries immediately: no backoff, no jitter
+                }
+            }
+            return false;
+        }
+    };
+
+    class NotificationManager
+    {
+    private:
+        vector<RetryNotification> channels;
+
+    public:
+        void addChannel(NotificationChannel *channel, int retries)
+        {
+            channels.emplace_back(channel, retries);
+        }
+
+        int broadcast(const string &recipient, const string &message)
+        {
+            int ok = 0;
+            for (auto &channel : channels)
+                ok += channel.send(recipient, message);
+            return ok;
+        }
+    };
+}
+
+// ============================================================================
+// INFRASTRUCTURE: thread pool + hashed timing wheel
+// ============================================================================
+
+class ThreadPool
+{
+private:
+    vector<thread> workers;
+    queue<function<void()>> tasks;
+    mutex mtx;
+    condition_variable cv;
+    bool stopping = false;
+
+public:
+    explicit ThreadPool(size_t threads)
+    {
+        for (size_t i = 0; i < threads; ++i)
+        {
+            workers.emplace_back([this]()
+                                 {
+                while (true)
+                {
+                    function<void()> task;
+                    {
+                        unique_lock<mutex> lock(mtx);
+                        cv.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                        if (stopping && tasks.empty())
+                            return;
+                        task = move(tasks.front());
+                        tasks.pop();
+                    }
+                    task();
+                } });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto &w : workers)
+            w.join();
+    }
+
+    void submit(function<void()> task)
+    {
+        {
+            lock_guard<mutex> lock(mtx);
+            tasks.push(move(task));
+        }
+        cv.notify_one();
+    }
+};
+
+// Single-level hashed wheel: slot = (currentTick + ticks) % SLOTS.
+// Timers further away than one revolution carry a "rounds" counter.
+// One thread advances the wheel; callbacks must be short (they hand work
+// back to the ThreadPool rather than doing it inline).
+class TimerWheel
+{
+private:
+    struct Timer
+    {
+        uint64_t rounds;
+        function<void()> callback;
+    };
+
+    static constexpr size_t SLOTS = 512;
+    const chrono::microseconds tick;
+    vector<vector<Timer>> slots;
+    uint64_t currentTick = 0;
+    mutex mtx;
+    atomic<bool> running{true};
+    thread driver;
+
+    void run()
+    {
+        auto next = Clock::now();
+        vector<Timer> due;
+        while (running.load(memory_order_relaxed))
+        {
+            next += tick;
+            this_thread::sleep_until(next);
+            {
+                lock_guard<mutex> lock(mtx);
+                ++currentTick;
+                auto &slot = slots[currentTick % SLOTS];
+                auto keep = slot.begin();
+                for (auto &timer : slot)
+                {
+                    if (timer.rounds == 0)
+                        due.push_back(move(timer));
+                    else
+                    {
+                        --timer.rounds;
+                        *keep++ = move(timer);
+                    }
+                }
+                slot.erase(keep, slot.end());
+            }
+            for (auto &timer : due) // fire outside the lock
+                timer.callback();
+            due.clear();
+        }
+    }
+
+public:
+    explicit TimerWheel(chrono::microseconds tickSize)
+        : tick(tickSize), slots(SLOTS), driver([this]()
+                                               { run(); }) {}
+
+    ~TimerWheel() { stop(); }
+
+    // Stops firing; later schedule() calls are accepted but never run
+    void stop()
+    {
+        if (running.exchange(false))
+            driver.join();
+    }
+
+    void schedule(chrono::microseconds delay, function<void()> callback)
+    {
+        uint64_t ticks = max<uint64_t>(1, (delay.count() + tick.count() - 1) / tick.count());
+        lock_guard<mutex> lock(mtx);
+        slots[(currentTick + ticks) % SLOTS].push_back({(ticks - 1) / SLOTS, move(callback)});
+    }
+};
+
+// ============================================================================
+// CIRCUIT BREAKER
+// ============================================================================
+
+class CircuitBreaker
+{
+public:
+    enum State
+    {
+        CLOSED,
+        OPEN,
+        HALF_OPEN
+    };
+
+private:
+    const int failureThreshold;
+    const chrono::nanoseconds cooldown;
+    atomic<int> state{CLOSED};
+    atomic<int> consecutiveFailures{0};
+    atomic<int64_t> openedAt{0};
+
+    static int64_t now() { return Clock::now().time_since_epoch().count(); }
+
+public:
+    CircuitBreaker(int threshold, chrono::milliseconds cool)
+        : failureThreshold(threshold), cooldown(cool) {}
+
+    // Hot path: CLOSED costs one atomic load
+    bool allowRequest()
+    {
+        int s = state.load(memory_order_acquire);
+        if (s == CLOSED)
+            return true;
+        if (s == OPEN && now() - openedAt.load(memory_order_relaxed) >= cooldown.count())
+        {
+            // Exactly one caller wins the probe
+            return state.compare_exchange_strong(s, HALF_OPEN, memory_order_acq_rel);
+        }
+        return false;
+    }
+
+    void onSuccess()
+    {
+        consecutiveFailures.store(0, memory_order_relaxed);
+        state.store(CLOSED, memory_order_release);
+    }
+
+    void onFailure()
+    {
+        int s = state.load(memory_order_acquire);
+        if (s == HALF_OPEN || consecutiveFailures.fetch_add(1, memory_order_relaxed) + 1 >= failureThreshold)
+        {
+            openedAt.store(now(), memory_order_relaxed);
+            state.store(OPEN, memory_order_release);
+        }
+    }
+
+    State getState() const { return static_cast<State>(state.load()); }
+
+    static const char *name(State s)
+    {
+        return s == CLOSED ? "CLOSED" : s == OPEN ? "OPEN"
+                                                  : "HALF_OPEN";
+    }
+};
+
+// ============================================================================
+// RESILIENT MANAGER
+// ============================================================================
+
+struct RetryPolicy
+{
+    int maxAttempts = 4;
+    chrono::microseconds baseDelay{2000};
+    chrono::microseconds maxDelay{50000};
+    chrono::microseconds slowCall{20000}; // slower than this counts against the breaker
+
+    // Full jitter: uniform in [0, min(max, base * 2^attempt)]
+    chrono::microseconds backoff(int attempt) const
+    {
+        thread_local mt19937 rng(random_device{}());
+        int64_t cap = min<int64_t>(maxDelay.count(), baseDelay.count() << min(attempt, 20));
+        return chrono::microseconds(uniform_int_distribution<int64_t>(0, cap)(rng));
+    }
+};
+
+enum class Outcome
+{
+    PENDING,
+    DELIVERED,
+    FAILED,
+    SKIPPED_OPEN_CIRCUIT
+};
+
+struct BroadcastReport
+{
+    vector<Outcome> outcomes;
+    chrono::microseconds latency;
+};
+
+class ResilientNotificationManager
+{
+private:
+    struct ChannelSlot
+    {
+        unique_ptr<NotificationChannel> channel;
+        CircuitBreaker breaker;
+
+        ChannelSlot(unique_ptr<NotificationChannel> ch, int threshold, chrono::milliseconds cooldown)
+            : channel(move(ch)), breaker(threshold, cooldown) {}
+    };
+
+    // Shared by every task of one broadcast; last one to finish fulfils the promise
+    struct Broadcast
+    {
+        string recipient;
+        string message;
+        vector<Outcome> outcomes;
+        atomic<int> pending;
+        promise<void> done;
+        Clock::time_point start = Clock::now();
+
+        Broadcast(const string &r, const string &m, size_t channels)
+            : recipient(r), message(m), outcomes(channels, Outcome::PENDING),
+              pending(static_cast<int>(channels)) {}
+    };
+
+    vector<unique_ptr<ChannelSlot>> slots;
+    RetryPolicy policy;
+    int breakerThreshold;
+    chrono::milliseconds breakerCooldown;
+    // Shutdown order matters: the destructor stops the wheel thread first (no
+    // timer can submit into a dying pool), then the pool drains - and any task
+    // it runs may still schedule() on the stopped-but-alive wheel.
+    TimerWheel wheel;
+    ThreadPool pool;
+
+    void finish(const shared_ptr<Broadcast> &b, size_t index, Outcome outcome)
+    {
+        b->outcomes[index] = outcome;
+        if (b->pending.fetch_sub(1, memory_order_acq_rel) == 1)
+            b->done.set_value();
+    }
+
+    void attempt(shared_ptr<Broadcast> b, size_t index, int attemptNo)
+    {
+        ChannelSlot &slot = *slots[index];
+        if (!slot.breaker.allowRequest())
+        {
+            finish(b, index, Outcome::SKIPPED_OPEN_CIRCUIT);
+            return;
+        }
+
+        auto start = Clock::now();
+        bool ok = true;
+        try
+        {
+            slot.channel->send(b->recipient, b->message);
+        }
+        catch (...)
+        {
+            ok = false;
+        }
+        bool slow = Clock::now() - start > policy.slowCall;
+
+        if (ok)
+        {
+            slow ? slot.breaker.onFailure() : slot.breaker.onSuccess();
+            finish(b, index, Outcome::DELIVERED);
+            return;
+        }
+
+        slot.breaker.onFailure();
+        if (attemptNo + 1 >= policy.maxAttempts)
+        {
+            finish(b, index, Outcome::FAILED);
+            return;
+        }
+
+        // No sleeping: park the retry on the wheel, free this worker now
+        wheel.schedule(policy.backoff(attemptNo), [this, b, index, attemptNo]()
+                       { pool.submit([this, b, index, attemptNo]()
+                                     { attempt(b, index, attemptNo + 1); }); });
+    }
+
+public:
+    ResilientNotificationManager(size_t workers, RetryPolicy retry,
+                                 int threshold = 5, chrono::milliseconds cooldown = chrono::milliseconds(200))
+        : policy(retry), breakerThreshold(threshold), breakerCooldown(cooldown),
+          wheel(chrono::microseconds(500)), pool(workers) {}
+
+    ~ResilientNotificationManager() { wheel.stop(); }
+
+    void addChannel(unique_ptr<NotificationChannel> channel)
+    {
+        slots.push_back(make_unique<ChannelSlot>(move(channel), breakerThreshold, breakerCooldown));
+    }
+
+    // Fan out to every channel; the future completes when all have settled
+    future<void> broadcastAsync(const shared_ptr<Broadcast> &b)
+    {
+        auto fut = b->done.get_future();
+        for (size_t i = 0; i < slots.size(); ++i)
+            pool.submit([this, b, i]()
+                        { attempt(b, i, 0); });
+        return fut;
+    }
+
+    BroadcastReport broadcast(const string &recipient, const string &message)
+    {
+        auto b = make_shared<Broadcast>(recipient, message, slots.size());
+        broadcastAsync(b).wait();
+        return {b->outcomes, chrono::duration_cast<chrono::microseconds>(Clock::now() - b->start)};
+    }
+
+    void printBreakers() const
+    {
+        for (const auto &slot : slots)
+        {
+            cout << "  " << setw(10) << left << slot->channel->getChannelName() << right
+                 << " breaker: " << CircuitBreaker::name(slot->breaker.getState()) << "\n";
+        }
+    }
+};
+
+// ============================================================================
+// BENCHMARK
+// ============================================================================
+
+struct Config
+{
+    double failRate = 0.10;
+    double stallRate = 0.05;
+    int stallMs = 30;
+    int broadcasts = 200;
+};
+
+struct Summary
+{
+    double p50, p99, max;
+};
+
+Summary summarize(vector<double> latenciesUs)
+{
+    sort(latenciesUs.begin(), latenciesUs.end());
+    auto at = [&](double q)
+    { return latenciesUs[min(latenciesUs.size() - 1, size_t(q * latenciesUs.size()))] / 1000.0; };
+    return {at(0.50), at(0.99), latenciesUs.back() / 1000.0};
+}
+
+vector<unique_ptr<FakeChannel>> makeChannels(const Config &cfg)
+{
+    vector<unique_ptr<FakeChannel>> channels;
+    const char *names[] = {"Email", "SMS", "Push", "Slack", "Webhook", "Pager"};
+    for (const char *n : names)
+        channels.push_back(make_unique<FakeChannel>(n, cfg.failRate, cfg.stallRate, chrono::milliseconds(cfg.stallMs)));
+    // One channel that is completely down - the breaker should cut it off
+    channels.push_back(make_unique<FakeChannel>("DeadSMSC", 1.0, 0.0, chrono::milliseconds(0)));
+    return channels;
+}
+
+void printSummary(const char *label, const Summary &s)
+{
+    cout << setw(28) << left << label << right << fixed << setprecision(2)
+         << " p50: " << setw(7) << s.p50 << " ms"
+         << "  p99: " << setw(7) << s.p99 << " ms"
+         << "  max: " << setw(7) << s.max << " ms\n";
+}
+
+int main(int argc, char **argv)
+{
+    Config cfg;
+    if (argc > 1)
+        cfg.failRate = atof(argv[1]);
+    if (argc > 2)
+        cfg.stallRate = atof(argv[2]);
+    if (argc > 3)
+        cfg.stallMs = atoi(argv[3]);
+
+    cout << "=== RESILIENT NOTIFICATION BROADCAST ===\n";
+    cout << "Usage: ./program [failRate] [stallRate] [stallMs]\n";
+    cout << "Fake channels: fail " << cfg.failRate * 100 << "%, stall " << cfg.stallRate * 100
+         << "% for " << cfg.stallMs << " ms, plus one channel that is always down\n\n";
+
+    // Baseline: serial broadcast, tight-loop retry
+    auto serialChannels = makeChannels(cfg);
+    original::NotificationManager serial;
+    for (auto &ch : serialChannels)
+        serial.addChannel(ch.get(), 4);
+
+    vector<double> serialLatency;
+    for (int i = 0; i < cfg.broadcasts; ++i)
+    {
+        auto start = Clock::now();
+        serial.broadcast("user@example.com", "Your order has shipped!");
+        serialLatency.push_back(chrono::duration<double, micro>(Clock::now() - start).count());
+    }
+
+    // Resilient: parallel fan-out, wheel backoff, breakers
+    RetryPolicy policy;
+    ResilientNotificationManager resilient(16, policy);
+    for (auto &ch : makeChannels(cfg))
+        resilient.addChannel(move(ch));
+
+    vector<double> parallelLatency;
+    int delivered = 0, failed = 0, skipped = 0;
+    for (int i = 0; i < cfg.broadcasts; ++i)
+    {
+        auto report = resilient.broadcast("user@example.com", "Your order has shipped!");
+        parallelLatency.push_back(report.latency.count());
+        for (auto o : report.outcomes)
+        {
+            delivered += o == Outcome::DELIVERED;
+            failed += o == Outcome::FAILED;
+            skipped += o == Outcome::SKIPPED_OPEN_CIRCUIT;
+        }
+    }
+
+    cout << "--- Broadcast latency over " << cfg.broadcasts << " broadcasts ---\n";
+    printSummary("Serial + tight retry:", summarize(serialLatency));
+    printSummary("Fan-out + backoff + breaker:", summarize(parallelLatency));
+    cout << "\nResilient outcomes: delivered " << delivered << ", failed " << failed
+         << ", skipped by open circuit " << skipped << "\n";
+    cout << "Breaker states after run:\n";
+    resilient.printBreakers();
+
+    cout << "\n=== KEY TAKEAWAYS ===\n";
+    cout << "1. Fan-out turns SUM of channel latencies into MAX\n";
+    cout << "2. Backoff with jitter avoids retry storms; a timer wheel avoids sleeping threads\n";
+    cout << "3. Circuit breakers fail fast on dead channels and probe for recovery\n";
+    cout << "4. Channels did not change - resilience is added by composition (OCP)\n";
+
+    return 0;
+}
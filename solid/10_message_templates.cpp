@@ -0,0 +1,310 @@
+/**
+ * PRECOMPILED MESSAGE TEMPLATES for Order Confirmations
+ *
+ * Problem: NotificationManager::notifyOrderConfirmation() in
+ * 06_real_world_ecommerce.cpp builds EVERY message like this:
+ *
+ *     stringstream message;
+ *     message << "Order " << id << " confirmed. Total: $"
+ *             << fixed << setprecision(2) << total;
+ *
+ * Per message that costs: a stringstream construction (locale + buffer
+ * allocation), locale-aware number formatting via num_put facets, and a final
+ * copy out with str(). Fine for one order, wasteful for millions.
+ *
+ * Design:
+ * - PARSE ONCE: "Order {orderId} confirmed. Total: ${total:.2}" is compiled
+ *   into a flat list of ops: LITERAL(offset, len) | FIELD(slot, precision).
+ *   Placeholders are resolved to slot indices at compile time, so rendering
+ *   never looks names up. Unknown placeholders fail at compile time, not
+ *   at 3am on the first order that hits them.
+ * - RENDER into a reusable buffer: the caller owns a std::string whose
+ *   capacity survives clear(), so steady state performs ZERO allocations.
+ * - NUMBERS via std::to_chars: locale-independent, non-allocating, and the
+ *   shortest/fixed conversions are among the fastest available.
+ *
+ * Trade-off: to_chars ignores the locale by design. Customer-facing messages
+ * that need "1.234,56 EUR" must format with an explicit, cached locale policy
+ * instead of the global iostream locale.
+ */
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <charconv>
+#include <chrono>
+#include <stdexcept>
+#include <cstdint>
+#include <cstdlib>
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+// ============================================================================
+// TEMPLATE ENGINE
+// ============================================================================
+
+// One argument value; string_view so callers pass data without copying it
+struct TemplateArg
+{
+    enum Kind : uint8_t
+    {
+        TEXT,
+        INTEGER,
+        DECIMAL
+    };
+
+    Kind kind;
+    string_view text;
+    int64_t integer = 0;
+    double decimal = 0.0;
+
+    TemplateArg(string_view s) : kind(TEXT), text(s) {}
+    TemplateArg(const char *s) : kind(TEXT), text(s) {}
+    TemplateArg(int64_t v) : kind(INTEGER), integer(v) {}
+    TemplateArg(int v) : kind(INTEGER), integer(v) {}
+    TemplateArg(double v) : kind(DECIMAL), decimal(v) {}
+};
+
+class MessageTemplate
+{
+private:
+    struct Op
+    {
+        enum Kind : uint8_t
+        {
+            LITERAL,
+            FIELD
+        };
+
+        Kind kind;
+        uint32_t offset; // LITERAL: offset into source; FIELD: slot index
+        uint32_t length; // LITERAL: length;             FIELD: precision (or NO_PRECISION)
+    };
+
+    static constexpr uint32_t NO_PRECISION = ~0u;
+    static constexpr uint32_t MAX_PRECISION = 17; // past this a double has no more digits to show
+    // Widest fixed output: sign + 309 integer digits of DBL_MAX + '.' + decimals
+    static constexpr size_t NUMBER_CHARS = 1 + 309 + 1 + MAX_PRECISION;
+
+    string source;
+    vector<Op> ops;
+    size_t literalBytes = 0;
+    size_t fieldCount = 0;
+
+    void appendNumber(string &out, const TemplateArg &arg, uint32_t precision) const
+    {
+        char buf[NUMBER_CHARS];
+        to_chars_result r;
+        if (arg.kind == TemplateArg::INTEGER)
+            r = to_chars(buf, buf + sizeof(buf), arg.integer);
+        else if (precision == NO_PRECISION)
+            r = to_chars(buf, buf + sizeof(buf), arg.decimal);
+        else
+            r = to_chars(buf, buf + sizeof(buf), arg.decimal, chars_format::fixed, static_cast<int>(precision));
+        if (r.ec != errc()) // cannot happen with the bounds above; never append an unwritten buffer
+            throw length_error("Number does not fit the format buffer");
+        out.append(buf, r.ptr);
+    }
+
+public:
+    // fields: the ordered argument names, e.g. {"orderId", "total"}.
+    // Syntax: {name} or {name:.N} for N decimal places; "{{" / "}}" escape braces.
+    MessageTemplate(string text, const vector<string> &fields)
+        : source(move(text)), fieldCount(fields.size())
+    {
+        size_t literalStart = 0;
+        auto flushLiteral = [&](size_t end)
+        {
+            if (end > literalStart)
+            {
+                ops.push_back({Op::LITERAL, uint32_t(literalStart), uint32_t(end - literalStart)});
+                literalBytes += end - literalStart;
+            }
+        };
+
+        for (size_t i = 0; i < source.size(); ++i)
+        {
+            if (source[i] == '}' && i + 1 < source.size() && source[i + 1] == '}')
+            {
+                flushLiteral(i + 1);
+                literalStart = i + 2;
+                ++i;
+                continue;
+            }
+            if (source[i] != '{')
+                continue;
+            if (i + 1 < source.size() && source[i + 1] == '{')
+            {
+                flushLiteral(i + 1); // keep one '{', skip the second
+                literalStart = i + 2;
+                ++i;
+                continue;
+            }
+
+            size_t close = source.find('}', i);
+            if (close == string::npos)
+                throw invalid_argument("Unterminated placeholder at offset " + to_string(i));
+
+            string_view spec(source.data() + i + 1, close - i - 1);
+            string_view name = spec.substr(0, spec.find(':'));
+            uint32_t precision = NO_PRECISION;
+            if (name.size() != spec.size())
+            {
+                string_view fmt = spec.substr(name.size() + 1);
+                if (fmt.size() < 2 || fmt[0] != '.' ||
+                    from_chars(fmt.data() + 1, fmt.data() + fmt.size(), precision).ec != errc())
+                    throw invalid_argument("Bad format spec: {" + string(spec) + "}");
+                if (precision > MAX_PRECISION)
+                    throw invalid_argument("Precision above " + to_string(MAX_PRECISION) + ": {" + string(spec) + "}");
+            }
+
+            size_t slot = 0;
+            while (slot < fields.size() && fields[slot] != name)
+                ++slot;
+            if (slot == fields.size())
+                throw invalid_argument("Unknown placeholder: {" + string(name) + "}");
+
+            flushLiteral(i);
+            ops.push_back({Op::FIELD, uint32_t(slot), precision});
+            literalStart = close + 1;
+            i = close;
+        }
+        flushLiteral(source.size());
+    }
+
+    // Appends to out; callers clear() a long-lived buffer to reuse its capacity
+    void renderTo(string &out, const TemplateArg *args, size_t argCount) const
+    {
+        if (argCount != fieldCount)
+            throw invalid_argument("Template expects " + to_string(fieldCount) + " arguments");
+
+        for (const Op &op : ops)
+        {
+            if (op.kind == Op::LITERAL)
+            {
+                out.append(source, op.offset, op.length);
+                continue;
+            }
+            const TemplateArg &arg = args[op.offset];
+            if (arg.kind == TemplateArg::TEXT)
+                out.append(arg.text);
+            else
+                appendNumber(out, arg, op.length);
+        }
+    }
+
+    void renderTo(string &out, initializer_list<TemplateArg> args) const
+    {
+        renderTo(out, args.begin(), args.size());
+    }
+
+    size_t opCount() const { return ops.size(); }
+    size_t literalSize() const { return literalBytes; }
+};
+
+// ============================================================================
+// INTEGRATION: order confirmations
+// ============================================================================
+
+namespace original
+{
+    // Verbatim formatting from 06_real_world_ecommerce.cpp
+    string confirmation(const string &orderId, double total)
+    {
+        stringstream message;
+        message << "Order " << orderId << " confirmed. "
+                << "Total: $" << fixed << setprecision(2) << total;
+        return message.str();
+    }
+}
+
+class OrderConfirmationFormatter
+{
+private:
+    MessageTemplate tmpl{"Order {orderId} confirmed. Total: ${total:.2}", {"orderId", "total"}};
+    string buffer; // reused across messages: no allocation once warmed up
+
+public:
+    OrderConfirmationFormatter() { buffer.reserve(128); }
+
+    // The returned view is valid until the next format() call
+    string_view format(string_view orderId, double total)
+    {
+        buffer.clear();
+        tmpl.renderTo(buffer, {orderId, total});
+        return buffer;
+    }
+};
+
+// ============================================================================
+// BENCHMARK
+// ============================================================================
+
+// Usage: ./program [messages]   (default 10,000,000)
+int main(int argc, char **argv)
+{
+    size_t messages = argc > 1 ? strtoull(argv[1], nullptr, 10) : 10000000;
+
+    cout << "=== PRECOMPILED MESSAGE TEMPLATES ===\n\n";
+
+    MessageTemplate shipped("Hi {name}, order {orderId} ({items} items, ${total:.2}) ships {{today}}.",
+                            {"name", "orderId", "items", "total"});
+    string out;
+    shipped.renderTo(out, {"Ada", "ORD001", 3, 1059.97});
+    cout << "Rendered: " << out << "\n";
+    cout << "Compiled into " << shipped.opCount() << " ops (" << shipped.literalSize() << " literal bytes)\n";
+
+    try
+    {
+        MessageTemplate broken("Order {orderID} confirmed", {"orderId"});
+    }
+    catch (const invalid_argument &e)
+    {
+        cout << "Compile-time check: " << e.what() << "\n";
+    }
+
+    // Same output, byte for byte
+    OrderConfirmationFormatter formatter;
+    for (double total : {0.0, 0.005, 29.99, 1059.97, 123456.785, 1e70, -1.7976931348623157e308})
+    {
+        string expected = original::confirmation("ORD42", total);
+        if (formatter.format("ORD42", total) != expected)
+            cout << "MISMATCH: " << expected << " vs " << formatter.format("ORD42", total) << "\n";
+    }
+
+    // Pre-build order ids so both paths format the same inputs
+    vector<string> ids(1024);
+    for (size_t i = 0; i < ids.size(); ++i)
+        ids[i] = "ORD" + to_string(100000 + i);
+
+    cout << "\n--- " << messages << " order confirmations ---\n";
+    size_t sink = 0;
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < messages; ++i)
+        sink += original::confirmation(ids[i & 1023], 10.0 + (i % 100000) * 0.01).size();
+    double streamSecs = chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    for (size_t i = 0; i < messages; ++i)
+        sink += formatter.format(ids[i & 1023], 10.0 + (i % 100000) * 0.01).size();
+    double templateSecs = chrono::duration<double>(Clock::now() - start).count();
+
+    cout << fixed << setprecision(0);
+    cout << "stringstream + setprecision: " << setw(12) << messages / streamSecs << " msgs/s\n";
+    cout << "precompiled template:        " << setw(12) << messages / templateSecs << " msgs/s\n";
+    cout << setprecision(1) << "speedup: " << streamSecs / templateSecs << "x"
+         << "  (checksum " << sink << ")\n";
+
+    cout << "\n=== KEY TAKEAWAYS ===\n";
+    cout << "1. Parse templates once; render from a flat op list\n";
+    cout << "2. Resolve placeholder names at compile time - errors surface early\n";
+    cout << "3. Reuse one output buffer: zero allocations in steady state\n";
+    cout << "4. std::to_chars is locale-free and allocation-free\n";
+
+    return 0;
+}
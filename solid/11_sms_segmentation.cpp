@@ -0,0 +1,589 @@
+/**
+ * SMS SEGMENTATION AND BATCHING
+ *
+ * Problem: SMSNotification::send() in 02_ocp_open_closed.cpp does
+ *
+ *     message.substr(0, 160)
+ *
+ * which (1) allocates a new string per message, (2) silently DROPS everything
+ * after 160 bytes, and (3) is wrong anyway: the 160 limit is in GSM-7
+ * SEPTETS, not bytes. "€" is 3 UTF-8 bytes but 2 septets; a single emoji
+ * switches the whole message to UCS-2 and the limit drops to 70.
+ *
+ * SMS facts this file encodes:
+ * - GSM-7: 160 septets in one SMS, 153 per part when concatenated
+ *   (the 6-byte User Data Header takes 7 septets incl. 1 fill bit).
+ * - GSM-7 extension chars ^ { } \ [ ~ ] | EUR cost 2 septets (ESC + char)
+ *   and must never be split across parts.
+ * - UCS-2/UTF-16: 70 code units single, 67 per part. Characters outside the
+ *   BMP (emoji) are surrogate pairs and must never be split either.
+ * - Concatenation UDH: 05 00 03 <ref> <total> <seq>.
+ *
+ * Design:
+ * - SEGMENTS ARE VIEWS: a segment is (byte offset, byte length) into the
+ *   caller's UTF-8 message plus its precomputed UDH - no substrings.
+ * - ENCODING writes straight into a fixed 140-byte PDU payload.
+ * - BATCHING: a sender groups PDUs per carrier into bulk submissions
+ *   (one "network call" per N segments). PDU storage is reused between
+ *   flushes, so steady state performs no heap allocations - the benchmark
+ *   counts them with a replaced global operator new.
+ */
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <memory>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <iomanip>
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+// ============================================================================
+// ALLOCATION COUNTER (for the report only)
+// ============================================================================
+
+static atomic<uint64_t> g_allocations{0};
+
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, memory_order_relaxed);
+    if (void *p = malloc(size ? size : 1))
+        return p;
+    throw bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// ============================================================================
+// GSM 03.38 CHARACTER TABLES
+// ============================================================================
+
+namespace gsm
+{
+
+    // Basic table: index = septet value, entry = Unicode code point
+    constexpr char32_t BASIC[128] = {
+        U'@', U'£', U'$', U'¥', U'è', U'é', U'ù', U'ì', U'ò', U'Ç', U'\n', U'Ø', U'ø', U'\r', U'Å', U'å',
+        U'Δ', U'_', U'Φ', U'Γ', U'Λ', U'Ω', U'Π', U'Ψ', U'Σ', U'Θ', U'Ξ', 0x1B, U'Æ', U'æ', U'ß', U'É',
+        U' ', U'!', U'"', U'#', U'¤', U'%', U'&', U'\'', U'(', U')', U'*', U'+', U',', U'-', U'.', U'/',
+        U'0', U'1', U'2', U'3', U'4', U'5', U'6', U'7', U'8', U'9', U':', U';', U'<', U'=', U'>', U'?',
+        U'¡', U'A', U'B', U'C', U'D', U'E', U'F', U'G', U'H', U'I', U'J', U'K', U'L', U'M', U'N', U'O',
+        U'P', U'Q', U'R', U'S', U'T', U'U', U'V', U'W', U'X', U'Y', U'Z', U'Ä', U'Ö', U'Ñ', U'Ü', U'§',
+        U'¿', U'a', U'b', U'c', U'd', U'e', U'f', U'g', U'h', U'i', U'j', U'k', U'l', U'm', U'n', U'o',
+        U'p', U'q', U'r', U's', U't', U'u', U'v', U'w', U'x', U'y', U'z', U'ä', U'ö', U'ñ', U'ü', U'à'};
+
+    // Extension table (sent as ESC + septet)
+    struct Ext
+    {
+        char32_t cp;
+        uint8_t septet;
+    };
+    constexpr Ext EXTENSION[] = {
+        {U'\f', 0x0A}, {U'^', 0x14}, {U'{', 0x28}, {U'}', 0x29}, {U'\\', 0x2F}, {U'[', 0x3C}, {U'~', 0x3D}, {U']', 0x3E}, {U'|', 0x40}, {U'€', 0x65}};
+
+    constexpr uint8_t ESC = 0x1B;
+
+    // Encoded form of one code point: 0 = not representable, 1 = basic, 2 = extension
+    struct Septets
+    {
+        uint8_t count;
+        uint8_t value;
+    };
+
+    // Built once; ASCII hits a flat table, the rest a tiny map
+    class Table
+    {
+    private:
+        array<Septets, 128> ascii{};
+        unordered_map<char32_t, Septets> other;
+
+    public:
+        Table()
+        {
+            for (uint8_t s = 0; s < 128; ++s)
+            {
+                if (s == ESC)
+                    continue;
+                if (BASIC[s] < 128)
+                    ascii[BASIC[s]] = {1, s};
+                else
+                    other[BASIC[s]] = {1, s};
+            }
+            for (const auto &e : EXTENSION)
+            {
+                if (e.cp < 128)
+                    ascii[e.cp] = {2, e.septet};
+                else
+                    other[e.cp] = {2, e.septet};
+            }
+        }
+
+        Septets lookup(char32_t cp) const
+        {
+            if (cp < 128)
+                return ascii[cp];
+            auto it = other.find(cp);
+            return it == other.end() ? Septets{0, 0} : it->second;
+        }
+    };
+
+    const Table &table()
+    {
+        static const Table t;
+        return t;
+    }
+}
+
+// Decodes one UTF-8 code point and advances p; malformed input -> U+FFFD
+char32_t decodeUtf8(const char *&p, const char *end)
+{
+    unsigned char c = static_cast<unsigned char>(*p++);
+    if (c < 0x80)
+        return c;
+    int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2
+                            : c >= 0xC0   ? 1
+                                          : -1;
+    if (extra < 0 || end - p < extra)
+        return 0xFFFD;
+    char32_t cp = c & (0x3F >> extra);
+    for (int i = 0; i < extra; ++i)
+    {
+        unsigned char cc = static_cast<unsigned char>(*p);
+        if ((cc & 0xC0) != 0x80)
+            return 0xFFFD;
+        cp = (cp << 6) | (cc & 0x3F);
+        ++p;
+    }
+    return cp;
+}
+
+// ============================================================================
+// SEGMENTATION
+// ============================================================================
+
+enum class Encoding : uint8_t
+{
+    GSM7,
+    UCS2
+};
+
+struct Segment
+{
+    uint32_t offset; // byte offset into the UTF-8 message
+    uint32_t length; // byte length
+    uint16_t units;  // septets (GSM7) or UTF-16 code units (UCS2)
+    uint8_t udh[6];  // 05 00 03 ref total seq; unused when the message has one part
+};
+
+struct SegmentPlan
+{
+    Encoding encoding = Encoding::GSM7;
+    uint32_t totalUnits = 0;
+    vector<Segment> segments; // reused between calls: capacity is kept
+};
+
+class SmsSegmenter
+{
+public:
+    static constexpr uint32_t GSM_SINGLE = 160, GSM_MULTI = 153;
+    static constexpr uint32_t UCS2_SINGLE = 70, UCS2_MULTI = 67;
+    static constexpr size_t MAX_PARTS = 255;
+
+private:
+    uint8_t nextReference = 0;
+
+    static uint32_t unitsOf(char32_t cp, Encoding enc)
+    {
+        if (enc == Encoding::GSM7)
+            return gsm::table().lookup(cp).count;
+        return cp > 0xFFFF ? 2 : 1;
+    }
+
+public:
+    // Two passes over the bytes, zero allocations once plan.segments has capacity.
+    // Returns false if the message would need more than 255 parts.
+    bool plan(string_view message, SegmentPlan &out)
+    {
+        const char *begin = message.data();
+        const char *end = begin + message.size();
+
+        // Pass 1: pick the encoding and count units
+        out.encoding = Encoding::GSM7;
+        out.totalUnits = 0;
+        uint32_t ucs2Units = 0;
+        for (const char *p = begin; p < end;)
+        {
+            char32_t cp = decodeUtf8(p, end);
+            uint32_t septets = gsm::table().lookup(cp).count;
+            if (septets == 0)
+                out.encoding = Encoding::UCS2;
+            out.totalUnits += septets;
+            ucs2Units += cp > 0xFFFF ? 2 : 1;
+        }
+        if (out.encoding == Encoding::UCS2)
+            out.totalUnits = ucs2Units;
+
+        uint32_t single = out.encoding == Encoding::GSM7 ? GSM_SINGLE : UCS2_SINGLE;
+        uint32_t perPart = out.encoding == Encoding::GSM7 ? GSM_MULTI : UCS2_MULTI;
+        out.segments.clear();
+
+        if (out.totalUnits <= single)
+        {
+            out.segments.push_back({0, uint32_t(message.size()), uint16_t(out.totalUnits), {}});
+            return true;
+        }
+
+        // Pass 2: cut on character boundaries so no escape/surrogate pair is split
+        Segment current{0, 0, 0, {}};
+        for (const char *p = begin; p < end;)
+        {
+            const char *charStart = p;
+            uint32_t units = unitsOf(decodeUtf8(p, end), out.encoding);
+            if (current.units + units > perPart)
+            {
+                current.length = uint32_t(charStart - begin) - current.offset;
+                out.segments.push_back(current);
+                current = {uint32_t(charStart - begin), 0, 0, {}};
+            }
+            current.units += units;
+        }
+        current.length = uint32_t(message.size()) - current.offset;
+        out.segments.push_back(current);
+
+        if (out.segments.size() > MAX_PARTS)
+            return false;
+
+        uint8_t ref = nextReference++;
+        uint8_t total = uint8_t(out.segments.size());
+        for (size_t i = 0; i < out.segments.size(); ++i)
+        {
+            uint8_t *h = out.segments[i].udh;
+            h[0] = 0x05; // UDH length
+            h[1] = 0x00; // IEI: concatenated SMS, 8-bit reference
+            h[2] = 0x03; // IE length
+            h[3] = ref;
+            h[4] = total;
+            h[5] = uint8_t(i + 1);
+        }
+        return true;
+    }
+};
+
+// ============================================================================
+// PDU ENCODING (straight into a fixed buffer)
+// ============================================================================
+
+struct SubmitPdu
+{
+    char recipient[20];
+    Encoding encoding;
+    bool hasUdh;
+    uint8_t length; // bytes of userData used
+    uint8_t userData[140];
+};
+
+// GSM-7 septets packed LSB-first, starting after the UDH + fill bits
+size_t packGsm7(string_view text, const uint8_t *udh, uint8_t *out)
+{
+    memset(out, 0, 140);
+    size_t bit = 0;
+    if (udh)
+    {
+        memcpy(out, udh, 6);
+        bit = 6 * 8 + 1; // 1 fill bit aligns the first septet to a septet boundary
+    }
+
+    auto put = [&](uint8_t septet)
+    {
+        size_t byte = bit / 8, shift = bit % 8;
+        out[byte] |= uint8_t(septet << shift);
+        if (shift > 1)
+            out[byte + 1] |= uint8_t(septet >> (8 - shift));
+        bit += 7;
+    };
+
+    const char *p = text.data(), *end = p + text.size();
+    while (p < end)
+    {
+        gsm::Septets s = gsm::table().lookup(decodeUtf8(p, end));
+        if (s.count == 2)
+            put(gsm::ESC);
+        put(s.value);
+    }
+    return (bit + 7) / 8;
+}
+
+// UTF-16 big endian, surrogate pairs for non-BMP code points
+size_t packUcs2(string_view text, const uint8_t *udh, uint8_t *out)
+{
+    size_t n = 0;
+    if (udh)
+    {
+        memcpy(out, udh, 6);
+        n = 6;
+    }
+    auto put16 = [&](uint16_t u)
+    {
+        out[n++] = uint8_t(u >> 8);
+        out[n++] = uint8_t(u & 0xFF);
+    };
+
+    const char *p = text.data(), *end = p + text.size();
+    while (p < end)
+    {
+        char32_t cp = decodeUtf8(p, end);
+        if (cp > 0xFFFF)
+        {
+            cp -= 0x10000;
+            put16(uint16_t(0xD800 + (cp >> 10)));
+            put16(uint16_t(0xDC00 + (cp & 0x3FF)));
+        }
+        else
+            put16(uint16_t(cp));
+    }
+    return n;
+}
+
+// ============================================================================
+// BATCHING SENDER + FAKE GATEWAY
+// ============================================================================
+
+// Local stand-in for an SMSC / aggregator bulk API
+class FakeSmsGateway
+{
+public:
+    uint64_t submissions = 0;
+    uint64_t segments = 0;
+    uint64_t bytes = 0;
+
+    void submitBulk(const string &carrier, const SubmitPdu *pdus, size_t count)
+    {
+        (void)carrier;
+        ++submissions;
+        segments += count;
+        for (size_t i = 0; i < count; ++i)
+            bytes += pdus[i].length;
+    }
+};
+
+class BatchingSmsSender
+{
+private:
+    struct CarrierBatch
+    {
+        string carrier;
+        vector<SubmitPdu> pdus; // capacity reserved once, reused after each flush
+    };
+
+    FakeSmsGateway &gateway;
+    size_t batchSize;
+    vector<CarrierBatch> batches;
+    SmsSegmenter segmenter;
+    SegmentPlan plan; // reused for every message
+
+    // Toy routing: carrier by country/number prefix
+    CarrierBatch &batchFor(string_view recipient)
+    {
+        size_t index = recipient.size() > 3 ? (recipient[2] - '0') % batches.size() : 0;
+        return batches[index];
+    }
+
+    void flush(CarrierBatch &batch)
+    {
+        if (batch.pdus.empty())
+            return;
+        gateway.submitBulk(batch.carrier, batch.pdus.data(), batch.pdus.size());
+        batch.pdus.clear();
+    }
+
+public:
+    BatchingSmsSender(FakeSmsGateway &gw, const vector<string> &carriers, size_t perBatch)
+        : gateway(gw), batchSize(perBatch)
+    {
+        for (const auto &c : carriers)
+        {
+            batches.push_back({c, {}});
+            // + MAX_PARTS headroom: one message's parts never straddle a flush
+            batches.back().pdus.reserve(perBatch + SmsSegmenter::MAX_PARTS);
+        }
+        plan.segments.reserve(SmsSegmenter::MAX_PARTS);
+    }
+
+    ~BatchingSmsSender() { flushAll(); }
+
+    // Returns the number of segments queued (0 if the message is too long)
+    size_t send(string_view recipient, string_view message)
+    {
+        if (!segmenter.plan(message, plan))
+            return 0;
+
+        CarrierBatch &batch = batchFor(recipient);
+        bool concatenated = plan.segments.size() > 1;
+        for (const Segment &seg : plan.segments)
+        {
+            batch.pdus.emplace_back();
+            SubmitPdu &pdu = batch.pdus.back();
+            size_t n = min(recipient.size(), sizeof(pdu.recipient) - 1);
+            memcpy(pdu.recipient, recipient.data(), n);
+            pdu.recipient[n] = '\0';
+            pdu.encoding = plan.encoding;
+            pdu.hasUdh = concatenated;
+
+            string_view text = message.substr(seg.offset, seg.length);
+            const uint8_t *udh = concatenated ? seg.udh : nullptr;
+            pdu.length = uint8_t(plan.encoding == Encoding::GSM7 ? packGsm7(text, udh, pdu.userData)
+                                                                  : packUcs2(text, udh, pdu.userData));
+        }
+
+        // Parts of one message stay together and in order within a bulk submit
+        if (batch.pdus.size() >= batchSize)
+            flush(batch);
+        return plan.segments.size();
+    }
+
+    void flushAll()
+    {
+        for (auto &b : batches)
+            flush(b);
+    }
+
+    const SegmentPlan &lastPlan() const { return plan; }
+};
+
+// ============================================================================
+// CHANNEL INTEGRATION (same interface as notification_system)
+// ============================================================================
+
+class NotificationChannel
+{
+public:
+    virtual ~NotificationChannel() = default;
+    virtual void send(const string &recipient, const string &message) = 0;
+    virtual string getChannelName() const = 0;
+};
+
+// Drop-in replacement for SMSNotification: segments instead of truncating
+class SegmentingSMSNotification : public NotificationChannel
+{
+private:
+    BatchingSmsSender &sender;
+
+public:
+    SegmentingSMSNotification(BatchingSmsSender &s) : sender(s) {}
+
+    void send(const string &recipient, const string &message) override
+    {
+        sender.send(recipient, message);
+    }
+
+    string getChannelName() const override { return "SMS (segmented)"; }
+};
+
+// ============================================================================
+// DEMO + BENCHMARK
+// ============================================================================
+
+void describe(SmsSegmenter &segmenter, const char *label, string_view message)
+{
+    SegmentPlan plan;
+    segmenter.plan(message, plan);
+    cout << setw(22) << left << label << right
+         << (plan.encoding == Encoding::GSM7 ? "GSM-7" : "UCS-2")
+         << "  units: " << setw(4) << plan.totalUnits
+         << "  bytes: " << setw(4) << message.size()
+         << "  parts: " << plan.segments.size();
+    if (plan.segments.size() > 1)
+    {
+        cout << "  (";
+        for (const auto &s : plan.segments)
+            cout << s.units << (&s == &plan.segments.back() ? "" : "+");
+        cout << ")";
+    }
+    cout << "\n";
+}
+
+int main(int argc, char **argv)
+{
+    size_t messages = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+
+    cout << "=== SMS SEGMENTATION AND BATCHING ===\n\n";
+
+    string shortMsg = "Your order ORD001 has shipped!";
+    string longMsg;
+    for (int i = 0; i < 8; ++i)
+        longMsg += "Order ORD001 update: your parcel left the warehouse [tracking #" + to_string(1000 + i) + "]. ";
+    string euroMsg = "Refund of €49.99 issued {ref: R-77}. ";
+    euroMsg += euroMsg + euroMsg + euroMsg + euroMsg;
+    string emojiMsg = "Your order has shipped 🚚📦 - thanks for shopping with us! ";
+    emojiMsg += emojiMsg;
+
+    SmsSegmenter segmenter;
+    describe(segmenter, "short ASCII:", shortMsg);
+    describe(segmenter, "long ASCII (GSM-7):", longMsg);
+    describe(segmenter, "euro + braces (ext):", euroMsg);
+    describe(segmenter, "emoji (UCS-2):", emojiMsg);
+
+    cout << "\nOriginal substr(0, 160) keeps " << longMsg.substr(0, 160).size() << " of "
+         << longMsg.size() << " bytes - the rest is silently lost.\n";
+
+    // Original path: one substr per message
+    vector<string> corpus = {shortMsg, longMsg, euroMsg, emojiMsg};
+    vector<string> recipients = {"+14155550100", "+447700900123", "+919812345678", "+33612345678"};
+
+    uint64_t before = g_allocations.load();
+    auto start = Clock::now();
+    size_t sink = 0;
+    for (size_t i = 0; i < messages; ++i)
+        sink += corpus[i % corpus.size()].substr(0, 160).size();
+    double substrSecs = chrono::duration<double>(Clock::now() - start).count();
+    uint64_t substrAllocs = g_allocations.load() - before;
+
+    // New path: segment + encode + batch, through the channel interface
+    FakeSmsGateway gateway;
+    BatchingSmsSender sender(gateway, {"carrier-A", "carrier-B", "carrier-C"}, 500);
+    SegmentingSMSNotification channel(sender);
+
+    // Warm up so the report shows steady-state allocations
+    for (size_t i = 0; i < 1000; ++i)
+        sender.send(recipients[i % recipients.size()], corpus[i % corpus.size()]);
+
+    before = g_allocations.load();
+    start = Clock::now();
+    size_t segments = 0;
+    for (size_t i = 0; i < messages; ++i)
+        segments += sender.send(recipients[i % recipients.size()], corpus[i % corpus.size()]);
+    sender.flushAll();
+    double segSecs = chrono::duration<double>(Clock::now() - start).count();
+    uint64_t segAllocs = g_allocations.load() - before;
+
+    channel.send("+14155550100", longMsg); // via NotificationChannel interface
+    sender.flushAll();
+
+    cout << "\n--- " << messages << " messages ---\n";
+    cout << fixed << setprecision(0);
+    cout << "substr(0,160):   " << setw(12) << messages / substrSecs << " msgs/s, "
+         << substrAllocs << " allocations (content lost)\n";
+    cout << "segment+encode:  " << setw(12) << segments / segSecs << " segments/s ("
+         << messages / segSecs << " msgs/s), " << segAllocs << " allocations\n";
+    cout << "Gateway: " << gateway.submissions << " bulk submissions, "
+         << gateway.segments << " segments, " << gateway.bytes << " payload bytes (incl. warm-up)"
+         << "  (checksum " << sink << ")\n";
+
+    cout << "\n=== KEY TAKEAWAYS ===\n";
+    cout << "1. SMS limits are in septets / UTF-16 units, not bytes\n";
+    cout << "2. Never split an escape sequence or a surrogate pair\n";
+    cout << "3. Segments as views + fixed PDU buffers = zero steady-state allocations\n";
+    cout << "4. Batch per carrier: one bulk call per N segments, parts kept in order\n";
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+// bravo_rwlock.h
+// Scalable reader-writer lock with distributed reader indicators
+// (big-reader / BRAVO style).
+//
+// Why std::shared_mutex stops scaling: every lock_shared() and unlock_shared()
+// does an atomic read-modify-write on ONE reader counter. With N cores reading,
+// that cache line ping-pongs between all of them (each RMW needs the line in
+// Modified state), so "concurrent" reads are serialized by the coherence
+// protocol - even though no reader ever waits for another.
+//
+// Idea: give readers many counters instead of one.
+//
+//   readers:  slot[hash(thread)] += 1   (each slot on its own cache line)
+//             then check writerPending; if set, undo and wait
+//   writer:   writerPending = true      (revoke the reader fast path)
+//             wait until every slot == 0
+//
+// - Readers on different slots never touch the same cache line: reads scale.
+// - Writers pay O(SLOTS) to scan the indicators - fine when writes are rare,
+//   a loss for write-heavy mixes (see rwlock_benchmark.cpp).
+// - Writer preference: new readers see writerPending and back off, so a
+//   steady stream of readers cannot starve a writer.
+// - Correctness hinges on a Dekker-style handshake: reader "increment then
+//   check flag" vs writer "set flag then check counters", both seq_cst, so at
+//   least one side always sees the other.
+//
+// Memory: SLOTS * 64 bytes per lock (4 KB for 64 slots) - use it for a few
+// hot, read-mostly structures, not for every object.
+//
+// Slots are hashed per THREAD rather than per core: a thread can migrate
+// between lock_shared() and unlock_shared(), but its slot never changes.
+
+#pragma once
+
+#include "spin_locks.h"
+
+#include <atomic>
+#include <mutex>
+#include <cstddef>
+
+class BravoRwLock
+{
+public:
+    static constexpr size_t SLOTS = 64;
+
+private:
+    struct alignas(spin::CACHE_LINE) Slot
+    {
+        std::atomic<int> readers{0};
+    };
+
+    Slot slots[SLOTS];
+    alignas(spin::CACHE_LINE) std::atomic<bool> writerPending{false};
+    std::mutex writerMutex; // serializes writers; readers never touch it
+
+    static size_t mySlot()
+    {
+        static std::atomic<size_t> nextId{0};
+        thread_local size_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+        return id % SLOTS;
+    }
+
+    void waitForWriter() const
+    {
+        spin::Backoff backoff;
+        while (writerPending.load(std::memory_order_acquire))
+            backoff.wait();
+    }
+
+public:
+    // ---- shared (reader) side ----
+
+    void lock_shared()
+    {
+        Slot &slot = slots[mySlot()];
+        while (true)
+        {
+            waitForWriter(); // writer preference: do not barge past a pending writer
+            slot.readers.fetch_add(1, std::memory_order_seq_cst);
+            SYNC_STRESS_POINT(); // counted, flag not checked yet: the Dekker window
+            if (!writerPending.load(std::memory_order_seq_cst))
+                return;
+            slot.readers.fetch_sub(1, std::memory_order_release); // writer won: back off
+        }
+    }
+
+    bool try_lock_shared()
+    {
+        if (writerPending.load(std::memory_order_acquire))
+            return false;
+        Slot &slot = slots[mySlot()];
+        slot.readers.fetch_add(1, std::memory_order_seq_cst);
+        if (!writerPending.load(std::memory_order_seq_cst))
+            return true;
+        slot.readers.fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+
+    void unlock_shared()
+    {
+        slots[mySlot()].readers.fetch_sub(1, std::memory_order_release);
+    }
+
+    // ---- exclusive (writer) side ----
+
+    void lock()
+    {
+        writerMutex.lock();
+        writerPending.store(true, std::memory_order_seq_cst);
+        SYNC_STRESS_POINT(); // flag set, slots not scanned yet
+        // seq_cst scan: the Dekker pair with lock_shared() needs it on both sides,
+        // or a slot load may be ordered ahead of the flag store and miss a reader
+        for (Slot &slot : slots)
+        {
+            spin::Backoff backoff;
+            while (slot.readers.load(std::memory_order_seq_cst) != 0)
+                backoff.wait(); // drain readers that got in before the flag
+        }
+    }
+
+    bool try_lock()
+    {
+        if (!writerMutex.try_lock())
+            return false;
+        writerPending.store(true, std::memory_order_seq_cst);
+        for (Slot &slot : slots)
+        {
+            if (slot.readers.load(std::memory_order_seq_cst) != 0)
+            {
+                writerPending.store(false, std::memory_order_release);
+                writerMutex.unlock();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void unlock()
+    {
+        writerPending.store(false, std::memory_order_release);
+        writerMutex.unlock();
+    }
+};
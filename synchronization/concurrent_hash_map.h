@@ -0,0 +1,436 @@
+// concurrent_hash_map.h
+// Concurrent open-addressing hash map with string keys.
+//
+//   - Reads are lock-free: no lock, no CAS, just an epoch guard and a probe.
+//   - Writes to the SAME key are serialized by a striped mutex; writes to
+//     different keys run in parallel and claim slots with CAS.
+//   - Resize is incremental: a full table gets a successor, and every write
+//     migrates one chunk of the old table. Nobody stops the world.
+//   - Lookup takes std::string_view, so callers never build a std::string
+//     just to ask a question (C++17 unordered_map cannot do that).
+//
+// Layout: each slot is an atomic pointer to an immutable Entry
+// {hash, key, value, deleted}. Updating a key swaps in a new Entry; the old
+// one is retired through reclaim::Epoch (memory_reclamation.h), so a reader
+// holding it keeps valid memory. Erase swaps in a tombstone Entry. A slot,
+// once claimed by a key, belongs to that key for the table's lifetime.
+//
+// Migration protocol (at most two live tables: old -> new):
+//   - migrating slot i of the old table CASes its pointer to pointer|MOVED.
+//     The thread whose CAS succeeds owns the entry: it copies it into the new
+//     table if that key is still absent there, otherwise retires it.
+//   - writers always write to the newest table, after tagging the key's slot
+//     in the old table (so a late copy can never overwrite a newer value).
+//   - readers probe newest -> oldest and return the first slot holding the
+//     key, tagged or not. A tagged old entry is returned only when the new
+//     table has nothing for the key yet, i.e. no newer write exists.
+//   - when every old slot is tagged the old table is retired.
+//
+// Values are copied out under the guard (find) or visited in place (visit).
+
+#pragma once
+
+#include "memory_reclamation.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+template <typename V>
+class ConcurrentHashMap
+{
+private:
+    struct Entry
+    {
+        size_t hash;
+        std::string key;
+        V value;
+        bool deleted;
+    };
+
+    static constexpr uintptr_t MOVED = 1;
+    static constexpr size_t MIGRATE_CHUNK = 64;
+    static constexpr size_t STRIPES = 64;
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    static bool isMoved(Entry *e) { return reinterpret_cast<uintptr_t>(e) & MOVED; }
+    static Entry *untag(Entry *e) { return reinterpret_cast<Entry *>(reinterpret_cast<uintptr_t>(e) & ~MOVED); }
+    static Entry *tag(Entry *e) { return reinterpret_cast<Entry *>(reinterpret_cast<uintptr_t>(e) | MOVED); }
+
+    struct Table
+    {
+        const size_t capacity; // power of two
+        std::atomic<Entry *> *slots;
+        std::atomic<size_t> used{0}; // claimed slots, tombstones included
+        std::atomic<Table *> next{nullptr};
+        std::atomic<size_t> migrateCursor{0};
+        std::atomic<size_t> migrated{0};
+
+        explicit Table(size_t cap) : capacity(cap), slots(new std::atomic<Entry *>[cap])
+        {
+            for (size_t i = 0; i < cap; ++i)
+                slots[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        ~Table() { delete[] slots; }
+
+        // Slot holding this key (tagged or not), or capacity if absent
+        size_t findSlot(size_t hash, std::string_view key) const
+        {
+            size_t mask = capacity - 1;
+            for (size_t n = 0, i = hash & mask; n < capacity; ++n, i = (i + 1) & mask)
+            {
+                Entry *e = slots[i].load(std::memory_order_acquire);
+                Entry *u = untag(e);
+                if (!u)
+                    return capacity; // empty (or empty-and-moved): key was never here
+                if (u->hash == hash && u->key == key)
+                    return i;
+            }
+            return capacity;
+        }
+    };
+
+    struct alignas(reclaim::CACHE_LINE) Stripe
+    {
+        std::mutex mtx;
+    };
+
+    std::atomic<Table *> root; // oldest live table; root->next is the newer one
+    std::atomic<long> count{0};
+    mutable Stripe stripes[STRIPES];
+
+    static size_t hashOf(std::string_view key) { return std::hash<std::string_view>{}(key); }
+
+    // Snapshot of the live tables, oldest first (at most a few during resize)
+    struct Chain
+    {
+        Table *tables[4];
+        int size = 0;
+        Table *newest() const { return tables[size - 1]; }
+    };
+
+    Chain snapshot() const
+    {
+        Chain c;
+        for (Table *t = root.load(std::memory_order_acquire); t && c.size < 4; t = t->next.load(std::memory_order_acquire))
+            c.tables[c.size++] = t;
+        return c;
+    }
+
+    // ---- migration ----
+
+    void copyIfAbsent(Table *to, Entry *e)
+    {
+        size_t mask = to->capacity - 1;
+        for (size_t n = 0, i = e->hash & mask; n < to->capacity; ++n, i = (i + 1) & mask)
+        {
+            while (true)
+            {
+                Entry *s = to->slots[i].load(std::memory_order_acquire);
+                if (!s)
+                {
+                    if (to->slots[i].compare_exchange_strong(s, e, std::memory_order_acq_rel))
+                    {
+                        to->used.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    continue; // someone claimed it: look again
+                }
+                Entry *u = untag(s);
+                if (u && u->hash == e->hash && u->key == e->key)
+                {
+                    reclaim::Epoch::retire(e); // a writer already stored a newer value
+                    return;
+                }
+                break;
+            }
+        }
+        // The new table is sized to hold every live entry of the old one
+        std::terminate();
+    }
+
+    // Returns the entry this slot held when it was tagged (null if empty)
+    Entry *migrateSlot(Table *from, size_t i)
+    {
+        Table *to = from->next.load(std::memory_order_acquire);
+        while (true)
+        {
+            Entry *e = from->slots[i].load(std::memory_order_acquire);
+            if (isMoved(e))
+                return untag(e);
+            if (!from->slots[i].compare_exchange_weak(e, tag(e), std::memory_order_acq_rel))
+                continue;
+            if (e)
+            {
+                if (e->deleted)
+                    reclaim::Epoch::retire(e);
+                else
+                    copyIfAbsent(to, e);
+            }
+            return e;
+        }
+    }
+
+    void promote(Table *old)
+    {
+        Table *expected = old;
+        if (root.compare_exchange_strong(expected, old->next.load(std::memory_order_acquire), std::memory_order_acq_rel))
+            reclaim::Epoch::retire(old);
+    }
+
+    // Migrate one chunk; returns false once there is nothing left to claim
+    bool helpMigrate(Table *old)
+    {
+        size_t begin = old->migrateCursor.fetch_add(MIGRATE_CHUNK, std::memory_order_relaxed);
+        if (begin >= old->capacity)
+            return false;
+        size_t end = std::min(begin + MIGRATE_CHUNK, old->capacity);
+        for (size_t i = begin; i < end; ++i)
+            migrateSlot(old, i);
+        if (old->migrated.fetch_add(end - begin, std::memory_order_acq_rel) + (end - begin) == old->capacity)
+            promote(old);
+        return true;
+    }
+
+    void finishMigration(Table *old)
+    {
+        while (helpMigrate(old))
+        {
+        }
+        while (root.load(std::memory_order_acquire) == old)
+            std::this_thread::yield(); // another helper is finishing its last chunk
+    }
+
+    // Give a full newest table a successor sized for its live entries
+    void startResize(Table *t)
+    {
+        Table *r = root.load(std::memory_order_acquire);
+        if (r != t)
+        {
+            finishMigration(r); // never more than two live tables
+            if (root.load(std::memory_order_acquire) != t)
+                return;
+        }
+        if (t->next.load(std::memory_order_acquire))
+            return;
+        size_t cap = MIN_CAPACITY;
+        while (cap < size_t(count.load(std::memory_order_relaxed)) * 4)
+            cap <<= 1;
+        if (cap < t->capacity)
+            cap = t->capacity; // do not shrink while writes keep coming
+        Table *n = new Table(cap);
+        Table *expected = nullptr;
+        if (!t->next.compare_exchange_strong(expected, n, std::memory_order_acq_rel))
+            delete n;
+    }
+
+    // ---- write path ----
+
+    enum class PutResult
+    {
+        DONE,
+        MOVED,
+        FULL
+    };
+
+    // Replace/claim the key's slot in t; on DONE, *previous is the entry replaced (or null)
+    PutResult putInto(Table *t, Entry *entry, Entry **previous)
+    {
+        size_t mask = t->capacity - 1;
+        for (size_t n = 0, i = entry->hash & mask; n < t->capacity; ++n, i = (i + 1) & mask)
+        {
+            while (true)
+            {
+                Entry *s = t->slots[i].load(std::memory_order_acquire);
+                if (isMoved(s))
+                    return PutResult::MOVED;
+                if (!s)
+                {
+                    if (t->slots[i].compare_exchange_strong(s, entry, std::memory_order_acq_rel))
+                    {
+                        t->used.fetch_add(1, std::memory_order_relaxed);
+                        *previous = nullptr;
+                        return PutResult::DONE;
+                    }
+                    continue;
+                }
+                if (s->hash == entry->hash && s->key == entry->key)
+                {
+                    if (!t->slots[i].compare_exchange_strong(s, entry, std::memory_order_acq_rel))
+                        continue; // got tagged by a migrator
+                    *previous = s;
+                    return PutResult::DONE;
+                }
+                break;
+            }
+        }
+        return PutResult::FULL;
+    }
+
+    // Stores entry for its key. Returns true if the key was live before.
+    // With skipIfAbsent (erase), nothing is stored when the key is not live.
+    bool put(Entry *entry, bool skipIfAbsent)
+    {
+        std::lock_guard<std::mutex> lock(stripes[entry->hash % STRIPES].mtx);
+        reclaim::Epoch::Guard guard;
+
+        while (true)
+        {
+            Chain chain = snapshot();
+            Table *newest = chain.newest();
+
+            // The value the key had in an older table, with its slot tagged
+            // so a pending copy can no longer resurrect it
+            Entry *older = nullptr;
+            if (chain.size > 1)
+            {
+                helpMigrate(chain.tables[0]);
+                for (int k = 0; k < chain.size - 1; ++k)
+                {
+                    size_t i = chain.tables[k]->findSlot(entry->hash, entry->key);
+                    if (i != chain.tables[k]->capacity)
+                        older = migrateSlot(chain.tables[k], i);
+                }
+            }
+
+            if (skipIfAbsent)
+            {
+                size_t i = newest->findSlot(entry->hash, entry->key);
+                Entry *current = i == newest->capacity ? older : untag(newest->slots[i].load(std::memory_order_acquire));
+                if (!current || current->deleted)
+                {
+                    delete entry;
+                    return false;
+                }
+            }
+
+            Entry *previous = nullptr;
+            PutResult r = putInto(newest, entry, &previous);
+            if (r == PutResult::FULL)
+            {
+                startResize(newest);
+                continue;
+            }
+            if (r == PutResult::MOVED)
+                continue;
+
+            if (previous)
+                reclaim::Epoch::retire(previous);
+            else
+                previous = older; // not in the newest table yet: the old table had the truth
+            bool wasLive = previous && !previous->deleted;
+
+            count.fetch_add((entry->deleted ? 0 : 1) - (wasLive ? 1 : 0), std::memory_order_relaxed);
+            if (newest->used.load(std::memory_order_relaxed) * 2 > newest->capacity)
+                startResize(newest);
+            return wasLive;
+        }
+    }
+
+    // Newest table first: the first table that knows the key has the truth
+    const Entry *lookup(std::string_view key) const
+    {
+        size_t h = hashOf(key);
+        Chain chain = snapshot();
+        for (int k = chain.size - 1; k >= 0; --k)
+        {
+            const Table *t = chain.tables[k];
+            size_t i = t->findSlot(h, key);
+            if (i == t->capacity)
+                continue;
+            Entry *e = untag(t->slots[i].load(std::memory_order_acquire));
+            return e->deleted ? nullptr : e;
+        }
+        return nullptr;
+    }
+
+public:
+    explicit ConcurrentHashMap(size_t initialCapacity = MIN_CAPACITY)
+    {
+        size_t cap = MIN_CAPACITY;
+        while (cap < initialCapacity * 2)
+            cap <<= 1;
+        root.store(new Table(cap));
+    }
+
+    ~ConcurrentHashMap()
+    {
+        Table *t = root.load();
+        while (t)
+        {
+            // Tagged entries were copied forward or retired by their migrator
+            for (size_t i = 0; i < t->capacity; ++i)
+            {
+                Entry *e = t->slots[i].load(std::memory_order_relaxed);
+                if (e && !isMoved(e))
+                    delete e;
+            }
+            Table *next = t->next.load();
+            delete t;
+            t = next;
+        }
+    }
+
+    ConcurrentHashMap(const ConcurrentHashMap &) = delete;
+    ConcurrentHashMap &operator=(const ConcurrentHashMap &) = delete;
+
+    // Returns true if the key was newly inserted
+    bool insert_or_assign(std::string_view key, V value)
+    {
+        return !put(new Entry{hashOf(key), std::string(key), std::move(value), false}, false);
+    }
+
+    // Returns true if the key was present
+    bool erase(std::string_view key)
+    {
+        return put(new Entry{hashOf(key), std::string(key), V{}, true}, true);
+    }
+
+    bool find(std::string_view key, V &out) const
+    {
+        reclaim::Epoch::Guard guard;
+        const Entry *e = lookup(key);
+        if (!e)
+            return false;
+        out = e->value;
+        return true;
+    }
+
+    // Calls f(const V&) on the value in place (no copy); keep f short, it
+    // runs inside an epoch guard
+    template <typename F>
+    bool visit(std::string_view key, F &&f) const
+    {
+        reclaim::Epoch::Guard guard;
+        const Entry *e = lookup(key);
+        if (!e)
+            return false;
+        f(e->value);
+        return true;
+    }
+
+    bool contains(std::string_view key) const
+    {
+        reclaim::Epoch::Guard guard;
+        return lookup(key) != nullptr;
+    }
+
+    size_t size() const
+    {
+        long n = count.load(std::memory_order_relaxed);
+        return n > 0 ? size_t(n) : 0;
+    }
+
+    size_t capacity() const
+    {
+        reclaim::Epoch::Guard guard;
+        return snapshot().newest()->capacity;
+    }
+};
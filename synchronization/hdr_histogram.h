@@ -0,0 +1,337 @@
+// hdr_histogram.h
+// Latency histograms for hot paths: tail percentiles instead of one
+// chrono delta averaged over N.
+//
+//   Histogram           - plain value type. Log-linear buckets (HDR style):
+//                         values below 256 are exact; above that, every power
+//                         of two is split into 128 equal sub-buckets, so any
+//                         recorded value is within 1/128 (0.8 %) of its bucket.
+//                         Covers the full uint64_t range in ~58 KB. Merge,
+//                         percentiles, and a compact serialized form (so a
+//                         child process can ship its histogram back to the
+//                         parent over a pipe).
+//   Recorder            - the per-thread recording side. One writer; counts are
+//                         single-writer atomics (relaxed load + store - plain
+//                         MOVs on x86, no lock prefix), so other threads can
+//                         read it at any time without a race and without
+//                         slowing the writer down.
+//   ConcurrentHistogram - hands out one Recorder per thread and merges them
+//                         on demand: snapshot() for totals so far, interval()
+//                         for what was recorded since the previous interval().
+//
+// Units are whatever the caller records; the repo records nanoseconds.
+//
+// Usage:
+//   hdr::ConcurrentHistogram latency;
+//   hdr::Recorder &mine = latency.recorder();        // once per thread
+//   mine.record(hdr::nowNs() - item.enqueuedNs);     // hot path
+//   latency.snapshot().print(cout, "handoff");       // any thread, any time
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include <ctime>
+
+namespace hdr
+{
+    // CLOCK_MONOTONIC in ns: comparable across processes on the same machine
+    // (steady_clock's epoch is unspecified, so not used for cross-process deltas)
+    inline uint64_t nowNs()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+    }
+
+    // ========================================================================
+    // BUCKET LAYOUT
+    // ========================================================================
+
+    constexpr int SUB_BITS = 8;
+    constexpr uint64_t SUB_COUNT = uint64_t(1) << SUB_BITS; // 256: exact below this
+    constexpr uint64_t HALF = SUB_COUNT / 2;                // sub-buckets per power of two above it
+    constexpr size_t BUCKETS = (64 - SUB_BITS + 1) * HALF + HALF;
+
+    // value -> bucket: the top SUB_BITS significant bits of the value, plus
+    // how far they had to be shifted down
+    inline size_t bucketOf(uint64_t v)
+    {
+        if (v < SUB_COUNT)
+            return size_t(v);
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - SUB_BITS + 1;
+        return size_t(shift) * HALF + size_t(v >> shift);
+    }
+
+    inline uint64_t lowestOf(size_t bucket)
+    {
+        if (bucket < SUB_COUNT)
+            return bucket;
+        size_t shift = bucket / HALF - 1;
+        return uint64_t(bucket % HALF + HALF) << shift;
+    }
+
+    // Largest value that lands in the bucket (what percentiles report)
+    inline uint64_t highestOf(size_t bucket)
+    {
+        if (bucket < SUB_COUNT)
+            return bucket;
+        size_t shift = bucket / HALF - 1;
+        return lowestOf(bucket) + ((uint64_t(1) << shift) - 1);
+    }
+
+    // ========================================================================
+    // HISTOGRAM (single-threaded value type)
+    // ========================================================================
+
+    class Histogram
+    {
+    private:
+        std::vector<uint64_t> counts = std::vector<uint64_t>(BUCKETS, 0);
+        uint64_t total = 0;
+
+        static void putVarint(std::string &out, uint64_t v)
+        {
+            while (v >= 0x80)
+            {
+                out.push_back(char(v | 0x80));
+                v >>= 7;
+            }
+            out.push_back(char(v));
+        }
+
+        static uint64_t getVarint(std::string_view in, size_t &pos)
+        {
+            uint64_t v = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                if (pos >= in.size())
+                    throw std::runtime_error("Histogram: truncated data");
+                uint8_t byte = uint8_t(in[pos++]);
+                v |= uint64_t(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    return v;
+            }
+            throw std::runtime_error("Histogram: bad varint");
+        }
+
+    public:
+        void record(uint64_t value, uint64_t n = 1)
+        {
+            counts[bucketOf(value)] += n;
+            total += n;
+        }
+
+        void addBucket(size_t bucket, uint64_t n)
+        {
+            counts[bucket] += n;
+            total += n;
+        }
+
+        void merge(const Histogram &other)
+        {
+            for (size_t i = 0; i < BUCKETS; ++i)
+                counts[i] += other.counts[i];
+            total += other.total;
+        }
+
+        // this - earlier, for histograms that only grew in between
+        Histogram since(const Histogram &earlier) const
+        {
+            Histogram delta;
+            for (size_t i = 0; i < BUCKETS; ++i)
+                delta.addBucket(i, counts[i] - std::min(counts[i], earlier.counts[i]));
+            return delta;
+        }
+
+        void reset()
+        {
+            std::fill(counts.begin(), counts.end(), 0);
+            total = 0;
+        }
+
+        uint64_t count() const { return total; }
+
+        uint64_t min() const
+        {
+            for (size_t i = 0; i < BUCKETS; ++i)
+                if (counts[i])
+                    return lowestOf(i);
+            return 0;
+        }
+
+        uint64_t max() const
+        {
+            for (size_t i = BUCKETS; i-- > 0;)
+                if (counts[i])
+                    return highestOf(i);
+            return 0;
+        }
+
+        double mean() const
+        {
+            if (total == 0)
+                return 0;
+            double sum = 0;
+            for (size_t i = 0; i < BUCKETS; ++i)
+                if (counts[i])
+                    sum += double(counts[i]) * (double(lowestOf(i)) + double(highestOf(i))) / 2;
+            return sum / double(total);
+        }
+
+        // Smallest bucket bound with at least `percent` % of samples at or below it
+        uint64_t percentile(double percent) const
+        {
+            if (total == 0)
+                return 0;
+            double wanted = std::clamp(percent, 0.0, 100.0) / 100.0 * double(total);
+            uint64_t rank = std::max<uint64_t>(1, uint64_t(wanted + 0.999999));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < BUCKETS; ++i)
+            {
+                seen += counts[i];
+                if (seen >= rank)
+                    return highestOf(i);
+            }
+            return max();
+        }
+
+        // "HDR1" + varint total + (varint bucket gap, varint count) per
+        // non-empty bucket: a latency histogram is typically a few hundred bytes
+        std::string serialize() const
+        {
+            std::string out = "HDR1";
+            putVarint(out, total);
+            size_t previous = 0;
+            for (size_t i = 0; i < BUCKETS; ++i)
+            {
+                if (!counts[i])
+                    continue;
+                putVarint(out, i - previous);
+                putVarint(out, counts[i]);
+                previous = i;
+            }
+            return out;
+        }
+
+        static Histogram deserialize(std::string_view in)
+        {
+            if (in.substr(0, 4) != "HDR1")
+                throw std::runtime_error("Histogram: not a serialized histogram");
+            Histogram h;
+            size_t pos = 4, bucket = 0;
+            uint64_t expected = getVarint(in, pos);
+            while (pos < in.size())
+            {
+                bucket += getVarint(in, pos);
+                if (bucket >= BUCKETS)
+                    throw std::runtime_error("Histogram: bucket out of range");
+                h.addBucket(bucket, getVarint(in, pos));
+            }
+            if (h.total != expected)
+                throw std::runtime_error("Histogram: count mismatch");
+            return h;
+        }
+
+        // One line: count, mean, p50/p90/p99/p99.9/max, in microseconds
+        // (recorded values are ns)
+        void print(std::ostream &out, const std::string &label) const
+        {
+            auto us = [](double ns)
+            { return ns / 1000.0; };
+            std::ios::fmtflags flags = out.flags();
+            out << std::left << std::setw(28) << label << std::right << " n=" << std::setw(8) << total
+                << std::fixed << std::setprecision(2)
+                << "  mean " << std::setw(9) << us(mean())
+                << "  p50 " << std::setw(9) << us(double(percentile(50)))
+                << "  p90 " << std::setw(9) << us(double(percentile(90)))
+                << "  p99 " << std::setw(9) << us(double(percentile(99)))
+                << "  p99.9 " << std::setw(9) << us(double(percentile(99.9)))
+                << "  max " << std::setw(10) << us(double(max())) << " us" << std::endl;
+            out.flags(flags);
+        }
+    };
+
+    // ========================================================================
+    // RECORDER (one writer, readable from any thread)
+    // ========================================================================
+
+    class Recorder
+    {
+    private:
+        std::vector<std::atomic<uint64_t>> counts = std::vector<std::atomic<uint64_t>>(BUCKETS);
+
+    public:
+        Recorder() = default;
+        Recorder(const Recorder &) = delete;
+        Recorder &operator=(const Recorder &) = delete;
+
+        // Owner thread only
+        void record(uint64_t value)
+        {
+            std::atomic<uint64_t> &cell = counts[bucketOf(value)];
+            cell.store(cell.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        // Any thread: adds what has been recorded so far. Buckets are read
+        // one at a time, so a concurrent snapshot may be a few samples short.
+        void addTo(Histogram &h) const
+        {
+            for (size_t i = 0; i < BUCKETS; ++i)
+                if (uint64_t n = counts[i].load(std::memory_order_relaxed))
+                    h.addBucket(i, n);
+        }
+    };
+
+    // ========================================================================
+    // CONCURRENT HISTOGRAM (per-thread recorders, merged on read)
+    // ========================================================================
+
+    class ConcurrentHistogram
+    {
+    private:
+        mutable std::mutex registryMutex; // recorder() and readers only, never record()
+        std::deque<Recorder> recorders;   // deque: references stay valid as it grows
+        Histogram lastInterval;
+
+    public:
+        // Call once per thread and keep the reference
+        Recorder &recorder()
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            return recorders.emplace_back();
+        }
+
+        Histogram snapshot() const
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            Histogram merged;
+            for (const Recorder &r : recorders)
+                r.addTo(merged);
+            return merged;
+        }
+
+        // What was recorded since the previous interval() call, for periodic
+        // reporting while the recorders keep running
+        Histogram interval()
+        {
+            Histogram now = snapshot();
+            std::lock_guard<std::mutex> lock(registryMutex);
+            Histogram delta = now.since(lastInterval);
+            lastInterval = std::move(now);
+            return delta;
+        }
+    };
+}
@@ -0,0 +1,640 @@
+// instrumented_mutex.h
+// Drop-in std::mutex / std::shared_mutex replacements that record contention
+// and validate lock ordering at runtime.
+//
+// Build modes (pick with -D flags, nothing else changes in user code):
+//   (none)              -> InstrumentedMutex IS-A std::mutex, no extra state,
+//                          no extra instructions. Zero cost.
+//   -DSYNC_INSTRUMENT   -> per-lock acquisition counts, contended acquisitions,
+//                          wait-time and hold-time histograms (log2 ns buckets),
+//                          and the same per acquisition SITE (file:line) for
+//                          lock calls tagged with SYNC_LOCK_SITE(m).
+//   -DSYNC_LOCK_ORDER   -> debug lock-order graph: every "acquired B while
+//                          holding A" adds edge A->B; a new edge that closes a
+//                          cycle is reported as a POTENTIAL deadlock, even if
+//                          the threads never actually collided.
+//
+// Usage:
+//   InstrumentedMutex mtx{"sync_mutex.mtx"};        // name = the lock in reports
+//   lock_guard<InstrumentedMutex> g(mtx);           // still satisfies Lockable
+//   lock_guard<InstrumentedMutex> h(SYNC_LOCK_SITE(mtx)); // also counted under file:line
+//   InstrumentedConditionVariable cv;               // condition_variable_any + site handover
+//   LockRegistry::instance().report(cout);
+//
+// Sites: one mutex is often taken from several places, and only one of
+// them is the hot one. SYNC_LOCK_SITE(m) registers its file:line once
+// (function-local static) and tags the next lock call on m from this
+// thread; the lock guards call lock() themselves, so the site has to be
+// handed over this way. A condition-variable wait re-locks m inside the
+// library; InstrumentedConditionVariable tags that one re-lock with the
+// site m is held from. Untagged acquisitions only appear in the per-lock
+// table.
+//
+// Cost notes (when enabled):
+// - Uncontended path: one try_lock + two steady_clock reads (~20-40 ns total).
+// - Contended path is where time goes anyway; timing it is noise by comparison.
+// - Stats are relaxed atomics in a per-lock (and per-site) block, so recording
+//   never takes another lock. Only NEW lock-order edges touch the global graph mutex.
+
+#pragma once
+
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+
+#if defined(SYNC_INSTRUMENT) || defined(SYNC_LOCK_ORDER)
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstring>
+
+namespace sync_instrument
+{
+    using Clock = std::chrono::steady_clock;
+
+    inline int64_t nowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   Clock::now().time_since_epoch())
+            .count();
+    }
+
+    // Bucket i holds samples in [2^i, 2^(i+1)) ns; bucket 0 also holds 0.
+    struct Log2Histogram
+    {
+        static constexpr int BUCKETS = 40;
+        std::atomic<uint64_t> counts[BUCKETS] = {};
+
+        void record(int64_t ns)
+        {
+            int b = 0;
+            for (uint64_t v = ns > 0 ? uint64_t(ns) : 0; v > 1 && b < BUCKETS - 1; v >>= 1)
+                ++b;
+            counts[b].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        uint64_t total() const
+        {
+            uint64_t t = 0;
+            for (const auto &c : counts)
+                t += c.load(std::memory_order_relaxed);
+            return t;
+        }
+
+        // Upper bound of the bucket containing quantile q (0 for the [0, 2) bucket)
+        uint64_t percentile(double q) const
+        {
+            uint64_t n = total();
+            if (n == 0)
+                return 0;
+            uint64_t target = uint64_t(q * (n - 1)) + 1, seen = 0;
+            for (int b = 0; b < BUCKETS; ++b)
+            {
+                seen += counts[b].load(std::memory_order_relaxed);
+                if (seen >= target)
+                    return b == 0 ? 0 : uint64_t(1) << (b + 1);
+            }
+            return uint64_t(1) << BUCKETS;
+        }
+    };
+
+    struct LockStats
+    {
+        std::string name;
+        uint32_t id;
+        std::atomic<uint64_t> acquisitions{0};
+        std::atomic<uint64_t> contended{0};
+        std::atomic<uint64_t> sharedAcquisitions{0};
+        std::atomic<int64_t> totalWaitNs{0};
+        std::atomic<int64_t> maxWaitNs{0};
+        Log2Histogram wait;
+        Log2Histogram hold;
+
+        LockStats(std::string n, uint32_t i) : name(std::move(n)), id(i) {}
+
+        void recordWait(int64_t ns)
+        {
+            wait.record(ns);
+            if (ns > 0)
+            {
+                contended.fetch_add(1, std::memory_order_relaxed);
+                totalWaitNs.fetch_add(ns, std::memory_order_relaxed);
+                int64_t prev = maxWaitNs.load(std::memory_order_relaxed);
+                while (ns > prev && !maxWaitNs.compare_exchange_weak(prev, ns, std::memory_order_relaxed))
+                {
+                }
+            }
+        }
+    };
+
+    // Per-thread stack of held locks: drives hold times and lock-order edges
+    struct HeldLock
+    {
+        LockStats *stats;
+        LockStats *site; // nullptr: untagged acquisition
+        int64_t acquiredAt;
+    };
+
+    inline std::vector<HeldLock> &heldLocks()
+    {
+        thread_local std::vector<HeldLock> held;
+        return held;
+    }
+
+    // Sites tagged by SYNC_LOCK_SITE, not yet consumed by a lock call. A few
+    // slots: std::scoped_lock(SYNC_LOCK_SITE(a), SYNC_LOCK_SITE(b)) tags both
+    // before it locks either.
+    struct PendingSite
+    {
+        const LockStats *lock;
+        LockStats *site;
+    };
+
+    constexpr int PENDING_SITES = 4;
+
+    inline PendingSite *pendingSites()
+    {
+        thread_local PendingSite pending[PENDING_SITES] = {};
+        return pending;
+    }
+
+    inline void tagSite(const LockStats *lock, LockStats *site)
+    {
+        PendingSite *pending = pendingSites();
+        int slot = PENDING_SITES - 1;
+        for (int i = 0; i < PENDING_SITES; ++i)
+        {
+            if (pending[i].lock == lock || pending[i].lock == nullptr)
+            {
+                slot = i;
+                break;
+            }
+        }
+        pending[slot] = {lock, site};
+    }
+
+    inline LockStats *takeSite(const LockStats *lock)
+    {
+        PendingSite *pending = pendingSites();
+        for (int i = 0; i < PENDING_SITES; ++i)
+        {
+            if (pending[i].lock == lock)
+            {
+                LockStats *site = pending[i].site;
+                pending[i] = {};
+                return site;
+            }
+        }
+        return nullptr;
+    }
+
+    // Before a condition-variable wait on `lock`: its re-lock is charged to
+    // the site the lock is held from now
+    inline void tagRelock(const LockStats *lock)
+    {
+        auto &held = heldLocks();
+        for (auto it = held.rbegin(); it != held.rend(); ++it)
+        {
+            if (it->stats == lock)
+            {
+                if (it->site)
+                    tagSite(lock, it->site);
+                return;
+            }
+        }
+    }
+
+    class LockRegistry
+    {
+    private:
+        std::mutex mtx; // plain mutex: the registry must not instrument itself
+        std::deque<LockStats> stats; // deque: addresses stay stable, outlive the mutexes
+        std::deque<LockStats> sites; // same record, keyed by file:line
+        std::unordered_map<std::string, LockStats *> siteIndex;
+        std::unordered_map<uint32_t, std::unordered_set<uint32_t>> edges;
+        std::vector<std::string> cycles;
+        std::function<void(const std::string &)> onCycle;
+
+        // DFS: is there a path from -> ... -> to in the current graph?
+        bool findPath(uint32_t from, uint32_t to, std::vector<uint32_t> &path,
+                      std::unordered_set<uint32_t> &visited)
+        {
+            path.push_back(from);
+            if (from == to)
+                return true;
+            if (visited.insert(from).second)
+            {
+                auto it = edges.find(from);
+                if (it != edges.end())
+                    for (uint32_t next : it->second)
+                        if (findPath(next, to, path, visited))
+                            return true;
+            }
+            path.pop_back();
+            return false;
+        }
+
+    public:
+        static LockRegistry &instance()
+        {
+            static LockRegistry registry;
+            return registry;
+        }
+
+        LockStats *registerLock(const char *name)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            uint32_t id = uint32_t(stats.size());
+            stats.emplace_back(name ? std::string(name) : "mutex#" + std::to_string(id), id);
+            return &stats.back();
+        }
+
+        // Once per SYNC_LOCK_SITE expansion; the same file:line from another
+        // instantiation or translation unit shares the record
+        LockStats *registerSite(const char *file, int line)
+        {
+            const char *slash = std::strrchr(file, '/');
+            std::string name = std::string(slash ? slash + 1 : file) + ":" + std::to_string(line);
+            std::lock_guard<std::mutex> lock(mtx);
+            auto it = siteIndex.find(name);
+            if (it != siteIndex.end())
+                return it->second;
+            sites.emplace_back(name, uint32_t(sites.size()));
+            return siteIndex[name] = &sites.back();
+        }
+
+        // Default handler prints to stderr; tests can install one that aborts
+        void setCycleHandler(std::function<void(const std::string &)> handler)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            onCycle = std::move(handler);
+        }
+
+        // Called BEFORE blocking on `next`, so a real deadlock is still reported
+        void checkOrder(const LockStats *next)
+        {
+            thread_local std::unordered_set<uint64_t> knownEdges;
+            for (const HeldLock &h : heldLocks())
+            {
+                if (h.stats == next)
+                    continue; // recursive use is std::mutex UB anyway; not an ordering bug
+                uint64_t key = (uint64_t(h.stats->id) << 32) | next->id;
+                if (!knownEdges.insert(key).second)
+                    continue; // this thread already reported/added this edge
+
+                std::string report;
+                std::function<void(const std::string &)> handler;
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    if (!edges[h.stats->id].insert(next->id).second)
+                        continue;
+                    std::vector<uint32_t> path;
+                    std::unordered_set<uint32_t> visited;
+                    if (!findPath(next->id, h.stats->id, path, visited))
+                        continue;
+                    report = "POTENTIAL DEADLOCK (lock-order cycle): ";
+                    for (uint32_t id : path)
+                        report += stats[id].name + " -> ";
+                    report += next->name;
+                    cycles.push_back(report);
+                    handler = onCycle;
+                }
+                if (handler)
+                    handler(report);
+                else
+                    std::cerr << "[lock-order] " << report << std::endl;
+            }
+        }
+
+        size_t cycleCount()
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            return cycles.size();
+        }
+
+        void report(std::ostream &os)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            os << "\n--- Lock contention report ---\n";
+            table(os, "lock", stats);
+            if (!sites.empty())
+            {
+                os << "\nBy acquisition site (SYNC_LOCK_SITE):\n";
+                table(os, "site", sites);
+            }
+            os << "(percentiles are log2 bucket upper bounds)\n";
+            os << "Lock-order cycles detected: " << cycles.size() << "\n";
+            for (const auto &c : cycles)
+                os << "  " << c << "\n";
+        }
+
+    private:
+        static void table(std::ostream &os, const char *title, const std::deque<LockStats> &rows)
+        {
+            os << std::left << std::setw(24) << title << std::right
+               << std::setw(10) << "acquires" << std::setw(9) << "shared"
+               << std::setw(11) << "contended" << std::setw(12) << "wait p50"
+               << std::setw(12) << "wait p99" << std::setw(12) << "wait max"
+               << std::setw(12) << "hold p50" << std::setw(12) << "hold p99" << "\n";
+            for (const auto &s : rows)
+            {
+                uint64_t acq = s.acquisitions.load() + s.sharedAcquisitions.load();
+                if (acq == 0)
+                    continue;
+                double pct = 100.0 * s.contended.load() / acq;
+                os << std::left << std::setw(24) << s.name << std::right
+                   << std::setw(10) << s.acquisitions.load()
+                   << std::setw(9) << s.sharedAcquisitions.load()
+                   << std::setw(10) << std::fixed << std::setprecision(2) << pct << "%"
+                   << std::setw(10) << s.wait.percentile(0.50) << "ns"
+                   << std::setw(10) << s.wait.percentile(0.99) << "ns"
+                   << std::setw(10) << s.maxWaitNs.load() << "ns"
+                   << std::setw(10) << s.hold.percentile(0.50) << "ns"
+                   << std::setw(10) << s.hold.percentile(0.99) << "ns\n";
+            }
+        }
+    };
+
+    // Hooks shared by both mutex types
+    inline void beforeAcquire(LockStats *s)
+    {
+#ifdef SYNC_LOCK_ORDER
+        LockRegistry::instance().checkOrder(s);
+#else
+        (void)s;
+#endif
+    }
+
+    inline void afterAcquire(LockStats *s, int64_t waitNs, bool shared)
+    {
+        LockStats *site = takeSite(s);
+#ifdef SYNC_INSTRUMENT
+        for (LockStats *target : {s, site})
+        {
+            if (!target)
+                continue;
+            (shared ? target->sharedAcquisitions : target->acquisitions).fetch_add(1, std::memory_order_relaxed);
+            target->recordWait(waitNs);
+        }
+#else
+        (void)waitNs;
+        (void)shared;
+#endif
+        heldLocks().push_back({s, site, nowNs()});
+    }
+
+    inline void beforeRelease(LockStats *s)
+    {
+        auto &held = heldLocks();
+        // Usually the top entry; search backwards for out-of-order unlocks
+        for (auto it = held.rbegin(); it != held.rend(); ++it)
+        {
+            if (it->stats == s)
+            {
+#ifdef SYNC_INSTRUMENT
+                int64_t heldNs = nowNs() - it->acquiredAt;
+                s->hold.record(heldNs);
+                if (it->site)
+                    it->site->hold.record(heldNs);
+#endif
+                held.erase(std::next(it).base());
+                return;
+            }
+        }
+    }
+}
+
+using sync_instrument::LockRegistry;
+
+// Tag the next lock call on `m` with this file:line (see "Sites" above)
+#define SYNC_LOCK_SITE(m)                                                                    \
+    (m).at([] {                                                                              \
+        static sync_instrument::LockStats *site = LockRegistry::instance().registerSite(__FILE__, __LINE__); \
+        return site;                                                                         \
+    }())
+
+class InstrumentedMutex
+{
+private:
+    std::mutex impl;
+    sync_instrument::LockStats *stats;
+
+public:
+    explicit InstrumentedMutex(const char *name = nullptr)
+        : stats(LockRegistry::instance().registerLock(name)) {}
+
+    InstrumentedMutex(const InstrumentedMutex &) = delete;
+    InstrumentedMutex &operator=(const InstrumentedMutex &) = delete;
+
+    InstrumentedMutex &at(sync_instrument::LockStats *site)
+    {
+        sync_instrument::tagSite(stats, site);
+        return *this;
+    }
+
+    void tagRelock() { sync_instrument::tagRelock(stats); }
+
+    void lock()
+    {
+        sync_instrument::beforeAcquire(stats);
+        int64_t waited = 0;
+        if (!impl.try_lock())
+        {
+            int64_t start = sync_instrument::nowNs();
+            impl.lock();
+            waited = sync_instrument::nowNs() - start;
+        }
+        sync_instrument::afterAcquire(stats, waited, false);
+    }
+
+    bool try_lock()
+    {
+        if (!impl.try_lock())
+            return false;
+        sync_instrument::afterAcquire(stats, 0, false);
+        return true;
+    }
+
+    void unlock()
+    {
+        sync_instrument::beforeRelease(stats);
+        impl.unlock();
+    }
+};
+
+class InstrumentedSharedMutex
+{
+private:
+    std::shared_mutex impl;
+    sync_instrument::LockStats *stats;
+
+public:
+    explicit InstrumentedSharedMutex(const char *name = nullptr)
+        : stats(LockRegistry::instance().registerLock(name)) {}
+
+    InstrumentedSharedMutex(const InstrumentedSharedMutex &) = delete;
+    InstrumentedSharedMutex &operator=(const InstrumentedSharedMutex &) = delete;
+
+    InstrumentedSharedMutex &at(sync_instrument::LockStats *site)
+    {
+        sync_instrument::tagSite(stats, site);
+        return *this;
+    }
+
+    void tagRelock() { sync_instrument::tagRelock(stats); }
+
+    void lock()
+    {
+        sync_instrument::beforeAcquire(stats);
+        int64_t waited = 0;
+        if (!impl.try_lock())
+        {
+            int64_t start = sync_instrument::nowNs();
+            impl.lock();
+            waited = sync_instrument::nowNs() - start;
+        }
+        sync_instrument::afterAcquire(stats, waited, false);
+    }
+
+    bool try_lock()
+    {
+        if (!impl.try_lock())
+            return false;
+        sync_instrument::afterAcquire(stats, 0, false);
+        return true;
+    }
+
+    void unlock()
+    {
+        sync_instrument::beforeRelease(stats);
+        impl.unlock();
+    }
+
+    void lock_shared()
+    {
+        sync_instrument::beforeAcquire(stats);
+        int64_t waited = 0;
+        if (!impl.try_lock_shared())
+        {
+            int64_t start = sync_instrument::nowNs();
+            impl.lock_shared();
+            waited = sync_instrument::nowNs() - start;
+        }
+        sync_instrument::afterAcquire(stats, waited, true);
+    }
+
+    bool try_lock_shared()
+    {
+        if (!impl.try_lock_shared())
+            return false;
+        sync_instrument::afterAcquire(stats, 0, true);
+        return true;
+    }
+
+    void unlock_shared()
+    {
+        sync_instrument::beforeRelease(stats);
+        impl.unlock_shared();
+    }
+};
+
+// condition_variable_any that hands the waiting lock's site to its re-lock.
+// Lock: unique_lock<InstrumentedMutex> or shared_lock<InstrumentedSharedMutex>
+class InstrumentedConditionVariable
+{
+private:
+    std::condition_variable_any impl;
+
+public:
+    void notify_one() noexcept { impl.notify_one(); }
+    void notify_all() noexcept { impl.notify_all(); }
+
+    template <class Lock>
+    void wait(Lock &lock)
+    {
+        lock.mutex()->tagRelock();
+        impl.wait(lock);
+    }
+
+    template <class Lock, class Predicate>
+    void wait(Lock &lock, Predicate pred)
+    {
+        while (!pred())
+            wait(lock);
+    }
+
+    template <class Lock, class Clock, class Duration>
+    std::cv_status wait_until(Lock &lock, const std::chrono::time_point<Clock, Duration> &deadline)
+    {
+        lock.mutex()->tagRelock();
+        return impl.wait_until(lock, deadline);
+    }
+
+    template <class Lock, class Clock, class Duration, class Predicate>
+    bool wait_until(Lock &lock, const std::chrono::time_point<Clock, Duration> &deadline, Predicate pred)
+    {
+        while (!pred())
+            if (wait_until(lock, deadline) == std::cv_status::timeout)
+                return pred();
+        return true;
+    }
+
+    template <class Lock, class Rep, class Period, class... Predicate>
+    auto wait_for(Lock &lock, const std::chrono::duration<Rep, Period> &timeout, Predicate... pred)
+    {
+        return wait_until(lock, std::chrono::steady_clock::now() + timeout, pred...);
+    }
+};
+
+#else // plain build: the wrappers ARE the standard types
+
+#define SYNC_LOCK_SITE(m) (m)
+
+using InstrumentedConditionVariable = std::condition_variable_any;
+
+class InstrumentedMutex : public std::mutex
+{
+public:
+    InstrumentedMutex() = default;
+    explicit InstrumentedMutex(const char *) {}
+};
+
+class InstrumentedSharedMutex : public std::shared_mutex
+{
+public:
+    InstrumentedSharedMutex() = default;
+    explicit InstrumentedSharedMutex(const char *) {}
+};
+
+#include <ostream>
+#include <string>
+#include <functional>
+
+// No-op registry so call sites compile unchanged
+class LockRegistry
+{
+public:
+    static LockRegistry &instance()
+    {
+        static LockRegistry registry;
+        return registry;
+    }
+    void setCycleHandler(std::function<void(const std::string &)>) {}
+    size_t cycleCount() { return 0; }
+    void report(std::ostream &os) { os << "\n(lock instrumentation disabled: built with plain mutexes)\n"; }
+};
+
+static_assert(sizeof(InstrumentedMutex) == sizeof(std::mutex), "plain build must add no state");
+
+#endif
@@ -0,0 +1,111 @@
+// lock_benchmark.cpp
+// safeWorker from sync_mutex.cpp (lock; so += 2; unlock) under increasing
+// contention, for std::mutex and the locks in spin_locks.h.
+//
+// Build: make FILE=lock_benchmark.cpp CXXFLAGS="-std=c++17 -O2 -Wall -Wextra -pthread" run
+// Args:  ./program [ms_per_run] [max_threads]     (defaults: 200 ms, 64 threads)
+//
+// What to look for:
+// - Throughput (M acquisitions/s) as threads grow past the core count.
+// - Fairness = min/max acquisitions per thread (1.0 = perfectly fair).
+//   std::mutex and the adaptive mutex let a running thread re-grab the lock
+//   (great throughput, poor fairness); ticket and MCS hand it over in FIFO order.
+// - With more threads than cores, FIFO spinlocks suffer lock-waiter
+//   preemption: the next-in-line thread may not even be running.
+
+#include "spin_locks.h"
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <cstdlib>
+
+using namespace std;
+
+struct Result
+{
+    double mopsPerSec;
+    double fairness;
+    bool correct;
+};
+
+template <typename Lock>
+Result run(int threads, chrono::milliseconds duration)
+{
+    Lock mtx;
+    long so = 0;
+    atomic<bool> start{false}, stop{false};
+    vector<long> perThread(threads, 0);
+    vector<thread> workers;
+
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&, t]()
+                             {
+            while (!start.load(memory_order_acquire))
+                this_thread::yield();
+            long mine = 0;
+            while (!stop.load(memory_order_relaxed))
+            {
+                lock_guard<Lock> guard(mtx); // Lockable: lock_guard just works
+                so += 2;
+                ++mine;
+            }
+            perThread[t] = mine; });
+    }
+
+    auto begin = chrono::steady_clock::now();
+    start.store(true, memory_order_release);
+    this_thread::sleep_for(duration);
+    stop.store(true);
+    for (auto &w : workers)
+        w.join();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    long total = 0;
+    for (long c : perThread)
+        total += c;
+    auto [mn, mx] = minmax_element(perThread.begin(), perThread.end());
+    return {total / secs / 1e6, *mx ? double(*mn) / *mx : 1.0, so == 2 * total};
+}
+
+int main(int argc, char **argv)
+{
+    chrono::milliseconds duration(argc > 1 ? atoi(argv[1]) : 200);
+    int maxThreads = argc > 2 ? atoi(argv[2]) : 64;
+
+    cout << "--- Lock benchmark: lock; so += 2; unlock ---" << endl;
+    cout << "Hardware threads: " << thread::hardware_concurrency()
+         << ", " << duration.count() << " ms per run" << endl;
+    cout << "Cells: M acquisitions/s (fairness min/max)\n\n";
+
+    cout << setw(8) << "threads" << setw(20) << "std::mutex" << setw(20) << "TicketLock"
+         << setw(20) << "AdaptiveMutex" << setw(20) << "McsLock" << endl;
+
+    bool allCorrect = true;
+    auto cell = [&](const Result &r)
+    {
+        allCorrect &= r.correct;
+        cout << setw(10) << fixed << setprecision(2) << r.mopsPerSec
+             << " (" << setprecision(2) << setw(5) << r.fairness << ")  ";
+    };
+
+    for (int threads = 2; threads <= maxThreads; threads *= 2)
+    {
+        cout << setw(8) << threads << "  ";
+        cell(run<mutex>(threads, duration));
+        cell(run<TicketLock>(threads, duration));
+        cell(run<AdaptiveMutex>(threads, duration));
+        cell(run<McsLock>(threads, duration));
+        cout << endl;
+    }
+
+    cout << "\nAll counters consistent (so == 2 * acquisitions): " << (allCorrect ? "yes" : "NO") << endl;
+    return allCorrect ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+// lock_profiling.cpp
+// Runs the existing synchronization patterns on top of instrumented_mutex.h:
+//   - safeWorker / safeWorkerRAII from sync_mutex.cpp
+//   - the condition_variable handoff from producer_consumer.cpp
+//   - Telemetry read/write from sync_shared_mutex.cpp
+//   - a deliberate A->B / B->A lock-order inversion
+//
+// The lock calls are tagged with SYNC_LOCK_SITE, so the report also splits
+// each mutex by file:line: safeWorker's lock()/unlock() and safeWorkerRAII's
+// guard share sync_mutex.mtx but show up as separate sites.
+//
+// Build (instrumented, the default for this demo):
+//   make FILE=lock_profiling.cpp run
+// Build with plain mutexes (wrappers compile down to std::mutex):
+//   make FILE=lock_profiling.cpp CXXFLAGS="-std=c++17 -Wall -Wextra -pthread -DSYNC_PLAIN" run
+//
+// Why the inversion matters: the two threads below run one AFTER the other,
+// so the program never actually deadlocks. A plain test run passes. The
+// lock-order graph still sees A->B and B->A and reports the cycle - the bug
+// is caught before the unlucky interleaving ever happens in production.
+
+#ifndef SYNC_PLAIN
+#define SYNC_INSTRUMENT
+#define SYNC_LOCK_ORDER
+#endif
+
+#include "instrumented_mutex.h"
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <queue>
+#include <condition_variable>
+#include <chrono>
+
+using namespace std;
+
+const int ITERATIONS = 100000;
+
+// ==================================================================
+// sync_mutex.cpp workers, unchanged except for the mutex type
+// ==================================================================
+
+InstrumentedMutex mtx{"sync_mutex.mtx"};
+
+void safeWorker(int &so)
+{
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        SYNC_LOCK_SITE(mtx).lock();
+        so += 2;
+        mtx.unlock();
+    }
+}
+
+void safeWorkerRAII(int &so)
+{
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        lock_guard<InstrumentedMutex> protect(SYNC_LOCK_SITE(mtx));
+        so += 2;
+    }
+}
+
+// ==================================================================
+// producer_consumer.cpp handoff
+// condition_variable only accepts unique_lock<std::mutex>; the _any
+// variant accepts any Lockable, including the instrumented wrapper.
+// InstrumentedConditionVariable is that, plus the wait's re-lock counted
+// at the site the consumer locked from.
+// ==================================================================
+
+InstrumentedMutex queue_mtx{"producer_consumer.mtx"};
+InstrumentedConditionVariable cv;
+queue<int> data_queue;
+bool finished_producing = false;
+
+void producer()
+{
+    for (int i = 0; i < 20000; ++i)
+    {
+        lock_guard<InstrumentedMutex> lock(SYNC_LOCK_SITE(queue_mtx));
+        data_queue.push(i);
+        cv.notify_one();
+    }
+    lock_guard<InstrumentedMutex> lock(SYNC_LOCK_SITE(queue_mtx));
+    finished_producing = true;
+    cv.notify_all();
+}
+
+void consumer(long &sum)
+{
+    while (true)
+    {
+        unique_lock<InstrumentedMutex> lock(SYNC_LOCK_SITE(queue_mtx)); // cv re-locks count here too
+        cv.wait(lock, []
+                { return !data_queue.empty() || finished_producing; });
+        if (!data_queue.empty())
+        {
+            sum += data_queue.front();
+            data_queue.pop();
+        }
+        else if (finished_producing)
+            break;
+    }
+}
+
+// ==================================================================
+// sync_shared_mutex.cpp Telemetry (sleeps removed so it runs quickly)
+// ==================================================================
+
+class Telemetry
+{
+public:
+    void write(int newValue)
+    {
+        lock_guard<InstrumentedSharedMutex> lock(SYNC_LOCK_SITE(sm_mutex));
+        value = newValue;
+    }
+
+    int read() const
+    {
+        shared_lock<InstrumentedSharedMutex> lock(SYNC_LOCK_SITE(sm_mutex));
+        return value;
+    }
+
+private:
+    mutable InstrumentedSharedMutex sm_mutex{"telemetry.sm_mutex"};
+    int value = 0;
+};
+
+// ==================================================================
+// Lock-order inversion (transfer between two accounts)
+// ==================================================================
+
+InstrumentedMutex account_a{"account_a"};
+InstrumentedMutex account_b{"account_b"};
+
+void transfer_a_to_b()
+{
+    lock_guard<InstrumentedMutex> first(account_a);
+    lock_guard<InstrumentedMutex> second(account_b);
+}
+
+void transfer_b_to_a()
+{
+    lock_guard<InstrumentedMutex> first(account_b); // opposite order!
+    lock_guard<InstrumentedMutex> second(account_a);
+}
+
+int main()
+{
+    cout << "--- Lock profiling with instrumented mutexes ---" << endl;
+    cout << "sizeof(InstrumentedMutex) = " << sizeof(InstrumentedMutex)
+         << ", sizeof(std::mutex) = " << sizeof(std::mutex) << endl;
+
+    int so = 23;
+    thread t1(safeWorker, ref(so));
+    thread t2(safeWorkerRAII, ref(so));
+    thread t3(safeWorkerRAII, ref(so));
+    t1.join();
+    t2.join();
+    t3.join();
+    cout << "Expected final value: " << 23 + 2 * ITERATIONS * 3 << endl;
+    cout << "Actual final value:   " << so << endl;
+
+    long sum = 0;
+    thread prod(producer);
+    thread cons(consumer, ref(sum));
+    prod.join();
+    cons.join();
+    cout << "Consumer sum: " << sum << " (expected " << 20000L * 19999 / 2 << ")" << endl;
+
+    Telemetry telemetry;
+    vector<thread> threads;
+    threads.emplace_back([&]
+                         { for (int i = 0; i < 2000; ++i) telemetry.write(i); });
+    for (int r = 0; r < 3; ++r)
+        threads.emplace_back([&]
+                             { long s = 0; for (int i = 0; i < 20000; ++i) s += telemetry.read(); (void)s; });
+    for (auto &t : threads)
+        t.join();
+
+    thread x(transfer_a_to_b);
+    x.join();
+    thread y(transfer_b_to_a); // runs after x: no real deadlock, but the cycle is reported
+    y.join();
+
+    LockRegistry::instance().report(cout);
+    return 0;
+}
@@ -0,0 +1,303 @@
+// lockfree_stack.cpp
+// Lock-free Treiber stack on top of memory_reclamation.h, with the
+// push / pop / peek / size / isEmpty interface of good_design_3::Stack
+// (solid/03_lsp_liskov_substitution.cpp).
+//
+// Build: make FILE=lockfree_stack.cpp CXXFLAGS="-std=c++17 -O2 -Wall -Wextra -pthread" run
+// Args:  ./program [ms_per_run] [max_threads]     (defaults: 200 ms, 8 threads)
+//
+// Treiber stack: head is one atomic pointer.
+//   push: node->next = head; CAS(head, node->next, node)
+//   pop:  top = head; CAS(head, top, top->next)
+// Reading top->next is only safe if nobody has freed top in the meantime -
+// that is exactly what the reclamation policy guarantees.
+//
+// The benchmark reports throughput and PEAK pending garbage (retired, not yet
+// freed nodes) for a mutex-protected vector stack, EBR and hazard pointers,
+// then repeats with one reader stuck inside a guard to show EBR's unbounded
+// garbage vs HP's bounded garbage.
+//
+// Reading the numbers: with threads > cores, a thread preempted inside a
+// guard holds the epoch back just like the stalled reader does, so EBR
+// garbage grows with oversubscription. On a single core the mutex stack wins
+// outright - nobody ever waits on it; lock-free pays off under real
+// parallelism and when a lock holder could be descheduled.
+
+#include "memory_reclamation.h"
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <cstdlib>
+
+using namespace std;
+
+// ============================================================================
+// BASELINE: good_design_3::Stack behind a mutex
+// ============================================================================
+
+class MutexStack
+{
+private:
+    mutable mutex mtx;
+    vector<int> items;
+
+public:
+    void push(int item)
+    {
+        lock_guard<mutex> lock(mtx);
+        items.push_back(item);
+    }
+
+    bool tryPop(int &out)
+    {
+        lock_guard<mutex> lock(mtx);
+        if (items.empty())
+            return false;
+        out = items.back();
+        items.pop_back();
+        return true;
+    }
+
+    int size() const
+    {
+        lock_guard<mutex> lock(mtx);
+        return items.size();
+    }
+
+    static size_t pending() { return 0; }
+    static const char *name() { return "mutex"; }
+};
+
+// ============================================================================
+// LOCK-FREE TREIBER STACK
+// ============================================================================
+
+template <typename Reclaimer>
+class LockFreeStack
+{
+private:
+    struct Node
+    {
+        int value;
+        Node *next;
+    };
+
+    atomic<Node *> head{nullptr};
+    atomic<int> count{0}; // approximate under concurrency, exact when quiescent
+
+public:
+    ~LockFreeStack()
+    {
+        Node *n = head.load();
+        while (n)
+        {
+            Node *next = n->next;
+            delete n;
+            n = next;
+        }
+    }
+
+    void push(int item)
+    {
+        Node *node = new Node{item, head.load(memory_order_relaxed)};
+        // No guard needed: we never dereference the old head, only compare it
+        while (!head.compare_exchange_weak(node->next, node, memory_order_release, memory_order_relaxed))
+        {
+        }
+        count.fetch_add(1, memory_order_relaxed);
+    }
+
+    // Concurrent callers cannot "check isEmpty() then pop()", so this is the
+    // primitive; pop() keeps the original throwing interface on top of it
+    bool tryPop(int &out)
+    {
+        typename Reclaimer::Guard guard;
+        while (true)
+        {
+            Node *top = guard.protect(head);
+            if (!top)
+                return false;
+            if (head.compare_exchange_weak(top, top->next, memory_order_acquire, memory_order_relaxed))
+            {
+                out = top->value;
+                guard.reset();
+                Reclaimer::retire(top); // NOT delete: other threads may still be reading it
+                count.fetch_sub(1, memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+
+    int pop()
+    {
+        int item;
+        if (!tryPop(item))
+            throw runtime_error("Stack empty");
+        return item;
+    }
+
+    int peek() const
+    {
+        typename Reclaimer::Guard guard;
+        Node *top = guard.protect(head);
+        if (!top)
+            throw runtime_error("Stack empty");
+        return top->value;
+    }
+
+    int size() const { return count.load(memory_order_relaxed); }
+    bool isEmpty() const { return head.load(memory_order_acquire) == nullptr; }
+
+    static size_t pending() { return Reclaimer::pending(); }
+    static const char *name() { return Reclaimer::name(); }
+    static constexpr size_t nodeBytes() { return sizeof(Node); }
+};
+
+// ============================================================================
+// BENCHMARK
+// ============================================================================
+
+struct Result
+{
+    double mops;
+    size_t peakPending;
+    bool balanced;
+};
+
+// Each thread does random push/pop. Checksum: everything pushed is either
+// popped by someone or still in the stack at the end.
+template <typename Stack, typename Reclaimer = reclaim::Epoch>
+Result run(int threads, chrono::milliseconds duration, bool stalledReader)
+{
+    Stack stack;
+    for (int i = 0; i < 1000; ++i)
+        stack.push(i);
+    long expected = 999L * 1000 / 2;
+
+    atomic<bool> start{false}, stop{false};
+    atomic<long> ops{0}, pushedSum{0}, poppedSum{0};
+    vector<thread> workers;
+
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&, t]()
+                             {
+            mt19937 rng(t + 7);
+            long mine = 0, pushed = 0, popped = 0;
+            while (!start.load(memory_order_acquire))
+                this_thread::yield();
+            while (!stop.load(memory_order_relaxed))
+            {
+                int v = int(rng() & 0xffff);
+                if (rng() & 1)
+                {
+                    stack.push(v);
+                    pushed += v;
+                }
+                else if (stack.tryPop(v))
+                    popped += v;
+                ++mine;
+            }
+            ops += mine;
+            pushedSum += pushed;
+            poppedSum += popped; });
+    }
+
+    // A reader that entered a critical region and got descheduled forever
+    atomic<bool> readerIn{false};
+    thread reader;
+    if (stalledReader)
+        reader = thread([&]()
+                        {
+            typename Reclaimer::Guard guard;
+            readerIn = true;
+            while (!stop.load(memory_order_relaxed))
+                this_thread::sleep_for(chrono::milliseconds(1)); });
+    while (stalledReader && !readerIn)
+        this_thread::yield();
+
+    size_t peak = 0;
+    auto begin = chrono::steady_clock::now();
+    start.store(true, memory_order_release);
+    while (chrono::steady_clock::now() - begin < duration)
+    {
+        this_thread::sleep_for(chrono::milliseconds(1));
+        peak = max(peak, Stack::pending());
+    }
+    stop = true;
+    for (auto &w : workers)
+        w.join();
+    if (reader.joinable())
+        reader.join();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    long remaining = 0;
+    int v;
+    while (stack.tryPop(v))
+        remaining += v;
+    bool balanced = expected + pushedSum.load() == poppedSum.load() + remaining;
+    return {ops.load() / secs / 1e6, peak, balanced};
+}
+
+template <typename Stack, typename Reclaimer = reclaim::Epoch>
+bool report(int threads, chrono::milliseconds duration, bool stalledReader = false)
+{
+    Result r = run<Stack, Reclaimer>(threads, duration, stalledReader);
+    cout << setw(8) << Stack::name() << setw(9) << threads << fixed << setprecision(2)
+         << setw(12) << r.mops << setw(16) << r.peakPending
+         << setw(14) << (r.balanced ? "ok" : "MISMATCH") << endl;
+    return r.balanced;
+}
+
+int main(int argc, char **argv)
+{
+    chrono::milliseconds duration(argc > 1 ? atoi(argv[1]) : 200);
+    int maxThreads = argc > 2 ? atoi(argv[2]) : 8;
+
+    using EbrStack = LockFreeStack<reclaim::Epoch>;
+    using HpStack = LockFreeStack<reclaim::Hazard>;
+
+    cout << "--- Treiber stack: mutex vs epoch-based reclamation vs hazard pointers ---" << endl;
+    cout << "Node size: " << EbrStack::nodeBytes() << " bytes; hazard slots per thread: "
+         << reclaim::Hazard::SLOTS_PER_THREAD << "; " << thread::hardware_concurrency() << " hardware threads\n\n";
+
+    cout << setw(8) << "stack" << setw(9) << "threads" << setw(12) << "Mops/s"
+         << setw(16) << "peak garbage" << setw(14) << "checksum" << endl;
+
+    bool ok = true;
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        ok &= report<MutexStack>(threads, duration);
+        ok &= report<EbrStack>(threads, duration);
+        ok &= report<HpStack>(threads, duration);
+    }
+
+    cout << "\n--- Same load, one reader stuck inside a guard ---" << endl;
+    ok &= report<EbrStack, reclaim::Epoch>(4, duration, true);
+    ok &= report<HpStack, reclaim::Hazard>(4, duration, true);
+    cout << "EBR cannot advance past the stalled reader, so nothing is freed;\n"
+            "HP only keeps the nodes that are actually published.\n";
+
+    // The original interface still works for single-threaded callers
+    HpStack stack;
+    stack.push(1);
+    stack.push(2);
+    cout << "\npeek=" << stack.peek() << " pop=" << stack.pop() << " size=" << stack.size() << endl;
+    try
+    {
+        stack.pop();
+        stack.pop();
+    }
+    catch (const runtime_error &e)
+    {
+        cout << "Error: " << e.what() << endl;
+    }
+    return ok ? 0 : 1;
+}
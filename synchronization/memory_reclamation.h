@@ -0,0 +1,419 @@
+// memory_reclamation.h
+// Safe memory reclamation for lock-free data structures.
+//
+// The problem: in a lock-free structure a thread can unlink a node while
+// another thread still holds a pointer to it (it loaded `head` a moment ago
+// and is about to read head->next). `delete` at unlink time is a
+// use-after-free; never deleting is a leak. A mutex-based stack never has
+// this problem because nobody can look at a node without holding the lock.
+//
+// Two schemes with the same interface:
+//
+//   reclaim::Epoch   - epoch-based reclamation (EBR)
+//       Readers announce "I am inside a critical region that started in
+//       epoch e". Retired nodes are tagged with the global epoch and freed
+//       once the epoch has advanced twice - at that point no thread can still
+//       be in a region that saw them. Entering a region is a couple of
+//       stores: very fast. But one stalled reader blocks the epoch, so
+//       garbage is UNBOUNDED.
+//
+//   reclaim::Hazard  - hazard pointers (HP)
+//       Readers publish the exact pointer they are about to dereference.
+//       A retiring thread periodically scans all published pointers and frees
+//       every retired node nobody has published. Each protect() costs a
+//       store + seq_cst fence + re-check, but garbage is BOUNDED: at most
+//       (scan threshold + published hazards) nodes per thread.
+//
+// Usage (identical for both, pick with a template parameter):
+//
+//   Policy::Guard guard;                 // RAII: enter critical region
+//   Node *top = guard.protect(head);     // safe to dereference until guard dies
+//   ...unlink top with CAS...
+//   Policy::retire(top);                 // freed later, when provably unused
+//
+// Both schemes also prevent ABA on the CAS: a node cannot be freed and its
+// address reused while any guard can still see it.
+//
+// Threads register lazily on first use (up to MAX_THREADS at a time) and
+// hand unreclaimed garbage to a shared orphan list when they exit.
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <exception>
+#include <cstdint>
+#include <cstddef>
+
+namespace reclaim
+{
+    constexpr size_t MAX_THREADS = 256;
+    constexpr size_t CACHE_LINE = 64;
+
+    namespace detail
+    {
+        struct Retired
+        {
+            void *ptr;
+            void (*deleter)(void *);
+            uint64_t epoch; // EBR only
+
+            void free() const { deleter(ptr); }
+        };
+
+        template <typename T>
+        void deleteAs(void *p) { delete static_cast<T *>(p); }
+
+        // Garbage left behind by exited threads; adopted by the next collector
+        class OrphanList
+        {
+        private:
+            std::mutex mtx;
+            std::vector<Retired> items;
+            std::atomic<size_t> count{0};
+
+        public:
+            ~OrphanList()
+            {
+                for (const Retired &r : items)
+                    r.free();
+            }
+
+            void add(std::vector<Retired> &from)
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                items.insert(items.end(), from.begin(), from.end());
+                count.store(items.size(), std::memory_order_relaxed);
+                from.clear();
+            }
+
+            // Moves everything into `to` if nobody else is adopting right now
+            bool adopt(std::vector<Retired> &to)
+            {
+                if (count.load(std::memory_order_relaxed) == 0)
+                    return false;
+                std::unique_lock<std::mutex> lock(mtx, std::try_to_lock);
+                if (!lock || items.empty())
+                    return false;
+                to.insert(to.end(), items.begin(), items.end());
+                items.clear();
+                count.store(0, std::memory_order_relaxed);
+                return true;
+            }
+
+            size_t size() const { return count.load(std::memory_order_relaxed); }
+        };
+
+        // Fixed table of per-thread records. A thread claims one on first use
+        // and releases it (after onThreadExit()) when the thread ends.
+        template <typename Record>
+        class ThreadRegistry
+        {
+        private:
+            struct Holder
+            {
+                Record *record;
+                ~Holder()
+                {
+                    record->onThreadExit();
+                    record->inUse.store(false, std::memory_order_release);
+                }
+            };
+
+            static Record *claim()
+            {
+                for (size_t i = 0; i < MAX_THREADS; ++i)
+                {
+                    Record &r = records[i];
+                    if (!r.inUse.load(std::memory_order_relaxed) &&
+                        !r.inUse.exchange(true, std::memory_order_acquire))
+                    {
+                        size_t hw = highWater.load(std::memory_order_relaxed);
+                        while (hw < i + 1 && !highWater.compare_exchange_weak(hw, i + 1))
+                        {
+                        }
+                        return &r;
+                    }
+                }
+                std::terminate(); // more than MAX_THREADS threads using one scheme at once
+            }
+
+        public:
+            inline static Record records[MAX_THREADS];
+            inline static std::atomic<size_t> highWater{0}; // records ever claimed: scan [0, highWater)
+
+            static Record &local()
+            {
+                thread_local Holder holder{claim()};
+                return *holder.record;
+            }
+        };
+    }
+
+    // ========================================================================
+    // EPOCH-BASED RECLAMATION
+    // ========================================================================
+
+    class Epoch
+    {
+    private:
+        struct alignas(CACHE_LINE) Record
+        {
+            // (epoch << 1) | 1 while inside a guard, 0 when quiescent
+            std::atomic<uint64_t> state{0};
+            std::atomic<bool> inUse{false};
+            unsigned nesting = 0;
+            unsigned retiresSinceCollect = 0;
+            std::vector<detail::Retired> retired; // epochs are non-decreasing
+            std::atomic<size_t> pending{0};
+
+            void onThreadExit()
+            {
+                Epoch::collect(*this);
+                orphans().add(retired);
+                pending.store(0, std::memory_order_relaxed);
+            }
+        };
+
+        using Registry = detail::ThreadRegistry<Record>;
+
+        // How many retire() calls between attempts to advance and free
+        static constexpr unsigned COLLECT_EVERY = 64;
+
+        inline static std::atomic<uint64_t> globalEpoch{1};
+
+        static detail::OrphanList &orphans()
+        {
+            static detail::OrphanList list;
+            return list;
+        }
+
+        // The epoch may advance only when every thread inside a guard has
+        // already observed the current one
+        static void tryAdvance()
+        {
+            uint64_t e = globalEpoch.load(std::memory_order_seq_cst);
+            size_t n = Registry::highWater.load(std::memory_order_acquire);
+            for (size_t i = 0; i < n; ++i)
+            {
+                uint64_t s = Registry::records[i].state.load(std::memory_order_seq_cst);
+                if ((s & 1) && (s >> 1) != e)
+                    return;
+            }
+            globalEpoch.compare_exchange_strong(e, e + 1, std::memory_order_seq_cst);
+        }
+
+        static void collect(Record &rec)
+        {
+            tryAdvance();
+            if (orphans().adopt(rec.retired))
+                std::stable_sort(rec.retired.begin(), rec.retired.end(),
+                                 [](const detail::Retired &a, const detail::Retired &b)
+                                 { return a.epoch < b.epoch; });
+
+            uint64_t e = globalEpoch.load(std::memory_order_seq_cst);
+            size_t freeable = 0;
+            while (freeable < rec.retired.size() && rec.retired[freeable].epoch + 2 <= e)
+                rec.retired[freeable++].free();
+            rec.retired.erase(rec.retired.begin(), rec.retired.begin() + freeable);
+            rec.pending.store(rec.retired.size(), std::memory_order_relaxed);
+        }
+
+    public:
+        class Guard
+        {
+        private:
+            Record &rec;
+
+        public:
+            Guard() : rec(Registry::local())
+            {
+                if (rec.nesting++ == 0)
+                {
+                    uint64_t e = globalEpoch.load(std::memory_order_relaxed);
+                    rec.state.store((e << 1) | 1, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                }
+            }
+
+            ~Guard()
+            {
+                if (--rec.nesting == 0)
+                    rec.state.store(0, std::memory_order_release);
+            }
+
+            Guard(const Guard &) = delete;
+            Guard &operator=(const Guard &) = delete;
+
+            // EBR protects everything read inside the region: a plain load
+            template <typename T>
+            T *protect(const std::atomic<T *> &src)
+            {
+                return src.load(std::memory_order_acquire);
+            }
+
+            void reset() {}
+        };
+
+        template <typename T>
+        static void retire(T *ptr)
+        {
+            Record &rec = Registry::local();
+            rec.retired.push_back({ptr, &detail::deleteAs<T>, globalEpoch.load(std::memory_order_seq_cst)});
+            rec.pending.store(rec.retired.size(), std::memory_order_relaxed);
+            // Safe even inside a guard: our own region started after anything
+            // old enough to be freed had already been unlinked
+            if (++rec.retiresSinceCollect >= COLLECT_EVERY)
+            {
+                rec.retiresSinceCollect = 0;
+                collect(rec);
+            }
+        }
+
+        // Retired but not yet freed, across all threads (approximate)
+        static size_t pending()
+        {
+            size_t total = orphans().size();
+            size_t n = Registry::highWater.load(std::memory_order_acquire);
+            for (size_t i = 0; i < n; ++i)
+                total += Registry::records[i].pending.load(std::memory_order_relaxed);
+            return total;
+        }
+
+        static const char *name() { return "epoch"; }
+    };
+
+    // ========================================================================
+    // HAZARD POINTERS
+    // ========================================================================
+
+    class Hazard
+    {
+    public:
+        // Guards a thread may hold at the same time
+        static constexpr size_t SLOTS_PER_THREAD = 4;
+
+    private:
+        struct alignas(CACHE_LINE) Record
+        {
+            std::atomic<void *> hazards[SLOTS_PER_THREAD] = {};
+            std::atomic<bool> inUse{false};
+            unsigned slotsUsed = 0; // owner only: guards are strictly nested
+            std::vector<detail::Retired> retired;
+            std::atomic<size_t> pending{0};
+
+            void onThreadExit()
+            {
+                Hazard::scan(*this);
+                orphans().add(retired);
+                pending.store(0, std::memory_order_relaxed);
+            }
+        };
+
+        using Registry = detail::ThreadRegistry<Record>;
+
+        static detail::OrphanList &orphans()
+        {
+            static detail::OrphanList list;
+            return list;
+        }
+
+        // Scan once the list is a constant factor larger than the number of
+        // hazards that could exist: amortized O(1) per retire, bounded garbage
+        static size_t scanThreshold()
+        {
+            return std::max<size_t>(64, 2 * SLOTS_PER_THREAD * Registry::highWater.load(std::memory_order_relaxed));
+        }
+
+        static void scan(Record &rec)
+        {
+            orphans().adopt(rec.retired);
+
+            std::vector<void *> published;
+            size_t n = Registry::highWater.load(std::memory_order_acquire);
+            published.reserve(n * SLOTS_PER_THREAD);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            for (size_t i = 0; i < n; ++i)
+                for (auto &h : Registry::records[i].hazards)
+                    if (void *p = h.load(std::memory_order_acquire))
+                        published.push_back(p);
+            std::sort(published.begin(), published.end());
+
+            auto keep = std::partition(rec.retired.begin(), rec.retired.end(),
+                                       [&](const detail::Retired &r)
+                                       { return std::binary_search(published.begin(), published.end(), r.ptr); });
+            for (auto it = keep; it != rec.retired.end(); ++it)
+                it->free();
+            rec.retired.erase(keep, rec.retired.end());
+            rec.pending.store(rec.retired.size(), std::memory_order_relaxed);
+        }
+
+    public:
+        class Guard
+        {
+        private:
+            Record &rec;
+            std::atomic<void *> &slot;
+
+            static std::atomic<void *> &takeSlot(Record &r)
+            {
+                if (r.slotsUsed == SLOTS_PER_THREAD)
+                    std::terminate(); // more than SLOTS_PER_THREAD live guards on one thread
+                return r.hazards[r.slotsUsed++];
+            }
+
+        public:
+            Guard() : rec(Registry::local()), slot(takeSlot(rec)) {}
+
+            ~Guard()
+            {
+                slot.store(nullptr, std::memory_order_release);
+                --rec.slotsUsed;
+            }
+
+            Guard(const Guard &) = delete;
+            Guard &operator=(const Guard &) = delete;
+
+            // Publish, then re-read: if src still holds p, no retirer can have
+            // missed our hazard, so p stays valid until reset() / destruction
+            template <typename T>
+            T *protect(const std::atomic<T *> &src)
+            {
+                T *p = src.load(std::memory_order_relaxed);
+                while (true)
+                {
+                    slot.store(p, std::memory_order_seq_cst);
+                    T *again = src.load(std::memory_order_seq_cst);
+                    if (again == p)
+                        return p;
+                    p = again;
+                }
+            }
+
+            void reset() { slot.store(nullptr, std::memory_order_release); }
+        };
+
+        template <typename T>
+        static void retire(T *ptr)
+        {
+            Record &rec = Registry::local();
+            rec.retired.push_back({ptr, &detail::deleteAs<T>, 0});
+            rec.pending.store(rec.retired.size(), std::memory_order_relaxed);
+            if (rec.retired.size() >= scanThreshold())
+                scan(rec);
+        }
+
+        static size_t pending()
+        {
+            size_t total = orphans().size();
+            size_t n = Registry::highWater.load(std::memory_order_acquire);
+            for (size_t i = 0; i < n; ++i)
+                total += Registry::records[i].pending.load(std::memory_order_relaxed);
+            return total;
+        }
+
+        static const char *name() { return "hazard"; }
+    };
+}
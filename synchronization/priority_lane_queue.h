@@ -0,0 +1,318 @@
+// priority_lane_queue.h
+// Multi-lane producer-consumer queue: one lock-free sub-queue per priority,
+// weighted fair dequeue across lanes, and deadline-aware dropping.
+//
+// Why not one FIFO (producer_consumer.cpp): a refund or a fraud hold waits
+// behind every bulk notification already queued. Why not strict priority:
+// under sustained load the low lanes never run at all (starvation).
+//
+// Design:
+//   - Each lane is a bounded MPMC ring (Vyukov): producers and consumers
+//     claim cells with one CAS on a position counter; each cell carries a
+//     sequence number that says whose turn it is. No locks, no allocation.
+//   - Weighted fair dequeue: weights {8, 4, 2, 1} are expanded once into an
+//     interleaved schedule (smooth weighted round robin: 0 1 0 2 0 1 0 3 ...).
+//     Every pop takes the next schedule position; if that lane is empty it
+//     falls back to the other lanes in priority order (work-conserving).
+//     When all lanes are backlogged each lane gets weight/sum of the pops, so
+//     even the lowest lane makes progress. Weights {1, 0, 0, 0} = strict priority.
+//   - Deadlines: an item whose deadline has passed when it reaches the front
+//     is dropped (counted per lane) instead of wasting a consumer on it.
+//   - Blocking: waitPop() spins briefly, then sleeps on a condition variable.
+//     Producers only touch the mutex when a consumer is actually asleep.
+//
+// A full lane rejects the push (returns false): backpressure is the caller's
+// decision (retry, shed, or spill), not a hidden unbounded buffer.
+
+#pragma once
+
+#include "stress_points.h"
+
+#include <atomic>
+#include <array>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+
+// ============================================================================
+// BOUNDED MPMC RING (one lane)
+// ============================================================================
+
+template <typename T>
+class MpmcRing
+{
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(CACHE_LINE) std::atomic<size_t> enqueuePos{0};
+    alignas(CACHE_LINE) std::atomic<size_t> dequeuePos{0};
+
+public:
+    explicit MpmcRing(size_t capacity) : mask(capacity - 1), cells(new Cell[capacity])
+    {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0)
+            throw std::invalid_argument("MpmcRing capacity must be a power of two");
+        for (size_t i = 0; i < capacity; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool tryPush(T value)
+    {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell &cell = cells[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    SYNC_STRESS_POINT(); // cell claimed, not yet published
+                    cell.data = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false; // full
+            else
+                pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    bool tryPop(T &out)
+    {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell &cell = cells[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = intptr_t(seq) - intptr_t(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    SYNC_STRESS_POINT(); // cell claimed, not yet read
+                    out = std::move(cell.data);
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false; // empty
+            else
+                pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Approximate under concurrency
+    bool empty() const
+    {
+        return dequeuePos.load(std::memory_order_acquire) >= enqueuePos.load(std::memory_order_acquire);
+    }
+};
+
+// ============================================================================
+// PRIORITY LANE QUEUE
+// ============================================================================
+
+// Lane 0 is the most important. T is the payload; the queue adds the
+// enqueue time and deadline.
+template <typename T, size_t LANES>
+class PriorityLaneQueue
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Item
+    {
+        T value;
+        Clock::time_point enqueued;
+        Clock::time_point deadline;
+    };
+
+    struct LaneStats
+    {
+        uint64_t pushed, popped, dropped, rejected;
+    };
+
+private:
+    struct alignas(64) Counters
+    {
+        std::atomic<uint64_t> pushed{0}, popped{0}, dropped{0}, rejected{0};
+    };
+
+    std::vector<std::unique_ptr<MpmcRing<Item>>> lanes;
+    std::array<Counters, LANES> counters;
+    std::vector<uint8_t> schedule;
+    alignas(64) std::atomic<uint64_t> turn{0};
+
+    std::atomic<bool> closed{false};
+    std::atomic<int> sleepers{0};
+    std::mutex sleepMutex;
+    std::condition_variable wakeup;
+
+    // Smooth weighted round robin: spreads each lane's turns evenly
+    static std::vector<uint8_t> buildSchedule(const std::array<unsigned, LANES> &weights)
+    {
+        unsigned total = 0;
+        for (unsigned w : weights)
+            total += w;
+        if (total == 0)
+            throw std::invalid_argument("At least one lane needs a non-zero weight");
+
+        std::vector<uint8_t> order;
+        std::array<long, LANES> current{};
+        for (unsigned n = 0; n < total; ++n)
+        {
+            size_t best = 0;
+            for (size_t l = 0; l < LANES; ++l)
+            {
+                current[l] += weights[l];
+                if (current[l] > current[best])
+                    best = l;
+            }
+            current[best] -= total;
+            order.push_back(uint8_t(best));
+        }
+        return order;
+    }
+
+    // One pass: scheduled lane first, then the rest in priority order
+    bool tryPopItem(Item &out, size_t &lane)
+    {
+        size_t first = schedule[turn.fetch_add(1, std::memory_order_relaxed) % schedule.size()];
+        for (size_t k = 0; k <= LANES; ++k)
+        {
+            lane = k == 0 ? first : k - 1;
+            if (k != 0 && lane == first)
+                continue;
+            if (lanes[lane]->tryPop(out))
+                return true;
+        }
+        return false;
+    }
+
+    bool anyReady() const
+    {
+        for (auto &l : lanes)
+            if (!l->empty())
+                return true;
+        return false;
+    }
+
+public:
+    // capacityPerLane must be a power of two
+    PriorityLaneQueue(const std::array<unsigned, LANES> &weights, size_t capacityPerLane)
+        : schedule(buildSchedule(weights))
+    {
+        for (size_t l = 0; l < LANES; ++l)
+            lanes.push_back(std::make_unique<MpmcRing<Item>>(capacityPerLane));
+    }
+
+    // Returns false if the lane is full (overload) or the queue is closed
+    bool push(size_t lane, T value, Clock::time_point deadline = Clock::time_point::max())
+    {
+        if (closed.load(std::memory_order_relaxed))
+            return false;
+        if (!lanes[lane]->tryPush(Item{std::move(value), Clock::now(), deadline}))
+        {
+            counters[lane].rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        counters[lane].pushed.fetch_add(1, std::memory_order_relaxed);
+        SYNC_STRESS_POINT(); // published; a consumer may be going to sleep now
+        // Pairs with the sleeper's increment-then-check: one side sees the other
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            wakeup.notify_one();
+        }
+        return true;
+    }
+
+    // Non-blocking; skips (and counts) expired items
+    bool tryPop(Item &out, size_t &lane)
+    {
+        while (tryPopItem(out, lane))
+        {
+            if (out.deadline < Clock::now())
+            {
+                counters[lane].dropped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            counters[lane].popped.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    // Blocks until an item is available; returns false once closed and drained
+    bool waitPop(Item &out, size_t &lane)
+    {
+        while (true)
+        {
+            for (int spin = 0; spin < 64; ++spin)
+            {
+                if (tryPop(out, lane))
+                    return true;
+                std::this_thread::yield();
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepers.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            SYNC_STRESS_POINT(); // announced, not yet re-checked the lanes
+            wakeup.wait(lock, [this]
+                        { return anyReady() || closed.load(std::memory_order_acquire); });
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+            lock.unlock();
+            if (tryPop(out, lane))
+                return true;
+            if (closed.load(std::memory_order_acquire) && !anyReady())
+                return false;
+        }
+    }
+
+    // Payload-only form for consumer() loops that do not care about lanes
+    bool waitPop(T &out)
+    {
+        Item item;
+        size_t lane;
+        if (!waitPop(item, lane))
+            return false;
+        out = std::move(item.value);
+        return true;
+    }
+
+    // Producers are done: consumers drain what is left, then waitPop() returns false
+    void close()
+    {
+        closed.store(true, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wakeup.notify_all();
+    }
+
+    LaneStats stats(size_t lane) const
+    {
+        const Counters &c = counters[lane];
+        return {c.pushed.load(), c.popped.load(), c.dropped.load(), c.rejected.load()};
+    }
+
+    const std::vector<uint8_t> &scheduleOrder() const { return schedule; }
+};
@@ -0,0 +1,202 @@
+// priority_lanes.cpp
+// producer_consumer_advanced.cpp with priority classes, under overload:
+// one FIFO vs strict priority vs weighted fair lanes (priority_lane_queue.h).
+//
+// Build: make FILE=priority_lanes.cpp CXXFLAGS="-std=c++17 -O2 -Wall -Wextra -pthread" run
+// Args:  ./program [ms_per_run] [overload_factor]    (defaults: 1000 ms, 1.5)
+//
+// Jobs: fraud holds / refunds (lane 0), payments (1), order notifications (2),
+// bulk marketing (3), arriving 10/30/40/20 %. Each lane has a deadline; a job
+// still queued past it is dropped. Producers offer overload_factor x what the
+// consumers can process, so something MUST give - the policy decides what.
+//
+// Expect:
+//   FIFO      - every lane waits behind everything: refunds miss deadlines too.
+//   strict    - lanes 0-1 are instant, but bulk starves: it mostly runs in the
+//               drain after producers stop (look at its p50).
+//   weighted  - lanes 0-1 stay fast, and bulk still gets its 1/15 share
+//               while the overload lasts; order notify absorbs the shedding.
+
+#include "priority_lane_queue.h"
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <string>
+#include <cstdlib>
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+const int NUM_PRODUCERS = 2;
+const int NUM_CONSUMERS = 2;
+const size_t LANES = 4;
+const array<const char *, LANES> LANE_NAMES = {"fraud/refund", "payment", "order notify", "bulk"};
+const array<int, LANES> ARRIVAL_PERCENT = {10, 30, 40, 20};
+const array<chrono::milliseconds, LANES> DEADLINE = {chrono::milliseconds(20), chrono::milliseconds(50),
+                                                     chrono::milliseconds(200), chrono::milliseconds(1000)};
+const chrono::microseconds SERVICE_TIME(20);
+
+struct Job
+{
+    uint8_t priority = 0; // the job's class, whatever lane layout the queue uses
+};
+
+// Simulated work: busy so it costs CPU like real processing
+void process(const Job &)
+{
+    auto until = Clock::now() + SERVICE_TIME;
+    while (Clock::now() < until)
+    {
+    }
+}
+
+struct RunStats
+{
+    array<uint64_t, LANES> offered{}, accepted{}, served{};
+    array<vector<double>, LANES> latencyMs;
+};
+
+template <size_t QLANES>
+RunStats run(const array<unsigned, QLANES> &weights, bool laneByPriority, double ratePerSec, chrono::milliseconds duration)
+{
+    PriorityLaneQueue<Job, QLANES> queue(weights, 4096);
+    RunStats stats;
+    array<atomic<uint64_t>, LANES> offered{}, accepted{};
+    vector<RunStats> perConsumer(NUM_CONSUMERS);
+
+    // The existing consumer() loop shape: wait, process, repeat until closed
+    auto consumer = [&](int id)
+    {
+        typename PriorityLaneQueue<Job, QLANES>::Item item;
+        size_t lane;
+        while (queue.waitPop(item, lane))
+        {
+            double waited = chrono::duration<double, milli>(Clock::now() - item.enqueued).count();
+            process(item.value);
+            perConsumer[id].served[item.value.priority]++;
+            perConsumer[id].latencyMs[item.value.priority].push_back(waited);
+        }
+    };
+
+    // Open-loop producers: a batch every millisecond, regardless of backlog
+    atomic<bool> stop{false};
+    auto producer = [&](int id)
+    {
+        mt19937 rng(id + 1);
+        double perTick = ratePerSec / 1000.0 / NUM_PRODUCERS, carry = 0;
+        auto tick = Clock::now();
+        while (!stop.load(memory_order_relaxed))
+        {
+            carry += perTick;
+            for (; carry >= 1; carry -= 1)
+            {
+                int r = int(rng() % 100), p = 0;
+                while (r >= ARRIVAL_PERCENT[p])
+                    r -= ARRIVAL_PERCENT[p++];
+                Job job{uint8_t(p)};
+                offered[p]++;
+                if (queue.push(laneByPriority ? p : 0, job, Clock::now() + DEADLINE[p]))
+                    accepted[p]++;
+            }
+            tick += chrono::milliseconds(1);
+            this_thread::sleep_until(tick);
+        }
+    };
+
+    vector<thread> producers, consumers;
+    for (int i = 0; i < NUM_CONSUMERS; ++i)
+        consumers.emplace_back(consumer, i);
+    for (int i = 0; i < NUM_PRODUCERS; ++i)
+        producers.emplace_back(producer, i);
+    this_thread::sleep_for(duration);
+    stop = true;
+    for (auto &t : producers)
+        t.join();
+    queue.close(); // consumers drain the backlog; expired jobs are dropped
+    for (auto &t : consumers)
+        t.join();
+
+    for (size_t p = 0; p < LANES; ++p)
+    {
+        stats.offered[p] = offered[p];
+        stats.accepted[p] = accepted[p];
+        for (auto &c : perConsumer)
+        {
+            stats.served[p] += c.served[p];
+            stats.latencyMs[p].insert(stats.latencyMs[p].end(), c.latencyMs[p].begin(), c.latencyMs[p].end());
+        }
+        sort(stats.latencyMs[p].begin(), stats.latencyMs[p].end());
+    }
+    return stats;
+}
+
+double percentile(const vector<double> &sorted, double q)
+{
+    return sorted.empty() ? 0.0 : sorted[min(sorted.size() - 1, size_t(q * sorted.size()))];
+}
+
+void report(const string &policy, const RunStats &s)
+{
+    cout << "\n"
+         << policy << "\n";
+    cout << setw(14) << "lane" << setw(10) << "offered" << setw(10) << "served" << setw(12) << "rejected"
+         << setw(12) << "deadline" << setw(11) << "p50 ms" << setw(11) << "p99 ms" << endl;
+    for (size_t p = 0; p < LANES; ++p)
+    {
+        cout << setw(14) << LANE_NAMES[p] << setw(10) << s.offered[p] << setw(10) << s.served[p]
+             << setw(12) << s.offered[p] - s.accepted[p] << setw(12) << s.accepted[p] - s.served[p]
+             << fixed << setprecision(2) << setw(11) << percentile(s.latencyMs[p], 0.50)
+             << setw(11) << percentile(s.latencyMs[p], 0.99) << endl;
+    }
+}
+
+// Jobs per second the consumers can actually sustain on this machine
+double measureCapacity()
+{
+    PriorityLaneQueue<Job, 1> queue({1}, 8192);
+    for (int i = 0; i < 8000; ++i)
+        queue.push(0, Job{});
+    queue.close();
+    auto start = Clock::now();
+    vector<thread> consumers;
+    for (int i = 0; i < NUM_CONSUMERS; ++i)
+        consumers.emplace_back([&]
+                               { Job job; while (queue.waitPop(job)) process(job); });
+    for (auto &t : consumers)
+        t.join();
+    return 8000 / chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    chrono::milliseconds duration(argc > 1 ? atoi(argv[1]) : 1000);
+    double overload = argc > 2 ? atof(argv[2]) : 1.5;
+
+    double capacity = measureCapacity();
+    double rate = capacity * overload;
+    cout << "--- Priority lanes under overload ---" << endl;
+    cout << NUM_CONSUMERS << " consumers, " << SERVICE_TIME.count() << " us per job, capacity ~"
+         << size_t(capacity) << " jobs/s; offering " << size_t(rate) << " jobs/s for " << duration.count() << " ms" << endl;
+    cout << "Deadlines (ms):";
+    for (size_t p = 0; p < LANES; ++p)
+        cout << " " << LANE_NAMES[p] << "=" << DEADLINE[p].count();
+    cout << "\nrejected = lane full at push; deadline = accepted but expired before a consumer got to it" << endl;
+
+    report("FIFO (single queue, like producer_consumer.cpp)", run<1>({1}, false, rate, duration));
+    report("Strict priority (weights 1:0:0:0)", run<LANES>({1, 0, 0, 0}, true, rate, duration));
+
+    PriorityLaneQueue<Job, LANES> weighted({8, 4, 2, 1}, 2);
+    cout << "\nWeighted schedule:";
+    for (uint8_t lane : weighted.scheduleOrder())
+        cout << " " << int(lane);
+    cout << endl;
+    report("Weighted fair (weights 8:4:2:1)", run<LANES>({8, 4, 2, 1}, true, rate, duration));
+    return 0;
+}
@@ -0,0 +1,258 @@
+// rate_limiter.h
+// Per-client rate limiting for the request path that traffic_counter.cpp
+// only counts.
+//
+//   TokenBucket       - lock-free; the whole bucket is ONE atomic 64-bit word:
+//                         [ tokens : 24 bits, 8 of them fractional | last refill : 40 bits of us ]
+//                       A decision is one load + one CAS. A denied request
+//                       writes nothing, so a client hammering past its limit
+//                       does not bounce the cache line between cores.
+//   SlidingWindowLog  - exact "at most N requests in any window W": keeps the
+//                       last N request timestamps in a ring. Precise, but
+//                       O(N) memory per key and a mutex per decision.
+//   RateLimiterTable  - sharded client-id -> limiter table. Lookups take a
+//                       shard's shared lock; only a client's FIRST request
+//                       takes it exclusively. sweep() evicts idle clients.
+//
+// Eviction is lossless for token buckets: a bucket idle long enough to be
+// full again is indistinguishable from a brand new one.
+//
+// Time is passed in explicitly (microseconds since the limiter's start) so
+// callers can read the clock once per batch, and tests can drive it.
+
+#pragma once
+
+#include "spin_locks.h"
+
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+
+namespace ratelimit
+{
+    using Micros = uint64_t;
+
+    // Microseconds since the first call (fits the 40-bit timestamp for ~12 days
+    // of process uptime per wrap; deltas are computed modulo 2^40)
+    inline Micros nowMicros()
+    {
+        using namespace std::chrono;
+        static const steady_clock::time_point start = steady_clock::now();
+        return Micros(duration_cast<microseconds>(steady_clock::now() - start).count());
+    }
+
+    struct Limit
+    {
+        uint32_t ratePerSec; // sustained rate
+        uint32_t burst;      // bucket size / requests per window
+    };
+
+    // ========================================================================
+    // TOKEN BUCKET (single 64-bit atomic)
+    // ========================================================================
+
+    class TokenBucket
+    {
+    private:
+        static constexpr int TIME_BITS = 40;
+        static constexpr uint64_t TIME_MASK = (uint64_t(1) << TIME_BITS) - 1;
+        static constexpr uint64_t ONE = 256; // 8 fractional bits
+        static constexpr uint64_t MAX_TOKENS_FP = (uint64_t(1) << (64 - TIME_BITS)) - 1;
+
+        std::atomic<uint64_t> state;
+
+        static uint64_t pack(uint64_t tokensFp, Micros t) { return (tokensFp << TIME_BITS) | (t & TIME_MASK); }
+
+        // Tokens (fixed point) and refill timestamp as of `now`
+        static void refill(uint64_t s, Micros now, const Limit &limit, uint64_t &tokensFp, Micros &last)
+        {
+            tokensFp = s >> TIME_BITS;
+            last = s & TIME_MASK;
+            uint64_t capFp = uint64_t(limit.burst) * ONE;
+            uint64_t elapsed = (now - last) & TIME_MASK;
+            if (elapsed > TIME_MASK / 2)
+                elapsed = 0; // our `now` was read before another thread's refill
+            uint64_t perSecFp = uint64_t(limit.ratePerSec) * ONE;
+            uint64_t fillTime = (capFp - std::min(tokensFp, capFp)) * 1000000 / perSecFp + 1;
+            if (elapsed >= fillTime)
+            {
+                tokensFp = capFp;
+                last = now & TIME_MASK;
+                return;
+            }
+            uint64_t added = elapsed * perSecFp / 1000000;
+            // Advance the clock only by the time actually converted into
+            // tokens, so frequent polling never loses fractional progress
+            tokensFp += added;
+            last = (last + added * 1000000 / perSecFp) & TIME_MASK;
+        }
+
+    public:
+        TokenBucket(const Limit &limit, Micros now) : state(pack(uint64_t(limit.burst) * ONE, now))
+        {
+            if (uint64_t(limit.burst) * ONE > MAX_TOKENS_FP || limit.ratePerSec == 0)
+                throw std::invalid_argument("TokenBucket: burst must be < 65536 and rate > 0");
+        }
+
+        bool tryAcquire(const Limit &limit, Micros now, uint32_t cost = 1)
+        {
+            uint64_t s = state.load(std::memory_order_relaxed);
+            while (true)
+            {
+                uint64_t tokensFp;
+                Micros last;
+                refill(s, now, limit, tokensFp, last);
+                if (tokensFp < cost * ONE)
+                    return false; // read-only denial
+                if (state.compare_exchange_weak(s, pack(tokensFp - cost * ONE, last), std::memory_order_relaxed))
+                    return true;
+            }
+        }
+
+        // Full again: evicting it changes nothing
+        bool idle(const Limit &limit, Micros now) const
+        {
+            uint64_t tokensFp;
+            Micros last;
+            refill(state.load(std::memory_order_relaxed), now, limit, tokensFp, last);
+            return tokensFp >= uint64_t(limit.burst) * ONE;
+        }
+    };
+
+    // ========================================================================
+    // SLIDING WINDOW LOG
+    // ========================================================================
+
+    // At most `burst` requests in any window of burst/ratePerSec seconds
+    class SlidingWindowLog
+    {
+    private:
+        std::mutex lock; // one per client: keep it small
+        uint32_t head = 0, count = 0;
+        std::unique_ptr<Micros[]> log; // ring of the last `burst` accepted timestamps
+
+        static Micros window(const Limit &limit) { return Micros(limit.burst) * 1000000 / limit.ratePerSec; }
+
+        // Before the ring is sized: burst 0 would make every index `% 0`
+        static const Limit &checked(const Limit &limit)
+        {
+            if (limit.burst == 0 || limit.ratePerSec == 0)
+                throw std::invalid_argument("SlidingWindowLog: burst and rate must be > 0");
+            return limit;
+        }
+
+    public:
+        SlidingWindowLog(const Limit &limit, Micros) : log(new Micros[checked(limit).burst]) {}
+
+        bool tryAcquire(const Limit &limit, Micros now, uint32_t = 1)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            Micros w = window(limit);
+            // Expire entries older than the window (oldest first)
+            while (count > 0 && now >= log[head] && now - log[head] >= w)
+            {
+                head = (head + 1) % limit.burst;
+                --count;
+            }
+            if (count == limit.burst)
+                return false;
+            log[(head + count) % limit.burst] = now;
+            ++count;
+            return true;
+        }
+
+        bool idle(const Limit &limit, Micros now)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (count == 0)
+                return true;
+            Micros newest = log[(head + count - 1) % limit.burst];
+            return now >= newest && now - newest >= window(limit);
+        }
+    };
+
+    // ========================================================================
+    // SHARDED CLIENT TABLE
+    // ========================================================================
+
+    template <typename Limiter>
+    class RateLimiterTable
+    {
+    private:
+        struct alignas(spin::CACHE_LINE) Shard
+        {
+            std::shared_mutex rw;
+            std::unordered_map<uint64_t, std::unique_ptr<Limiter>> clients;
+        };
+
+        Limit limit;
+        std::vector<Shard> shards;
+
+        Shard &shardFor(uint64_t client)
+        {
+            // Mix the id so sequential ids spread over shards
+            uint64_t h = client * 0x9E3779B97F4A7C15ull;
+            return shards[(h >> 32) % shards.size()];
+        }
+
+    public:
+        RateLimiterTable(Limit l, size_t shardCount = 1024) : limit(l), shards(shardCount) {}
+
+        bool allow(uint64_t client, Micros now = nowMicros())
+        {
+            Shard &shard = shardFor(client);
+            {
+                std::shared_lock<std::shared_mutex> read(shard.rw);
+                auto it = shard.clients.find(client);
+                if (it != shard.clients.end())
+                    return it->second->tryAcquire(limit, now);
+            }
+            // First request from this client (or it was evicted while idle)
+            std::unique_lock<std::shared_mutex> write(shard.rw);
+            auto &slot = shard.clients[client];
+            if (!slot)
+                slot = std::make_unique<Limiter>(limit, now);
+            return slot->tryAcquire(limit, now);
+        }
+
+        // Drops idle clients; one shard locked at a time. Returns how many.
+        size_t sweep(Micros now = nowMicros())
+        {
+            size_t evicted = 0;
+            for (Shard &shard : shards)
+            {
+                std::unique_lock<std::shared_mutex> write(shard.rw);
+                for (auto it = shard.clients.begin(); it != shard.clients.end();)
+                {
+                    if (it->second->idle(limit, now))
+                    {
+                        it = shard.clients.erase(it);
+                        ++evicted;
+                    }
+                    else
+                        ++it;
+                }
+            }
+            return evicted;
+        }
+
+        size_t size()
+        {
+            size_t n = 0;
+            for (Shard &shard : shards)
+            {
+                std::shared_lock<std::shared_mutex> read(shard.rw);
+                n += shard.clients.size();
+            }
+            return n;
+        }
+    };
+}
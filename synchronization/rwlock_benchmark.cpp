@@ -0,0 +1,128 @@
+// rwlock_benchmark.cpp
+// Telemetry from sync_shared_mutex.cpp under a read/write ratio sweep:
+// std::shared_mutex vs BravoRwLock (bravo_rwlock.h).
+//
+// Build: make FILE=rwlock_benchmark.cpp CXXFLAGS="-std=c++17 -O2 -Wall -Wextra -pthread" run
+// Args:  ./program [threads] [ms_per_run]     (defaults: hardware threads x2 (min 4), 200 ms)
+//
+// Each op is either read() (shared lock) or write() (exclusive lock). The
+// writer updates two fields together; readers check they always match, which
+// proves readers never observe a half-finished write.
+//
+// Expect: BRAVO wins big at 100:0 .. 99:1 on multi-core machines, the gap
+// closes around 90:10, and std::shared_mutex wins write-heavy mixes because
+// every BRAVO writer scans all reader slots.
+
+#include "bravo_rwlock.h"
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+
+using namespace std;
+
+template <typename RwLock>
+class Telemetry
+{
+public:
+    void write(long newValue)
+    {
+        lock_guard<RwLock> lock(rw);
+        a = newValue;
+        b = newValue;
+    }
+
+    // Returns false if a torn write was observed (must never happen)
+    bool read(long &out) const
+    {
+        shared_lock<RwLock> lock(rw);
+        out = a;
+        return a == b;
+    }
+
+private:
+    mutable RwLock rw;
+    long a = 0, b = 0;
+};
+
+struct Result
+{
+    double mops;
+    bool consistent;
+};
+
+template <typename RwLock>
+Result run(int threads, int readPercent, chrono::milliseconds duration)
+{
+    Telemetry<RwLock> telemetry;
+    atomic<bool> start{false}, stop{false}, consistent{true};
+    atomic<long> ops{0};
+    vector<thread> workers;
+
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&, t]()
+                             {
+            mt19937 rng(t + 1);
+            while (!start.load(memory_order_acquire))
+                this_thread::yield();
+            long mine = 0, value = 0;
+            bool ok = true;
+            while (!stop.load(memory_order_relaxed))
+            {
+                if (int(rng() % 100) < readPercent)
+                    ok &= telemetry.read(value);
+                else
+                    telemetry.write(mine);
+                ++mine;
+            }
+            if (!ok)
+                consistent = false;
+            ops.fetch_add(mine); });
+    }
+
+    auto begin = chrono::steady_clock::now();
+    start.store(true, memory_order_release);
+    this_thread::sleep_for(duration);
+    stop = true;
+    for (auto &w : workers)
+        w.join();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    return {ops.load() / secs / 1e6, consistent.load()};
+}
+
+int main(int argc, char **argv)
+{
+    int hw = int(thread::hardware_concurrency());
+    int threads = argc > 1 ? atoi(argv[1]) : max(4, hw * 2);
+    chrono::milliseconds duration(argc > 2 ? atoi(argv[2]) : 200);
+
+    cout << "--- Reader/writer ratio sweep: std::shared_mutex vs BravoRwLock ---" << endl;
+    cout << threads << " threads on " << hw << " hardware threads, " << duration.count() << " ms per run" << endl;
+    cout << "BravoRwLock footprint: " << sizeof(BravoRwLock) << " bytes (std::shared_mutex: "
+         << sizeof(shared_mutex) << ")\n\n";
+
+    cout << setw(10) << "read:write" << setw(22) << "shared_mutex Mops/s" << setw(20) << "BRAVO Mops/s"
+         << setw(10) << "ratio" << endl;
+
+    bool allConsistent = true;
+    for (int readPct : {100, 99, 95, 90, 75, 50})
+    {
+        Result base = run<shared_mutex>(threads, readPct, duration);
+        Result bravo = run<BravoRwLock>(threads, readPct, duration);
+        allConsistent &= base.consistent && bravo.consistent;
+        cout << setw(6) << readPct << ":" << setw(3) << left << 100 - readPct << right
+             << fixed << setprecision(2) << setw(22) << base.mops << setw(20) << bravo.mops
+             << setw(9) << bravo.mops / base.mops << "x" << endl;
+    }
+
+    cout << "\nNo torn reads observed: " << (allConsistent ? "yes" : "NO") << endl;
+    return allConsistent ? 0 : 1;
+}
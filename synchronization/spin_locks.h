@@ -0,0 +1,303 @@
+// spin_locks.h
+// Lock implementations for SHORT critical sections (e.g. `so += 2` in
+// sync_mutex.cpp). All of them satisfy the Lockable requirements
+// (lock / try_lock / unlock), so lock_guard / unique_lock / scoped_lock work.
+//
+//   TicketLock     - FIFO "take a number" spinlock; simple and fair, but every
+//                    waiter spins on the SAME cache line (now_serving), so each
+//                    release invalidates that line in every waiting core.
+//   AdaptiveMutex  - spin-then-park: bounded spin with pause + exponential
+//                    backoff, then sleep in the kernel on a futex. The spin
+//                    budget adapts to how long the lock is usually held.
+//   McsLock        - MCS queue lock: waiters form a linked list and each one
+//                    spins on ITS OWN node. A release touches exactly one
+//                    other cache line (the successor's). FIFO => fair.
+//
+// Why std::mutex can lose here: once contended, glibc's default mutex parks
+// in the kernel (futex syscall ~100s of ns + a context switch) even though the
+// holder will release the lock a few nanoseconds later.
+//
+// Oversubscription caveat: pure spinning is only sane when #threads <= #cores.
+// A FIFO lock handed to a thread that is NOT running stalls every waiter
+// behind it ("lock-waiter preemption"). TicketLock and McsLock therefore fall
+// back to yield() after a spin budget; AdaptiveMutex parks on a futex.
+//
+// Linux-only: futex(2) via syscall().
+//
+// SYNC_STRESS_POINT() marks the race windows for stress_test.cpp; it compiles
+// to nothing unless built with -DSYNC_STRESS (see stress_points.h).
+
+#pragma once
+
+#include "stress_points.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <climits>
+#include <algorithm>
+#include <exception>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace spin
+{
+    constexpr size_t CACHE_LINE = 64;
+
+    // PAUSE tells the core "this is a spin-wait": saves power, frees pipeline
+    // resources for the sibling hyperthread, avoids a memory-order flush on exit.
+    inline void cpuRelax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield" ::: "memory");
+#endif
+    }
+
+    inline void futexWait(std::atomic<int> *addr, int expected)
+    {
+        syscall(SYS_futex, reinterpret_cast<int *>(addr), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+    }
+
+    inline void futexWake(std::atomic<int> *addr, int count)
+    {
+        syscall(SYS_futex, reinterpret_cast<int *>(addr), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+    }
+
+    // Spin with exponential backoff, yielding once the budget is exhausted
+    class Backoff
+    {
+    private:
+        uint32_t pauses = 1;
+        uint32_t spins = 0;
+        static constexpr uint32_t MAX_PAUSES = 64;
+        static constexpr uint32_t YIELD_AFTER = 128;
+
+    public:
+        void wait()
+        {
+            if (++spins > YIELD_AFTER)
+            {
+                std::this_thread::yield();
+                return;
+            }
+            for (uint32_t i = 0; i < pauses; ++i)
+                cpuRelax();
+            if (pauses < MAX_PAUSES)
+                pauses <<= 1;
+        }
+    };
+}
+
+// ============================================================================
+// TICKET LOCK
+// ============================================================================
+
+class TicketLock
+{
+private:
+    alignas(spin::CACHE_LINE) std::atomic<uint32_t> nextTicket{0};
+    alignas(spin::CACHE_LINE) std::atomic<uint32_t> nowServing{0};
+
+public:
+    void lock()
+    {
+        uint32_t my = nextTicket.fetch_add(1, std::memory_order_relaxed);
+        SYNC_STRESS_POINT(); // holding a ticket, not yet watching nowServing
+        uint32_t spins = 0;
+        while (true)
+        {
+            uint32_t serving = nowServing.load(std::memory_order_acquire);
+            if (serving == my)
+                return;
+            // Proportional backoff: the further back in line, the longer we wait
+            if (++spins > 128)
+                std::this_thread::yield();
+            else
+                for (uint32_t i = 0; i < (my - serving) * 8; ++i)
+                    spin::cpuRelax();
+        }
+    }
+
+    bool try_lock()
+    {
+        uint32_t serving = nowServing.load(std::memory_order_acquire);
+        uint32_t expected = serving;
+        return nextTicket.compare_exchange_strong(expected, serving + 1, std::memory_order_acquire,
+                                                  std::memory_order_relaxed);
+    }
+
+    void unlock()
+    {
+        nowServing.store(nowServing.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+};
+
+// ============================================================================
+// ADAPTIVE SPIN-THEN-PARK MUTEX (futex based)
+// ============================================================================
+
+// state: 0 = unlocked, 1 = locked (no waiters), 2 = locked (maybe waiters)
+class AdaptiveMutex
+{
+private:
+    alignas(spin::CACHE_LINE) std::atomic<int> state{0};
+    // Running estimate of a useful spin budget (like glibc's ADAPTIVE_NP mutex)
+    std::atomic<int> spinEstimate{64};
+    static constexpr int MAX_SPIN = 1000;
+
+    bool spinAcquire()
+    {
+        int limit = std::min(MAX_SPIN, spinEstimate.load(std::memory_order_relaxed) * 2 + 10);
+        uint32_t pauses = 1;
+        for (int i = 0; i < limit; ++i)
+        {
+            int expected = 0;
+            // Test before test-and-set: read-only spinning keeps the line Shared
+            if (state.load(std::memory_order_relaxed) == 0 &&
+                state.compare_exchange_weak(expected, 1, std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                int est = spinEstimate.load(std::memory_order_relaxed);
+                spinEstimate.store(est + (i - est) / 8, std::memory_order_relaxed);
+                return true;
+            }
+            for (uint32_t p = 0; p < pauses; ++p)
+                spin::cpuRelax();
+            if (pauses < 32)
+                pauses <<= 1;
+        }
+        int est = spinEstimate.load(std::memory_order_relaxed);
+        spinEstimate.store(est + (MAX_SPIN - est) / 8, std::memory_order_relaxed);
+        return false;
+    }
+
+public:
+    void lock()
+    {
+        int expected = 0;
+        if (state.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed))
+            return; // uncontended fast path: one CAS, no syscall
+        if (spinAcquire())
+            return;
+        SYNC_STRESS_POINT(); // about to park: the holder may release right now
+        // Park: mark "waiters present" and sleep until the value changes
+        while (state.exchange(2, std::memory_order_acquire) != 0)
+            spin::futexWait(&state, 2);
+    }
+
+    bool try_lock()
+    {
+        int expected = 0;
+        return state.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock()
+    {
+        // 1 -> 0: nobody parked, no syscall. 2 -> 0: wake one sleeper.
+        if (state.exchange(0, std::memory_order_release) == 2)
+        {
+            SYNC_STRESS_POINT(); // released, waiter not woken yet
+            spin::futexWake(&state, 1);
+        }
+    }
+};
+
+// ============================================================================
+// MCS QUEUE LOCK
+// ============================================================================
+
+// Each waiter enqueues a node and spins on node->locked; the holder hands the
+// lock to its successor directly. To keep the Lockable interface (no node
+// argument), nodes come from a small per-thread pool and the holder's node is
+// remembered in the lock itself (only the holder reads/writes it).
+class McsLock
+{
+private:
+    struct alignas(spin::CACHE_LINE) Node
+    {
+        std::atomic<Node *> next{nullptr};
+        std::atomic<bool> locked{false};
+        bool inUse = false;
+    };
+
+    // Enough for a thread holding this many MCS locks at the same time
+    static constexpr int NODES_PER_THREAD = 8;
+
+    static Node *acquireNode()
+    {
+        thread_local Node pool[NODES_PER_THREAD];
+        for (Node &n : pool)
+        {
+            if (!n.inUse)
+            {
+                n.inUse = true;
+                return &n;
+            }
+        }
+        std::terminate(); // nesting deeper than NODES_PER_THREAD MCS locks
+    }
+
+    alignas(spin::CACHE_LINE) std::atomic<Node *> tail{nullptr};
+    Node *holder = nullptr;
+
+public:
+    void lock()
+    {
+        Node *me = acquireNode();
+        me->next.store(nullptr, std::memory_order_relaxed);
+        me->locked.store(true, std::memory_order_relaxed);
+
+        Node *prev = tail.exchange(me, std::memory_order_acq_rel);
+        if (prev)
+        {
+            SYNC_STRESS_POINT(); // in the queue, but prev cannot see us yet
+            prev->next.store(me, std::memory_order_release);
+            spin::Backoff backoff;
+            while (me->locked.load(std::memory_order_acquire))
+                backoff.wait(); // spinning on OUR node only: no shared-line traffic
+        }
+        holder = me;
+    }
+
+    bool try_lock()
+    {
+        Node *me = acquireNode();
+        me->next.store(nullptr, std::memory_order_relaxed);
+        Node *expected = nullptr;
+        if (tail.compare_exchange_strong(expected, me, std::memory_order_acq_rel))
+        {
+            holder = me;
+            return true;
+        }
+        me->inUse = false;
+        return false;
+    }
+
+    void unlock()
+    {
+        Node *me = holder;
+        Node *succ = me->next.load(std::memory_order_acquire);
+        if (!succ)
+        {
+            Node *expected = me;
+            if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel))
+            {
+                me->inUse = false;
+                return; // no one waiting
+            }
+            // A successor swapped tail but has not linked itself yet. It may
+            // have been preempted right there: back off to yield, not just pause.
+            spin::Backoff backoff;
+            while (!(succ = me->next.load(std::memory_order_acquire)))
+                backoff.wait();
+        }
+        succ->locked.store(false, std::memory_order_release);
+        me->inUse = false;
+    }
+};
@@ -0,0 +1,173 @@
+// stress_harness.h
+// Runs a concurrent scenario many times under different schedules and checks
+// its invariants, reporting throughput from the same code.
+//
+// One scenario run (runThreads):
+//   - threads are created in a seed-permuted order and pinned to a
+//     seed-permuted CPU (sched_setaffinity; with fewer CPUs than threads,
+//     several share one - which forces preemption inside critical sections)
+//   - all of them wait at a start gate and are released together
+//   - each thread gets its own fuzz stream (stress_points.h), so
+//     stress::point() in the test body and SYNC_STRESS_POINT() inside the
+//     implementations inject spins / yields / sleeps reproducibly per seed
+//
+// Suite::run(name, ...) does one clean run (no injection, full iterations)
+// for ops/sec, then `seeds` fuzzed runs with seeds 1..N; all of them are
+// checked. A failing run prints its seed; pass
+// that seed back (stress_test.cpp's third argument) to replay it.
+//
+// A scenario returns an Outcome: ok + a message describing the first
+// violated invariant (lost item, duplicate, count mismatch, exclusion broken).
+
+#pragma once
+
+#include "stress_points.h"
+
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <string>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <sched.h>
+#include <pthread.h>
+
+namespace stress
+{
+    struct RunConfig
+    {
+        int threads = 4;
+        uint64_t seed = 0;
+        uint32_t permille = 0; // injection chance per point; 0 = clean run
+        size_t iterations = 0; // per thread, scenario-defined
+    };
+
+    struct Outcome
+    {
+        bool ok = true;
+        std::string failure;
+        uint64_t ops = 0;
+        double seconds = 0;
+
+        void fail(const std::string &why)
+        {
+            if (ok)
+                failure = why;
+            ok = false;
+        }
+    };
+
+    inline std::vector<int> allowedCpus()
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        std::vector<int> cpus;
+        if (sched_getaffinity(0, sizeof(set), &set) == 0)
+            for (int c = 0; c < CPU_SETSIZE; ++c)
+                if (CPU_ISSET(c, &set))
+                    cpus.push_back(c);
+        if (cpus.empty())
+            cpus.push_back(0);
+        return cpus;
+    }
+
+    // Runs body(threadIndex) on cfg.threads threads; returns wall seconds
+    // from the gate opening until the last thread finishes
+    inline double runThreads(const RunConfig &cfg, const std::function<void(int)> &body)
+    {
+        static const std::vector<int> cpus = allowedCpus();
+        std::mt19937_64 rng(cfg.seed * 7919 + 1);
+        std::vector<int> order(cfg.threads), cpuOf(cfg.threads);
+        for (int i = 0; i < cfg.threads; ++i)
+        {
+            order[i] = i;
+            cpuOf[i] = cpus[i % cpus.size()];
+        }
+        if (cfg.seed != 0)
+        {
+            std::shuffle(order.begin(), order.end(), rng);
+            std::shuffle(cpuOf.begin(), cpuOf.end(), rng);
+        }
+
+        std::atomic<int> ready{0};
+        std::atomic<bool> go{false};
+        std::vector<std::thread> workers;
+        for (int i : order)
+        {
+            workers.emplace_back([&, i]()
+                                 {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpuOf[i], &set);
+                pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+                bind(cfg.seed, uint32_t(i), cfg.permille);
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+                body(i);
+                unbind(); });
+        }
+        while (ready.load() < cfg.threads)
+            std::this_thread::yield();
+        auto start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        for (auto &w : workers)
+            w.join();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    class Suite
+    {
+    private:
+        int seeds;
+        uint32_t permille;
+        uint64_t onlySeed;
+        int unexpected = 0;
+
+    public:
+        // onlySeed != 0: skip the sweep and replay just that seed
+        Suite(int seedCount, uint32_t injectPermille, uint64_t replaySeed = 0)
+            : seeds(seedCount), permille(injectPermille), onlySeed(replaySeed)
+        {
+            std::cout << std::left << std::setw(40) << "scenario" << std::right << std::setw(14) << "clean ops/s"
+                      << std::setw(8) << "runs" << std::setw(10) << "failed" << "  first failure" << std::endl;
+        }
+
+        // scenario(cfg) performs one run; expectFailure marks a deliberately
+        // broken variant that the harness must catch
+        void run(const std::string &name, int threads, size_t iterations, bool expectFailure,
+                 const std::function<Outcome(const RunConfig &)> &scenario)
+        {
+            Outcome clean = scenario(RunConfig{threads, 0, 0, iterations});
+            int failed = clean.ok ? 0 : 1, runs = 1;
+            std::string first = clean.ok ? "" : "clean run: " + clean.failure;
+            for (int s = 1; s <= seeds; ++s)
+            {
+                uint64_t seed = onlySeed ? onlySeed : uint64_t(s);
+                // Fuzzed runs are slower: a tenth of the work, many schedules
+                Outcome o = scenario(RunConfig{threads, seed, permille, std::max<size_t>(1, iterations / 10)});
+                ++runs;
+                if (!o.ok && failed++ == 0)
+                    first = "seed " + std::to_string(seed) + ": " + o.failure;
+                if (onlySeed)
+                    break;
+            }
+            bool surprising = expectFailure ? failed == 0 : failed > 0;
+            unexpected += surprising;
+            std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(0)
+                      << std::setw(14) << (clean.seconds > 0 ? clean.ops / clean.seconds : 0)
+                      << std::setw(8) << runs << std::setw(10) << failed << "  "
+                      << (first.empty() ? "-" : first)
+                      << (expectFailure ? (failed ? "  (expected: broken on purpose)" : "  NOT CAUGHT") : "")
+                      << std::endl;
+        }
+
+        // Scenarios whose outcome differed from what was expected
+        int unexpectedResults() const { return unexpected; }
+    };
+}
@@ -0,0 +1,90 @@
+// stress_points.h
+// Schedule-fuzzing hooks. SYNC_STRESS_POINT() marks a race window inside a
+// lock or queue implementation (e.g. between an MCS waiter swapping the tail
+// and linking itself to its predecessor). Normally it expands to nothing.
+//
+// Build modes:
+//   (none)          -> SYNC_STRESS_POINT() is empty: zero cost.
+//   -DSYNC_STRESS   -> each point asks the calling thread's fuzz stream whether
+//                      to perturb the schedule right there: a short spin, a
+//                      yield, or a sleep of up to 50 us. Threads that were never
+//                      bound (stress::bind) are untouched, so only the threads
+//                      under test are perturbed.
+//
+// A fuzz stream is a xorshift generator seeded from (run seed, thread index):
+// the same seed injects the same delays at the same points, so a failing seed
+// can be rerun. The OS scheduler still adds its own nondeterminism on top.
+//
+// Used by stress_harness.h / stress_test.cpp; test bodies call stress::point()
+// directly to widen windows in their own code.
+
+#pragma once
+
+#include <thread>
+#include <chrono>
+#include <cstdint>
+
+namespace stress
+{
+    struct ThreadFuzz
+    {
+        uint64_t state = 0;
+        uint32_t permille = 0; // chance per point, in 1/1000
+        bool active = false;
+        uint64_t injected = 0;
+    };
+
+    inline ThreadFuzz &threadFuzz()
+    {
+        thread_local ThreadFuzz fuzz;
+        return fuzz;
+    }
+
+    inline void bind(uint64_t seed, uint32_t threadIndex, uint32_t permille)
+    {
+        ThreadFuzz &f = threadFuzz();
+        f.state = (seed + 1) * 0x9E3779B97F4A7C15ull ^ (uint64_t(threadIndex + 1) * 0xBF58476D1CE4E5B9ull);
+        f.state |= 1;
+        f.permille = permille;
+        f.active = permille > 0;
+        f.injected = 0;
+    }
+
+    inline void unbind() { threadFuzz().active = false; }
+
+    // Perturb the schedule here, if this thread is being fuzzed
+    inline void point()
+    {
+        ThreadFuzz &f = threadFuzz();
+        if (!f.active)
+            return;
+        f.state ^= f.state << 13;
+        f.state ^= f.state >> 7;
+        f.state ^= f.state << 17;
+        uint64_t r = f.state;
+        if (r % 1000 >= f.permille)
+            return;
+        ++f.injected;
+        switch ((r >> 10) % 8)
+        {
+        case 7:
+            std::this_thread::sleep_for(std::chrono::microseconds((r >> 16) % 50));
+            break;
+        case 4:
+        case 5:
+        case 6:
+            std::this_thread::yield();
+            break;
+        default:
+            for (volatile uint32_t i = 0, n = uint32_t((r >> 16) % 512); i < n; i = i + 1)
+            {
+            }
+        }
+    }
+}
+
+#ifdef SYNC_STRESS
+#define SYNC_STRESS_POINT() ::stress::point()
+#else
+#define SYNC_STRESS_POINT() ((void)0)
+#endif
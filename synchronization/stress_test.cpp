@@ -0,0 +1,450 @@
+// stress_test.cpp
+// Correctness under many interleavings, plus throughput, for the counter,
+// semaphore, producer-consumer and reader-writer implementations in this
+// folder - instead of eyeballing "Expected final value" in the output.
+//
+// Build: make FILE=stress_test.cpp CXXFLAGS="-std=c++17 -O2 -Wall -Wextra -pthread -DSYNC_STRESS" run
+// Args:  ./program [seeds] [inject_permille] [replay_seed]    (defaults: 20, 20, none)
+//
+// -DSYNC_STRESS turns on the injection points INSIDE spin_locks.h,
+// bravo_rwlock.h and priority_lane_queue.h (stress_points.h). Without it only
+// the points in the test bodies below fire.
+//
+// Invariants checked:
+//   counters          - final value == threads x iterations; never two
+//                       threads inside the critical section
+//   semaphores        - never more than PERMITS holders; permits conserved
+//   producer-consumer - every item consumed exactly once (no loss, no dup)
+//   rw locks          - readers never see a half-written pair; a writer is
+//                       never inside with anyone else; writes conserved
+//
+// Rows marked "broken on purpose" are there to prove the harness notices:
+// they must FAIL. The exit code is non-zero if any row surprises.
+
+#include "stress_harness.h"
+#include "spin_locks.h"
+#include "bravo_rwlock.h"
+#include "instrumented_mutex.h"
+#include "priority_lane_queue.h"
+
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <queue>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <string>
+#include <cstdlib>
+
+using namespace std;
+using stress::Outcome;
+using stress::RunConfig;
+
+// ==================================================================
+// COUNTERS (sync_mutex.cpp / traffic_counter.cpp)
+// ==================================================================
+
+// The read-modify-write is split around an injection point on purpose:
+// without the lock, another thread's update in between is lost
+template <typename Lock>
+Outcome lockedCounter(const RunConfig &cfg)
+{
+    Lock lock;
+    long counter = 0;
+    atomic<int> inside{0};
+    atomic<bool> overlapped{false};
+    Outcome out;
+    out.seconds = stress::runThreads(cfg, [&](int)
+                                     {
+        for (size_t i = 0; i < cfg.iterations; ++i)
+        {
+            lock_guard<Lock> guard(lock);
+            if (inside.fetch_add(1, memory_order_relaxed) != 0)
+                overlapped = true;
+            long v = counter;
+            stress::point();
+            counter = v + 1;
+            inside.fetch_sub(1, memory_order_relaxed);
+        } });
+    out.ops = uint64_t(cfg.threads) * cfg.iterations;
+    if (overlapped)
+        out.fail("two threads inside the critical section");
+    if (counter != long(out.ops))
+        out.fail("counter " + to_string(counter) + ", expected " + to_string(out.ops));
+    return out;
+}
+
+Outcome atomicCounter(const RunConfig &cfg)
+{
+    atomic<long> counter{0};
+    Outcome out;
+    out.seconds = stress::runThreads(cfg, [&](int)
+                                     {
+        for (size_t i = 0; i < cfg.iterations; ++i)
+        {
+            counter++;
+            stress::point();
+        } });
+    out.ops = uint64_t(cfg.threads) * cfg.iterations;
+    if (counter != long(out.ops))
+        out.fail("counter " + to_string(counter.load()) + ", expected " + to_string(out.ops));
+    return out;
+}
+
+// Broken on purpose: load + store instead of one atomic increment
+Outcome unguardedCounter(const RunConfig &cfg)
+{
+    atomic<long> counter{0};
+    Outcome out;
+    out.seconds = stress::runThreads(cfg, [&](int)
+                                     {
+        for (size_t i = 0; i < cfg.iterations; ++i)
+        {
+            long v = counter.load(memory_order_relaxed);
+            stress::point();
+            counter.store(v + 1, memory_order_relaxed);
+        } });
+    out.ops = uint64_t(cfg.threads) * cfg.iterations;
+    if (counter != long(out.ops))
+        out.fail("counter " + to_string(counter.load()) + ", expected " + to_string(out.ops));
+    return out;
+}
+
+// ==================================================================
+// SEMAPHORES (semaphore_cpp20.cpp / semaphore_native.cpp)
+// ==================================================================
+
+const int PERMITS = 3;
+
+// semaphore_cpp20.cpp's portable CountingSemaphore
+class CountingSemaphore
+{
+    int count;
+    mutex mtx;
+    condition_variable cv;
+
+public:
+    CountingSemaphore(int initial) : count(initial) {}
+    void acquire()
+    {
+        unique_lock<mutex> lock(mtx);
+        cv.wait(lock, [&]
+                { return count > 0; });
+        --count;
+    }
+    void release()
+    {
+        unique_lock<mutex> lock(mtx);
+        ++count;
+        cv.notify_one();
+    }
+    int available()
+    {
+        lock_guard<mutex> lock(mtx);
+        return count;
+    }
+};
+
+// Broken on purpose: checks and decrements in two steps, outside the lock
+class CheckThenActSemaphore
+{
+    atomic<int> count;
+
+public:
+    CheckThenActSemaphore(int initial) : count(initial) {}
+    void acquire()
+    {
+        while (count.load() <= 0)
+            this_thread::yield();
+        stress::point();
+        count--;
+    }
+    void release() { count++; }
+    int available() { return count.load(); }
+};
+
+template <typename Semaphore>
+Outcome semaphoreLimit(const RunConfig &cfg)
+{
+    Semaphore sem(PERMITS);
+    atomic<int> holders{0}, peak{0};
+    Outcome out;
+    out.seconds = stress::runThreads(cfg, [&](int)
+                                     {
+        for (size_t i = 0; i < cfg.iterations; ++i)
+        {
+            sem.acquire();
+            int now = holders.fetch_add(1) + 1;
+            int p = peak.load();
+            while (now > p && !peak.compare_exchange_weak(p, now))
+            {
+            }
+            stress::point();
+            holders.fetch_sub(1);
+            sem.release();
+        } });
+    out.ops = uint64_t(cfg.threads) * cfg.iterations;
+    if (peak > PERMITS)
+        out.fail(to_string(peak.load()) + " holders at once, limit " + to_string(PERMITS));
+    if (sem.available() != PERMITS)
+        out.fail("permits " + to_string(sem.available()) + " after the run, expected " + to_string(PERMITS));
+    return out;
+}
+
+// ==================================================================
+// PRODUCER-CONSUMER (producer_consumer_advanced.cpp / priority_lane_queue.h)
+// ==================================================================
+
+// Checks each id in [0, total) was consumed exactly once
+class Ledger
+{
+    vector<atomic<uint8_t>> seen;
+
+public:
+    explicit Ledger(size_t total) : seen(total) {}
+    void consumed(uint64_t id) { seen[id].fetch_add(1, memory_order_relaxed); }
+    void check(Outcome &out) const
+    {
+        size_t lost = 0, dup = 0;
+        for (auto &s : seen)
+        {
+            lost += s.load() == 0;
+            dup += s.load() > 1;
+        }
+        if (lost)
+            out.fail(to_string(lost) + " items lost");
+        if (dup)
+            out.fail(to_string(dup) + " items consumed twice");
+    }
+};
+
+// The mutex + condition_variable queue with a "finished producing" flag
+Outcome mutexQueue(const RunConfig &cfg)
+{
+    int producers = cfg.threads / 2;
+    size_t total = producers * cfg.iterations;
+    mutex mtx;
+    condition_variable cv;
+    queue<uint64_t> q;
+    int producersDone = 0;
+    Ledger ledger(total);
+    Outcome out;
+    out.seconds = stress::runThreads(cfg, [&](int t)
+                                     {
+        if (t < producers)
+        {
+            for (size_t i = 0; i < cfg.iterations; ++i)
+            {
+                {
+                    lock_guard<mutex> lock(mtx);
+                    q.push(t * cfg.iterations + i);
+                }
+                stress::point();
+                cv.notify_one();
+            }
+            lock_guard<mutex> lock(mtx);
+            if (++producersDone == producers)
+                cv.notify_all();
+            return;
+        }
+        while (true)
+        {
+            unique_lock<mutex> lock(mtx);
+            cv.wait(lock, [&] { return !q.empty() || producersDone == producers; });
+            if (q.empty())
+                break;
+            uint64_t id = q.front();
+            q.pop();
+            lock.unlock();
+            stress::point();
+            ledger.consumed(id);
+        } });
+    out.ops = total;
+    ledger.check(out);
+    return out;
+}
+
+// PriorityLaneQueue: lock-free lanes, weighted dequeue, sleep/wake handshake
+Outcome laneQueue(const RunConfig &cfg)
+{
+    int producers = cfg.threads / 2;
+    size_t total = producers * cfg.iterations;
+    PriorityLaneQueue<uint64_t, 2> queue({2, 1}, 64); // small: exercises "lane full"
+    atomic<int> producersDone{0};
+    Ledger ledger(total);
+    Outcome out;
+    out.seconds = stress::runThreads(cfg, [&](int t)
+                                     {
+        if (t < producers)
+        {
+            for (size_t i = 0; i < cfg.iterations; ++i)
+            {
+                uint64_t id = t * cfg.iterations + i;
+                while (!queue.push(id % 2, id))
+                    this_thread::yield(); // lane full: backpressure
+                stress::point();
+            }
+            if (producersDone.fetch_add(1) + 1 == producers)
+                queue.close();
+            return;
+        }
+        uint64_t id;
+        while (queue.waitPop(id))
+        {
+            stress::point();
+            ledger.consumed(id);
+        } });
+    out.ops = total;
+    ledger.check(out);
+    return out;
+}
+
+// Broken on purpose: two consumers peek then pop without holding the lock
+// across both steps, so one item can be taken twice and another skipped
+Outcome splitPeekPopQueue(const RunConfig &cfg)
+{
+    int producers = cfg.threads / 2;
+    size_t total = producers * cfg.iterations;
+    mutex mtx;
+    deque<uint64_t> q;
+    atomic<int> producersDone{0};
+    Ledger ledger(total);
+    Outcome out;
+    out.seconds = stress::runThreads(cfg, [&](int t)
+                                     {
+        if (t < producers)
+        {
+            for (size_t i = 0; i < cfg.iterations; ++i)
+            {
+                lock_guard<mutex> lock(mtx);
+                q.push_back(t * cfg.iterations + i);
+            }
+            producersDone++;
+            return;
+        }
+        while (true)
+        {
+            uint64_t id;
+            {
+                lock_guard<mutex> lock(mtx);
+                if (q.empty())
+                {
+                    if (producersDone == producers)
+                        break;
+                    continue;
+                }
+                id = q.front();
+            }
+            stress::point();
+            {
+                lock_guard<mutex> lock(mtx);
+                if (!q.empty())
+                    q.pop_front();
+            }
+            ledger.consumed(id);
+        } });
+    out.ops = total;
+    ledger.check(out);
+    return out;
+}
+
+// ==================================================================
+// READER-WRITER LOCKS (sync_shared_mutex.cpp / bravo_rwlock.h)
+// ==================================================================
+
+// One writer thread in four; writers keep a == b, readers check it
+template <typename RwLock>
+Outcome rwPair(const RunConfig &cfg)
+{
+    RwLock lock;
+    long a = 0, b = 0;
+    atomic<int> readersIn{0}, writersIn{0};
+    atomic<bool> torn{false}, excluded{true};
+    atomic<long> writes{0};
+    Outcome out;
+    out.seconds = stress::runThreads(cfg, [&](int t)
+                                     {
+        bool writer = t % 4 == 0;
+        for (size_t i = 0; i < cfg.iterations; ++i)
+        {
+            if (writer)
+            {
+                lock_guard<RwLock> guard(lock);
+                if (writersIn.fetch_add(1) != 0 || readersIn.load() != 0)
+                    excluded = false;
+                a = a + 1;
+                stress::point();
+                b = b + 1;
+                writes++;
+                writersIn.fetch_sub(1);
+            }
+            else
+            {
+                shared_lock<RwLock> guard(lock);
+                readersIn.fetch_add(1);
+                if (writersIn.load() != 0)
+                    excluded = false;
+                long x = a;
+                stress::point();
+                long y = b;
+                if (x != y)
+                    torn = true;
+                readersIn.fetch_sub(1);
+            }
+        } });
+    out.ops = uint64_t(cfg.threads) * cfg.iterations;
+    if (!excluded)
+        out.fail("a writer was inside together with another thread");
+    if (torn)
+        out.fail("reader saw a half-written pair");
+    if (a != writes || b != writes)
+        out.fail("pair (" + to_string(a) + ", " + to_string(b) + "), expected " + to_string(writes.load()));
+    return out;
+}
+
+int main(int argc, char **argv)
+{
+    int seeds = argc > 1 ? atoi(argv[1]) : 20;
+    uint32_t permille = argc > 2 ? uint32_t(atoi(argv[2])) : 20;
+    uint64_t replay = argc > 3 ? strtoull(argv[3], nullptr, 10) : 0;
+
+#ifdef SYNC_STRESS
+    const char *inside = "on";
+#else
+    const char *inside = "off (build with -DSYNC_STRESS)";
+#endif
+    cout << "--- Stress: " << seeds << " seeds, injection " << permille << "/1000 per point, "
+         << "implementation points " << inside << ", " << stress::allowedCpus().size() << " CPUs ---\n"
+         << endl;
+
+    stress::Suite suite(seeds, permille, replay);
+    suite.run("counter: atomic (traffic_counter)", 4, 50000, false, atomicCounter);
+    suite.run("counter: InstrumentedMutex", 4, 50000, false, lockedCounter<InstrumentedMutex>);
+    // FIFO spinlocks hand the lock to the next ticket even if that thread is
+    // not running: with more threads than CPUs every handoff can cost a time
+    // slice (spin_locks.h, "oversubscription caveat"). Fewer iterations so a
+    // small machine finishes; compare their ops/s on a many-core box.
+    suite.run("counter: TicketLock", 4, 2000, false, lockedCounter<TicketLock>);
+    suite.run("counter: AdaptiveMutex", 4, 50000, false, lockedCounter<AdaptiveMutex>);
+    suite.run("counter: McsLock", 4, 2000, false, lockedCounter<McsLock>);
+    suite.run("counter: load+store, no lock", 4, 50000, true, unguardedCounter);
+
+    suite.run("semaphore: CountingSemaphore", 8, 10000, false, semaphoreLimit<CountingSemaphore>);
+    suite.run("semaphore: check-then-act", 8, 10000, true, semaphoreLimit<CheckThenActSemaphore>);
+
+    suite.run("queue: mutex + condition_variable", 4, 50000, false, mutexQueue);
+    suite.run("queue: PriorityLaneQueue", 4, 50000, false, laneQueue);
+    suite.run("queue: peek and pop in two steps", 4, 50000, true, splitPeekPopQueue);
+
+    suite.run("rwlock: InstrumentedSharedMutex", 8, 20000, false, rwPair<InstrumentedSharedMutex>);
+    suite.run("rwlock: BravoRwLock", 8, 20000, false, rwPair<BravoRwLock>);
+
+    int surprises = suite.unexpectedResults();
+    cout << "\n"
+         << (surprises ? to_string(surprises) + " scenario(s) did not behave as expected" : "All scenarios behaved as expected")
+         << endl;
+    return surprises ? 1 : 0;
+}
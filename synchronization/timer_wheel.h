@@ -0,0 +1,349 @@
+// timer_wheel.h
+// Millions of timeouts without one sleeping thread per delay.
+//
+//   ThreadPool         - fixed workers over one task queue (the pool from
+//                        solid/09_resilient_broadcast.cpp) plus submitBatch():
+//                        a whole run of expired callbacks is ONE queue
+//                        operation and one wakeup.
+//   HierarchicalWheel  - 4 levels; a level-l slot covers 256^l ticks (tick =
+//                        1 ms by default: 1 ms, 256 ms, 65 s, 4.7 h per slot).
+//                        A timer goes into the finest level it fits and is
+//                        CASCADED (re-placed one level down) as its deadline
+//                        approaches - at most 3 times per timer, so:
+//                          schedule() - O(1): pick level/slot, link into a list
+//                          cancel()   - O(1): unlink by handle
+//                          per tick   - O(expired + cascaded), no sorting
+//                        One driver thread advances the wheel and hands each
+//                        tick's expired callbacks to the pool as batches.
+//
+// Incremental cascading: the textbook wheel re-places a whole slot the moment
+// the level below wraps - with a million pending timers that is ~100k nodes
+// relinked in one tick, and every timer due in that tick waits ~10 ms behind
+// it. Here each level has 512 slots (two revolutions' worth), so the NEXT
+// slot can be moved down a little every tick while the current revolution is
+// still running: a slot's timers are spread over the 256^l ticks before they
+// are needed.
+//
+// solid/09 uses a single-level hashed wheel: fine for a few retries, but
+// every far-away timer sits in a slot and is re-checked each revolution.
+//
+// Timers are nodes in a chunked pool (std::deque: stable, no reallocation
+// copies), linked by 32-bit indices. A TimerId carries a generation, so
+// cancelling a timer that already fired (and whose node was reused) is a
+// harmless no-op returning false.
+//
+// Resolution is one tick: a timer fires in the first tick at or after its
+// deadline, never before it.
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <array>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+namespace timers
+{
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void()>;
+
+    // ========================================================================
+    // THREAD POOL
+    // ========================================================================
+
+    class ThreadPool
+    {
+    private:
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool stopping = false;
+
+    public:
+        explicit ThreadPool(size_t threads)
+        {
+            for (size_t i = 0; i < threads; ++i)
+            {
+                workers.emplace_back([this]()
+                                     {
+                    while (true)
+                    {
+                        std::function<void()> task;
+                        {
+                            std::unique_lock<std::mutex> lock(mtx);
+                            cv.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                            if (stopping && tasks.empty())
+                                return;
+                            task = std::move(tasks.front());
+                            tasks.pop();
+                        }
+                        task();
+                    } });
+            }
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                stopping = true;
+            }
+            cv.notify_all();
+            for (auto &w : workers)
+                w.join();
+        }
+
+        void submit(std::function<void()> task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                tasks.push(std::move(task));
+            }
+            cv.notify_one();
+        }
+
+        // Splits `batch` into one task per `chunk` callbacks
+        void submitBatch(std::vector<Callback> &&batch, size_t chunk = 256)
+        {
+            for (size_t i = 0; i < batch.size(); i += chunk)
+            {
+                size_t end = std::min(batch.size(), i + chunk);
+                std::vector<Callback> part(std::make_move_iterator(batch.begin() + i),
+                                           std::make_move_iterator(batch.begin() + end));
+                submit([part = std::move(part)]()
+                       { for (auto &cb : part) cb(); });
+            }
+            batch.clear();
+        }
+    };
+
+    // ========================================================================
+    // HIERARCHICAL TIMING WHEEL
+    // ========================================================================
+
+    struct TimerId
+    {
+        uint32_t index = UINT32_MAX;
+        uint32_t generation = 0;
+    };
+
+    class HierarchicalWheel
+    {
+    public:
+        static constexpr int LEVELS = 4;
+        static constexpr int SLOT_BITS = 8;    // level l slot = 2^(8l) ticks
+        static constexpr uint64_t SLOTS = 512; // per level: this revolution and the next
+
+    private:
+        static constexpr uint32_t NIL = UINT32_MAX;
+
+        struct Node
+        {
+            Callback callback;
+            uint64_t expiry = 0; // absolute tick
+            uint32_t prev = NIL, next = NIL;
+            uint32_t generation = 0;
+            uint16_t slot = 0; // level * SLOTS + index, for unlinking the head
+            bool armed = false;
+        };
+
+        const Clock::duration tick;
+        const Clock::time_point start;
+        ThreadPool &pool;
+
+        std::mutex mtx; // schedule/cancel hold it for O(1); the driver once per tick
+        std::deque<Node> nodes;
+        uint32_t freeList = NIL;
+        std::array<uint32_t, LEVELS * SLOTS> heads;
+        std::array<uint32_t, LEVELS * SLOTS> sizes{};
+        uint64_t currentTick = 0; // every tick <= this has been processed
+        size_t armedCount = 0;
+
+        std::atomic<bool> running{true};
+        std::thread driver;
+
+        static uint64_t block(uint64_t t, int level) { return t >> (SLOT_BITS * level); }
+
+        uint32_t allocate()
+        {
+            if (freeList != NIL)
+            {
+                uint32_t i = freeList;
+                freeList = nodes[i].next;
+                return i;
+            }
+            nodes.emplace_back();
+            return uint32_t(nodes.size() - 1);
+        }
+
+        void release(uint32_t i)
+        {
+            Node &n = nodes[i];
+            n.armed = false;
+            ++n.generation;
+            n.next = freeList;
+            freeList = i;
+        }
+
+        // Level l holds timers whose level-(l+1) block is the current or the
+        // next one; pick the finest level that qualifies
+        void link(uint32_t i)
+        {
+            Node &n = nodes[i];
+            int level = 0;
+            while (level < LEVELS - 1 && block(n.expiry, level + 1) - block(currentTick, level + 1) > 1)
+                ++level;
+            uint64_t at = n.expiry;
+            uint64_t farthest = block(currentTick, LEVELS - 1) + SLOTS - 1;
+            if (level == LEVELS - 1 && block(at, level) > farthest)
+                at = farthest << (SLOT_BITS * level); // beyond ~99 days: park, re-placed when cascaded
+            uint16_t slot = uint16_t(level * SLOTS + (block(at, level) & (SLOTS - 1)));
+            n.slot = slot;
+            n.prev = NIL;
+            n.next = heads[slot];
+            if (n.next != NIL)
+                nodes[n.next].prev = i;
+            heads[slot] = i;
+            ++sizes[slot];
+        }
+
+        void unlink(uint32_t i)
+        {
+            Node &n = nodes[i];
+            if (n.prev != NIL)
+                nodes[n.prev].next = n.next;
+            else
+                heads[n.slot] = n.next;
+            if (n.next != NIL)
+                nodes[n.next].prev = n.prev;
+            --sizes[n.slot];
+        }
+
+        // Move part of level `level`'s next slot one level down: its timers
+        // became eligible for the level below when this block started, and
+        // must all be there before the block ends
+        void cascade(int level)
+        {
+            uint16_t slot = uint16_t(level * SLOTS + ((block(currentTick, level) + 1) & (SLOTS - 1)));
+            if (sizes[slot] == 0)
+                return;
+            uint64_t span = uint64_t(1) << (SLOT_BITS * level);
+            uint64_t ticksLeft = span - (currentTick & (span - 1));
+            uint64_t budget = (sizes[slot] + ticksLeft - 1) / ticksLeft;
+            while (budget-- > 0 && heads[slot] != NIL)
+            {
+                uint32_t i = heads[slot];
+                unlink(i);
+                link(i);
+            }
+        }
+
+        // Advance one tick; expired callbacks are moved into `due`
+        void step(std::vector<Callback> &due)
+        {
+            ++currentTick;
+            for (int level = LEVELS - 1; level >= 1; --level) // top first: what it moves may move on
+                cascade(level);
+            uint16_t slot = uint16_t(currentTick & (SLOTS - 1));
+            uint32_t i = heads[slot];
+            heads[slot] = NIL;
+            sizes[slot] = 0;
+            while (i != NIL)
+            {
+                Node &n = nodes[i];
+                uint32_t next = n.next;
+                due.push_back(std::move(n.callback));
+                n.callback = nullptr;
+                release(i);
+                --armedCount;
+                i = next;
+            }
+        }
+
+        void run()
+        {
+            std::vector<Callback> due;
+            uint64_t processed = 0;
+            while (running.load(std::memory_order_relaxed))
+            {
+                std::this_thread::sleep_until(start + tick * (processed + 1));
+                uint64_t target = uint64_t((Clock::now() - start) / tick);
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    while (currentTick < target) // catch up if this thread was late
+                        step(due);
+                    processed = currentTick;
+                }
+                if (!due.empty())
+                    pool.submitBatch(std::move(due)); // outside the lock
+            }
+        }
+
+    public:
+        HierarchicalWheel(ThreadPool &p, Clock::duration tickSize = std::chrono::milliseconds(1))
+            : tick(tickSize), start(Clock::now()), pool(p)
+        {
+            heads.fill(NIL);
+            driver = std::thread([this]()
+                                 { run(); });
+        }
+
+        ~HierarchicalWheel() { stop(); }
+
+        // Stops firing; pending timers are dropped
+        void stop()
+        {
+            if (running.exchange(false))
+                driver.join();
+        }
+
+        TimerId schedule(Clock::duration delay, Callback callback)
+        {
+            // Overdue deadlines fire on the next tick; a negative count would wrap the cast
+            delay = std::max(delay, Clock::duration::zero());
+            // Round the deadline UP to a tick: never fire early
+            uint64_t due = uint64_t((Clock::now() - start + delay + tick - Clock::duration(1)) / tick);
+            std::lock_guard<std::mutex> lock(mtx);
+            uint32_t i = allocate();
+            Node &n = nodes[i];
+            n.callback = std::move(callback);
+            n.expiry = std::max(due, currentTick + 1);
+            n.armed = true;
+            link(i);
+            ++armedCount;
+            return TimerId{i, n.generation};
+        }
+
+        // False if it already fired, was cancelled, or never existed
+        bool cancel(TimerId id)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (id.index >= nodes.size())
+                return false;
+            Node &n = nodes[id.index];
+            if (!n.armed || n.generation != id.generation)
+                return false;
+            unlink(id.index);
+            n.callback = nullptr;
+            release(id.index);
+            --armedCount;
+            return true;
+        }
+
+        size_t pending()
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            return armedCount;
+        }
+    };
+}
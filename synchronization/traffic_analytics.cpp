@@ -0,0 +1,193 @@
+// traffic_analytics.cpp
+// traffic_counter.cpp answers "how many requests". This answers "which
+// clients are hottest" and "how many unique clients" over the last N
+// windows, using traffic_sketches.h, and checks it against exact counting.
+//
+// Build: make FILE=traffic_analytics.cpp CXXFLAGS="-std=c++17 -O2 -Wall -Wextra -pthread" run
+// Args:  ./program [events] [threads] [zipf_s]    (defaults: 4,000,000, 4, 1.1)
+//
+// Stream: client ids drawn from a Zipf(s) distribution over 1,000,000
+// clients - a few very hot clients and a long tail, like real traffic. The
+// stream spans 10 windows; queries cover the most recent 4.
+//
+// Exact baseline: a per-thread unordered_map<client, count>, merged at the
+// end. Memory grows with distinct clients; the sketches stay fixed.
+//
+// The stream is then recorded a second time while another thread keeps
+// querying; the settled result must match the first run exactly.
+
+#include "traffic_sketches.h"
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <unordered_map>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+using namespace sketch;
+using Clock = chrono::steady_clock;
+
+const uint64_t CLIENTS = 1000000;
+const uint64_t WINDOW_US = 1000000; // 1 s windows on the synthetic clock
+const uint64_t WINDOWS_IN_STREAM = 10;
+const size_t QUERY_WINDOWS = 4;
+const size_t TOP_K = 10;
+
+vector<uint64_t> zipfStream(size_t n, double s, uint64_t seed)
+{
+    vector<double> cdf(CLIENTS);
+    double sum = 0;
+    for (uint64_t i = 0; i < CLIENTS; ++i)
+        cdf[i] = (sum += 1.0 / pow(double(i + 1), s));
+    mt19937_64 rng(seed);
+    uniform_real_distribution<double> u(0, sum);
+    vector<uint64_t> out(n);
+    for (auto &x : out)
+    {
+        uint64_t rank = lower_bound(cdf.begin(), cdf.end(), u(rng)) - cdf.begin();
+        x = mix64(rank) % (CLIENTS * 100); // scatter ranks over a sparse id space
+    }
+    return out;
+}
+
+// Event i happens at this time: the stream is spread evenly over the windows
+uint64_t eventTime(size_t i, size_t n) { return i * WINDOWS_IN_STREAM * WINDOW_US / n; }
+
+int main(int argc, char **argv)
+{
+    size_t events = argc > 1 ? strtoull(argv[1], nullptr, 10) : 4000000;
+    int threads = argc > 2 ? atoi(argv[2]) : 4;
+    double s = argc > 3 ? atof(argv[3]) : 1.1;
+
+    cout << "--- Traffic analytics: " << events << " events, " << threads << " threads, Zipf s=" << s << " ---" << endl;
+    vector<uint64_t> stream = zipfStream(events, s, 42);
+    uint64_t endTime = eventTime(events - 1, events);
+
+    // ---- sketches ----
+    TrafficAnalytics analytics(WINDOW_US);
+    vector<TrafficAnalytics::Recorder> recorders;
+    for (int t = 0; t < threads; ++t)
+        recorders.push_back(analytics.recorder());
+
+    auto start = Clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back([&, t]()
+                             {
+            for (size_t i = t; i < events; i += threads)
+                recorders[t].record(stream[i], eventTime(i, events)); });
+    for (auto &w : workers)
+        w.join();
+    double sketchNs = chrono::duration<double, nano>(Clock::now() - start).count() / events;
+
+    auto qStart = Clock::now();
+    TrafficAnalytics::Report report = analytics.query(endTime, QUERY_WINDOWS, TOP_K);
+    double queryMs = chrono::duration<double, milli>(Clock::now() - qStart).count();
+
+    // ---- same stream again, with a reader querying while the recorders run ----
+    // Slots get reset under the reader's feet; the final merge must still match
+    TrafficAnalytics live(WINDOW_US);
+    vector<TrafficAnalytics::Recorder> liveRecorders;
+    for (int t = 0; t < threads; ++t)
+        liveRecorders.push_back(live.recorder());
+    atomic<uint64_t> liveTime{0};
+    atomic<bool> recording{true};
+    size_t liveQueries = 0, liveTorn = 0;
+    thread reader([&]()
+                  {
+        while (recording.load(memory_order_acquire))
+        {
+            TrafficAnalytics::Report r = live.query(liveTime.load(memory_order_relaxed), QUERY_WINDOWS, TOP_K);
+            liveTorn += r.events > events;
+            ++liveQueries;
+        } });
+    workers.clear();
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back([&, t]()
+                             {
+            for (size_t i = t; i < events; i += threads)
+            {
+                liveRecorders[t].record(stream[i], eventTime(i, events));
+                if (t == 0 && (i & 1023) == 0)
+                    liveTime.store(eventTime(i, events), memory_order_relaxed);
+            } });
+    for (auto &w : workers)
+        w.join();
+    recording.store(false, memory_order_release);
+    reader.join();
+    TrafficAnalytics::Report settled = live.query(endTime, QUERY_WINDOWS, TOP_K);
+    bool liveAgrees = settled.events == report.events && settled.distinct == report.distinct &&
+                      settled.top.size() == report.top.size();
+    for (size_t i = 0; liveAgrees && i < report.top.size(); ++i)
+        liveAgrees = settled.top[i].key == report.top[i].key && settled.top[i].estimate == report.top[i].estimate;
+
+    // ---- exact: cost of counting every event, then the truth for the query windows ----
+    start = Clock::now();
+    vector<unordered_map<uint64_t, uint64_t>> exactPerThread(threads);
+    workers.clear();
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back([&, t]()
+                             {
+            for (size_t i = t; i < events; i += threads)
+                exactPerThread[t][stream[i]]++; });
+    for (auto &w : workers)
+        w.join();
+    double exactNs = chrono::duration<double, nano>(Clock::now() - start).count() / events;
+
+    uint64_t firstWindow = endTime / WINDOW_US + 1 - QUERY_WINDOWS;
+    unordered_map<uint64_t, uint64_t> exact;
+    for (size_t i = 0; i < events; ++i)
+        if (eventTime(i, events) / WINDOW_US >= firstWindow)
+            exact[stream[i]]++;
+
+    vector<pair<uint64_t, uint64_t>> truth(exact.begin(), exact.end());
+    sort(truth.begin(), truth.end(), [](auto &a, auto &b)
+         { return a.second > b.second; });
+    uint64_t windowEvents = 0;
+    for (auto &kv : truth)
+        windowEvents += kv.second;
+
+    // ---- accuracy ----
+    cout << "\nLast " << QUERY_WINDOWS << " windows: " << report.events << " events (exact " << windowEvents << ")\n";
+    cout << "Distinct clients: HLL " << fixed << setprecision(0) << report.distinct << " vs exact "
+         << exact.size() << " (" << setprecision(2) << 100.0 * (report.distinct - double(exact.size())) / exact.size()
+         << "% error)\n\n";
+
+    cout << setw(6) << "rank" << setw(16) << "true client" << setw(12) << "true count" << setw(16)
+         << "sketch client" << setw(12) << "estimate" << setw(10) << "error" << endl;
+    size_t hits = 0;
+    for (size_t i = 0; i < TOP_K && i < truth.size(); ++i)
+    {
+        bool found = false;
+        for (auto &h : report.top)
+            found |= h.key == truth[i].first;
+        hits += found;
+        uint64_t est = i < report.top.size() ? report.top[i].estimate : 0;
+        uint64_t trueOfEst = i < report.top.size() ? exact[report.top[i].key] : 0;
+        cout << setw(6) << i + 1 << setw(16) << truth[i].first << setw(12) << truth[i].second
+             << setw(16) << (i < report.top.size() ? report.top[i].key : 0) << setw(12) << est
+             << setw(9) << setprecision(2) << (trueOfEst ? 100.0 * (double(est) - trueOfEst) / trueOfEst : 0) << "%" << endl;
+    }
+    cout << "Top-" << TOP_K << " recall: " << hits << "/" << TOP_K << endl;
+
+    // ---- cost ----
+    size_t sketchBytes = threads * TrafficAnalytics::WINDOW_SLOTS *
+                         (CountMin::DEPTH * CountMin::WIDTH * 4 + HyperLogLog::REGISTERS +
+                          TrafficAnalytics::TOP_K_CAPACITY * 24);
+    cout << "\nUpdate cost: sketches " << setprecision(1) << sketchNs << " ns/event, exact map "
+         << exactNs << " ns/event (wall time / events, " << threads << " threads)\n";
+    cout << "Memory: sketches " << sketchBytes / 1024 << " KB fixed, exact map ~"
+         << exact.size() * 32 / 1024 << " KB and growing with distinct clients\n";
+    cout << "Query (merge " << threads << " recorders x " << QUERY_WINDOWS << " windows): "
+         << setprecision(2) << queryMs << " ms" << endl;
+    cout << "Queries during recording: " << liveQueries << " (" << liveTorn << " implausible), final merge "
+         << (liveAgrees ? "matches" : "DIFFERS FROM") << " the quiescent run" << endl;
+    return liveAgrees && liveTorn == 0 ? 0 : 1;
+}
@@ -0,0 +1,534 @@
+// traffic_sketches.h
+// Streaming traffic analytics: "which clients are hottest" and "how many
+// unique clients", over a sliding window, in fixed memory.
+//
+//   CountMin     - d x w counter matrix. add() bumps one counter per row;
+//                  estimate() takes the row minimum. Never under-counts;
+//                  over-counts by at most ~e/w of the total with high probability.
+//   SpaceSaving  - keeps the m most frequent keys seen (a min-heap of
+//                  (key, count, error)). A new key replaces the current minimum
+//                  and inherits its count as error. Any key with true count
+//                  > total/m is guaranteed to be in the summary. Newcomers are
+//                  first checked against Count-Min (see offer()), which keeps
+//                  the long tail of a Zipf stream from churning the heap.
+//   HyperLogLog  - 2^p one-byte registers; each keeps the longest run of
+//                  leading zeros seen among hashes routed to it. ~1.04/sqrt(2^p)
+//                  relative error (1.6 % for p = 12) in 4 KB, for any cardinality.
+//
+// All three MERGE: Count-Min by adding counters, HyperLogLog by register max,
+// Space-Saving by unioning candidates (then ranking them with the merged
+// Count-Min). So every thread records into its own sketches - no shared
+// cache line on the hot path - and readers merge on demand.
+//
+// TrafficAnalytics ties them together:
+//   - each worker thread gets a Recorder with a ring of WINDOW_SLOTS sketches,
+//     one per time window; recording into a new window resets the oldest slot.
+//   - queries merge the last N windows across all recorders. Reads are
+//     lock-free: sketch cells are single-writer atomics (relaxed loads and
+//     stores - plain MOVs on x86, no lock prefix), and a per-slot window id is
+//     re-checked after merging to discard a slot that was reset mid-read.
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <unordered_set>
+#include <mutex>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+namespace sketch
+{
+    inline uint64_t mix64(uint64_t x)
+    {
+        // splitmix64 finalizer: client ids are often sequential
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    // Single-writer cell: the owner increments without a locked RMW,
+    // readers on other threads load it race-free
+    template <typename T>
+    inline void bump(std::atomic<T> &cell, T by)
+    {
+        cell.store(cell.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    // ========================================================================
+    // COUNT-MIN
+    // ========================================================================
+
+    class CountMin
+    {
+    public:
+        static constexpr size_t DEPTH = 4;
+        static constexpr size_t WIDTH = 4096; // power of two
+
+    private:
+        std::unique_ptr<std::atomic<uint32_t>[]> cells{new std::atomic<uint32_t>[DEPTH * WIDTH]};
+
+        // Kirsch-Mitzenmacher: row i uses h1 + i*h2 from one 64-bit hash
+        static size_t column(uint64_t h, size_t row)
+        {
+            uint32_t h1 = uint32_t(h), h2 = uint32_t(h >> 32) | 1;
+            return (h1 + row * h2) & (WIDTH - 1);
+        }
+
+    public:
+        CountMin() { clear(); }
+
+        void clear()
+        {
+            for (size_t i = 0; i < DEPTH * WIDTH; ++i)
+                cells[i].store(0, std::memory_order_relaxed);
+        }
+
+        void add(uint64_t hash, uint32_t n = 1)
+        {
+            for (size_t r = 0; r < DEPTH; ++r)
+                bump(cells[r * WIDTH + column(hash, r)], n);
+        }
+
+        uint64_t estimate(uint64_t hash) const
+        {
+            uint64_t best = UINT64_MAX;
+            for (size_t r = 0; r < DEPTH; ++r)
+                best = std::min<uint64_t>(best, cells[r * WIDTH + column(hash, r)].load(std::memory_order_relaxed));
+            return best;
+        }
+
+        // Into a plain accumulator (merging happens on the reader's side)
+        void mergeInto(std::vector<uint64_t> &acc) const
+        {
+            acc.resize(DEPTH * WIDTH);
+            for (size_t i = 0; i < DEPTH * WIDTH; ++i)
+                acc[i] += cells[i].load(std::memory_order_relaxed);
+        }
+
+        static uint64_t estimate(const std::vector<uint64_t> &merged, uint64_t hash)
+        {
+            uint64_t best = UINT64_MAX;
+            for (size_t r = 0; r < DEPTH; ++r)
+                best = std::min(best, merged[r * WIDTH + column(hash, r)]);
+            return best;
+        }
+    };
+
+    // ========================================================================
+    // SPACE-SAVING TOP-K
+    // ========================================================================
+
+    class SpaceSaving
+    {
+    public:
+        struct Counter
+        {
+            uint64_t key, count, error;
+        };
+
+    private:
+        struct Slot
+        {
+            std::atomic<uint64_t> key{0}, count{0}, error{0};
+        };
+
+        // Owner-only key -> heap index. Open addressing with backward-shift
+        // deletion: the tail of a Zipf stream evicts on almost every event, so
+        // node-based maps would allocate on the hot path.
+        class FlatIndex
+        {
+        private:
+            static constexpr uint32_t EMPTY = UINT32_MAX;
+            size_t mask;
+            std::vector<uint64_t> keys;
+            std::vector<uint32_t> values;
+
+            size_t home(uint64_t key) const { return mix64(key) & mask; }
+
+        public:
+            explicit FlatIndex(size_t entries)
+            {
+                size_t cap = 16;
+                while (cap < entries * 2)
+                    cap <<= 1;
+                mask = cap - 1;
+                keys.assign(cap, 0);
+                values.assign(cap, EMPTY);
+            }
+
+            void clear() { std::fill(values.begin(), values.end(), EMPTY); }
+
+            uint32_t *find(uint64_t key)
+            {
+                for (size_t i = home(key);; i = (i + 1) & mask)
+                {
+                    if (values[i] == EMPTY)
+                        return nullptr;
+                    if (keys[i] == key)
+                        return &values[i];
+                }
+            }
+
+            void set(uint64_t key, uint32_t value)
+            {
+                size_t i = home(key);
+                while (values[i] != EMPTY && keys[i] != key)
+                    i = (i + 1) & mask;
+                keys[i] = key;
+                values[i] = value;
+            }
+
+            void erase(uint64_t key)
+            {
+                size_t i = home(key);
+                while (keys[i] != key || values[i] == EMPTY)
+                {
+                    if (values[i] == EMPTY)
+                        return;
+                    i = (i + 1) & mask;
+                }
+                // Pull later entries of the probe run back over the hole
+                for (size_t j = (i + 1) & mask; values[j] != EMPTY; j = (j + 1) & mask)
+                {
+                    size_t h = home(keys[j]);
+                    if (((j - h) & mask) >= ((j - i) & mask))
+                    {
+                        keys[i] = keys[j];
+                        values[i] = values[j];
+                        i = j;
+                    }
+                }
+                values[i] = EMPTY;
+            }
+        };
+
+        const size_t capacity;
+        std::unique_ptr<Slot[]> heap; // min-heap on count
+        std::atomic<size_t> used{0};
+        FlatIndex position; // owner only
+
+        uint64_t countAt(size_t i) const { return heap[i].count.load(std::memory_order_relaxed); }
+
+        void swapSlots(size_t a, size_t b)
+        {
+            uint64_t ka = heap[a].key.load(std::memory_order_relaxed), kb = heap[b].key.load(std::memory_order_relaxed);
+            uint64_t ca = countAt(a), cb = countAt(b);
+            uint64_t ea = heap[a].error.load(std::memory_order_relaxed), eb = heap[b].error.load(std::memory_order_relaxed);
+            heap[a].key.store(kb, std::memory_order_relaxed);
+            heap[a].count.store(cb, std::memory_order_relaxed);
+            heap[a].error.store(eb, std::memory_order_relaxed);
+            heap[b].key.store(ka, std::memory_order_relaxed);
+            heap[b].count.store(ca, std::memory_order_relaxed);
+            heap[b].error.store(ea, std::memory_order_relaxed);
+            position.set(kb, uint32_t(a));
+            position.set(ka, uint32_t(b));
+        }
+
+        // A count only grows, so it can only need to move down
+        void siftDown(size_t i)
+        {
+            size_t n = used.load(std::memory_order_relaxed);
+            while (true)
+            {
+                size_t l = 2 * i + 1, r = l + 1, smallest = i;
+                if (l < n && countAt(l) < countAt(smallest))
+                    smallest = l;
+                if (r < n && countAt(r) < countAt(smallest))
+                    smallest = r;
+                if (smallest == i)
+                    return;
+                swapSlots(i, smallest);
+                i = smallest;
+            }
+        }
+
+        void siftUp(size_t i)
+        {
+            while (i > 0 && countAt((i - 1) / 2) > countAt(i))
+            {
+                swapSlots(i, (i - 1) / 2);
+                i = (i - 1) / 2;
+            }
+        }
+
+    public:
+        explicit SpaceSaving(size_t m) : capacity(m), heap(new Slot[m]), position(m) {}
+
+        void clear()
+        {
+            used.store(0, std::memory_order_relaxed);
+            position.clear();
+        }
+
+        void add(uint64_t key, uint64_t n = 1)
+        {
+            if (uint32_t *at = position.find(key))
+            {
+                bump(heap[*at].count, n);
+                siftDown(*at);
+                return;
+            }
+            size_t u = used.load(std::memory_order_relaxed);
+            if (u < capacity)
+            {
+                heap[u].key.store(key, std::memory_order_relaxed);
+                heap[u].count.store(n, std::memory_order_relaxed);
+                heap[u].error.store(0, std::memory_order_relaxed);
+                position.set(key, uint32_t(u));
+                used.store(u + 1, std::memory_order_release);
+                siftUp(u);
+                return;
+            }
+            // Evict the minimum; the newcomer inherits its count as error
+            uint64_t minCount = countAt(0);
+            position.erase(heap[0].key.load(std::memory_order_relaxed));
+            heap[0].key.store(key, std::memory_order_relaxed);
+            heap[0].count.store(minCount + n, std::memory_order_relaxed);
+            heap[0].error.store(minCount, std::memory_order_relaxed);
+            position.set(key, 0);
+            siftDown(0);
+        }
+
+        // Count-Min gated add: a newcomer whose (over-)estimate cannot beat
+        // the current minimum would only churn the heap and be evicted again.
+        // Count-Min never under-counts, so no real heavy hitter is turned away.
+        void offer(uint64_t key, uint64_t estimate)
+        {
+            if (used.load(std::memory_order_relaxed) == capacity && estimate <= countAt(0) &&
+                !position.find(key))
+                return;
+            add(key);
+        }
+
+        // Readable from any thread (entries may be mid-update: treat as candidates)
+        void candidates(std::vector<Counter> &out) const
+        {
+            size_t n = std::min(used.load(std::memory_order_acquire), capacity);
+            for (size_t i = 0; i < n; ++i)
+                out.push_back({heap[i].key.load(std::memory_order_relaxed), countAt(i),
+                               heap[i].error.load(std::memory_order_relaxed)});
+        }
+    };
+
+    // ========================================================================
+    // HYPERLOGLOG
+    // ========================================================================
+
+    class HyperLogLog
+    {
+    public:
+        static constexpr int P = 12;
+        static constexpr size_t REGISTERS = size_t(1) << P;
+
+    private:
+        std::unique_ptr<std::atomic<uint8_t>[]> registers{new std::atomic<uint8_t>[REGISTERS]};
+
+    public:
+        HyperLogLog() { clear(); }
+
+        void clear()
+        {
+            for (size_t i = 0; i < REGISTERS; ++i)
+                registers[i].store(0, std::memory_order_relaxed);
+        }
+
+        void add(uint64_t hash)
+        {
+            size_t idx = hash >> (64 - P);
+            uint64_t rest = (hash << P) | (uint64_t(1) << (P - 1)); // sentinel bounds the rank
+            uint8_t rank = uint8_t(__builtin_clzll(rest) + 1);
+            if (rank > registers[idx].load(std::memory_order_relaxed))
+                registers[idx].store(rank, std::memory_order_relaxed);
+        }
+
+        void mergeInto(std::vector<uint8_t> &acc) const
+        {
+            acc.resize(REGISTERS);
+            for (size_t i = 0; i < REGISTERS; ++i)
+                acc[i] = std::max(acc[i], registers[i].load(std::memory_order_relaxed));
+        }
+
+        static double estimate(const std::vector<uint8_t> &regs)
+        {
+            double m = double(REGISTERS), sum = 0;
+            size_t zeros = 0;
+            for (uint8_t r : regs)
+            {
+                sum += std::ldexp(1.0, -int(r));
+                zeros += r == 0;
+            }
+            double alpha = 0.7213 / (1 + 1.079 / m);
+            double e = alpha * m * m / sum;
+            if (e <= 2.5 * m && zeros > 0)
+                return m * std::log(m / double(zeros)); // linear counting for small sets
+            return e;
+        }
+    };
+
+    // ========================================================================
+    // WINDOWED, PER-THREAD AGGREGATION
+    // ========================================================================
+
+    class TrafficAnalytics
+    {
+    public:
+        static constexpr size_t WINDOW_SLOTS = 8;
+        static constexpr size_t TOP_K_CAPACITY = 128;
+
+        struct HotKey
+        {
+            uint64_t key, estimate;
+        };
+
+        struct Report
+        {
+            std::vector<HotKey> top;
+            double distinct;
+            uint64_t events;
+        };
+
+    private:
+        struct WindowSketch
+        {
+            std::atomic<uint64_t> windowId{UINT64_MAX};
+            std::atomic<uint64_t> events{0};
+            CountMin counts;
+            SpaceSaving heavy{TOP_K_CAPACITY};
+            HyperLogLog distinct;
+
+            void reset(uint64_t id)
+            {
+                // Invalidate first so a concurrent reader's re-check fails. The
+                // fence orders the invalidation before the clears below: a release
+                // store alone would let them become visible ahead of it
+                windowId.store(UINT64_MAX, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                events.store(0, std::memory_order_relaxed);
+                counts.clear();
+                heavy.clear();
+                distinct.clear();
+                windowId.store(id, std::memory_order_release);
+            }
+        };
+
+        struct ThreadSketches
+        {
+            WindowSketch ring[WINDOW_SLOTS];
+        };
+
+        const uint64_t windowMicros;
+        std::mutex registryMutex; // taken only when a recorder is created
+        std::vector<std::unique_ptr<ThreadSketches>> owned;
+        static constexpr size_t MAX_RECORDERS = 256;
+        std::atomic<ThreadSketches *> recorders[MAX_RECORDERS] = {};
+        std::atomic<size_t> recorderCount{0};
+
+    public:
+        // One per worker thread; not shareable between threads
+        class Recorder
+        {
+        private:
+            ThreadSketches *mine;
+            uint64_t windowMicros;
+            uint64_t currentId = UINT64_MAX;
+            WindowSketch *current = nullptr;
+
+        public:
+            Recorder(ThreadSketches *s, uint64_t w) : mine(s), windowMicros(w) {}
+
+            void record(uint64_t client, uint64_t nowMicros)
+            {
+                uint64_t id = nowMicros / windowMicros;
+                if (id != currentId)
+                {
+                    current = &mine->ring[id % WINDOW_SLOTS];
+                    if (current->windowId.load(std::memory_order_relaxed) != id)
+                        current->reset(id);
+                    currentId = id;
+                }
+                uint64_t h = mix64(client);
+                bump(current->events, uint64_t(1));
+                current->counts.add(h);
+                current->heavy.offer(client, current->counts.estimate(h));
+                current->distinct.add(h);
+            }
+        };
+
+        explicit TrafficAnalytics(uint64_t windowMicros) : windowMicros(windowMicros) {}
+
+        Recorder recorder()
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            size_t n = recorderCount.load(std::memory_order_relaxed);
+            if (n == MAX_RECORDERS)
+                throw std::length_error("TrafficAnalytics: too many recorders");
+            owned.push_back(std::make_unique<ThreadSketches>());
+            recorders[n].store(owned.back().get(), std::memory_order_release);
+            recorderCount.store(n + 1, std::memory_order_release);
+            return Recorder(owned.back().get(), windowMicros);
+        }
+
+        // Merge windows (lastWindowId - windows, lastWindowId] over every recorder
+        Report query(uint64_t nowMicros, size_t windows, size_t k) const
+        {
+            uint64_t last = nowMicros / windowMicros;
+            uint64_t first = last + 1 >= windows ? last + 1 - windows : 0;
+
+            std::vector<uint64_t> cm(CountMin::DEPTH * CountMin::WIDTH, 0);
+            std::vector<uint8_t> hll(HyperLogLog::REGISTERS, 0);
+            std::vector<SpaceSaving::Counter> cands;
+            uint64_t events = 0;
+
+            size_t n = recorderCount.load(std::memory_order_acquire);
+            for (size_t r = 0; r < n; ++r)
+            {
+                const ThreadSketches *ts = recorders[r].load(std::memory_order_acquire);
+                for (const WindowSketch &w : ts->ring)
+                {
+                    uint64_t id = w.windowId.load(std::memory_order_acquire);
+                    if (id == UINT64_MAX || id < first || id > last)
+                        continue;
+                    // Merge into scratch first; keep it only if the slot was not reset meanwhile
+                    std::vector<uint64_t> cmPart(cm.size(), 0);
+                    std::vector<uint8_t> hllPart(hll.size(), 0);
+                    size_t candBefore = cands.size();
+                    uint64_t ev = w.events.load(std::memory_order_relaxed);
+                    w.counts.mergeInto(cmPart);
+                    w.distinct.mergeInto(hllPart);
+                    w.heavy.candidates(cands);
+                    // Pairs with the fence in reset(): if any load above saw a
+                    // clear, the re-check below sees the invalidation
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (w.windowId.load(std::memory_order_relaxed) != id)
+                    {
+                        cands.resize(candBefore);
+                        continue;
+                    }
+                    for (size_t i = 0; i < cm.size(); ++i)
+                        cm[i] += cmPart[i];
+                    for (size_t i = 0; i < hll.size(); ++i)
+                        hll[i] = std::max(hll[i], hllPart[i]);
+                    events += ev;
+                }
+            }
+
+            // Rank the union of candidates by the merged Count-Min estimate
+            std::unordered_set<uint64_t> seen;
+            Report report{{}, HyperLogLog::estimate(hll), events};
+            for (const auto &c : cands)
+                if (seen.insert(c.key).second)
+                    report.top.push_back({c.key, CountMin::estimate(cm, mix64(c.key))});
+            std::sort(report.top.begin(), report.top.end(),
+                      [](const HotKey &a, const HotKey &b)
+                      { return a.estimate > b.estimate; });
+            if (report.top.size() > k)
+                report.top.resize(k);
+            return report;
+        }
+    };
+}